@@ -0,0 +1,275 @@
+///
+/// \file     AdcCapture.c
+/// \brief    Raw ADC capture, for the probe characterization
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <string.h>
+#include "Arduino.h"
+#include "AdcCapture.h"
+#include "SystemTime.h"
+#include "WorkBudget.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oAdcCaptureBufTy
+/// \brief 	One frame buffer.
+///
+typedef struct
+{
+	UINT8		au8Data[ADCFRAME_SIZE_MAX];
+	UINT32		u32Size;				///< Frame size, 0 if the buffer is free.
+	UINT32		u32Pos;					///< Bytes already sent.
+	UINT16		u16Count;				///< Samples in the frame.
+} oAdcCaptureBufTy;
+
+///
+/// \struct	oAdcCaptureTy
+/// \brief 	AdcCapture object.
+///
+typedef struct
+{
+	bool					bActive;
+	UINT8					u8AdcPin;
+	UINT8					u8PowerPin;
+	bool					bPowerOn;			///< The probe is to be powered at the next burst.
+	AdcCaptureWriteFuncTy	pfWrite;
+	oAdcCaptureBufTy		aoBuf[2];
+	UINT8					u8Send;				///< Buffer being sent. The other one is filled.
+	UINT16					u16Sequence;		///< Of the next frame.
+	oAdcCaptureStatsTy		oStats;
+} oAdcCaptureTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void AdcCaptureBurst();
+static void AdcCapturePump(UINT32 u32Max);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oAdcCaptureTy oAdcCapture = {FALSE};
+
+MEMSTATS_REGISTER(AdcCapture, sizeof(oAdcCapture))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcCaptureStart - Starts a capture.
+/// \public
+/// \details	The probe is powered right before the first burst, which is
+///				flagged ADCFRAME_FLAG_POWER_ON: it holds the settling.
+///
+/// \param[in]	u8AdcPin	ADC input.
+/// \param[in]	u8PowerPin	Probe power output, ADCCAPTURE_NO_PIN if none.
+/// \param[in]	pfWrite		Frame output.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool AdcCaptureStart(UINT8 u8AdcPin, UINT8 u8PowerPin, AdcCaptureWriteFuncTy pfWrite)
+{
+	if (!pfWrite || oAdcCapture.bActive)
+	{
+		return FALSE;
+	}
+
+	memset(&oAdcCapture, 0, sizeof(oAdcCapture));
+	oAdcCapture.u8AdcPin				= u8AdcPin;
+	oAdcCapture.u8PowerPin				= u8PowerPin;
+	oAdcCapture.bPowerOn				= (u8PowerPin != ADCCAPTURE_NO_PIN);
+	oAdcCapture.pfWrite					= pfWrite;
+	oAdcCapture.oStats.u32StartTime		= SystemTimeGetTime();
+	oAdcCapture.bActive					= TRUE;
+
+	if (oAdcCapture.bPowerOn)
+	{
+		pinMode(u8PowerPin, OUTPUT);
+		digitalWrite(u8PowerPin, LOW);
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcCaptureStop - Stops the capture and the probe power.
+/// \public
+/// \details	A frame being sent is cut: the receiver drops it (CRC).
+////////////////////////////////////////////////////////////////////////////////
+void AdcCaptureStop()
+{
+	if (oAdcCapture.bActive && (oAdcCapture.u8PowerPin != ADCCAPTURE_NO_PIN))
+	{
+		digitalWrite(oAdcCapture.u8PowerPin, LOW);
+	}
+
+	oAdcCapture.bActive = FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcCaptureIsActive - Tells if a capture runs.
+/// \public
+///
+/// \return		TRUE if capturing.
+////////////////////////////////////////////////////////////////////////////////
+bool AdcCaptureIsActive()
+{
+	return oAdcCapture.bActive;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcCaptureTask - Sends what the output takes, then runs one
+///				burst.
+/// \public
+/// \details	Call it from loop(). Takes up to ADCCAPTURE_BURST_BUDGET.
+////////////////////////////////////////////////////////////////////////////////
+void AdcCaptureTask()
+{
+	if (!oAdcCapture.bActive)
+	{
+		return;
+	}
+
+	AdcCapturePump(ADCFRAME_SIZE_MAX);
+	AdcCaptureBurst();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcCaptureGetStats - Gets the statistics of the capture.
+/// \public
+///
+/// \return		Statistics, kept after AdcCaptureStop().
+////////////////////////////////////////////////////////////////////////////////
+const oAdcCaptureStatsTy* AdcCaptureGetStats()
+{
+	return &oAdcCapture.oStats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcCaptureBurst - Fills the free buffer with one burst.
+/// \details	A frame still waiting in that buffer is dropped: the newest
+///				samples are worth more than the oldest ones.
+////////////////////////////////////////////////////////////////////////////////
+static void AdcCaptureBurst()
+{
+	oAdcCaptureBufTy*	poBuf			= &oAdcCapture.aoBuf[oAdcCapture.u8Send ^ 1];
+	UINT8*				pu8Payload		= &poBuf->au8Data[ADCFRAME_HEADER_SIZE];
+	oAdcCaptureStatsTy*	poStats			= &oAdcCapture.oStats;
+	oAdcFrameTy			oFrame;
+	UINT32				u32SliceStart	= SystemTimeGetTime();
+	UINT32				u32Rate			= 0;
+	UINT16				u16Count		= 0;
+	UINT16				u16First		= 0;
+
+	if (poBuf->u32Size)
+	{
+		++poStats->u32Dropped;
+		poBuf->u32Size = 0;
+	}
+
+	oFrame.u8Flags = 0;
+	if (oAdcCapture.bPowerOn)
+	{
+		digitalWrite(oAdcCapture.u8PowerPin, HIGH);
+		oAdcCapture.bPowerOn	= FALSE;
+		oFrame.u8Flags			= ADCFRAME_FLAG_POWER_ON;
+	}
+
+	oFrame.u32Start = micros();
+	while (u16Count < ADCFRAME_SAMPLES_MAX)
+	{
+		u16First = (UINT16)analogRead(oAdcCapture.u8AdcPin);
+		AdcFramePackPair(pu8Payload, u16Count, u16First, (UINT16)analogRead(oAdcCapture.u8AdcPin));
+		u16Count += 2;
+
+		if ((u16Count % ADCCAPTURE_PUMP_PERIOD) == 0)
+		{
+			// Keep the UART busy, a little at a time.
+			AdcCapturePump(ADCCAPTURE_PUMP_CHUNK);
+
+			if (WorkBudgetIsExpired(u32SliceStart, ADCCAPTURE_BURST_BUDGET))
+			{
+				break;
+			}
+		}
+	}
+	oFrame.u32Duration = micros() - oFrame.u32Start;
+
+	oFrame.u16Sequence	= oAdcCapture.u16Sequence++;
+	oFrame.u16Count		= u16Count;
+	oFrame.u32Dropped	= poStats->u32Dropped;
+
+	poBuf->u32Size		= AdcFrameFinish(poBuf->au8Data, &oFrame);
+	poBuf->u32Pos		= 0;
+	poBuf->u16Count		= u16Count;
+
+	u32Rate = oFrame.u32Duration ? (UINT32)((UINT64)u16Count * 1000000 / oFrame.u32Duration) : 0;
+	if (!poStats->u32Bursts || (u32Rate < poStats->u32MinRate))
+	{
+		poStats->u32MinRate = u32Rate;
+	}
+	if (u32Rate > poStats->u32MaxRate)
+	{
+		poStats->u32MaxRate = u32Rate;
+	}
+	poStats->u32LastRate	= u32Rate;
+	poStats->u32Samples		+= u16Count;
+	++poStats->u32Bursts;
+
+	// Nothing in flight: send this one right away.
+	if (!oAdcCapture.aoBuf[oAdcCapture.u8Send].u32Size)
+	{
+		oAdcCapture.u8Send ^= 1;
+	}
+
+	WorkBudgetAccount(u32SliceStart, ADCCAPTURE_BURST_BUDGET, u16Count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcCapturePump - Hands the frame being sent to the output.
+///
+/// \param[in]	u32Max	Most bytes to hand now.
+////////////////////////////////////////////////////////////////////////////////
+static void AdcCapturePump(UINT32 u32Max)
+{
+	oAdcCaptureBufTy*	poBuf	= &oAdcCapture.aoBuf[oAdcCapture.u8Send];
+	UINT32				u32Len	= poBuf->u32Size - poBuf->u32Pos;
+
+	if (!poBuf->u32Size)
+	{
+		return;
+	}
+
+	if (u32Len > u32Max)
+	{
+		u32Len = u32Max;
+	}
+	poBuf->u32Pos += oAdcCapture.pfWrite(&poBuf->au8Data[poBuf->u32Pos], u32Len);
+
+	if (poBuf->u32Pos < poBuf->u32Size)
+	{
+		return;
+	}
+
+	++oAdcCapture.oStats.u32Frames;
+	oAdcCapture.oStats.u32SamplesSent += poBuf->u16Count;
+	poBuf->u32Size	= 0;
+	poBuf->u32Pos	= 0;
+
+	// The other buffer may hold a complete frame already.
+	if (oAdcCapture.aoBuf[oAdcCapture.u8Send ^ 1].u32Size)
+	{
+		oAdcCapture.u8Send ^= 1;
+	}
+}
@@ -0,0 +1,82 @@
+///
+/// \file     AdcCapture.h
+/// \brief    Raw ADC capture, for the probe characterization
+/// \details  Samples the ADC as fast as analogRead() allows, in bursts, and
+///           streams the raw samples in AdcFrame frames, instead of the one
+///           average per POLL_DELAY of the normal readings. tools/adcrecv
+///           writes the stream to disk.
+///
+///           - Double buffer: a burst fills one frame while the other one
+///             is sent. The serial output is topped up between samples, so
+///             the UART keeps sending during the burst.
+///           - A burst ends when its frame is full or after
+///             ADCCAPTURE_BURST_BUDGET, so loop() still yields often enough
+///             for the WiFi. The samples of a frame are consecutive, the
+///             frames are not.
+///           - When the output is slower than the ADC, a full frame still
+///             waiting when the next burst needs its buffer is dropped:
+///             counted, and its sequence number is skipped.
+///
+///           Meant for the bench: the moisture sensor state machine must
+///           not run meanwhile (the probe power is driven from here).
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef ADCCAPTURE_H
+#define ADCCAPTURE_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "AdcFrame.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define ADCCAPTURE_BURST_BUDGET     10          ///< Longest burst, in ms.
+#define ADCCAPTURE_PUMP_PERIOD      8           ///< Samples between two top-ups of the output during a burst.
+#define ADCCAPTURE_PUMP_CHUNK       16          ///< Largest top-up during a burst, in bytes (keeps the sampling jitter low).
+#define ADCCAPTURE_NO_PIN           0xFF        ///< No probe power pin.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Non-blocking output: takes what fits right now.
+///
+/// \return Number of bytes taken, possibly 0.
+///
+typedef UINT32 (*AdcCaptureWriteFuncTy)(const UINT8* pu8Data, UINT32 u32Size);
+
+///
+/// \struct	oAdcCaptureStatsTy
+/// \brief 	Instrumentation, since the start of the capture.
+///
+typedef struct
+{
+	UINT32		u32StartTime;			///< System time of the start, in ms.
+	UINT32		u32Bursts;
+	UINT32		u32Samples;				///< Samples taken.
+	UINT32		u32Frames;				///< Frames completely sent.
+	UINT32		u32SamplesSent;			///< Samples in the frames sent.
+	UINT32		u32Dropped;				///< Frames dropped (output too slow).
+	UINT32		u32LastRate;			///< Sample rate of the last burst, in samples/s.
+	UINT32		u32MinRate;
+	UINT32		u32MaxRate;
+} oAdcCaptureStatsTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool AdcCaptureStart(UINT8 u8AdcPin, UINT8 u8PowerPin, AdcCaptureWriteFuncTy pfWrite);
+void AdcCaptureStop();
+bool AdcCaptureIsActive();
+void AdcCaptureTask();
+const oAdcCaptureStatsTy* AdcCaptureGetStats();
+
+#endif
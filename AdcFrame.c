@@ -0,0 +1,171 @@
+///
+/// \file     AdcFrame.c
+/// \brief    Wire format of the raw ADC capture frames
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "AdcFrame.h"
+#include "Crc.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void AdcFramePut16(UINT8* pu8Buffer, UINT16 u16Value);
+static void AdcFramePut32(UINT8* pu8Buffer, UINT32 u32Value);
+static UINT16 AdcFrameGet16(const UINT8* pu8Buffer);
+static UINT32 AdcFrameGet32(const UINT8* pu8Buffer);
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcFramePackPair - Stores two consecutive samples.
+/// \public
+/// \details	Called in the sampling loop, so kept to a few operations.
+///
+/// \param[out]	pu8Payload	Samples area of the frame (ADCFRAME_HEADER_SIZE in).
+/// \param[in]	u16Index	Index of the first sample, even.
+/// \param[in]	u16First	Samples, 12 bits.
+/// \param[in]	u16Second
+////////////////////////////////////////////////////////////////////////////////
+void AdcFramePackPair(UINT8* pu8Payload, UINT16 u16Index, UINT16 u16First, UINT16 u16Second)
+{
+	UINT8* pu8Out = &pu8Payload[(u16Index >> 1) * 3];
+
+	pu8Out[0] = (UINT8)u16First;
+	pu8Out[1] = (UINT8)(((u16First >> 8) & 0x0F) | (u16Second << 4));
+	pu8Out[2] = (UINT8)(u16Second >> 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcFrameFinish - Writes the header and the CRC around the
+///				packed samples.
+/// \public
+///
+/// \param[in,out]	pu8Frame	Frame buffer, samples already packed.
+/// \param[in]		poFrame		Header. u16Count up to ADCFRAME_SAMPLES_MAX.
+///
+/// \return		Size of the frame, in bytes. 0 if the header is not valid.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 AdcFrameFinish(UINT8* pu8Frame, const oAdcFrameTy* poFrame)
+{
+	UINT32 u32Size = 0;
+
+	if (!pu8Frame || !poFrame || (poFrame->u16Count > ADCFRAME_SAMPLES_MAX))
+	{
+		return 0;
+	}
+
+	AdcFramePut16(&pu8Frame[0], ADCFRAME_MAGIC);
+	pu8Frame[2] = ADCFRAME_VERSION;
+	pu8Frame[3] = poFrame->u8Flags;
+	AdcFramePut16(&pu8Frame[4], poFrame->u16Sequence);
+	AdcFramePut16(&pu8Frame[6], poFrame->u16Count);
+	AdcFramePut32(&pu8Frame[8], poFrame->u32Start);
+	AdcFramePut32(&pu8Frame[12], poFrame->u32Duration);
+	AdcFramePut32(&pu8Frame[16], poFrame->u32Dropped);
+
+	u32Size = ADCFRAME_HEADER_SIZE + ADCFRAME_PACKED_SIZE(poFrame->u16Count);
+	AdcFramePut32(&pu8Frame[u32Size], Crc32(&pu8Frame[2], u32Size - 2));
+
+	return u32Size + ADCFRAME_CRC_SIZE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcFrameDecode - Parses a frame at the start of a buffer.
+/// \public
+///
+/// \param[in]	pu8Buffer		Received bytes, starting where a frame might.
+/// \param[in]	u32Size			Number of received bytes.
+/// \param[out]	poFrame			Decoded header.
+/// \param[out]	pu32FrameSize	Size of the frame, when ADCFRAME_OK.
+///
+/// \return		AdcFrameResultTy.
+////////////////////////////////////////////////////////////////////////////////
+AdcFrameResultTy AdcFrameDecode(const UINT8* pu8Buffer, UINT32 u32Size, poAdcFrameTy poFrame, UINT32* pu32FrameSize)
+{
+	UINT32 u32Payload = 0;
+
+	if (!pu8Buffer || !poFrame || !pu32FrameSize)
+	{
+		return ADCFRAME_INVALID;
+	}
+
+	// Reject as early as possible, so a scan does not wait for a whole
+	// "frame" that is not one.
+	if ((u32Size >= 1) && (pu8Buffer[0] != (UINT8)ADCFRAME_MAGIC)) return ADCFRAME_INVALID;
+	if ((u32Size >= 2) && (AdcFrameGet16(&pu8Buffer[0]) != ADCFRAME_MAGIC)) return ADCFRAME_INVALID;
+	if ((u32Size >= 3) && (pu8Buffer[2] != ADCFRAME_VERSION)) return ADCFRAME_INVALID;
+	if ((u32Size >= 8) && (AdcFrameGet16(&pu8Buffer[6]) > ADCFRAME_SAMPLES_MAX)) return ADCFRAME_INVALID;
+	if (u32Size < ADCFRAME_HEADER_SIZE) return ADCFRAME_INCOMPLETE;
+
+	poFrame->u8Flags		= pu8Buffer[3];
+	poFrame->u16Sequence	= AdcFrameGet16(&pu8Buffer[4]);
+	poFrame->u16Count		= AdcFrameGet16(&pu8Buffer[6]);
+	poFrame->u32Start		= AdcFrameGet32(&pu8Buffer[8]);
+	poFrame->u32Duration	= AdcFrameGet32(&pu8Buffer[12]);
+	poFrame->u32Dropped		= AdcFrameGet32(&pu8Buffer[16]);
+
+	u32Payload = ADCFRAME_HEADER_SIZE + ADCFRAME_PACKED_SIZE(poFrame->u16Count);
+	if (u32Size < u32Payload + ADCFRAME_CRC_SIZE)
+	{
+		return ADCFRAME_INCOMPLETE;
+	}
+
+	if (AdcFrameGet32(&pu8Buffer[u32Payload]) != Crc32(&pu8Buffer[2], u32Payload - 2))
+	{
+		return ADCFRAME_INVALID;
+	}
+
+	*pu32FrameSize = u32Payload + ADCFRAME_CRC_SIZE;
+
+	return ADCFRAME_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		AdcFrameGetSample - Reads one sample of a decoded frame.
+/// \public
+///
+/// \param[in]	pu8Frame	Frame, from its magic.
+/// \param[in]	u16Index	Sample index, below the sample count.
+///
+/// \return		Sample value.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 AdcFrameGetSample(const UINT8* pu8Frame, UINT16 u16Index)
+{
+	const UINT8* pu8In = &pu8Frame[ADCFRAME_HEADER_SIZE + (u16Index >> 1) * 3];
+
+	if (u16Index & 1)
+	{
+		return (UINT16)((pu8In[1] >> 4) | (pu8In[2] << 4));
+	}
+
+	return (UINT16)(pu8In[0] | ((pu8In[1] & 0x0F) << 8));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void AdcFramePut16(UINT8* pu8Buffer, UINT16 u16Value)
+{
+	pu8Buffer[0] = (UINT8)(u16Value);
+	pu8Buffer[1] = (UINT8)(u16Value >> 8);
+}
+
+static void AdcFramePut32(UINT8* pu8Buffer, UINT32 u32Value)
+{
+	AdcFramePut16(&pu8Buffer[0], (UINT16)(u32Value));
+	AdcFramePut16(&pu8Buffer[2], (UINT16)(u32Value >> 16));
+}
+
+static UINT16 AdcFrameGet16(const UINT8* pu8Buffer)
+{
+	return (UINT16)(pu8Buffer[0] | (pu8Buffer[1] << 8));
+}
+
+static UINT32 AdcFrameGet32(const UINT8* pu8Buffer)
+{
+	return (UINT32)AdcFrameGet16(&pu8Buffer[0]) | ((UINT32)AdcFrameGet16(&pu8Buffer[2]) << 16);
+}
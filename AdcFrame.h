@@ -0,0 +1,92 @@
+///
+/// \file     AdcFrame.h
+/// \brief    Wire format of the raw ADC capture frames
+/// \details  One frame carries one burst of consecutive ADC samples (see
+///           AdcCapture). The frames are sent back to back on the serial
+///           port, possibly mixed with console text, so each one starts with
+///           a magic and ends with a CRC-32 over everything after the magic:
+///           a receiver scans for the magic and resynchronizes after any
+///           corruption. Little endian. Shared by the firmware (encoding) and
+///           by tools/adcrecv (decoding), so this module must not depend on
+///           the hardware.
+///
+///           Offset  Size  Field
+///           0       2     Magic (ADCFRAME_MAGIC)
+///           2       1     Format version (ADCFRAME_VERSION)
+///           3       1     Flags (ADCFRAME_FLAG_xxx)
+///           4       2     Sequence number, also taken by the dropped frames
+///           6       2     Sample count (up to ADCFRAME_SAMPLES_MAX)
+///           8       4     Node time of the first sample, in us
+///           12      4     Burst duration, in us: the sample rate is
+///                         count * 10^6 / duration
+///           16      4     Frames dropped by the node since the start
+///           20      n     Samples, 12 bits each, two in three bytes:
+///                         a[7:0], b[3:0] a[11:8], b[11:4]
+///           20 + n  4     CRC-32 of the bytes 2 to 19 + n
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef ADCFRAME_H
+#define ADCFRAME_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define ADCFRAME_MAGIC          0x4341      ///< "AC" on the wire.
+#define ADCFRAME_VERSION        1           ///< Bump each time the layout changes.
+#define ADCFRAME_HEADER_SIZE    20          ///< Bytes before the samples.
+#define ADCFRAME_CRC_SIZE       4
+#define ADCFRAME_SAMPLES_MAX    512         ///< Largest burst.
+
+#define ADCFRAME_FLAG_POWER_ON  0x01        ///< The burst starts as the probe is powered.
+
+#define ADCFRAME_PACKED_SIZE(count)     ((UINT32)(((count) * 3 + 1) / 2))
+#define ADCFRAME_SIZE(count)            (ADCFRAME_HEADER_SIZE + ADCFRAME_PACKED_SIZE(count) + ADCFRAME_CRC_SIZE)
+#define ADCFRAME_SIZE_MAX               ADCFRAME_SIZE(ADCFRAME_SAMPLES_MAX)
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   AdcFrameResultTy
+/// \brief  Outcome of AdcFrameDecode().
+///
+typedef enum
+{
+	ADCFRAME_OK			= 0,	///< A valid frame.
+	ADCFRAME_INCOMPLETE,		///< Could be a frame, more bytes are needed.
+	ADCFRAME_INVALID,			///< Not a frame here: skip a byte and scan again.
+} AdcFrameResultTy;
+
+///
+/// \struct	oAdcFrameTy
+/// \brief 	Frame header.
+///
+typedef struct
+{
+	UINT8		u8Flags;				///< ADCFRAME_FLAG_xxx.
+	UINT16		u16Sequence;
+	UINT16		u16Count;				///< Samples in the frame.
+	UINT32		u32Start;				///< Node time of the first sample, in us.
+	UINT32		u32Duration;			///< Burst duration, in us.
+	UINT32		u32Dropped;				///< Frames dropped by the node so far.
+} oAdcFrameTy, *poAdcFrameTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+void AdcFramePackPair(UINT8* pu8Payload, UINT16 u16Index, UINT16 u16First, UINT16 u16Second);
+UINT32 AdcFrameFinish(UINT8* pu8Frame, const oAdcFrameTy* poFrame);
+AdcFrameResultTy AdcFrameDecode(const UINT8* pu8Buffer, UINT32 u32Size, poAdcFrameTy poFrame, UINT32* pu32FrameSize);
+UINT16 AdcFrameGetSample(const UINT8* pu8Frame, UINT16 u16Index);
+
+#endif
@@ -0,0 +1,492 @@
+///
+/// \file     BufPool.c
+/// \brief    Static pool of message buffers
+/// \details  The payload areas are UINT32 arrays, for the alignment. Each
+///           class keeps its free buffers in a singly linked list through
+///           poNext, so allocating and freeing are constant time.
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <string.h>
+#include "BufPool.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oBufPoolTy
+/// \brief 	BufPool object.
+///
+typedef struct
+{
+	bool			bIsInit;
+	UINT32			aau32Small[BUFPOOL_SMALL_COUNT][BUFPOOL_SMALL_SIZE / 4];
+	UINT32			aau32Medium[BUFPOOL_MEDIUM_COUNT][BUFPOOL_MEDIUM_SIZE / 4];
+	UINT32			aau32Large[BUFPOOL_LARGE_COUNT][BUFPOOL_LARGE_SIZE / 4];
+	oBufTy			aoBufs[BUFPOOL_BUFFERS];
+	poBufTy			apoFree[BUFPOOL_CLASSES];		///< Free list of each class.
+	oBufPoolStatsTy	oStats;
+} oBufPoolTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool BufPoolIsBuf(const oBufTy* poBuf);
+static void BufPoolFree(poBufTy poBuf);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oBufPoolTy oBufPool = {FALSE};
+
+static const UINT16 au16ClassSize[BUFPOOL_CLASSES]	= {BUFPOOL_SMALL_SIZE, BUFPOOL_MEDIUM_SIZE, BUFPOOL_LARGE_SIZE};
+static const UINT8 au8ClassCount[BUFPOOL_CLASSES]	= {BUFPOOL_SMALL_COUNT, BUFPOOL_MEDIUM_COUNT, BUFPOOL_LARGE_COUNT};
+
+MEMSTATS_REGISTER(BufPool, sizeof(oBufPool))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolInit - Puts every buffer in the pool and clears the
+///				counters.
+/// \public
+/// \details	Called once at boot, before any allocation (the first
+///				allocation does it otherwise). Buffers handed out before a
+///				second call are lost.
+///
+/// \return		TRUE if success.
+////////////////////////////////////////////////////////////////////////////////
+bool BufPoolInit()
+{
+	UINT8 u8Class	= 0;
+	UINT8 u8Idx		= 0;
+	UINT8 u8Buf		= 0;
+
+	memset(&oBufPool, 0, sizeof(oBufPool));
+
+	for (u8Class = 0; u8Class < BUFPOOL_CLASSES; ++u8Class)
+	{
+		oBufPool.oStats.aoClass[u8Class].u16Size	= au16ClassSize[u8Class];
+		oBufPool.oStats.aoClass[u8Class].u8Count	= au8ClassCount[u8Class];
+
+		for (u8Idx = 0; u8Idx < au8ClassCount[u8Class]; ++u8Idx, ++u8Buf)
+		{
+			poBufTy poBuf = &oBufPool.aoBufs[u8Buf];
+
+			switch (u8Class)
+			{
+			case 0:		poBuf->pu8Data = (UINT8*)oBufPool.aau32Small[u8Idx]; break;
+			case 1:		poBuf->pu8Data = (UINT8*)oBufPool.aau32Medium[u8Idx]; break;
+			default:	poBuf->pu8Data = (UINT8*)oBufPool.aau32Large[u8Idx]; break;
+			}
+			poBuf->u16Size	= au16ClassSize[u8Class];
+			poBuf->u8Class	= u8Class;
+
+			BufPoolFree(poBuf);
+		}
+
+		oBufPool.oStats.aoClass[u8Class].u8MinFree = oBufPool.oStats.aoClass[u8Class].u8Free;
+	}
+
+	oBufPool.bIsInit = TRUE;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolAlloc - Takes a buffer from the pool.
+/// \public
+/// \details	Smallest class of at least u16Size bytes, or a bigger one if
+///				that class is empty. The buffer comes with one reference, an
+///				empty payload and no next segment.
+///
+/// \param[in]	u16Size		Payload size needed, at most BUFPOOL_LARGE_SIZE.
+///
+/// \return		The buffer, NULL if none is free or u16Size is too big.
+////////////////////////////////////////////////////////////////////////////////
+poBufTy BufPoolAlloc(UINT16 u16Size)
+{
+	poBufTy	poBuf	= NULL;
+	UINT8	u8Class	= 0;
+	UINT8	u8Take	= 0;
+
+	if (!oBufPool.bIsInit)
+	{
+		BufPoolInit();
+	}
+
+	while ((u8Class < BUFPOOL_CLASSES) && (au16ClassSize[u8Class] < u16Size))
+	{
+		++u8Class;
+	}
+
+	if (u8Class == BUFPOOL_CLASSES)
+	{
+		++oBufPool.oStats.u32Failures;
+		goto END;
+	}
+
+	for (u8Take = u8Class; (u8Take < BUFPOOL_CLASSES) && !oBufPool.apoFree[u8Take]; ++u8Take);
+
+	if (u8Take == BUFPOOL_CLASSES)
+	{
+		++oBufPool.oStats.aoClass[u8Class].u32Failures;
+		++oBufPool.oStats.u32Failures;
+		goto END;
+	}
+
+	if (u8Take != u8Class)
+	{
+		++oBufPool.oStats.aoClass[u8Class].u32Fallbacks;
+	}
+
+	poBuf						= oBufPool.apoFree[u8Take];
+	oBufPool.apoFree[u8Take]	= poBuf->poNext;
+	poBuf->poNext				= NULL;
+	poBuf->u16Len				= 0;
+	poBuf->u8Ref				= 1;
+
+	++oBufPool.oStats.aoClass[u8Take].u32Allocs;
+	if (--oBufPool.oStats.aoClass[u8Take].u8Free < oBufPool.oStats.aoClass[u8Take].u8MinFree)
+	{
+		oBufPool.oStats.aoClass[u8Take].u8MinFree = oBufPool.oStats.aoClass[u8Take].u8Free;
+	}
+
+END:
+	return poBuf;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolAppend - Appends bytes to a chain.
+/// \public
+/// \details	Fills the last segment, then chains new ones (each new
+///				segment is referenced by the one before it). *ppoChain NULL
+///				starts a new chain. Meant for building a payload, before it is
+///				shared.
+///
+/// \param[in,out]	ppoChain	First segment of the chain.
+/// \param[in]		pu8Data		Bytes to append.
+/// \param[in]		u16Len		Number of bytes.
+///
+/// \return		TRUE if success, FALSE if out of buffers (the chain is left as
+///				it was).
+////////////////////////////////////////////////////////////////////////////////
+bool BufPoolAppend(poBufTy* ppoChain, const UINT8* pu8Data, UINT16 u16Len)
+{
+	bool	bRet		= FALSE;
+	poBufTy	poLast		= NULL;
+	poBufTy	poNew		= NULL;
+	poBufTy	poNewTail	= NULL;
+	poBufTy	poSeg		= NULL;
+	UINT16	u16LastLen	= 0;
+	UINT16	u16Part		= 0;
+
+	if (!ppoChain || (!pu8Data && u16Len)
+		|| ((UINT32)BufPoolChainLen(*ppoChain) + u16Len > 0xFFFF)) goto END;
+
+	for (poLast = *ppoChain; poLast && poLast->poNext; poLast = poLast->poNext);
+
+	if (poLast)
+	{
+		u16LastLen	= poLast->u16Len;
+		u16Part		= poLast->u16Size - poLast->u16Len;
+		if (u16Part > u16Len) u16Part = u16Len;
+
+		memcpy(&poLast->pu8Data[poLast->u16Len], pu8Data, u16Part);
+		poLast->u16Len	+= u16Part;
+		pu8Data			+= u16Part;
+		u16Len			-= u16Part;
+	}
+
+	while (u16Len)
+	{
+		u16Part	= (u16Len > BUFPOOL_LARGE_SIZE) ? BUFPOOL_LARGE_SIZE : u16Len;
+		poSeg	= BufPoolAlloc(u16Part);
+		if (!poSeg)
+		{
+			// Undo: the new segments hold each other, one release frees them.
+			BufPoolRelease(poNew);
+			if (poLast)
+			{
+				poLast->u16Len = u16LastLen;
+			}
+			goto END;
+		}
+
+		memcpy(poSeg->pu8Data, pu8Data, u16Part);
+		poSeg->u16Len	= u16Part;
+		pu8Data			+= u16Part;
+		u16Len			-= u16Part;
+
+		if (poNewTail)
+		{
+			poNewTail->poNext = poSeg;
+		}
+		else
+		{
+			poNew = poSeg;
+		}
+		poNewTail = poSeg;
+	}
+
+	if (poNew)
+	{
+		if (poLast)
+		{
+			poLast->poNext = poNew;
+		}
+		else
+		{
+			*ppoChain = poNew;
+		}
+	}
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolRef - Takes a reference on a buffer.
+/// \public
+/// \details	Like pbuf_ref(): the reference is on this segment, and through
+///				it on the rest of the chain.
+///
+/// \param[in]	poBuf	Buffer handed out by the pool. NULL is ignored.
+////////////////////////////////////////////////////////////////////////////////
+void BufPoolRef(poBufTy poBuf)
+{
+	if (!poBuf)
+	{
+		return;
+	}
+
+	if (!BufPoolIsBuf(poBuf) || (poBuf->u8Ref == 0) || (poBuf->u8Ref == BUFPOOL_REF_MAX))
+	{
+		++oBufPool.oStats.u32Misuses;
+		return;
+	}
+
+	++poBuf->u8Ref;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolRelease - Drops a reference.
+/// \public
+/// \details	Like pbuf_free(): a segment left without reference goes back
+///				to the pool and drops the reference it held on the next one,
+///				and so on down the chain.
+///
+/// \param[in]	poBuf	Buffer handed out by the pool. NULL is ignored.
+////////////////////////////////////////////////////////////////////////////////
+void BufPoolRelease(poBufTy poBuf)
+{
+	poBufTy poNext = NULL;
+
+	for (; poBuf; poBuf = poNext)
+	{
+		if (!BufPoolIsBuf(poBuf) || (poBuf->u8Ref == 0))
+		{
+			++oBufPool.oStats.u32Misuses;
+			return;
+		}
+
+		if (--poBuf->u8Ref)
+		{
+			return;
+		}
+
+		poNext = poBuf->poNext;
+		BufPoolFree(poBuf);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolChainLen - Payload length of a chain.
+/// \public
+///
+/// \return		Bytes in all the segments from poBuf.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 BufPoolChainLen(const oBufTy* poBuf)
+{
+	UINT32 u32Len = 0;
+
+	for (; poBuf; poBuf = poBuf->poNext)
+	{
+		u32Len += poBuf->u16Len;
+	}
+
+	return (u32Len > 0xFFFF) ? 0xFFFF : (UINT16)u32Len;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolCopyOut - Copies bytes out of a chain.
+/// \public
+///
+/// \param[in]	poBuf		First segment.
+/// \param[in]	u16Offset	Offset in the chain payload.
+/// \param[out]	pu8Dest		Destination.
+/// \param[in]	u16Len		Bytes to copy.
+///
+/// \return		Bytes copied, less than u16Len at the end of the chain.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 BufPoolCopyOut(const oBufTy* poBuf, UINT16 u16Offset, UINT8* pu8Dest, UINT16 u16Len)
+{
+	UINT16 u16Done = 0;
+	UINT16 u16Part = 0;
+
+	if (!pu8Dest)
+	{
+		return 0;
+	}
+
+	for (; poBuf && (u16Done < u16Len); poBuf = poBuf->poNext)
+	{
+		if (u16Offset >= poBuf->u16Len)
+		{
+			u16Offset -= poBuf->u16Len;
+			continue;
+		}
+
+		u16Part = poBuf->u16Len - u16Offset;
+		if (u16Part > u16Len - u16Done) u16Part = u16Len - u16Done;
+
+		memcpy(&pu8Dest[u16Done], &poBuf->pu8Data[u16Offset], u16Part);
+		u16Done		+= u16Part;
+		u16Offset	= 0;
+	}
+
+	return u16Done;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolGetStats - Occupancy and failure counters.
+/// \public
+///
+/// \return		TRUE if success.
+////////////////////////////////////////////////////////////////////////////////
+bool BufPoolGetStats(poBufPoolStatsTy poStats)
+{
+	if (!poStats)
+	{
+		return FALSE;
+	}
+
+	if (!oBufPool.bIsInit)
+	{
+		BufPoolInit();
+	}
+
+	memcpy(poStats, &oBufPool.oStats, sizeof(oBufPoolStatsTy));
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolInUse - Buffers handed out, all classes.
+/// \public
+///
+/// \return		Number of buffers out of the pool.
+////////////////////////////////////////////////////////////////////////////////
+UINT8 BufPoolInUse()
+{
+	UINT8 u8Class	= 0;
+	UINT8 u8Free	= 0;
+
+	if (!oBufPool.bIsInit)
+	{
+		return 0;
+	}
+
+	for (u8Class = 0; u8Class < BUFPOOL_CLASSES; ++u8Class)
+	{
+		u8Free += oBufPool.oStats.aoClass[u8Class].u8Free;
+	}
+
+	return BUFPOOL_BUFFERS - u8Free;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BufPoolFormatLine - Writes one line of the text report.
+/// \public
+/// \details	Same use as MemStatsFormatLine(): u8Line = 0, 1, 2... until it
+///				returns 0. Line 0 is the summary, then one line per class.
+///
+/// \param[in]	u8Line		Line number.
+/// \param[out]	pszBuffer	Destination, always NUL terminated.
+/// \param[in]	u16Size		Size of the destination.
+///
+/// \return		Length of the line (truncated to the buffer), 0 past the end.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 BufPoolFormatLine(UINT8 u8Line, char* pszBuffer, UINT16 u16Size)
+{
+	const oBufPoolClassTy*	poClass	= NULL;
+	UINT32					u32Fb	= 0;
+	UINT8					u8Class	= 0;
+	int						iLen	= 0;
+
+	if (!pszBuffer || !u16Size)
+	{
+		return 0;
+	}
+
+	if (!oBufPool.bIsInit)
+	{
+		BufPoolInit();
+	}
+
+	if (u8Line == 0)
+	{
+		for (u8Class = 0; u8Class < BUFPOOL_CLASSES; ++u8Class)
+		{
+			u32Fb += oBufPool.oStats.aoClass[u8Class].u32Fallbacks;
+		}
+
+		iLen = snprintf(pszBuffer, u16Size, "pool used %u/%u fail %lu fallback %lu misuse %lu",
+			BufPoolInUse(), BUFPOOL_BUFFERS, (unsigned long)oBufPool.oStats.u32Failures,
+			(unsigned long)u32Fb, (unsigned long)oBufPool.oStats.u32Misuses);
+	}
+	else if (u8Line <= BUFPOOL_CLASSES)
+	{
+		poClass	= &oBufPool.oStats.aoClass[u8Line - 1];
+		iLen	= snprintf(pszBuffer, u16Size, "pool %uB free %u/%u min %u alloc %lu fail %lu",
+			poClass->u16Size, poClass->u8Free, poClass->u8Count, poClass->u8MinFree,
+			(unsigned long)poClass->u32Allocs, (unsigned long)poClass->u32Failures);
+	}
+	else
+	{
+		pszBuffer[0] = '\0';
+	}
+
+	if (iLen < 0)
+	{
+		iLen = 0;
+		pszBuffer[0] = '\0';
+	}
+
+	return (iLen < u16Size) ? (UINT16)iLen : (UINT16)(u16Size - 1);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool BufPoolIsBuf(const oBufTy* poBuf)
+{
+	return (poBuf >= &oBufPool.aoBufs[0]) && (poBuf < &oBufPool.aoBufs[BUFPOOL_BUFFERS]);
+}
+
+static void BufPoolFree(poBufTy poBuf)
+{
+	poBuf->u8Ref	= 0;
+	poBuf->u16Len	= 0;
+	poBuf->poNext	= oBufPool.apoFree[poBuf->u8Class];
+	oBufPool.apoFree[poBuf->u8Class] = poBuf;
+	++oBufPool.oStats.aoClass[poBuf->u8Class].u8Free;
+}
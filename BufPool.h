@@ -0,0 +1,109 @@
+///
+/// \file     BufPool.h
+/// \brief    Static pool of message buffers
+/// \details  Fixed size classes of buffers reserved at build time, so the
+///           network payloads never go through the heap (which fragments
+///           over weeks of uptime).
+///
+///           - Allocation takes the smallest class that fits, then the
+///             bigger ones. Longer payloads are chained segments
+///             (BufPoolAppend()).
+///           - The buffers are reference counted like the lwIP pbufs: a
+///             reference is taken on the first segment (BufPoolRef()), and
+///             BufPoolRelease() frees the segments down the chain until one
+///             is still referenced. A report is encoded once and its buffer
+///             handed to the offline queue and to the socket, each one
+///             holding a reference.
+///           - Occupancy (with its low-water mark) and failures are counted
+///             per class, for the memory report and the soak tests.
+///
+///           Not reentrant: not to be used from interrupts (on the ESP8266
+///           loop() and the lwIP callbacks do not preempt each other). Does
+///           not depend on the hardware.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef BUFPOOL_H
+#define BUFPOOL_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define BUFPOOL_SMALL_SIZE      32          ///< Holds one report (COMMREPORT_SIZE).
+#define BUFPOOL_SMALL_COUNT     12
+#define BUFPOOL_MEDIUM_SIZE     128
+#define BUFPOOL_MEDIUM_COUNT    4
+#define BUFPOOL_LARGE_SIZE      512
+#define BUFPOOL_LARGE_COUNT     2
+#define BUFPOOL_CLASSES         3
+#define BUFPOOL_BUFFERS         (BUFPOOL_SMALL_COUNT + BUFPOOL_MEDIUM_COUNT + BUFPOOL_LARGE_COUNT)
+#define BUFPOOL_REF_MAX         0xFF
+#define BUFPOOL_LINE_MAX        64          ///< Longest line of BufPoolFormatLine(), with the NUL.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oBufTy
+/// \brief 	Buffer, or segment of a chain.
+///
+typedef struct oBufTy
+{
+	struct oBufTy*	poNext;				///< Next segment. In the pool: next free buffer of the class.
+	UINT8*			pu8Data;			///< Payload, 4 bytes aligned.
+	UINT16			u16Len;				///< Bytes used in this segment.
+	UINT16			u16Size;			///< Size of the payload area.
+	UINT8			u8Ref;				///< References, 0 in the pool.
+	UINT8			u8Class;
+} oBufTy, *poBufTy;
+
+///
+/// \struct	oBufPoolClassTy
+/// \brief 	Counters of a size class.
+///
+typedef struct
+{
+	UINT16		u16Size;				///< Payload size of the class.
+	UINT8		u8Count;				///< Buffers in the class.
+	UINT8		u8Free;					///< Buffers in the pool now.
+	UINT8		u8MinFree;				///< Lowest u8Free since the start.
+	UINT32		u32Allocs;				///< Buffers of this class handed out.
+	UINT32		u32Fallbacks;			///< Requests for this class served by a bigger one.
+	UINT32		u32Failures;			///< Requests for this class that found no buffer.
+} oBufPoolClassTy;
+
+///
+/// \struct	oBufPoolStatsTy
+/// \brief 	Pool counters.
+///
+typedef struct
+{
+	oBufPoolClassTy	aoClass[BUFPOOL_CLASSES];
+	UINT32			u32Failures;		///< Allocations that failed, all classes and oversize requests.
+	UINT32			u32Misuses;			///< References taken or dropped on a free buffer, or overflowing.
+} oBufPoolStatsTy, *poBufPoolStatsTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool     BufPoolInit();
+poBufTy  BufPoolAlloc(UINT16 u16Size);
+bool     BufPoolAppend(poBufTy* ppoChain, const UINT8* pu8Data, UINT16 u16Len);
+void     BufPoolRef(poBufTy poBuf);
+void     BufPoolRelease(poBufTy poBuf);
+UINT16   BufPoolChainLen(const oBufTy* poBuf);
+UINT16   BufPoolCopyOut(const oBufTy* poBuf, UINT16 u16Offset, UINT8* pu8Dest, UINT16 u16Len);
+bool     BufPoolGetStats(poBufPoolStatsTy poStats);
+UINT8    BufPoolInUse();
+UINT16   BufPoolFormatLine(UINT8 u8Line, char* pszBuffer, UINT16 u16Size);
+
+#endif
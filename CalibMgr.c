@@ -0,0 +1,183 @@
+///
+/// \file     CalibMgr.c
+/// \brief    Per-probe moisture calibration manager
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "CalibMgr.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static UINT8 aau8CalibTable[CALIBMGR_PROBE_MAX][CALIBMGR_LUT_SIZE];		///< Raw to % lookup tables.
+
+MEMSTATS_REGISTER(CalibMgr, sizeof(aau8CalibTable))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CalibMgrBuild - Compiles a calibration curve into the probe table.
+/// \public
+/// \details	Linear interpolation between the reference points, flat
+///				outside of them. Points may be given in any raw order and the
+///				percentages may decrease with the raw value (resistive probes
+///				read lower when wet).
+///
+/// \param[in]	u8Probe		Probe index.
+/// \param[in]	poCurve		Reference points. NULL or less than 2 points: use
+///							the map bounds.
+/// \param[in]	u16MapMax	Raw value mapped to 0 % when no curve is given.
+/// \param[in]	u16MapMin	Raw value mapped to 100 % when no curve is given.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool CalibMgrBuild(UINT8 u8Probe, const oCalibCurveTy* poCurve, UINT16 u16MapMax, UINT16 u16MapMin)
+{
+	oCalibCurveTy	oCurve;
+	UINT8*			pu8Table	= NULL;
+	UINT8			u8Seg		= 0;
+	UINT16			u16Raw		= 0;
+	INT32			i32Raw0		= 0;
+	INT32			i32Raw1		= 0;
+	INT32			i32Pct0		= 0;
+	INT32			i32Pct1		= 0;
+
+	if (u8Probe >= CALIBMGR_PROBE_MAX)
+	{
+		return FALSE;
+	}
+
+	if (poCurve && (poCurve->u8Count >= 2) && (poCurve->u8Count <= CALIBMGR_POINTS_MAX))
+	{
+		oCurve = *poCurve;
+	}
+	else
+	{
+		memset(&oCurve, 0, sizeof(oCurve));
+		CalibMgrCapturePoint(&oCurve, 0, u16MapMax);
+		CalibMgrCapturePoint(&oCurve, 100, u16MapMin);
+	}
+
+	pu8Table = aau8CalibTable[u8Probe];
+
+	for (u16Raw = 0; u16Raw < CALIBMGR_LUT_SIZE; ++u16Raw)
+	{
+		// Points are sorted by raw value: find the segment holding u16Raw.
+		while ((u8Seg + 2 < oCurve.u8Count) && (u16Raw >= oCurve.aoPoints[u8Seg + 1].u16Raw))
+		{
+			++u8Seg;
+		}
+
+		i32Raw0	= oCurve.aoPoints[u8Seg].u16Raw;
+		i32Raw1	= oCurve.aoPoints[u8Seg + 1].u16Raw;
+		i32Pct0	= oCurve.aoPoints[u8Seg].u8Percent;
+		i32Pct1	= oCurve.aoPoints[u8Seg + 1].u8Percent;
+
+		if ((u16Raw <= i32Raw0) || (i32Raw1 == i32Raw0))
+		{
+			pu8Table[u16Raw] = (UINT8)i32Pct0;
+		}
+		else if (u16Raw >= i32Raw1)
+		{
+			pu8Table[u16Raw] = (UINT8)i32Pct1;
+		}
+		else
+		{
+			// Rounded to the nearest %.
+			pu8Table[u16Raw] = (UINT8)(i32Pct0 + ((i32Pct1 - i32Pct0) * (u16Raw - i32Raw0) * 2 + (i32Raw1 - i32Raw0) * ((i32Pct1 >= i32Pct0) ? 1 : -1)) / ((i32Raw1 - i32Raw0) * 2));
+		}
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CalibMgrGetTable - Gets the lookup table of a probe.
+/// \public
+/// \details	Index with the raw ADC value (0 to CALIBMGR_LUT_SIZE - 1).
+///
+/// \return		The table, NULL if the probe index is invalid.
+////////////////////////////////////////////////////////////////////////////////
+const UINT8* CalibMgrGetTable(UINT8 u8Probe)
+{
+	if (u8Probe >= CALIBMGR_PROBE_MAX)
+	{
+		return NULL;
+	}
+
+	return aau8CalibTable[u8Probe];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CalibMgrCapturePoint - Adds a reference point to a curve.
+/// \public
+/// \details	Call it with the probe in a reference medium and the raw value
+///				averaged by the sensor manager. A point with the same
+///				percentage is replaced. The curve stays sorted by raw value.
+///				Rebuild the table (CalibMgrBuild) to use the new curve.
+///
+/// \param[in]	u8Percent	Moisture of the reference medium, in %.
+/// \param[in]	u16Raw		Raw value measured in it.
+///
+/// \return		TRUE if success, FALSE if invalid or the curve is full.
+////////////////////////////////////////////////////////////////////////////////
+bool CalibMgrCapturePoint(oCalibCurveTy* poCurve, UINT8 u8Percent, UINT16 u16Raw)
+{
+	UINT8 u8Idx = 0;
+
+	if (!poCurve || (u8Percent > 100) || (poCurve->u8Count > CALIBMGR_POINTS_MAX))
+	{
+		return FALSE;
+	}
+
+	// Remove a previous capture of the same reference.
+	for (u8Idx = 0; u8Idx < poCurve->u8Count; ++u8Idx)
+	{
+		if (poCurve->aoPoints[u8Idx].u8Percent == u8Percent)
+		{
+			memmove(&poCurve->aoPoints[u8Idx], &poCurve->aoPoints[u8Idx + 1], (poCurve->u8Count - u8Idx - 1) * sizeof(oCalibPointTy));
+			--poCurve->u8Count;
+			break;
+		}
+	}
+
+	if (poCurve->u8Count == CALIBMGR_POINTS_MAX)
+	{
+		return FALSE;
+	}
+
+	// Insertion sort by raw value.
+	for (u8Idx = poCurve->u8Count; (u8Idx > 0) && (poCurve->aoPoints[u8Idx - 1].u16Raw > u16Raw); --u8Idx)
+	{
+		poCurve->aoPoints[u8Idx] = poCurve->aoPoints[u8Idx - 1];
+	}
+
+	poCurve->aoPoints[u8Idx].u16Raw		= u16Raw;
+	poCurve->aoPoints[u8Idx].u8Percent	= u8Percent;
+	poCurve->aoPoints[u8Idx].u8Reserved	= 0;
+	++poCurve->u8Count;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CalibMgrClear - Removes all the reference points of a curve.
+/// \public
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool CalibMgrClear(oCalibCurveTy* poCurve)
+{
+	if (!poCurve)
+	{
+		return FALSE;
+	}
+
+	memset(poCurve, 0, sizeof(*poCurve));
+
+	return TRUE;
+}
@@ -0,0 +1,69 @@
+///
+/// \file     CalibMgr.h
+/// \brief    Per-probe moisture calibration manager
+/// \details  Each probe has a piecewise-linear curve defined by a few
+///           reference points (e.g. dry, field capacity, saturated). The
+///           curve is compiled once into a lookup table covering the whole
+///           ADC range, so converting a raw value is a single indexed load.
+///           A probe without reference points uses the configured MAP_MAX /
+///           MAP_MIN bounds as a two-point curve.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef CALIBMGR_H
+#define CALIBMGR_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define CALIBMGR_PROBE_MAX      1           ///< Probes per node (one ADC on the ESP8266).
+#define CALIBMGR_POINTS_MAX     6           ///< Reference points per probe.
+#define CALIBMGR_LUT_SIZE       1024        ///< Entries per table, one per ADC code.
+
+#define CALIBMGR_PCT_DRY        0           ///< Usual reference: dry soil.
+#define CALIBMGR_PCT_FIELD      60          ///< Usual reference: field capacity.
+#define CALIBMGR_PCT_SATURATED  100         ///< Usual reference: saturated soil.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oCalibPointTy
+/// \brief 	Reference point of a calibration curve.
+///
+typedef struct
+{
+	UINT16		u16Raw;									///< Raw ADC value measured at the reference.
+	UINT8		u8Percent;								///< Moisture of the reference, in %.
+	UINT8		u8Reserved;
+} oCalibPointTy;
+
+///
+/// \struct	oCalibCurveTy
+/// \brief 	Calibration curve of a probe, as stored in the configuration.
+///
+typedef struct
+{
+	UINT8			u8Count;							///< Number of valid points. 0: use the map bounds.
+	UINT8			au8Reserved[3];
+	oCalibPointTy	aoPoints[CALIBMGR_POINTS_MAX];		///< Reference points, sorted by raw value.
+} oCalibCurveTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool CalibMgrBuild(UINT8 u8Probe, const oCalibCurveTy* poCurve, UINT16 u16MapMax, UINT16 u16MapMin);
+const UINT8* CalibMgrGetTable(UINT8 u8Probe);
+bool CalibMgrCapturePoint(oCalibCurveTy* poCurve, UINT8 u8Percent, UINT16 u16Raw);
+bool CalibMgrClear(oCalibCurveTy* poCurve);
+
+#endif
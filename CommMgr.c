@@ -0,0 +1,475 @@
+// This is file has been prepared by a cog script.
+
+/// \file CommMgr.c
+/// \brief    Communication manager. Sends the reports to the gateway over UDP.
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "CommMgr.h"
+#include "MemStats.h"
+#include "ConfigMgr.h"
+#include "SystemTime.h"
+
+#ifdef ARDUINO_ARCH_ESP8266
+#include "user_interface.h"
+#include "osapi.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define COMM_PBUF_MAX       COMM_QUEUE_MAX  ///< Segments lent to lwIP at once.
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+#if defined(ARDUINO_ARCH_ESP8266) && LWIP_SUPPORT_CUSTOM_PBUF
+///
+/// \struct	oCommPbufTy
+/// \brief 	PBUF_REF over a BufPool segment, released by lwIP when done.
+///
+typedef struct
+{
+	struct pbuf_custom	oCustom;					///< First: lwIP hands it back as a struct pbuf*.
+	poBufTy				poBuf;						///< Segment referenced, NULL if the wrapper is free.
+} oCommPbufTy;
+#endif
+
+typedef struct
+{
+	bool			bIsConfigured;					///< Flag indicating that the module is configured or not.
+	UINT32			u32NodeId;						///< Node ID put in every report.
+	UINT32			u32Sequence;					///< Sequence number of the next report.
+	UINT8			u8BootId;						///< Tells the gateway the sequence restarted.
+	UINT32			u32SentCount;					///< Number of reports handed to the network stack.
+	UINT32			u32ErrorCount;					///< Number of send attempts that failed.
+	UINT32			u32DropCount;					///< Number of reports dropped from the full queue.
+	poBufTy			apoQueue[COMM_QUEUE_MAX];		///< Offline queue, oldest first from u8QueueHead.
+	UINT8			u8QueueHead;
+	UINT8			u8QueueCount;
+#ifdef ARDUINO_ARCH_ESP8266
+	struct udp_pcb*	poPcb;							///< UDP control block.
+	ip_addr_t		oGatewayAddr;					///< Gateway address.
+#if LWIP_SUPPORT_CUSTOM_PBUF
+	oCommPbufTy		aoPbufs[COMM_PBUF_MAX];
+#endif
+#endif
+	UINT16			u16GatewayPort;					///< Gateway UDP port.
+
+	// Uplink schedule.
+	oCommSchedTy	oSched;
+	bool			bBeaconPending;					///< oBeacon received, not applied yet.
+	oCommBeaconTy	oBeacon;						///< Last beacon received.
+	UINT32			u32BeaconTime;					///< System time of its reception.
+	UINT32			u32BeaconCount;					///< Valid beacons received.
+} oCommMgrTy;
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool CommMgrSend(poBufTy poBuf);
+static void CommMgrFlushQueue();
+
+#ifdef ARDUINO_ARCH_ESP8266
+static void CommMgrOnRecv(void* pvArg, struct udp_pcb* poPcb, struct pbuf* poBuf, const ip_addr_t* poAddr, u16_t u16Port);
+#if LWIP_SUPPORT_CUSTOM_PBUF
+static void CommMgrPbufFree(struct pbuf* poPbuf);
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+/// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oCommMgrTy oCommMgr = {FALSE};
+
+MEMSTATS_REGISTER(CommMgr, sizeof(oCommMgr))
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgr - Initializes the communication manager.
+/// \public
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool CommMgr()
+{
+	while (oCommMgr.u8QueueCount)
+	{
+		BufPoolRelease(oCommMgr.apoQueue[oCommMgr.u8QueueHead]);
+		oCommMgr.u8QueueHead = (oCommMgr.u8QueueHead + 1) % COMM_QUEUE_MAX;
+		--oCommMgr.u8QueueCount;
+	}
+
+	oCommMgr.bIsConfigured	= false;
+	oCommMgr.u32Sequence	= 0;
+	oCommMgr.u32SentCount	= 0;
+	oCommMgr.u32ErrorCount	= 0;
+	oCommMgr.u32DropCount	= 0;
+	oCommMgr.u8QueueHead	= 0;
+	oCommMgr.bBeaconPending	= false;
+	oCommMgr.u32BeaconCount	= 0;
+
+#ifdef ARDUINO_ARCH_ESP8266
+	oCommMgr.u32NodeId		= system_get_chip_id();
+	oCommMgr.u8BootId		= (UINT8)os_random();
+
+	// Called again when the boot stage is retried: the port must be free.
+	if (oCommMgr.poPcb)
+	{
+		udp_remove(oCommMgr.poPcb);
+		oCommMgr.poPcb = NULL;
+	}
+#else
+	oCommMgr.u32NodeId		= 0;
+	oCommMgr.u8BootId		= (UINT8)(oCommMgr.u8BootId + 1);
+#endif
+
+	// 0 is for the nodes without boot ID.
+	if (!oCommMgr.u8BootId)
+	{
+		oCommMgr.u8BootId = 1;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgrConfigure - Opens the UDP socket toward the gateway.
+/// \public
+/// \details	Must be called once the WiFi link is up. Called again after a
+///				change of the settings, the schedule restarts unsynchronized.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool CommMgrConfigure()
+{
+	bool			bRet		= false;
+	poConfigMgrTy	poConfig	= ConfigMgr();
+
+	if (!poConfig->bIsLoaded) goto END;
+
+	oCommMgr.u16GatewayPort = poConfig->oData.u16GatewayPort;
+
+	if (!CommSchedInit(&oCommMgr.oSched, poConfig->oData.u8SlotMode, poConfig->oData.u32SlotCycle,
+		poConfig->oData.u16SlotCount, poConfig->oData.u16Slot, oCommMgr.u32NodeId)) goto END;
+
+#ifdef ARDUINO_ARCH_ESP8266
+	{
+		UINT32 u32Ip = poConfig->oData.u32GatewayIp;
+
+		IP_ADDR4(&oCommMgr.oGatewayAddr, (u32Ip >> 24) & 0xFF, (u32Ip >> 16) & 0xFF, (u32Ip >> 8) & 0xFF, u32Ip & 0xFF);
+
+		if (!oCommMgr.poPcb)
+		{
+			oCommMgr.poPcb = udp_new();
+			if (!oCommMgr.poPcb) goto END;
+
+			ip_set_option(oCommMgr.poPcb, SOF_BROADCAST);
+
+			// Same socket for the beacons: reports go out from COMM_BEACON_PORT.
+			if (udp_bind(oCommMgr.poPcb, IP_ADDR_ANY, COMM_BEACON_PORT) != ERR_OK)
+			{
+				udp_remove(oCommMgr.poPcb);
+				oCommMgr.poPcb = NULL;
+				goto END;
+			}
+			udp_recv(oCommMgr.poPcb, CommMgrOnRecv, NULL);
+		}
+	}
+#endif
+
+	oCommMgr.bIsConfigured = true;
+
+	bRet = true;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgrTask - Periodic processing.
+/// \public
+/// \details	Retries the queued reports, and applies the last beacon
+///				received.
+////////////////////////////////////////////////////////////////////////////////
+void CommMgrTask()
+{
+	CommMgrFlushQueue();
+	CommSchedTrack(&oCommMgr.oSched, SystemTimeGetTime());
+
+	if (!oCommMgr.bBeaconPending)
+	{
+		return;
+	}
+
+	oCommMgr.bBeaconPending = false;
+
+	if (!CommSchedSync(&oCommMgr.oSched, oCommMgr.u32BeaconTime, oCommMgr.oBeacon.u32Cycle,
+		oCommMgr.oBeacon.u16SlotCount, oCommMgr.oBeacon.u32Phase))
+	{
+		return;
+	}
+
+	if (oCommMgr.oBeacon.u32NodeId && (oCommMgr.oBeacon.u32NodeId == oCommMgr.u32NodeId))
+	{
+		CommSchedAssign(&oCommMgr.oSched, oCommMgr.oBeacon.u16Slot);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgrIsReady - Checks if reports can be sent.
+/// \public
+///
+/// \return		TRUE if configured and the WiFi link is up.
+////////////////////////////////////////////////////////////////////////////////
+bool CommMgrIsReady()
+{
+	return oCommMgr.bIsConfigured && WifiMgrIsConnected();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgrSendReading - Sends the last processed result of a sensor.
+/// \public
+/// \details	The report is encoded in a pool buffer and queued behind the
+///				ones waiting, then the queue is sent as far as possible. While
+///				the link is down or the slot closed, it stays in the queue
+///				and CommMgrTask() sends it later.
+///
+/// \param[in]	poSensor	Sensor manager holding the result.
+///
+/// \return		TRUE if the report was sent or queued, FALSE if it could not
+///				be built (not configured, no buffer).
+////////////////////////////////////////////////////////////////////////////////
+bool CommMgrSendReading(poMoistSensorMgrTy poSensor)
+{
+	bool			bRet		= false;
+	oCommReportTy	oReport;
+	poBufTy			poBuf		= NULL;
+
+	if (!poSensor || !oCommMgr.bIsConfigured) goto END;
+
+	memset(&oReport, 0, sizeof(oReport));
+	oReport.u8Type			= COMMREPORT_TYPE_READING;
+	oReport.u32NodeId		= oCommMgr.u32NodeId;
+	oReport.u32Sequence		= oCommMgr.u32Sequence;
+	oReport.u32Timestamp	= SystemTimeGetTime();
+	oReport.u16RawValue		= poSensor->u16CurrentValueRaw;
+	oReport.u8CurrentValue	= poSensor->u8CurrentValue;
+	oReport.u8MinimumValue	= poSensor->u8MinimumValue;
+	oReport.u8MaximumValue	= poSensor->u8MaximumValue;
+	oReport.u8AverageValue	= poSensor->u8AverageValue;
+	oReport.u8Flags			= COMMREPORT_FLAGS(poSensor->u8Quality, poSensor->u8FaultCode);
+	oReport.u8BootId		= oCommMgr.u8BootId;
+
+	poBuf = BufPoolAlloc(COMMREPORT_SIZE);
+	if (!poBuf) goto END;
+
+	poBuf->u16Len = CommReportEncode(&oReport, poBuf->pu8Data, poBuf->u16Size);
+	if (poBuf->u16Len == 0)
+	{
+		BufPoolRelease(poBuf);
+		goto END;
+	}
+
+	++oCommMgr.u32Sequence;
+
+	// The queue takes over the reference of the allocation.
+	if (oCommMgr.u8QueueCount == COMM_QUEUE_MAX)
+	{
+		BufPoolRelease(oCommMgr.apoQueue[oCommMgr.u8QueueHead]);
+		oCommMgr.u8QueueHead = (oCommMgr.u8QueueHead + 1) % COMM_QUEUE_MAX;
+		--oCommMgr.u8QueueCount;
+		++oCommMgr.u32DropCount;
+	}
+	oCommMgr.apoQueue[(oCommMgr.u8QueueHead + oCommMgr.u8QueueCount) % COMM_QUEUE_MAX] = poBuf;
+	++oCommMgr.u8QueueCount;
+
+	CommMgrFlushQueue();
+
+	bRet = true;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgrGetStats - Gets the report counters.
+/// \public
+///
+/// \param[out]	poStats		Counters.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool CommMgrGetStats(poCommMgrStatsTy poStats)
+{
+	if (!poStats)
+	{
+		return false;
+	}
+
+	poStats->u32Sent	= oCommMgr.u32SentCount;
+	poStats->u32Errors	= oCommMgr.u32ErrorCount;
+	poStats->u32Dropped	= oCommMgr.u32DropCount;
+	poStats->u8Queued	= oCommMgr.u8QueueCount;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgrIsSlotOpen - Checks if the schedule allows a report now.
+/// \public
+///
+/// \return		TRUE in free mode, or within the slot of the node.
+////////////////////////////////////////////////////////////////////////////////
+bool CommMgrIsSlotOpen()
+{
+	return oCommMgr.bIsConfigured && CommSchedIsSlotOpen(&oCommMgr.oSched, SystemTimeGetTime());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgrGetReadingPhase - Reading times that give a fresh result
+///				at the slot.
+/// \public
+/// \details	To be passed to MoistSensorMgrSetPhase(). Changes with each
+///				beacon (clock drift) and slot assignment.
+///
+/// \param[in]	u32Duration		Duration of a reading, in ms.
+/// \param[out]	pu32Cycle		Cycle, in ms.
+/// \param[out]	pu32Start		System time of a reading start.
+///
+/// \return		TRUE when sending in a slot, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool CommMgrGetReadingPhase(UINT32 u32Duration, UINT32* pu32Cycle, UINT32* pu32Start)
+{
+	if (!oCommMgr.bIsConfigured || !CommSchedHasSlot(&oCommMgr.oSched) || !pu32Cycle || !pu32Start)
+	{
+		return false;
+	}
+
+	*pu32Cycle	= oCommMgr.oSched.u32Cycle;
+	*pu32Start	= CommSchedReadingStart(&oCommMgr.oSched, u32Duration);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommMgrGetSchedule - Current uplink schedule, for display.
+/// \public
+///
+/// \return		The schedule, NULL if not configured.
+////////////////////////////////////////////////////////////////////////////////
+const oCommSchedTy* CommMgrGetSchedule()
+{
+	return oCommMgr.bIsConfigured ? &oCommMgr.oSched : NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool CommMgrSend(poBufTy poBuf)
+{
+#ifdef ARDUINO_ARCH_ESP8266
+	bool			bRet	= false;
+	struct pbuf*	poHead	= NULL;
+#if LWIP_SUPPORT_CUSTOM_PBUF
+	struct pbuf*	poPart	= NULL;
+	oCommPbufTy*	poWrap	= NULL;
+	poBufTy			poSeg	= NULL;
+	UINT8			u8Idx	= 0;
+
+	// No copy: one PBUF_REF per segment, holding a reference on it until
+	// lwIP frees it (maybe after udp_sendto() returned).
+	for (poSeg = poBuf; poSeg; poSeg = poSeg->poNext)
+	{
+		for (u8Idx = 0, poWrap = NULL; (u8Idx < COMM_PBUF_MAX) && !poWrap; ++u8Idx)
+		{
+			if (!oCommMgr.aoPbufs[u8Idx].poBuf)
+			{
+				poWrap = &oCommMgr.aoPbufs[u8Idx];
+			}
+		}
+		if (!poWrap) goto END;
+
+		poWrap->oCustom.custom_free_function = CommMgrPbufFree;
+		poPart = pbuf_alloced_custom(PBUF_RAW, poSeg->u16Len, PBUF_REF, &poWrap->oCustom, poSeg->pu8Data, poSeg->u16Size);
+		if (!poPart) goto END;
+
+		BufPoolRef(poSeg);
+		poWrap->poBuf = poSeg;
+
+		if (poHead)
+		{
+			pbuf_cat(poHead, poPart);
+		}
+		else
+		{
+			poHead = poPart;
+		}
+	}
+#else
+	poHead = pbuf_alloc(PBUF_TRANSPORT, BufPoolChainLen(poBuf), PBUF_RAM);
+	if (!poHead) goto END;
+
+	BufPoolCopyOut(poBuf, 0, (UINT8*)poHead->payload, poHead->tot_len);
+#endif
+
+	bRet = (udp_sendto(oCommMgr.poPcb, poHead, &oCommMgr.oGatewayAddr, oCommMgr.u16GatewayPort) == ERR_OK);
+END:
+	if (poHead)
+	{
+		pbuf_free(poHead);
+	}
+	return bRet;
+#else
+	return HostArduinoUdpSend(poBuf);
+#endif
+}
+
+static void CommMgrFlushQueue()
+{
+	while (oCommMgr.u8QueueCount && CommMgrIsReady() && CommMgrIsSlotOpen())
+	{
+		if (!CommMgrSend(oCommMgr.apoQueue[oCommMgr.u8QueueHead]))
+		{
+			++oCommMgr.u32ErrorCount;
+			break;
+		}
+
+		++oCommMgr.u32SentCount;
+		BufPoolRelease(oCommMgr.apoQueue[oCommMgr.u8QueueHead]);
+		oCommMgr.u8QueueHead = (oCommMgr.u8QueueHead + 1) % COMM_QUEUE_MAX;
+		--oCommMgr.u8QueueCount;
+	}
+}
+
+#ifdef ARDUINO_ARCH_ESP8266
+static void CommMgrOnRecv(void* pvArg, struct udp_pcb* poPcb, struct pbuf* poBuf, const ip_addr_t* poAddr, u16_t u16Port)
+{
+	UINT8 au8Buffer[COMMREPORT_SIZE];
+
+	// Applied from CommMgrTask(), only the reception time matters here.
+	if ((poBuf->tot_len == COMMREPORT_SIZE)
+		&& (pbuf_copy_partial(poBuf, au8Buffer, COMMREPORT_SIZE, 0) == COMMREPORT_SIZE)
+		&& CommReportDecodeBeacon(au8Buffer, COMMREPORT_SIZE, &oCommMgr.oBeacon))
+	{
+		oCommMgr.u32BeaconTime	= SystemTimeGetTime();
+		oCommMgr.bBeaconPending	= true;
+		++oCommMgr.u32BeaconCount;
+	}
+
+	pbuf_free(poBuf);
+}
+#endif
+
+#if defined(ARDUINO_ARCH_ESP8266) && LWIP_SUPPORT_CUSTOM_PBUF
+static void CommMgrPbufFree(struct pbuf* poPbuf)
+{
+	oCommPbufTy* poWrap = (oCommPbufTy*)poPbuf;
+
+	BufPoolRelease(poWrap->poBuf);
+	poWrap->poBuf = NULL;
+}
+#endif
@@ -1,7 +1,16 @@
 // This is file has been prepared by a cog script.
 
 /// \file CommMgr.h
-/// \brief    DON'T FORGET TO DESCRIBE THE FILE HERE!
+/// \brief    Communication manager. Sends the reports to the gateway over UDP.
+/// \details  In slotted mode (see CommSched) the reports wait for the slot of
+///           the node, and the beacons of the gateway, received on
+///           COMM_BEACON_PORT, synchronize the cycle and assign the slot.
+///
+///           A report is encoded once, in a BufPool buffer, which goes to
+///           the offline queue and from there to the socket without copy.
+///           The reports that cannot be sent (link down, slot closed, send
+///           error) wait in the queue, the oldest is dropped when it is
+///           full, and are sent from CommMgrTask() once possible.
 /// \author   Infinition - Nicolas Bourré
 ///
 
@@ -13,14 +22,33 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "TypeDefs.h"
 #include "WifiMgr.h"
+#include "CommReport.h"
+#include "MoistSensorMgr.h"
+#include "CommSched.h"
+#include "BufPool.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
 ////////////////////////////////////////////////////////////////////////////////
+#define COMM_GATEWAY_IP     0xFFFFFFFFUL    ///< Default gateway address (broadcast), host byte order.
+#define COMM_GATEWAY_PORT   4210            ///< Default gateway UDP port.
+#define COMM_BEACON_PORT    4211            ///< UDP port the nodes receive the gateway beacons on.
+#define COMM_QUEUE_MAX      8               ///< Reports kept while they cannot be sent.
 
 ////////////////////////////////////////////////////////////////////////////////
 // Data types
 ////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oCommMgrStatsTy
+/// \brief 	Report counters.
+///
+typedef struct
+{
+	UINT32		u32Sent;				///< Reports handed to the network stack.
+	UINT32		u32Errors;				///< Send attempts that failed (retried).
+	UINT32		u32Dropped;				///< Reports dropped from the full queue.
+	UINT8		u8Queued;				///< Reports waiting now.
+} oCommMgrStatsTy, *poCommMgrStatsTy;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -28,5 +56,11 @@
 bool CommMgr();
 void CommMgrTask();
 bool CommMgrConfigure();
+bool CommMgrIsReady();
+bool CommMgrSendReading(poMoistSensorMgrTy poSensor);
+bool CommMgrGetStats(poCommMgrStatsTy poStats);
+bool CommMgrIsSlotOpen();
+bool CommMgrGetReadingPhase(UINT32 u32Duration, UINT32* pu32Cycle, UINT32* pu32Start);
+const oCommSchedTy* CommMgrGetSchedule();
 
 #endif
@@ -0,0 +1,172 @@
+///
+/// \file     CommReport.c
+/// \brief    Wire format of the reports sent by a node
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "CommReport.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void CommReportPut16(UINT8* pu8Buffer, UINT16 u16Value);
+static void CommReportPut32(UINT8* pu8Buffer, UINT32 u32Value);
+static UINT16 CommReportGet16(const UINT8* pu8Buffer);
+static UINT32 CommReportGet32(const UINT8* pu8Buffer);
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommReportEncode - Serializes a report.
+/// \public
+///
+/// \param[in]	poReport	Report to serialize.
+/// \param[out]	pu8Buffer	Destination buffer.
+/// \param[in]	u16Size		Size of the destination buffer.
+///
+/// \return		Number of bytes written, 0 if the buffer is too small.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 CommReportEncode(const oCommReportTy* poReport, UINT8* pu8Buffer, UINT16 u16Size)
+{
+	if (!poReport || !pu8Buffer || (u16Size < COMMREPORT_SIZE))
+	{
+		return 0;
+	}
+
+	CommReportPut16(&pu8Buffer[0], COMMREPORT_MAGIC);
+	pu8Buffer[2] = COMMREPORT_VERSION;
+	pu8Buffer[3] = poReport->u8Type;
+	CommReportPut32(&pu8Buffer[4], poReport->u32NodeId);
+	CommReportPut32(&pu8Buffer[8], poReport->u32Sequence);
+	CommReportPut32(&pu8Buffer[12], poReport->u32Timestamp);
+	CommReportPut16(&pu8Buffer[16], poReport->u16RawValue);
+	pu8Buffer[18] = poReport->u8CurrentValue;
+	pu8Buffer[19] = poReport->u8MinimumValue;
+	pu8Buffer[20] = poReport->u8MaximumValue;
+	pu8Buffer[21] = poReport->u8AverageValue;
+	pu8Buffer[22] = poReport->u8Flags;
+	pu8Buffer[23] = poReport->u8BootId;
+
+	return COMMREPORT_SIZE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommReportDecode - Parses a report.
+/// \public
+///
+/// \param[in]	pu8Buffer	Received datagram.
+/// \param[in]	u16Size		Size of the datagram.
+/// \param[out]	poReport	Decoded report.
+///
+/// \return		TRUE if the datagram is a valid report, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool CommReportDecode(const UINT8* pu8Buffer, UINT16 u16Size, oCommReportTy* poReport)
+{
+	if (!pu8Buffer || !poReport || (u16Size != COMMREPORT_SIZE)
+		|| (CommReportGet16(&pu8Buffer[0]) != COMMREPORT_MAGIC)
+		|| (pu8Buffer[2] != COMMREPORT_VERSION))
+	{
+		return FALSE;
+	}
+
+	poReport->u8Type			= pu8Buffer[3];
+	poReport->u32NodeId			= CommReportGet32(&pu8Buffer[4]);
+	poReport->u32Sequence		= CommReportGet32(&pu8Buffer[8]);
+	poReport->u32Timestamp		= CommReportGet32(&pu8Buffer[12]);
+	poReport->u16RawValue		= CommReportGet16(&pu8Buffer[16]);
+	poReport->u8CurrentValue	= pu8Buffer[18];
+	poReport->u8MinimumValue	= pu8Buffer[19];
+	poReport->u8MaximumValue	= pu8Buffer[20];
+	poReport->u8AverageValue	= pu8Buffer[21];
+	poReport->u8Flags			= pu8Buffer[22];
+	poReport->u8BootId			= pu8Buffer[23];
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommReportEncodeBeacon - Serializes a beacon.
+/// \public
+///
+/// \param[in]	poBeacon	Beacon to serialize.
+/// \param[out]	pu8Buffer	Destination buffer.
+/// \param[in]	u16Size		Size of the destination buffer.
+///
+/// \return		Number of bytes written, 0 if the buffer is too small.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 CommReportEncodeBeacon(const oCommBeaconTy* poBeacon, UINT8* pu8Buffer, UINT16 u16Size)
+{
+	if (!poBeacon || !pu8Buffer || (u16Size < COMMREPORT_SIZE))
+	{
+		return 0;
+	}
+
+	CommReportPut16(&pu8Buffer[0], COMMREPORT_MAGIC);
+	pu8Buffer[2] = COMMREPORT_VERSION;
+	pu8Buffer[3] = COMMREPORT_TYPE_BEACON;
+	CommReportPut32(&pu8Buffer[4], poBeacon->u32NodeId);
+	CommReportPut32(&pu8Buffer[8], poBeacon->u32Cycle);
+	CommReportPut32(&pu8Buffer[12], poBeacon->u32Phase);
+	CommReportPut16(&pu8Buffer[16], poBeacon->u16SlotCount);
+	CommReportPut16(&pu8Buffer[18], poBeacon->u16Slot);
+	CommReportPut32(&pu8Buffer[20], 0);
+
+	return COMMREPORT_SIZE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommReportDecodeBeacon - Parses a beacon.
+/// \public
+///
+/// \param[in]	pu8Buffer	Received datagram.
+/// \param[in]	u16Size		Size of the datagram.
+/// \param[out]	poBeacon	Decoded beacon.
+///
+/// \return		TRUE if the datagram is a valid beacon, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool CommReportDecodeBeacon(const UINT8* pu8Buffer, UINT16 u16Size, oCommBeaconTy* poBeacon)
+{
+	if (!pu8Buffer || !poBeacon || (u16Size != COMMREPORT_SIZE)
+		|| (CommReportGet16(&pu8Buffer[0]) != COMMREPORT_MAGIC)
+		|| (pu8Buffer[2] != COMMREPORT_VERSION)
+		|| (pu8Buffer[3] != COMMREPORT_TYPE_BEACON))
+	{
+		return FALSE;
+	}
+
+	poBeacon->u32NodeId		= CommReportGet32(&pu8Buffer[4]);
+	poBeacon->u32Cycle		= CommReportGet32(&pu8Buffer[8]);
+	poBeacon->u32Phase		= CommReportGet32(&pu8Buffer[12]);
+	poBeacon->u16SlotCount	= CommReportGet16(&pu8Buffer[16]);
+	poBeacon->u16Slot		= CommReportGet16(&pu8Buffer[18]);
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void CommReportPut16(UINT8* pu8Buffer, UINT16 u16Value)
+{
+	pu8Buffer[0] = (UINT8)(u16Value);
+	pu8Buffer[1] = (UINT8)(u16Value >> 8);
+}
+
+static void CommReportPut32(UINT8* pu8Buffer, UINT32 u32Value)
+{
+	CommReportPut16(&pu8Buffer[0], (UINT16)(u32Value));
+	CommReportPut16(&pu8Buffer[2], (UINT16)(u32Value >> 16));
+}
+
+static UINT16 CommReportGet16(const UINT8* pu8Buffer)
+{
+	return (UINT16)(pu8Buffer[0] | (pu8Buffer[1] << 8));
+}
+
+static UINT32 CommReportGet32(const UINT8* pu8Buffer)
+{
+	return CommReportGet16(&pu8Buffer[0]) | ((UINT32)CommReportGet16(&pu8Buffer[2]) << 16);
+}
@@ -0,0 +1,113 @@
+///
+/// \file     CommReport.h
+/// \brief    Wire format of the reports sent by a node
+/// \details  A report is a fixed size little endian datagram. The format is
+///           shared by the firmware (encoding) and by the host tools
+///           (decoding), so this module must not depend on the hardware.
+///
+///           Offset  Size  Field
+///           0       2     Magic (COMMREPORT_MAGIC)
+///           2       1     Format version (COMMREPORT_VERSION)
+///           3       1     Report type (CommReportTypeTy)
+///           4       4     Node ID
+///           8       4     Sequence number
+///           12      4     Node time stamp of the reading, in ms
+///           16      2     Raw ADC value
+///           18      1     Current value, in %
+///           19      1     Minimum value, in %
+///           20      1     Maximum value, in %
+///           21      1     Average value, in %
+///           22      1     Flags: quality (bits 0-1), fault code (bits 2-7)
+///           23      1     Boot ID, changes when the sequence restarts (0: unknown)
+///
+///           The gateway sends beacons to the nodes (COMMREPORT_TYPE_BEACON,
+///           same size, header and version):
+///
+///           Offset  Size  Field
+///           4       4     Node ID of the slot assignment, 0 if none
+///           8       4     Reporting cycle, in ms
+///           12      4     Time since the cycle start at the sending, in ms
+///           16      2     Slots per cycle
+///           18      2     Assigned slot (ignored if no node ID)
+///           20      4     Reserved (0)
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef COMMREPORT_H
+#define COMMREPORT_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define COMMREPORT_MAGIC        0x534D      ///< "MS" on the wire.
+#define COMMREPORT_VERSION      1           ///< Bump each time the layout changes.
+#define COMMREPORT_SIZE         24          ///< Size of an encoded report, in bytes.
+
+// Flags byte: bits 0-1 quality, bits 2-7 fault code (see SensorHealth.h).
+#define COMMREPORT_FLAGS(quality, fault)    ((UINT8)(((quality) & 0x03) | (((fault) & 0x3F) << 2)))
+#define COMMREPORT_FLAGS_QUALITY(flags)     ((flags) & 0x03)
+#define COMMREPORT_FLAGS_FAULT(flags)       (((flags) >> 2) & 0x3F)
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   CommReportTypeTy
+/// \brief  Report types.
+///
+typedef enum
+{
+	COMMREPORT_TYPE_READING	= 1,	///< Moisture reading.
+	COMMREPORT_TYPE_BEACON	= 2,	///< Cycle synchronization and slot assignment (see CommSched).
+} CommReportTypeTy;
+
+///
+/// \struct	oCommReportTy
+/// \brief 	Decoded report.
+///
+typedef struct
+{
+	UINT8		u8Type;					///< CommReportTypeTy.
+	UINT32		u32NodeId;				///< Unique node ID (chip ID).
+	UINT32		u32Sequence;			///< Incremented for each new report, not for retransmits.
+	UINT32		u32Timestamp;			///< Node time stamp of the reading, in ms.
+	UINT16		u16RawValue;			///< Raw ADC value.
+	UINT8		u8CurrentValue;			///< Current value, in %.
+	UINT8		u8MinimumValue;			///< Minimum value, in %.
+	UINT8		u8MaximumValue;			///< Maximum value, in %.
+	UINT8		u8AverageValue;			///< Average value, in %.
+	UINT8		u8Flags;				///< Flags, see COMMREPORT_FLAGS().
+	UINT8		u8BootId;				///< Random at each start of the sequence, never 0. 0: unknown (older nodes).
+} oCommReportTy, *poCommReportTy;
+
+///
+/// \struct	oCommBeaconTy
+/// \brief 	Decoded beacon.
+///
+typedef struct
+{
+	UINT32		u32NodeId;				///< Node of the slot assignment, 0 for a synchronization only.
+	UINT32		u32Cycle;				///< Reporting cycle, in ms.
+	UINT32		u32Phase;				///< Time since the cycle start at the sending, in ms.
+	UINT16		u16SlotCount;			///< Slots per cycle.
+	UINT16		u16Slot;				///< Slot assigned to u32NodeId.
+} oCommBeaconTy, *poCommBeaconTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+UINT16 CommReportEncode(const oCommReportTy* poReport, UINT8* pu8Buffer, UINT16 u16Size);
+bool CommReportDecode(const UINT8* pu8Buffer, UINT16 u16Size, oCommReportTy* poReport);
+UINT16 CommReportEncodeBeacon(const oCommBeaconTy* poBeacon, UINT8* pu8Buffer, UINT16 u16Size);
+bool CommReportDecodeBeacon(const UINT8* pu8Buffer, UINT16 u16Size, oCommBeaconTy* poBeacon);
+
+#endif
@@ -0,0 +1,267 @@
+///
+/// \file     CommSched.c
+/// \brief    Time-slotted uplink schedule
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <string.h>
+#include "CommSched.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static UINT32 CommSchedSlotStart(const oCommSchedTy* poSched);
+static UINT32 CommSchedCycleOffset(const oCommSchedTy* poSched, UINT32 u32Now);
+static bool CommSchedIsValid(UINT32 u32Cycle, UINT16 u16SlotCount);
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedInit - Sets up the schedule of a node.
+/// \public
+/// \details	Until the first beacon, the cycle starts on the local clock.
+///
+/// \param[in]	u8Mode			CommSchedModeTy.
+/// \param[in]	u32Cycle		Cycle length, in ms.
+/// \param[in]	u16SlotCount	Slots per cycle.
+/// \param[in]	u16Slot			Slot of the node, COMMSCHED_SLOT_AUTO to derive it.
+/// \param[in]	u32NodeId		Node ID, for the derived slot.
+///
+/// \return		TRUE if success, FALSE if the settings are not valid.
+////////////////////////////////////////////////////////////////////////////////
+bool CommSchedInit(poCommSchedTy this, UINT8 u8Mode, UINT32 u32Cycle, UINT16 u16SlotCount, UINT16 u16Slot, UINT32 u32NodeId)
+{
+	bool bRet = FALSE;
+
+	if (!this || (u8Mode >= COMMSCHED_MODE_MAX) || !CommSchedIsValid(u32Cycle, u16SlotCount)) goto END;
+	if ((u16Slot != COMMSCHED_SLOT_AUTO) && (u16Slot >= u16SlotCount)) goto END;
+
+	memset(this, 0, sizeof(*this));
+	this->u8Mode			= u8Mode;
+	this->u32Cycle			= u32Cycle;
+	this->u16SlotCount		= u16SlotCount;
+	this->u16SlotConfig		= u16Slot;
+	this->u32NodeId			= u32NodeId;
+	this->u16Slot			= (u16Slot == COMMSCHED_SLOT_AUTO) ? CommSchedDeriveSlot(u32NodeId, u16SlotCount) : u16Slot;
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedDeriveSlot - Slot of a node without configuration.
+/// \public
+/// \details	Spreads the chip IDs, which are far from uniform, over the
+///				slots. Two nodes can still get the same slot, so it is only
+///				a starting point: the node sends in free mode until the
+///				gateway assigns its slot.
+///
+/// \return		Slot, below u16SlotCount.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 CommSchedDeriveSlot(UINT32 u32NodeId, UINT16 u16SlotCount)
+{
+	// Murmur3 finalizer.
+	u32NodeId ^= u32NodeId >> 16;
+	u32NodeId *= 0x85EBCA6BUL;
+	u32NodeId ^= u32NodeId >> 13;
+	u32NodeId *= 0xC2B2AE35UL;
+	u32NodeId ^= u32NodeId >> 16;
+
+	return u16SlotCount ? (UINT16)(u32NodeId % u16SlotCount) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedSync - Anchors the cycle on a gateway beacon.
+/// \public
+/// \details	The cycle and the slot count of the gateway replace the
+///				configured ones. A slot assigned for another slot count is
+///				dropped.
+///
+/// \param[in]	u32Now			Local time of the reception.
+/// \param[in]	u32Cycle		Cycle length of the gateway, in ms.
+/// \param[in]	u16SlotCount	Slots per cycle of the gateway.
+/// \param[in]	u32Phase		Time since the cycle start when the beacon was sent, in ms.
+///
+/// \return		TRUE if the beacon was applied.
+////////////////////////////////////////////////////////////////////////////////
+bool CommSchedSync(poCommSchedTy this, UINT32 u32Now, UINT32 u32Cycle, UINT16 u16SlotCount, UINT32 u32Phase)
+{
+	bool	bRet		= FALSE;
+	UINT32	u32Anchor	= 0;
+	UINT32	u32Move		= 0;
+
+	if (!this || !CommSchedIsValid(u32Cycle, u16SlotCount) || (u32Phase >= u32Cycle)) goto END;
+
+	u32Anchor = u32Now - u32Phase;
+
+	if ((u32Cycle != this->u32Cycle) || (u16SlotCount != this->u16SlotCount))
+	{
+		this->u32Cycle		= u32Cycle;
+		this->u16SlotCount	= u16SlotCount;
+		this->bAssigned		= FALSE;
+		this->u16Slot		= ((this->u16SlotConfig != COMMSCHED_SLOT_AUTO) && (this->u16SlotConfig < u16SlotCount))
+							? this->u16SlotConfig : CommSchedDeriveSlot(this->u32NodeId, u16SlotCount);
+		this->i32LastCorrection = 0;
+	}
+	else if (this->bSynced)
+	{
+		// Shortest move of the cycle start, either way.
+		u32Move = (u32Anchor - this->u32Anchor) % u32Cycle;
+		this->i32LastCorrection = (u32Move > u32Cycle / 2) ? -(INT32)(u32Cycle - u32Move) : (INT32)u32Move;
+	}
+
+	this->u32Anchor	= u32Anchor;
+	this->bSynced	= TRUE;
+	++this->u32Syncs;
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedAssign - Applies a slot assigned by the gateway.
+/// \public
+///
+/// \return		TRUE if the slot exists in the current cycle.
+////////////////////////////////////////////////////////////////////////////////
+bool CommSchedAssign(poCommSchedTy this, UINT16 u16Slot)
+{
+	if (!this || (u16Slot >= this->u16SlotCount))
+	{
+		return FALSE;
+	}
+
+	this->u16Slot	= u16Slot;
+	this->bAssigned	= TRUE;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedHasSlot - Checks if the node sends in a slot.
+/// \public
+///
+/// \return		TRUE in slotted mode with a configured or assigned slot.
+////////////////////////////////////////////////////////////////////////////////
+bool CommSchedHasSlot(const oCommSchedTy* this)
+{
+	return (this->u8Mode == COMMSCHED_MODE_SLOTTED) && (this->bAssigned || (this->u16SlotConfig != COMMSCHED_SLOT_AUTO));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedIsSlotOpen - Checks if the node may transmit now.
+/// \public
+///
+/// \return		TRUE without a slot (see CommSchedHasSlot()), or within the
+///				slot of the node.
+////////////////////////////////////////////////////////////////////////////////
+bool CommSchedIsSlotOpen(const oCommSchedTy* this, UINT32 u32Now)
+{
+	UINT32 u32Offset = 0;
+	UINT32 u32Start	= 0;
+
+	if (!CommSchedHasSlot(this))
+	{
+		return TRUE;
+	}
+
+	u32Offset	= CommSchedCycleOffset(this, u32Now);
+	u32Start	= CommSchedSlotStart(this);
+
+	return (u32Offset >= u32Start) && (u32Offset < u32Start + this->u32Cycle / this->u16SlotCount - COMMSCHED_GUARD);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedTimeToSlot - Time until the node may transmit.
+/// \public
+///
+/// \return		0 if the slot is open (or in free mode), else the time until
+///				its next start, in ms.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 CommSchedTimeToSlot(const oCommSchedTy* this, UINT32 u32Now)
+{
+	if (CommSchedIsSlotOpen(this, u32Now))
+	{
+		return 0;
+	}
+
+	return (CommSchedSlotStart(this) + this->u32Cycle - CommSchedCycleOffset(this, u32Now)) % this->u32Cycle;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedReadingStart - When to start a reading for a fresh
+///				result at the slot.
+/// \public
+/// \details	The result is published COMMSCHED_READING_MARGIN before the
+///				slot opens. Any time congruent to the returned one modulo the
+///				cycle is as good (see MoistSensorMgrSetPhase).
+///
+/// \param[in]	u32Duration		Duration of a reading, in ms.
+///
+/// \return		Local time of a reading start.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 CommSchedReadingStart(const oCommSchedTy* this, UINT32 u32Duration)
+{
+	return this->u32Anchor + CommSchedSlotStart(this) - u32Duration - COMMSCHED_READING_MARGIN;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		CommSchedTrack - Keeps the anchor within a cycle of the time.
+/// \public
+/// \details	Moves the anchor by whole cycles: the phase does not change,
+///				and the offsets stay exact for any uptime, beacons or not
+///				(before the first one, the anchor is the zero of the local
+///				clock). Call it from the periodic task.
+///
+/// \param[in]	u32Now		Local time, in ms.
+////////////////////////////////////////////////////////////////////////////////
+void CommSchedTrack(poCommSchedTy this, UINT32 u32Now)
+{
+	UINT32 u32Delta = 0;
+
+	if (!this || !this->u32Cycle)
+	{
+		return;
+	}
+
+	// Unsigned: exact across the wrap-around as long as it runs at least
+	// once every 49 days.
+	u32Delta = u32Now - this->u32Anchor;
+	if (u32Delta >= this->u32Cycle)
+	{
+		this->u32Anchor += u32Delta - u32Delta % this->u32Cycle;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static UINT32 CommSchedSlotStart(const oCommSchedTy* this)
+{
+	return (UINT32)((UINT64)this->u16Slot * this->u32Cycle / this->u16SlotCount);
+}
+
+static UINT32 CommSchedCycleOffset(const oCommSchedTy* this, UINT32 u32Now)
+{
+	// Signed: a reading aligned on slot 0 ends before the cycle start.
+	// Exact within 24 days of the anchor, across the wrap-around of the
+	// system time; CommSchedTrack() keeps it within a cycle.
+	INT32 i32Delta = (INT32)(u32Now - this->u32Anchor);
+
+	if (i32Delta >= 0)
+	{
+		return (UINT32)i32Delta % this->u32Cycle;
+	}
+
+	return (this->u32Cycle - (UINT32)(-i32Delta) % this->u32Cycle) % this->u32Cycle;
+}
+
+static bool CommSchedIsValid(UINT32 u32Cycle, UINT16 u16SlotCount)
+{
+	return u16SlotCount && (u32Cycle / u16SlotCount >= COMMSCHED_SLOT_WIDTH_MIN);
+}
@@ -0,0 +1,100 @@
+///
+/// \file     CommSched.h
+/// \brief    Time-slotted uplink schedule
+/// \details  Splits a reporting cycle shared by all the nodes into slots and
+///           gives each node one slot to transmit in, so that nodes booted at
+///           the same time (e.g. after a power cut) do not all contend for
+///           the medium at once.
+///
+///           - Slot: set in the configuration, or assigned by the gateway in
+///             a beacon. The slot derived from the node ID (hash) is not
+///             used to send: nodes sharing a hashed slot transmit at the
+///             same instant, which collides more than free sends (see
+///             tools/slotsim). Until its slot is assigned, a node sends as
+///             in free mode.
+///           - Cycle: anchored on the gateway beacons (COMMREPORT_TYPE_BEACON)
+///             when there are some, on the local clock until the first one.
+///           - Guard: the end of each slot is kept free for the clock drift
+///             between two beacons and the loop() jitter.
+///
+///           Like CommReport, this module does not depend on the hardware
+///           and is shared with the host tools (tools/slotsim).
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef COMMSCHED_H
+#define COMMSCHED_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+// Default tunables. The values actually used at runtime come from the
+// configuration block (see ConfigMgr), then from the gateway beacons.
+#define COMMSCHED_MODE              COMMSCHED_MODE_FREE     ///< Send as soon as a result is ready.
+#define COMMSCHED_CYCLE             15000UL     ///< Reporting cycle, in ms (MOISTURE_DELAY).
+#define COMMSCHED_SLOTS             64          ///< Slots per cycle.
+#define COMMSCHED_SLOT_AUTO         0xFFFF      ///< Slot derived from the node ID.
+
+#define COMMSCHED_GUARD             20          ///< End of each slot left free, in ms.
+#define COMMSCHED_SLOT_WIDTH_MIN    (2 * COMMSCHED_GUARD)   ///< Narrowest accepted slot, in ms.
+#define COMMSCHED_READING_MARGIN    200         ///< Time between the end of the aligned reading and the slot, in ms.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   CommSchedModeTy
+/// \brief  Uplink scheduling.
+///
+typedef enum
+{
+	COMMSCHED_MODE_FREE		= 0,	///< Each result is sent right away.
+	COMMSCHED_MODE_SLOTTED,			///< Results wait for the slot of the node, once it has one.
+
+	COMMSCHED_MODE_MAX,
+} CommSchedModeTy;
+
+///
+/// \struct	oCommSchedTy
+/// \brief 	Schedule of one node.
+///
+typedef struct
+{
+	UINT8			u8Mode;							///< CommSchedModeTy.
+	UINT32			u32Cycle;						///< Cycle length, in ms.
+	UINT16			u16SlotCount;					///< Slots per cycle.
+	UINT16			u16Slot;						///< Slot in use.
+	UINT16			u16SlotConfig;					///< Configured slot, COMMSCHED_SLOT_AUTO to derive it.
+	UINT32			u32NodeId;
+	bool			bAssigned;						///< u16Slot comes from the gateway.
+	bool			bSynced;						///< u32Anchor comes from a beacon.
+	UINT32			u32Anchor;						///< Local time of a cycle start, kept within a cycle by CommSchedTrack().
+
+	// Statistics.
+	UINT32			u32Syncs;						///< Beacons applied.
+	INT32			i32LastCorrection;				///< Anchor move at the last beacon, in ms (drift).
+} oCommSchedTy, *poCommSchedTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool CommSchedInit(poCommSchedTy, UINT8 u8Mode, UINT32 u32Cycle, UINT16 u16SlotCount, UINT16 u16Slot, UINT32 u32NodeId);
+UINT16 CommSchedDeriveSlot(UINT32 u32NodeId, UINT16 u16SlotCount);
+bool CommSchedSync(poCommSchedTy, UINT32 u32Now, UINT32 u32Cycle, UINT16 u16SlotCount, UINT32 u32Phase);
+bool CommSchedAssign(poCommSchedTy, UINT16 u16Slot);
+bool CommSchedHasSlot(const oCommSchedTy*);
+bool CommSchedIsSlotOpen(const oCommSchedTy*, UINT32 u32Now);
+UINT32 CommSchedTimeToSlot(const oCommSchedTy*, UINT32 u32Now);
+UINT32 CommSchedReadingStart(const oCommSchedTy*, UINT32 u32Duration);
+void CommSchedTrack(poCommSchedTy, UINT32 u32Now);
+
+#endif
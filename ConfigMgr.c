@@ -0,0 +1,618 @@
+///
+/// \file     ConfigMgr.c
+/// \brief    Persistent configuration manager
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <stdlib.h>
+#include "ConfigMgr.h"
+#include "MemStats.h"
+#include "CommMgr.h"
+#include "Crc.h"
+#include "FlashMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define CONFIGMGR_CRC_SIZE      offsetof(oConfigMgrDataTy, u32Crc)  ///< Number of bytes covered by the CRC.
+
+#define CONFIGMGR_INTERVAL_MIN  10              ///< Smallest accepted interval, in ms.
+#define CONFIGMGR_SAMPLES_MAX   4096            ///< Most samples per reading: their squares (1023^2 each) add up in 32 bits.
+#define CONFIGMGR_OFFSET_NONE   0xFFFF          ///< Field of an old version, converted by ConfigMgrMigrate().
+
+/// Describes a field of the block for the migration.
+#define CONFIGMGR_FIELD(Member, Since) \
+	{ offsetof(oConfigMgrDataTy, Member), sizeof(((oConfigMgrDataTy*)0)->Member), __alignof__(((oConfigMgrDataTy*)0)->Member), Since, CONFIGMGR_VERSION }
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oConfigMgrFieldTy
+/// \brief 	Field of the stored block, and the versions holding it.
+///
+typedef struct
+{
+	UINT16		u16Offset;								///< Offset in oConfigMgrDataTy, CONFIGMGR_OFFSET_NONE if gone.
+	UINT16		u16Size;
+	UINT8		u8Align;
+	UINT8		u8Since;								///< First version holding the field.
+	UINT8		u8Until;								///< Last version holding the field.
+} oConfigMgrFieldTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool ConfigMgrIsSane(const oConfigMgrDataTy* poData);
+static bool ConfigMgrMigrate(poConfigMgrTy this, const UINT8* pu8Old, UINT16 u16Version, UINT16 u16Length);
+static bool ConfigMgrParseIp(const char* pszValue, UINT32* pu32Ip);
+static bool ConfigMgrParseU8(const char* pszValue, UINT8* pu8Value);
+static bool ConfigMgrParseU16(const char* pszValue, UINT16* pu16Value);
+static bool ConfigMgrParseU32(const char* pszValue, UINT32* pu32Value);
+static bool ConfigMgrCopyStr(char* pszDest, UINT32 u32Max, const char* pszValue);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oConfigMgrTy oConfigMgr = {FALSE};
+
+/// Fields in the stored order. The fields are only ever added, so the layout
+/// of an old version is rebuilt from the ones it holds (same alignment).
+static const oConfigMgrFieldTy aoConfigMgrFields[] =
+{
+	CONFIGMGR_FIELD(u32Magic, 1),
+	CONFIGMGR_FIELD(u16Version, 1),
+	CONFIGMGR_FIELD(u16Length, 1),
+	{ CONFIGMGR_OFFSET_NONE, sizeof(UINT16), __alignof__(UINT16), 1, 1 },	// u16ReadingInterval.
+	CONFIGMGR_FIELD(u32ReadingIntervalMin, 2),
+	CONFIGMGR_FIELD(u32ReadingIntervalMax, 2),
+	CONFIGMGR_FIELD(u16AdaptDelta, 2),
+	CONFIGMGR_FIELD(u16AdaptVariance, 2),
+	CONFIGMGR_FIELD(u16PollingInterval, 1),
+	CONFIGMGR_FIELD(u16PollingDuration, 1),
+	CONFIGMGR_FIELD(u16MapMax, 1),
+	CONFIGMGR_FIELD(u16MapMin, 1),
+	CONFIGMGR_FIELD(u32Heartbeat, 3),
+	CONFIGMGR_FIELD(u8DeadbandAbs, 3),
+	CONFIGMGR_FIELD(u8DeadbandPct, 3),
+	CONFIGMGR_FIELD(u32StatsWindow, 7),
+	CONFIGMGR_FIELD(u16StatsSamples, 7),
+	CONFIGMGR_FIELD(u8StatsPercentile, 7),
+	CONFIGMGR_FIELD(aoCalib, 4),
+	CONFIGMGR_FIELD(u8IrrMode, 5),
+	CONFIGMGR_FIELD(u8IrrLow, 5),
+	CONFIGMGR_FIELD(u8IrrHigh, 5),
+	CONFIGMGR_FIELD(u8IrrSetpoint, 5),
+	CONFIGMGR_FIELD(u16IrrKp, 5),
+	CONFIGMGR_FIELD(u16IrrKi, 5),
+	CONFIGMGR_FIELD(u32IrrMaxOn, 5),
+	CONFIGMGR_FIELD(u32IrrMinOff, 5),
+	CONFIGMGR_FIELD(u32IrrDailyCap, 5),
+	CONFIGMGR_FIELD(u16IrrFlow, 5),
+	CONFIGMGR_FIELD(u16GatewayPort, 1),
+	CONFIGMGR_FIELD(u32GatewayIp, 1),
+	CONFIGMGR_FIELD(u8SlotMode, 6),
+	CONFIGMGR_FIELD(u16SlotCount, 6),
+	CONFIGMGR_FIELD(u16Slot, 6),
+	CONFIGMGR_FIELD(u32SlotCycle, 6),
+	CONFIGMGR_FIELD(szSSID, 1),
+	CONFIGMGR_FIELD(szPW, 1),
+};
+
+MEMSTATS_REGISTER(ConfigMgr, sizeof(oConfigMgr))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		ConfigMgr - Gets the configuration manager instance.
+/// \public
+///
+/// \return		Pointer to the instance.
+////////////////////////////////////////////////////////////////////////////////
+poConfigMgrTy ConfigMgr()
+{
+	return &oConfigMgr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		ConfigMgrLoad - Loads the configuration block from flash.
+/// \public
+/// \details	Fast path: when the stored block has the right magic, version,
+///				length and CRC it is used as is, nothing is re-derived.
+///				A valid block of an older version is migrated, otherwise the
+///				defaults are loaded. Either is written back so the next boot
+///				takes the fast path.
+///
+/// \return		TRUE if a usable configuration is loaded, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool ConfigMgrLoad(poConfigMgrTy this)
+{
+	bool	bRet	= FALSE;
+	UINT32	u32Addr	= 0;
+	UINT32	u32Size	= 0;
+
+	if (!this) goto END;
+
+	this->bIsLoaded		= FALSE;
+	this->bFromFlash	= FALSE;
+
+	bRet = FlashMgrInit();
+	if (!bRet) goto END;
+
+	bRet = FlashMgrGetPartition(FLASHMGR_PART_CONFIG, &u32Addr, &u32Size);
+	if (!bRet) goto END;
+
+	bRet = FlashMgrRead(u32Addr, &this->oData, sizeof(this->oData));
+
+	if (bRet
+		&& (this->oData.u32Magic == CONFIGMGR_MAGIC)
+		&& (this->oData.u16Version < CONFIGMGR_VERSION)
+		&& (this->oData.u16Length <= sizeof(oConfigMgrDataTy)))
+	{
+		oConfigMgrDataTy oOld = this->oData;
+
+		// A failed write is not fatal, as below.
+		if (ConfigMgrMigrate(this, (const UINT8*)&oOld, oOld.u16Version, oOld.u16Length))
+		{
+			ConfigMgrSave(this);
+			goto END;
+		}
+	}
+
+	if (bRet
+		&& (this->oData.u32Magic == CONFIGMGR_MAGIC)
+		&& (this->oData.u16Version == CONFIGMGR_VERSION)
+		&& (this->oData.u16Length == sizeof(oConfigMgrDataTy))
+		&& (this->oData.u32Crc == Crc32(&this->oData, CONFIGMGR_CRC_SIZE))
+		&& ConfigMgrIsSane(&this->oData))
+	{
+		this->bFromFlash	= TRUE;
+		this->bIsLoaded		= TRUE;
+		goto END;
+	}
+
+	// Slow path: nothing usable in flash.
+	bRet = ConfigMgrSetDefaults(this);
+	if (!bRet) goto END;
+
+	// A failed write is not fatal, the defaults are still usable.
+	ConfigMgrSave(this);
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		ConfigMgrSave - Writes the active configuration to flash.
+/// \public
+///
+/// \return		TRUE if the block was written and read back correctly.
+////////////////////////////////////////////////////////////////////////////////
+bool ConfigMgrSave(poConfigMgrTy this)
+{
+	bool				bRet	= FALSE;
+	UINT32				u32Addr	= 0;
+	UINT32				u32Size	= 0;
+	oConfigMgrDataTy	oCheck;
+
+	if (!this || !this->bIsLoaded) goto END;
+
+	this->oData.u32Magic	= CONFIGMGR_MAGIC;
+	this->oData.u16Version	= CONFIGMGR_VERSION;
+	this->oData.u16Length	= sizeof(oConfigMgrDataTy);
+	this->oData.u32Crc		= Crc32(&this->oData, CONFIGMGR_CRC_SIZE);
+
+	bRet = FlashMgrGetPartition(FLASHMGR_PART_CONFIG, &u32Addr, &u32Size);
+	if (!bRet) goto END;
+
+	bRet = FlashMgrErase(u32Addr, u32Size);
+	if (!bRet) goto END;
+
+	bRet = FlashMgrWrite(u32Addr, &this->oData, sizeof(this->oData));
+	if (!bRet) goto END;
+
+	bRet = FlashMgrRead(u32Addr, &oCheck, sizeof(oCheck));
+	if (!bRet) goto END;
+
+	bRet = (memcmp(&oCheck, &this->oData, sizeof(oCheck)) == 0);
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		ConfigMgrSetDefaults - Loads the compile-time defaults.
+/// \public
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool ConfigMgrSetDefaults(poConfigMgrTy this)
+{
+	if (!this)
+	{
+		return FALSE;
+	}
+
+	// Clear padding too, the CRC covers the raw bytes.
+	memset(&this->oData, 0, sizeof(this->oData));
+
+	this->oData.u32ReadingIntervalMin	= MOISTURE_DELAY;
+	this->oData.u32ReadingIntervalMax	= MOISTURE_DELAY_MAX;
+	this->oData.u16AdaptDelta		= MOISTURE_ADAPT_DELTA;
+	this->oData.u16AdaptVariance	= MOISTURE_ADAPT_VARIANCE;
+	this->oData.u16PollingInterval	= POLL_DELAY;
+	this->oData.u16PollingDuration	= POLLING_TIME;
+	this->oData.u16MapMax			= MAP_MAX;
+	this->oData.u16MapMin			= MAP_MIN;
+	this->oData.u32Heartbeat		= MOISTURE_HEARTBEAT;
+	this->oData.u8DeadbandAbs		= MOISTURE_DEADBAND_ABS;
+	this->oData.u8DeadbandPct		= MOISTURE_DEADBAND_PCT;
+	this->oData.u32StatsWindow		= MOISTURE_STATS_WINDOW;
+	this->oData.u16StatsSamples		= MOISTURE_STATS_SAMPLES;
+	this->oData.u8StatsPercentile	= MOISTURE_STATS_PERCENTILE;
+
+	this->oData.u8IrrMode			= IRRIGATION_MODE;
+	this->oData.u8IrrLow			= IRRIGATION_LOW;
+	this->oData.u8IrrHigh			= IRRIGATION_HIGH;
+	this->oData.u8IrrSetpoint		= IRRIGATION_SETPOINT;
+	this->oData.u16IrrKp			= IRRIGATION_KP;
+	this->oData.u16IrrKi			= IRRIGATION_KI;
+	this->oData.u32IrrMaxOn			= IRRIGATION_MAX_ON;
+	this->oData.u32IrrMinOff		= IRRIGATION_MIN_OFF;
+	this->oData.u32IrrDailyCap		= IRRIGATION_DAILY_CAP;
+	this->oData.u16IrrFlow			= IRRIGATION_FLOW;
+
+	this->oData.u16GatewayPort		= COMM_GATEWAY_PORT;
+	this->oData.u32GatewayIp		= COMM_GATEWAY_IP;
+	this->oData.u8SlotMode			= COMMSCHED_MODE;
+	this->oData.u16SlotCount		= COMMSCHED_SLOTS;
+	this->oData.u16Slot				= COMMSCHED_SLOT_AUTO;
+	this->oData.u32SlotCycle		= COMMSCHED_CYCLE;
+	ConfigMgrCopyStr(this->oData.szSSID, CONFIGMGR_SSID_MAX, SSID);
+	ConfigMgrCopyStr(this->oData.szPW, CONFIGMGR_PW_MAX, PW);
+
+	this->bFromFlash	= FALSE;
+	this->bIsLoaded		= TRUE;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		ConfigMgrSetValue - Changes one setting of the active configuration.
+/// \public
+/// \details	The change is only kept in RAM. Call ConfigMgrSave() to make it
+///				persistent. Known keys: reading (sets a fixed rate), reading_min,
+///				reading_max, adapt_delta, adapt_var, polling, duration, map_max,
+///				map_min, deadband, deadband_pct, heartbeat, stats_window,
+///				stats_samples, stats_pct, irr_mode, irr_low,
+///				irr_high, irr_setpoint, irr_kp, irr_ki, irr_max_on, irr_min_off,
+///				irr_cap, irr_flow, gw_ip, gw_port, slot_mode, slot_cycle,
+///				slot_count, slot (a number or "auto"), ssid, pw.
+///
+/// \param[in]	pszKey		Setting name.
+/// \param[in]	pszValue	New value, as text.
+///
+/// \return		TRUE if the key is known and the value is valid.
+////////////////////////////////////////////////////////////////////////////////
+bool ConfigMgrSetValue(poConfigMgrTy this, const char* pszKey, const char* pszValue)
+{
+	bool				bRet	= FALSE;
+	oConfigMgrDataTy	oNew;
+
+	if (!this || !this->bIsLoaded || !pszKey || !pszValue) goto END;
+
+	oNew = this->oData;
+
+	if (!strcmp(pszKey, "reading"))
+	{
+		bRet = ConfigMgrParseU32(pszValue, &oNew.u32ReadingIntervalMin);
+		oNew.u32ReadingIntervalMax = oNew.u32ReadingIntervalMin;
+	}
+	else if (!strcmp(pszKey, "reading_min"))	bRet = ConfigMgrParseU32(pszValue, &oNew.u32ReadingIntervalMin);
+	else if (!strcmp(pszKey, "reading_max"))	bRet = ConfigMgrParseU32(pszValue, &oNew.u32ReadingIntervalMax);
+	else if (!strcmp(pszKey, "adapt_delta"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16AdaptDelta);
+	else if (!strcmp(pszKey, "adapt_var"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16AdaptVariance);
+	else if (!strcmp(pszKey, "polling"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16PollingInterval);
+	else if (!strcmp(pszKey, "duration"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16PollingDuration);
+	else if (!strcmp(pszKey, "map_max"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16MapMax);
+	else if (!strcmp(pszKey, "map_min"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16MapMin);
+	else if (!strcmp(pszKey, "deadband"))	bRet = ConfigMgrParseU8(pszValue, &oNew.u8DeadbandAbs);
+	else if (!strcmp(pszKey, "deadband_pct"))	bRet = ConfigMgrParseU8(pszValue, &oNew.u8DeadbandPct);
+	else if (!strcmp(pszKey, "heartbeat"))	bRet = ConfigMgrParseU32(pszValue, &oNew.u32Heartbeat);
+	else if (!strcmp(pszKey, "stats_window"))	bRet = ConfigMgrParseU32(pszValue, &oNew.u32StatsWindow);
+	else if (!strcmp(pszKey, "stats_samples"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16StatsSamples);
+	else if (!strcmp(pszKey, "stats_pct"))	bRet = ConfigMgrParseU8(pszValue, &oNew.u8StatsPercentile);
+	else if (!strcmp(pszKey, "irr_mode"))	bRet = ConfigMgrParseU8(pszValue, &oNew.u8IrrMode);
+	else if (!strcmp(pszKey, "irr_low"))	bRet = ConfigMgrParseU8(pszValue, &oNew.u8IrrLow);
+	else if (!strcmp(pszKey, "irr_high"))	bRet = ConfigMgrParseU8(pszValue, &oNew.u8IrrHigh);
+	else if (!strcmp(pszKey, "irr_setpoint"))	bRet = ConfigMgrParseU8(pszValue, &oNew.u8IrrSetpoint);
+	else if (!strcmp(pszKey, "irr_kp"))		bRet = ConfigMgrParseU16(pszValue, &oNew.u16IrrKp);
+	else if (!strcmp(pszKey, "irr_ki"))		bRet = ConfigMgrParseU16(pszValue, &oNew.u16IrrKi);
+	else if (!strcmp(pszKey, "irr_max_on"))	bRet = ConfigMgrParseU32(pszValue, &oNew.u32IrrMaxOn);
+	else if (!strcmp(pszKey, "irr_min_off"))	bRet = ConfigMgrParseU32(pszValue, &oNew.u32IrrMinOff);
+	else if (!strcmp(pszKey, "irr_cap"))	bRet = ConfigMgrParseU32(pszValue, &oNew.u32IrrDailyCap);
+	else if (!strcmp(pszKey, "irr_flow"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16IrrFlow);
+	else if (!strcmp(pszKey, "gw_port"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16GatewayPort);
+	else if (!strcmp(pszKey, "gw_ip"))		bRet = ConfigMgrParseIp(pszValue, &oNew.u32GatewayIp);
+	else if (!strcmp(pszKey, "slot_mode"))	bRet = ConfigMgrParseU8(pszValue, &oNew.u8SlotMode);
+	else if (!strcmp(pszKey, "slot_cycle"))	bRet = ConfigMgrParseU32(pszValue, &oNew.u32SlotCycle);
+	else if (!strcmp(pszKey, "slot_count"))	bRet = ConfigMgrParseU16(pszValue, &oNew.u16SlotCount);
+	else if (!strcmp(pszKey, "slot"))
+	{
+		oNew.u16Slot	= COMMSCHED_SLOT_AUTO;
+		bRet			= !strcmp(pszValue, "auto") || ConfigMgrParseU16(pszValue, &oNew.u16Slot);
+	}
+	else if (!strcmp(pszKey, "ssid"))		bRet = ConfigMgrCopyStr(oNew.szSSID, CONFIGMGR_SSID_MAX, pszValue);
+	else if (!strcmp(pszKey, "pw"))			bRet = ConfigMgrCopyStr(oNew.szPW, CONFIGMGR_PW_MAX, pszValue);
+
+	if (!bRet) goto END;
+
+	bRet = ConfigMgrIsSane(&oNew);
+	if (!bRet) goto END;
+
+	this->oData = oNew;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		ConfigMgrApplySensor - Copies the sensor settings to a sensor manager.
+/// \public
+/// \details	Also builds the calibration table of the sensor probe.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool ConfigMgrApplySensor(poConfigMgrTy this, poMoistSensorMgrTy poSensor)
+{
+	if (!this || !this->bIsLoaded || !poSensor)
+	{
+		return FALSE;
+	}
+
+	poSensor->u32ReadingIntervalMin	= this->oData.u32ReadingIntervalMin;
+	poSensor->u32ReadingIntervalMax	= this->oData.u32ReadingIntervalMax;
+	poSensor->u16AdaptDelta			= this->oData.u16AdaptDelta;
+	poSensor->u16AdaptVariance		= this->oData.u16AdaptVariance;
+	poSensor->u16PollingInterval	= this->oData.u16PollingInterval;
+	poSensor->u16PollingDuration	= this->oData.u16PollingDuration;
+	poSensor->u16MapMax				= this->oData.u16MapMax;
+	poSensor->u16MapMin				= this->oData.u16MapMin;
+	poSensor->u32Heartbeat			= this->oData.u32Heartbeat;
+	poSensor->u8DeadbandAbs			= this->oData.u8DeadbandAbs;
+	poSensor->u8DeadbandPct			= this->oData.u8DeadbandPct;
+	poSensor->u32StatsWindow		= this->oData.u32StatsWindow;
+	poSensor->u16StatsSamples		= this->oData.u16StatsSamples;
+	poSensor->u8StatsPercentile		= this->oData.u8StatsPercentile;
+
+	if (poSensor->u8ProbeId >= CALIBMGR_PROBE_MAX)
+	{
+		return FALSE;
+	}
+
+	return CalibMgrBuild(poSensor->u8ProbeId, &this->oData.aoCalib[poSensor->u8ProbeId], poSensor->u16MapMax, poSensor->u16MapMin);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		ConfigMgrApplyIrrigation - Copies the irrigation settings to the controller.
+/// \public
+/// \details	Call IrrigationMgrConfigure() afterwards.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool ConfigMgrApplyIrrigation(poConfigMgrTy this, poIrrigationMgrTy poIrrigation)
+{
+	if (!this || !this->bIsLoaded || !poIrrigation)
+	{
+		return FALSE;
+	}
+
+	poIrrigation->u8Mode		= this->oData.u8IrrMode;
+	poIrrigation->u8Low			= this->oData.u8IrrLow;
+	poIrrigation->u8High		= this->oData.u8IrrHigh;
+	poIrrigation->u8Setpoint	= this->oData.u8IrrSetpoint;
+	poIrrigation->u16Kp			= this->oData.u16IrrKp;
+	poIrrigation->u16Ki			= this->oData.u16IrrKi;
+	poIrrigation->u32MaxOn		= this->oData.u32IrrMaxOn;
+	poIrrigation->u32MinOff		= this->oData.u32IrrMinOff;
+	poIrrigation->u32DailyCap	= this->oData.u32IrrDailyCap;
+	poIrrigation->u16Flow		= this->oData.u16IrrFlow;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool ConfigMgrIsSane(const oConfigMgrDataTy* poData)
+{
+	return (poData->u16PollingInterval >= CONFIGMGR_INTERVAL_MIN)
+		&& (poData->u16PollingDuration >= poData->u16PollingInterval)
+		&& (poData->u16PollingDuration / poData->u16PollingInterval <= CONFIGMGR_SAMPLES_MAX)
+		&& (poData->u32ReadingIntervalMin >= CONFIGMGR_INTERVAL_MIN)
+		&& (poData->u32ReadingIntervalMax >= poData->u32ReadingIntervalMin)
+		&& (poData->u16MapMax != poData->u16MapMin)
+		&& (poData->u32StatsWindow >= STREAMSTATS_BUCKETS)
+		&& poData->u8StatsPercentile && (poData->u8StatsPercentile < 100)
+		&& (poData->u8IrrMode < IRRIGATIONMGR_MODE_MAX)
+		&& (poData->u8IrrLow < poData->u8IrrHigh) && (poData->u8IrrHigh <= 100)
+		&& (poData->u8IrrSetpoint <= 100)
+		&& poData->u32IrrMaxOn && poData->u16IrrFlow
+		&& (poData->u8SlotMode < COMMSCHED_MODE_MAX)
+		&& poData->u16SlotCount && (poData->u32SlotCycle / poData->u16SlotCount >= COMMSCHED_SLOT_WIDTH_MIN)
+		&& ((poData->u16Slot == COMMSCHED_SLOT_AUTO) || (poData->u16Slot < poData->u16SlotCount))
+		&& (poData->szSSID[CONFIGMGR_SSID_MAX] == '\0')
+		&& (poData->szPW[CONFIGMGR_PW_MAX] == '\0');
+}
+
+static bool ConfigMgrMigrate(poConfigMgrTy this, const UINT8* pu8Old, UINT16 u16Version, UINT16 u16Length)
+{
+	const oConfigMgrFieldTy*	poField		= NULL;
+	UINT32						u32Old		= 0;
+	UINT32						u32Crc		= 0;
+	UINT16						u16Interval	= 0;
+	UINT8						u8Idx		= 0;
+
+	if (!u16Version || (u16Length < sizeof(UINT32)))
+	{
+		return FALSE;
+	}
+
+	memcpy(&u32Crc, &pu8Old[u16Length - sizeof(UINT32)], sizeof(u32Crc));
+	if (u32Crc != Crc32(pu8Old, u16Length - sizeof(UINT32)))
+	{
+		return FALSE;
+	}
+
+	// The fields added since then keep their defaults.
+	ConfigMgrSetDefaults(this);
+
+	for (u8Idx = 0; u8Idx < sizeof(aoConfigMgrFields) / sizeof(aoConfigMgrFields[0]); ++u8Idx)
+	{
+		poField = &aoConfigMgrFields[u8Idx];
+		if ((u16Version < poField->u8Since) || (u16Version > poField->u8Until))
+		{
+			continue;
+		}
+
+		u32Old = (u32Old + poField->u8Align - 1) & ~(UINT32)(poField->u8Align - 1);
+		if (u32Old + poField->u16Size > u16Length) break;
+
+		if (poField->u16Offset != CONFIGMGR_OFFSET_NONE)
+		{
+			memcpy((UINT8*)&this->oData + poField->u16Offset, &pu8Old[u32Old], poField->u16Size);
+		}
+		else
+		{
+			memcpy(&u16Interval, &pu8Old[u32Old], sizeof(u16Interval));
+		}
+		u32Old += poField->u16Size;
+	}
+
+	// The CRC follows, on a 4 bytes boundary: the length must match exactly.
+	u32Old = (u32Old + 3) & ~3UL;
+	if (u32Old + sizeof(UINT32) != u16Length)
+	{
+		ConfigMgrSetDefaults(this);
+		return FALSE;
+	}
+
+	// Version 1 had one fixed reading interval.
+	if (u16Version < 2)
+	{
+		this->oData.u32ReadingIntervalMin = u16Interval;
+		this->oData.u32ReadingIntervalMax = u16Interval;
+	}
+
+	if (!ConfigMgrIsSane(&this->oData))
+	{
+		ConfigMgrSetDefaults(this);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static bool ConfigMgrParseU8(const char* pszValue, UINT8* pu8Value)
+{
+	UINT16 u16Value = 0;
+
+	if (!ConfigMgrParseU16(pszValue, &u16Value) || (u16Value > 0xFF))
+	{
+		return FALSE;
+	}
+
+	*pu8Value = (UINT8)u16Value;
+	return TRUE;
+}
+
+static bool ConfigMgrParseU16(const char* pszValue, UINT16* pu16Value)
+{
+	char*			pszEnd	= NULL;
+	unsigned long	ulValue	= strtoul(pszValue, &pszEnd, 0);
+
+	if ((pszEnd == pszValue) || (*pszEnd != '\0') || (ulValue > 0xFFFF))
+	{
+		return FALSE;
+	}
+
+	*pu16Value = (UINT16)ulValue;
+	return TRUE;
+}
+
+static bool ConfigMgrParseU32(const char* pszValue, UINT32* pu32Value)
+{
+	char*			pszEnd	= NULL;
+	unsigned long	ulValue	= 0;
+
+	// strtoul() negates a value with a sign instead of refusing it.
+	if (strchr(pszValue, '-'))
+	{
+		return FALSE;
+	}
+
+	errno	= 0;
+	ulValue	= strtoul(pszValue, &pszEnd, 0);
+
+	// The cast only loses bits where unsigned long is wider than 32 bits.
+	if ((pszEnd == pszValue) || (*pszEnd != '\0') || (errno == ERANGE) || ((UINT32)ulValue != ulValue))
+	{
+		return FALSE;
+	}
+
+	*pu32Value = (UINT32)ulValue;
+	return TRUE;
+}
+
+static bool ConfigMgrParseIp(const char* pszValue, UINT32* pu32Ip)
+{
+	UINT32			u32Ip	= 0;
+	UINT8			u8Idx	= 0;
+	char*			pszEnd	= NULL;
+	unsigned long	ulPart	= 0;
+
+	for (u8Idx = 0; u8Idx < 4; ++u8Idx)
+	{
+		ulPart = strtoul(pszValue, &pszEnd, 10);
+		if ((pszEnd == pszValue) || (ulPart > 255))
+		{
+			return FALSE;
+		}
+
+		u32Ip = (u32Ip << 8) | ulPart;
+
+		if (u8Idx < 3)
+		{
+			if (*pszEnd != '.') return FALSE;
+			pszValue = pszEnd + 1;
+		}
+	}
+
+	if (*pszEnd != '\0')
+	{
+		return FALSE;
+	}
+
+	*pu32Ip = u32Ip;
+	return TRUE;
+}
+
+static bool ConfigMgrCopyStr(char* pszDest, UINT32 u32Max, const char* pszValue)
+{
+	UINT32 u32Len = strlen(pszValue);
+
+	if (u32Len > u32Max)
+	{
+		return FALSE;
+	}
+
+	memset(pszDest, 0, u32Max + 1);
+	memcpy(pszDest, pszValue, u32Len);
+	return TRUE;
+}
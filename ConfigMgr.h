@@ -0,0 +1,115 @@
+///
+/// \file     ConfigMgr.h
+/// \brief    Persistent configuration manager
+/// \details  Holds every runtime tunable of the node in one versioned block
+///           stored in flash and protected by a CRC-32. The block is read
+///           once at boot. A block from an older version is migrated: the
+///           stored settings are kept and only the fields added since get
+///           their defaults. When it is missing, from an unknown version or
+///           corrupted, the compile-time defaults are used. Either way the
+///           result is written back.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef CONFIGMGR_H
+#define CONFIGMGR_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "MoistSensorMgr.h"
+#include "CalibMgr.h"
+#include "IrrigationMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define CONFIGMGR_MAGIC         0x4749464EUL    ///< "NFIG" in little endian memory order.
+#define CONFIGMGR_VERSION       7               ///< Bump each time oConfigMgrDataTy changes, and list the new fields in ConfigMgr.c.
+
+#define CONFIGMGR_SSID_MAX      32              ///< Maximum SSID length (802.11).
+#define CONFIGMGR_PW_MAX        64              ///< Maximum WPA2 passphrase length.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oConfigMgrDataTy
+/// \brief 	Configuration block, as stored in flash.
+///
+typedef struct
+{
+	UINT32		u32Magic;								///< CONFIGMGR_MAGIC.
+	UINT16		u16Version;								///< CONFIGMGR_VERSION.
+	UINT16		u16Length;								///< sizeof(oConfigMgrDataTy).
+
+	// Moisture sensor.
+	UINT32		u32ReadingIntervalMin;					///< Fastest time between two readings, in ms.
+	UINT32		u32ReadingIntervalMax;					///< Slowest time between two readings, in ms.
+	UINT16		u16AdaptDelta;							///< Change of average (raw) that restores the fast rate.
+	UINT16		u16AdaptVariance;						///< Variance of a reading (raw^2) that restores the fast rate.
+	UINT16		u16PollingInterval;						///< Time between two ADC samples of a reading, in ms.
+	UINT16		u16PollingDuration;						///< Duration of a reading, in ms.
+	UINT16		u16MapMax;								///< Raw value mapped to 0 %.
+	UINT16		u16MapMin;								///< Raw value mapped to 100 %.
+	UINT32		u32Heartbeat;							///< Longest time without a new result, in ms.
+	UINT8		u8DeadbandAbs;							///< Absolute deadband, in %.
+	UINT8		u8DeadbandPct;							///< Relative deadband, in % of the last value.
+	UINT32		u32StatsWindow;							///< Span of the window statistics, in ms.
+	UINT16		u16StatsSamples;						///< Span of the window statistics, in readings. 0: use u32StatsWindow.
+	UINT8		u8StatsPercentile;						///< Percentile of the window statistics.
+	oCalibCurveTy	aoCalib[CALIBMGR_PROBE_MAX];		///< Calibration curve of each probe.
+
+	// Irrigation.
+	UINT8		u8IrrMode;								///< IrrigationMgrModeTy.
+	UINT8		u8IrrLow;								///< Hysteresis: open below, in %.
+	UINT8		u8IrrHigh;								///< Hysteresis: close at or above, in %.
+	UINT8		u8IrrSetpoint;							///< PI: target moisture, in %.
+	UINT16		u16IrrKp;								///< PI: watering per % of error, in ms.
+	UINT16		u16IrrKi;								///< PI: watering per % of summed error, in ms.
+	UINT32		u32IrrMaxOn;							///< Longest opening, in ms.
+	UINT32		u32IrrMinOff;							///< Shortest time closed between two openings, in ms.
+	UINT32		u32IrrDailyCap;							///< Water per day, in mL.
+	UINT16		u16IrrFlow;								///< Flow when open, in mL/min.
+
+	// Network.
+	UINT16		u16GatewayPort;							///< Gateway UDP port.
+	UINT32		u32GatewayIp;							///< Gateway IPv4 address, host byte order.
+	UINT8		u8SlotMode;								///< CommSchedModeTy.
+	UINT16		u16SlotCount;							///< Slots per cycle, until a beacon gives it.
+	UINT16		u16Slot;								///< Transmit slot, COMMSCHED_SLOT_AUTO to derive it.
+	UINT32		u32SlotCycle;							///< Reporting cycle, in ms, until a beacon gives it.
+	char		szSSID[CONFIGMGR_SSID_MAX + 1];			///< WiFi SSID.
+	char		szPW[CONFIGMGR_PW_MAX + 1];				///< WiFi passphrase.
+
+	UINT32		u32Crc;									///< CRC-32 of all the preceding bytes. Must stay last.
+} oConfigMgrDataTy;
+
+///
+/// \struct	oConfigMgrTy
+/// \brief 	ConfigMgr object.
+///
+typedef struct
+{
+	bool				bIsLoaded;						///< Flag indicating that oData holds a usable configuration.
+	bool				bFromFlash;						///< Flag indicating that oData came from flash (fast path).
+	oConfigMgrDataTy	oData;							///< Active configuration.
+} oConfigMgrTy, *poConfigMgrTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+poConfigMgrTy ConfigMgr();
+bool ConfigMgrLoad(poConfigMgrTy);
+bool ConfigMgrSave(poConfigMgrTy);
+bool ConfigMgrSetDefaults(poConfigMgrTy);
+bool ConfigMgrSetValue(poConfigMgrTy, const char* pszKey, const char* pszValue);
+bool ConfigMgrApplySensor(poConfigMgrTy, poMoistSensorMgrTy);
+bool ConfigMgrApplyIrrigation(poConfigMgrTy, poIrrigationMgrTy);
+
+#endif
@@ -0,0 +1,76 @@
+///
+/// \file     Crc.c
+/// \brief    CRC utility
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "Crc.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+/// Nibble table for the reflected CRC-32 (IEEE 802.3) polynomial. 16 entries
+/// instead of 256 to keep the flash footprint small.
+static const UINT32 au32Crc32Table[16] =
+{
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+	0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+	0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		Crc32Update - Adds a block of data to a running CRC-32.
+/// \public
+///
+/// \param[in]	u32Crc		Running CRC. Start with CRC32_INIT.
+/// \param[in]	pvData		Data to add.
+/// \param[in]	u32Size		Number of bytes to add.
+///
+/// \return		The updated running CRC.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 Crc32Update(UINT32 u32Crc, const void* pvData, UINT32 u32Size)
+{
+	const UINT8* pu8Data = (const UINT8*)pvData;
+
+	while (u32Size--)
+	{
+		u32Crc ^= *pu8Data++;
+		u32Crc = (u32Crc >> 4) ^ au32Crc32Table[u32Crc & 0x0F];
+		u32Crc = (u32Crc >> 4) ^ au32Crc32Table[u32Crc & 0x0F];
+	}
+
+	return u32Crc;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		Crc32Final - Finalizes a running CRC-32.
+/// \public
+///
+/// \param[in]	u32Crc		Running CRC.
+///
+/// \return		The CRC-32 value.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 Crc32Final(UINT32 u32Crc)
+{
+	return u32Crc ^ CRC32_INIT;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		Crc32 - Computes the CRC-32 of a block of data.
+/// \public
+///
+/// \param[in]	pvData		Data.
+/// \param[in]	u32Size		Number of bytes.
+///
+/// \return		The CRC-32 value.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 Crc32(const void* pvData, UINT32 u32Size)
+{
+	return Crc32Final(Crc32Update(CRC32_INIT, pvData, u32Size));
+}
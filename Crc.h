@@ -0,0 +1,30 @@
+///
+/// \file     Crc.h
+/// \brief    CRC utility
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef CRC_H
+#define CRC_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define CRC32_INIT      0xFFFFFFFFUL    ///< Initial value of a running CRC-32.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+UINT32  Crc32Update(UINT32 u32Crc, const void* pvData, UINT32 u32Size);
+UINT32  Crc32Final(UINT32 u32Crc);
+UINT32  Crc32(const void* pvData, UINT32 u32Size);
+
+#endif
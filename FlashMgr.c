@@ -0,0 +1,475 @@
+///
+/// \file     FlashMgr.c
+/// \brief    Raw flash access manager (sector erase, read and write)
+/// \details  On the ESP8266 the SDK SPI flash API is used directly. On any
+///           other target (host builds) the flash is simulated in RAM with
+///           NOR semantics: erase sets bytes to 0xFF and writes can only
+///           clear bits. The simulation can be backed by a file so its
+///           content survives a restart of the host tool, and can be slowed
+///           down to the timing of a real chip.
+///
+///           ESP8266 layout: the space before the file system is split in
+///           two halves. The running sketch lives in the lower one, the
+///           update is received in the upper one and copied down by the
+///           boot loader. The last sector of the upper half keeps the
+///           update progress. A sketch bigger than the lower half leaves no
+///           room for an update: the update partition is then empty, like
+///           the Updater of the core refuses it. The language packs take the start of the file
+///           system space, which the sketch does not use otherwise (none if
+///           the board is built without one).
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "FlashMgr.h"
+#include "MemStats.h"
+
+#ifdef ARDUINO_ARCH_ESP8266
+#include "spi_flash.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define FLASHMGR_BOUNCE_WORDS       32          ///< Size of the aligned bounce buffer, in 32 bits words.
+
+#ifdef ARDUINO_ARCH_ESP8266
+#define FLASHMGR_MAP_BASE           0x40200000UL    ///< Address where the flash is mapped in the CPU space.
+#define FLASHMGR_APP_START          0x1000UL        ///< Flash offset of the sketch image, after the boot loader.
+#else
+#define FLASHMGR_SIM_OTA_ADDR       FLASHMGR_SECTOR_SIZE        ///< The configuration sector comes first.
+#define FLASHMGR_SIM_LANG_ADDR      (FLASHMGR_SIM_OTA_ADDR + FLASHMGR_SIM_OTA_SIZE + FLASHMGR_SECTOR_SIZE)  ///< After the update progress sector.
+#define FLASHMGR_SIM_SIZE           (FLASHMGR_SIM_LANG_ADDR + FLASHMGR_LANG_SIZE)   ///< Size of the simulated flash.
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oFlashMgrTy
+/// \brief 	FlashMgr object.
+///
+typedef struct
+{
+	bool		bIsInitialized;								///< Flag indicating if this object is ready to use.
+	UINT32		au32PartAddr[FLASHMGR_PART_MAX];			///< Start address of each partition.
+	UINT32		au32PartSize[FLASHMGR_PART_MAX];			///< Size of each partition, in bytes.
+} oFlashMgrTy, *poFlashMgrTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool FlashMgrLowErase(UINT32 u32Sector);
+static bool FlashMgrLowRead(UINT32 u32Addr, UINT32* pu32Data, UINT32 u32Size);
+static bool FlashMgrLowWrite(UINT32 u32Addr, const UINT32* pu32Data, UINT32 u32Size);
+#ifdef ARDUINO_ARCH_ESP8266
+static UINT32 FlashMgrSketchEnd();
+#else
+static void FlashMgrSimDelay(UINT64 u64Ns);
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oFlashMgrTy oFlashMgr = {FALSE};
+
+#ifdef ARDUINO_ARCH_ESP8266
+extern UINT32 _EEPROM_start;								///< Linker symbol of the EEPROM emulation sector.
+extern UINT32 _FS_start;									///< Linker symbol of the file system, end of the sketch space.
+extern UINT32 _FS_end;										///< Linker symbol of the end of the file system.
+#else
+static UINT8 au8SimFlash[FLASHMGR_SIM_SIZE];				///< Simulated flash content.
+static UINT8* pu8SimFlash				= au8SimFlash;		///< au8SimFlash or the mapped backing file.
+static bool bSimAttached				= FALSE;			///< The simulated flash is backed by a file.
+static UINT32 u32SimEraseUs				= 0;				///< Simulated sector erase time.
+static UINT32 u32SimWriteNsPerByte		= 0;				///< Simulated programming time.
+#endif
+
+MEMSTATS_REGISTER(FlashMgr, sizeof(oFlashMgr))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		FlashMgrInit - Initializes the flash manager and its partition map.
+/// \public
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool FlashMgrInit()
+{
+	if (!oFlashMgr.bIsInitialized)
+	{
+#ifdef ARDUINO_ARCH_ESP8266
+		UINT32 u32SketchEnd = (UINT32)&_FS_start - FLASHMGR_MAP_BASE;
+		UINT32 u32Half = (u32SketchEnd / 2) & ~(FLASHMGR_SECTOR_SIZE - 1);
+
+		oFlashMgr.au32PartAddr[FLASHMGR_PART_CONFIG] = (UINT32)&_EEPROM_start - FLASHMGR_MAP_BASE;
+		oFlashMgr.au32PartAddr[FLASHMGR_PART_OTA] = u32SketchEnd - u32Half;
+		oFlashMgr.au32PartSize[FLASHMGR_PART_OTA] = u32Half - FLASHMGR_SECTOR_SIZE;
+		if (FlashMgrSketchEnd() > oFlashMgr.au32PartAddr[FLASHMGR_PART_OTA])
+		{
+			// Writing an update would overwrite the running sketch.
+			oFlashMgr.au32PartSize[FLASHMGR_PART_OTA] = 0;
+		}
+		oFlashMgr.au32PartAddr[FLASHMGR_PART_LANG] = u32SketchEnd;
+		oFlashMgr.au32PartSize[FLASHMGR_PART_LANG] = (UINT32)&_FS_end - (UINT32)&_FS_start;
+		if (oFlashMgr.au32PartSize[FLASHMGR_PART_LANG] > FLASHMGR_LANG_SIZE)
+		{
+			oFlashMgr.au32PartSize[FLASHMGR_PART_LANG] = FLASHMGR_LANG_SIZE;
+		}
+#else
+		if (!bSimAttached)
+		{
+			memset(au8SimFlash, 0xFF, sizeof(au8SimFlash));
+		}
+		oFlashMgr.au32PartAddr[FLASHMGR_PART_CONFIG] = 0;
+		oFlashMgr.au32PartAddr[FLASHMGR_PART_OTA] = FLASHMGR_SIM_OTA_ADDR;
+		oFlashMgr.au32PartSize[FLASHMGR_PART_OTA] = FLASHMGR_SIM_OTA_SIZE;
+		oFlashMgr.au32PartAddr[FLASHMGR_PART_LANG] = FLASHMGR_SIM_LANG_ADDR;
+		oFlashMgr.au32PartSize[FLASHMGR_PART_LANG] = FLASHMGR_LANG_SIZE;
+#endif
+		oFlashMgr.au32PartSize[FLASHMGR_PART_CONFIG] = FLASHMGR_SECTOR_SIZE;
+		oFlashMgr.au32PartAddr[FLASHMGR_PART_OTA_STATE] = oFlashMgr.au32PartAddr[FLASHMGR_PART_OTA] + oFlashMgr.au32PartSize[FLASHMGR_PART_OTA];
+		oFlashMgr.au32PartSize[FLASHMGR_PART_OTA_STATE] = FLASHMGR_SECTOR_SIZE;
+
+		oFlashMgr.bIsInitialized = TRUE;
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		FlashMgrGetPartition - Gets the location of a partition.
+/// \public
+///
+/// \param[in]	ePart		Partition to look for.
+/// \param[out]	pu32Addr	Start address of the partition (flash offset).
+/// \param[out]	pu32Size	Size of the partition, in bytes.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool FlashMgrGetPartition(FlashMgrPartTy ePart, UINT32* pu32Addr, UINT32* pu32Size)
+{
+	if (!oFlashMgr.bIsInitialized || (ePart >= FLASHMGR_PART_MAX) || !pu32Addr || !pu32Size)
+	{
+		return FALSE;
+	}
+
+	*pu32Addr = oFlashMgr.au32PartAddr[ePart];
+	*pu32Size = oFlashMgr.au32PartSize[ePart];
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		FlashMgrErase - Erases all the sectors covering a region.
+/// \public
+///
+/// \param[in]	u32Addr		Start address. Must be sector aligned.
+/// \param[in]	u32Size		Number of bytes to erase. Rounded up to a full sector.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool FlashMgrErase(UINT32 u32Addr, UINT32 u32Size)
+{
+	bool	bRet		= FALSE;
+	UINT32	u32Sector	= 0;
+	UINT32	u32Last		= 0;
+
+	if (!oFlashMgr.bIsInitialized || (u32Addr % FLASHMGR_SECTOR_SIZE) || (u32Size == 0))
+	{
+		goto END;
+	}
+
+	u32Sector	= u32Addr / FLASHMGR_SECTOR_SIZE;
+	u32Last		= (u32Addr + u32Size - 1) / FLASHMGR_SECTOR_SIZE;
+
+	for (; u32Sector <= u32Last; ++u32Sector)
+	{
+		bRet = FlashMgrLowErase(u32Sector);
+		if (!bRet) goto END;
+	}
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		FlashMgrRead - Reads a block from flash.
+/// \public
+/// \details	The SPI flash only accepts word aligned transfers. The data goes
+///				through an aligned bounce buffer so the caller's buffer and size
+///				can be anything, as long as the flash address is aligned.
+///
+/// \param[in]	u32Addr		Flash address. Must be FLASHMGR_ALIGN aligned.
+/// \param[out]	pvData		Destination buffer.
+/// \param[in]	u32Size		Number of bytes to read.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool FlashMgrRead(UINT32 u32Addr, void* pvData, UINT32 u32Size)
+{
+	bool	bRet								= FALSE;
+	UINT32	au32Bounce[FLASHMGR_BOUNCE_WORDS];
+	UINT8*	pu8Data								= (UINT8*)pvData;
+	UINT32	u32Chunk							= 0;
+
+	if (!oFlashMgr.bIsInitialized || !pvData || (u32Addr % FLASHMGR_ALIGN))
+	{
+		goto END;
+	}
+
+	while (u32Size > 0)
+	{
+		u32Chunk = (u32Size < sizeof(au32Bounce)) ? u32Size : sizeof(au32Bounce);
+
+		bRet = FlashMgrLowRead(u32Addr, au32Bounce, (u32Chunk + FLASHMGR_ALIGN - 1) & ~(FLASHMGR_ALIGN - 1));
+		if (!bRet) goto END;
+
+		memcpy(pu8Data, au32Bounce, u32Chunk);
+
+		pu8Data	+= u32Chunk;
+		u32Addr	+= u32Chunk;
+		u32Size	-= u32Chunk;
+	}
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		FlashMgrWrite - Writes a block to flash.
+/// \public
+/// \details	The region must have been erased first. A size that is not a
+///				multiple of FLASHMGR_ALIGN is padded with 0xFF, which leaves the
+///				remaining erased bytes untouched.
+///
+/// \param[in]	u32Addr		Flash address. Must be FLASHMGR_ALIGN aligned.
+/// \param[in]	pvData		Source buffer.
+/// \param[in]	u32Size		Number of bytes to write.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool FlashMgrWrite(UINT32 u32Addr, const void* pvData, UINT32 u32Size)
+{
+	bool			bRet								= FALSE;
+	UINT32			au32Bounce[FLASHMGR_BOUNCE_WORDS];
+	const UINT8*	pu8Data								= (const UINT8*)pvData;
+	UINT32			u32Chunk							= 0;
+	UINT32			u32Padded							= 0;
+
+	if (!oFlashMgr.bIsInitialized || !pvData || (u32Addr % FLASHMGR_ALIGN))
+	{
+		goto END;
+	}
+
+	while (u32Size > 0)
+	{
+		u32Chunk	= (u32Size < sizeof(au32Bounce)) ? u32Size : sizeof(au32Bounce);
+		u32Padded	= (u32Chunk + FLASHMGR_ALIGN - 1) & ~(FLASHMGR_ALIGN - 1);
+
+		memset(au32Bounce, 0xFF, u32Padded);
+		memcpy(au32Bounce, pu8Data, u32Chunk);
+
+		bRet = FlashMgrLowWrite(u32Addr, au32Bounce, u32Padded);
+		if (!bRet) goto END;
+
+		pu8Data	+= u32Chunk;
+		u32Addr	+= u32Chunk;
+		u32Size	-= u32Chunk;
+	}
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+#ifdef ARDUINO_ARCH_ESP8266
+
+static bool FlashMgrLowErase(UINT32 u32Sector)
+{
+	return spi_flash_erase_sector((UINT16)u32Sector) == SPI_FLASH_RESULT_OK;
+}
+
+static bool FlashMgrLowRead(UINT32 u32Addr, UINT32* pu32Data, UINT32 u32Size)
+{
+	return spi_flash_read(u32Addr, pu32Data, u32Size) == SPI_FLASH_RESULT_OK;
+}
+
+static bool FlashMgrLowWrite(UINT32 u32Addr, const UINT32* pu32Data, UINT32 u32Size)
+{
+	return spi_flash_write(u32Addr, (UINT32*)pu32Data, u32Size) == SPI_FLASH_RESULT_OK;
+}
+
+static UINT32 FlashMgrSketchEnd()
+{
+	UINT32	au32Header[2];
+	UINT32	u32Addr		= FLASHMGR_APP_START;
+	UINT8	u8Segments	= 0;
+	UINT8	u8Idx		= 0;
+
+	// Image header (magic, segment count, flash mode and size, entry), then
+	// each segment (address, size, data). Same walk as ESP.getSketchSize().
+	if (!FlashMgrLowRead(u32Addr, au32Header, sizeof(au32Header)))
+	{
+		return MAX_VAL_UINT32;
+	}
+	u8Segments	= (UINT8)(au32Header[0] >> 8);
+	u32Addr		+= sizeof(au32Header);
+
+	for (u8Idx = 0; u8Idx < u8Segments; ++u8Idx)
+	{
+		if (!FlashMgrLowRead(u32Addr, au32Header, sizeof(au32Header)))
+		{
+			return MAX_VAL_UINT32;
+		}
+		u32Addr += sizeof(au32Header) + au32Header[1];
+	}
+
+	// Checksum byte, padded to 16 bytes.
+	return (u32Addr + 16) & ~15UL;
+}
+
+#else
+
+static bool FlashMgrLowErase(UINT32 u32Sector)
+{
+	UINT32 u32Addr = u32Sector * FLASHMGR_SECTOR_SIZE;
+
+	if (u32Addr + FLASHMGR_SECTOR_SIZE > FLASHMGR_SIM_SIZE)
+	{
+		return FALSE;
+	}
+
+	memset(&pu8SimFlash[u32Addr], 0xFF, FLASHMGR_SECTOR_SIZE);
+	FlashMgrSimDelay((UINT64)u32SimEraseUs * 1000);
+
+	return TRUE;
+}
+
+static bool FlashMgrLowRead(UINT32 u32Addr, UINT32* pu32Data, UINT32 u32Size)
+{
+	if (u32Addr + u32Size > FLASHMGR_SIM_SIZE)
+	{
+		return FALSE;
+	}
+
+	memcpy(pu32Data, &pu8SimFlash[u32Addr], u32Size);
+
+	return TRUE;
+}
+
+static bool FlashMgrLowWrite(UINT32 u32Addr, const UINT32* pu32Data, UINT32 u32Size)
+{
+	const UINT8*	pu8Data	= (const UINT8*)pu32Data;
+	UINT32			u32Idx	= 0;
+
+	if (u32Addr + u32Size > FLASHMGR_SIM_SIZE)
+	{
+		return FALSE;
+	}
+
+	// NOR flash: programming can only clear bits.
+	for (u32Idx = 0; u32Idx < u32Size; ++u32Idx)
+	{
+		pu8SimFlash[u32Addr + u32Idx] &= pu8Data[u32Idx];
+	}
+
+	FlashMgrSimDelay((UINT64)u32SimWriteNsPerByte * u32Size);
+
+	return TRUE;
+}
+
+static void FlashMgrSimDelay(UINT64 u64Ns)
+{
+	struct timespec oDelay;
+
+	if (u64Ns)
+	{
+		oDelay.tv_sec	= (time_t)(u64Ns / 1000000000ULL);
+		oDelay.tv_nsec	= (long)(u64Ns % 1000000000ULL);
+		nanosleep(&oDelay, NULL);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		FlashMgrSimAttach - Backs the simulated flash with a file.
+/// \public
+/// \details	Host builds only. Must be called before FlashMgrInit(). A new
+///				or short file is extended with erased (0xFF) bytes, an
+///				existing one keeps its content, like a real chip across a
+///				power cycle.
+///
+/// \param[in]	pszPath		Backing file.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool FlashMgrSimAttach(const char* pszPath)
+{
+	bool		bRet	= FALSE;
+	int			iFd		= -1;
+	struct stat	oStat;
+	void*		pvMap	= MAP_FAILED;
+
+	if (oFlashMgr.bIsInitialized || bSimAttached || !pszPath)
+	{
+		goto END;
+	}
+
+	iFd = open(pszPath, O_RDWR | O_CREAT, 0644);
+	if ((iFd < 0) || fstat(iFd, &oStat)) goto END;
+
+	if ((UINT64)oStat.st_size < FLASHMGR_SIM_SIZE)
+	{
+		if (ftruncate(iFd, FLASHMGR_SIM_SIZE)) goto END;
+	}
+
+	pvMap = mmap(NULL, FLASHMGR_SIM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0);
+	if (pvMap == MAP_FAILED) goto END;
+
+	if ((UINT64)oStat.st_size < FLASHMGR_SIM_SIZE)
+	{
+		memset((UINT8*)pvMap + oStat.st_size, 0xFF, FLASHMGR_SIM_SIZE - oStat.st_size);
+	}
+
+	pu8SimFlash		= (UINT8*)pvMap;
+	bSimAttached	= TRUE;
+
+	bRet = TRUE;
+END:
+	if (iFd >= 0)
+	{
+		close(iFd);
+	}
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		FlashMgrSimSetTiming - Slows the simulated flash down.
+/// \public
+/// \details	Host builds only. A real ESP8266 flash takes around 40 ms to
+///				erase a sector and a few hundred ns per programmed byte.
+///
+/// \param[in]	u32EraseUs			Time to erase a sector, in us. 0 for none.
+/// \param[in]	u32WriteNsPerByte	Time to program a byte, in ns. 0 for none.
+////////////////////////////////////////////////////////////////////////////////
+void FlashMgrSimSetTiming(UINT32 u32EraseUs, UINT32 u32WriteNsPerByte)
+{
+	u32SimEraseUs			= u32EraseUs;
+	u32SimWriteNsPerByte	= u32WriteNsPerByte;
+}
+
+#endif
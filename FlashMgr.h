@@ -0,0 +1,61 @@
+///
+/// \file     FlashMgr.h
+/// \brief    Raw flash access manager (sector erase, read and write)
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef FLASHMGR_H
+#define FLASHMGR_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define FLASHMGR_SECTOR_SIZE    4096        ///< Erase unit, in bytes.
+#define FLASHMGR_ALIGN          4           ///< Required alignment of flash addresses, in bytes.
+#define FLASHMGR_LANG_SIZE      (4UL * FLASHMGR_SECTOR_SIZE)    ///< Language packs partition, at most.
+
+#ifndef ARDUINO_ARCH_ESP8266
+#define FLASHMGR_SIM_OTA_SIZE   (1024UL * 1024UL)   ///< Size of the simulated update partition.
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   FlashMgrPartTy
+/// \brief  Flash partitions known by the manager.
+///
+typedef enum
+{
+	FLASHMGR_PART_CONFIG	= 0,	///< Persistent configuration block (EEPROM emulation sector).
+	FLASHMGR_PART_OTA,				///< Inactive image, receives a firmware update.
+	FLASHMGR_PART_OTA_STATE,		///< Progress records of the firmware update (one sector).
+	FLASHMGR_PART_LANG,				///< Language packs (see StringTable).
+
+	FLASHMGR_PART_MAX				///< Number of partitions.
+} FlashMgrPartTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool FlashMgrInit();
+bool FlashMgrGetPartition(FlashMgrPartTy ePart, UINT32* pu32Addr, UINT32* pu32Size);
+bool FlashMgrErase(UINT32 u32Addr, UINT32 u32Size);
+bool FlashMgrRead(UINT32 u32Addr, void* pvData, UINT32 u32Size);
+bool FlashMgrWrite(UINT32 u32Addr, const void* pvData, UINT32 u32Size);
+
+#ifndef ARDUINO_ARCH_ESP8266
+bool FlashMgrSimAttach(const char* pszPath);
+void FlashMgrSimSetTiming(UINT32 u32EraseUs, UINT32 u32WriteNsPerByte);
+#endif
+
+#endif
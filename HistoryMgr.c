@@ -0,0 +1,213 @@
+///
+/// \file     HistoryMgr.c
+/// \brief    Recent readings history
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <string.h>
+#include "HistoryMgr.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define HISTORYMGR_SLOT(seq)    ((seq) % HISTORYMGR_BLOCK_COUNT)
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oHistoryMgrTy
+/// \brief 	HistoryMgr object.
+///
+/// Blocks are numbered with an ever increasing sequence number; block n lives
+/// in slot n % HISTORYMGR_BLOCK_COUNT. A reader notices that the block it is
+/// reading was recycled when the slot holds another sequence number.
+typedef struct
+{
+	bool				bStarted;										///< At least one reading stored.
+	UINT32				u32FirstSeq;									///< Oldest block still held.
+	UINT32				u32HeadSeq;										///< Block being written.
+	UINT32				au32Seq[HISTORYMGR_BLOCK_COUNT];				///< Sequence number of each slot.
+	oSeriesEncoderTy	oEncoder;										///< Writer of the head block.
+	UINT8				au8Block[HISTORYMGR_BLOCK_COUNT][HISTORYMGR_BLOCK_SIZE];
+} oHistoryMgrTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oHistoryMgrTy oHistoryMgr = {FALSE};
+
+MEMSTATS_REGISTER(HistoryMgr, sizeof(oHistoryMgr))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HistoryMgrAppend - Adds a reading.
+/// \public
+///
+/// \param[in]	u32Timestamp	System time of the reading.
+/// \param[in]	u16Raw			Raw average.
+/// \param[in]	u8Value			Moisture, in %.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryMgrAppend(UINT32 u32Timestamp, UINT16 u16Raw, UINT8 u8Value)
+{
+	UINT8* pu8Block = NULL;
+
+	if (!oHistoryMgr.bStarted)
+	{
+		oHistoryMgr.u32FirstSeq	= 1;
+		oHistoryMgr.u32HeadSeq	= 1;
+		oHistoryMgr.au32Seq[HISTORYMGR_SLOT(1)] = 1;
+		SeriesEncoderInit(&oHistoryMgr.oEncoder, oHistoryMgr.au8Block[HISTORYMGR_SLOT(1)], HISTORYMGR_BLOCK_SIZE);
+		oHistoryMgr.bStarted	= TRUE;
+	}
+
+	if (SeriesEncoderAppend(&oHistoryMgr.oEncoder, u32Timestamp, u16Raw, u8Value))
+	{
+		return TRUE;
+	}
+
+	// Head block full: recycle the oldest one.
+	++oHistoryMgr.u32HeadSeq;
+	if (oHistoryMgr.u32HeadSeq - oHistoryMgr.u32FirstSeq >= HISTORYMGR_BLOCK_COUNT)
+	{
+		oHistoryMgr.u32FirstSeq = oHistoryMgr.u32HeadSeq - HISTORYMGR_BLOCK_COUNT + 1;
+	}
+
+	oHistoryMgr.au32Seq[HISTORYMGR_SLOT(oHistoryMgr.u32HeadSeq)] = oHistoryMgr.u32HeadSeq;
+	pu8Block = oHistoryMgr.au8Block[HISTORYMGR_SLOT(oHistoryMgr.u32HeadSeq)];
+
+	return SeriesEncoderInit(&oHistoryMgr.oEncoder, pu8Block, HISTORYMGR_BLOCK_SIZE)
+		&& SeriesEncoderAppend(&oHistoryMgr.oEncoder, u32Timestamp, u16Raw, u8Value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HistoryMgrGetCount - Gets the number of readings held.
+/// \public
+///
+/// \return		Number of readings.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 HistoryMgrGetCount()
+{
+	UINT32			u32Seq		= 0;
+	UINT32			u32Count	= 0;
+	const UINT8*	pu8Block	= NULL;
+
+	if (!oHistoryMgr.bStarted)
+	{
+		return 0;
+	}
+
+	// The count is the first field of each block.
+	for (u32Seq = oHistoryMgr.u32FirstSeq; u32Seq <= oHistoryMgr.u32HeadSeq; ++u32Seq)
+	{
+		pu8Block	= oHistoryMgr.au8Block[HISTORYMGR_SLOT(u32Seq)];
+		u32Count	+= pu8Block[0] | ((UINT16)pu8Block[1] << 8);
+	}
+
+	return u32Count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HistoryMgrClear - Forgets all the readings.
+/// \public
+/// \details	Readers in progress end at their next call.
+////////////////////////////////////////////////////////////////////////////////
+void HistoryMgrClear()
+{
+	memset(oHistoryMgr.au32Seq, 0, sizeof(oHistoryMgr.au32Seq));
+	oHistoryMgr.bStarted = FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HistoryReaderInit - Positions a reader on the oldest reading.
+/// \public
+/// \details	The reader stops at the end of the block being written when it
+///				started. It survives appends; if the ring wraps over it, it
+///				skips what was dropped.
+///
+/// \param[out]	poReader	Reader.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryReaderInit(poHistoryReaderTy poReader)
+{
+	if (!poReader)
+	{
+		return FALSE;
+	}
+
+	poReader->bDone = !oHistoryMgr.bStarted;
+	if (poReader->bDone)
+	{
+		return TRUE;
+	}
+
+	poReader->u32Seq		= oHistoryMgr.u32FirstSeq;
+	poReader->u32LastSeq	= oHistoryMgr.u32HeadSeq;
+
+	return SeriesDecoderInit(&poReader->oDecoder, oHistoryMgr.au8Block[HISTORYMGR_SLOT(poReader->u32Seq)], HISTORYMGR_BLOCK_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HistoryReaderNext - Reads the next reading.
+/// \public
+///
+/// \param[in]	poReader		Reader.
+/// \param[out]	pu32Timestamp	System time of the reading.
+/// \param[out]	pu16Raw			Raw average.
+/// \param[out]	pu8Value		Moisture, in %.
+///
+/// \return		TRUE if a reading was read, FALSE at the end.
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryReaderNext(poHistoryReaderTy poReader, UINT32* pu32Timestamp, UINT16* pu16Raw, UINT8* pu8Value)
+{
+	while (poReader && !poReader->bDone)
+	{
+		if (!oHistoryMgr.bStarted)
+		{
+			break;
+		}
+
+		// Recycled under the reader: go on with the oldest block left.
+		if (oHistoryMgr.au32Seq[HISTORYMGR_SLOT(poReader->u32Seq)] != poReader->u32Seq)
+		{
+			poReader->u32Seq = oHistoryMgr.u32FirstSeq;
+			if (poReader->u32LastSeq < poReader->u32Seq)
+			{
+				poReader->u32LastSeq = oHistoryMgr.u32HeadSeq;
+			}
+
+			SeriesDecoderInit(&poReader->oDecoder, oHistoryMgr.au8Block[HISTORYMGR_SLOT(poReader->u32Seq)], HISTORYMGR_BLOCK_SIZE);
+			continue;
+		}
+
+		if (SeriesDecoderNext(&poReader->oDecoder, pu32Timestamp, pu16Raw, pu8Value))
+		{
+			return TRUE;
+		}
+
+		if (poReader->u32Seq >= poReader->u32LastSeq)
+		{
+			break;
+		}
+
+		++poReader->u32Seq;
+		SeriesDecoderInit(&poReader->oDecoder, oHistoryMgr.au8Block[HISTORYMGR_SLOT(poReader->u32Seq)], HISTORYMGR_BLOCK_SIZE);
+	}
+
+	if (poReader)
+	{
+		poReader->bDone = TRUE;
+	}
+
+	return FALSE;
+}
@@ -0,0 +1,56 @@
+///
+/// \file     HistoryMgr.h
+/// \brief    Recent readings history
+/// \details  Keeps the last published readings in RAM, compressed with
+///           SeriesCodec into a ring of small blocks. When the ring is full
+///           the oldest block is dropped. A reader walks the history one
+///           reading at a time, from the oldest, so it can be streamed (see
+///           WebMgr) without ever being expanded in memory.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef HISTORYMGR_H
+#define HISTORYMGR_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "SeriesCodec.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define HISTORYMGR_BLOCK_SIZE   256         ///< Bytes per block, about 100 readings.
+#define HISTORYMGR_BLOCK_COUNT  16          ///< Blocks in the ring.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oHistoryReaderTy
+/// \brief 	Position of a reader in the history.
+///
+typedef struct
+{
+	UINT32				u32Seq;				///< Sequence number of the block being read.
+	UINT32				u32LastSeq;			///< Block being written when the reader started.
+	oSeriesDecoderTy	oDecoder;			///< Position within the block.
+	bool				bDone;
+} oHistoryReaderTy, *poHistoryReaderTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool HistoryMgrAppend(UINT32 u32Timestamp, UINT16 u16Raw, UINT8 u8Value);
+UINT32 HistoryMgrGetCount();
+void HistoryMgrClear();
+
+bool HistoryReaderInit(poHistoryReaderTy poReader);
+bool HistoryReaderNext(poHistoryReaderTy poReader, UINT32* pu32Timestamp, UINT16* pu16Raw, UINT8* pu8Value);
+
+#endif
@@ -0,0 +1,415 @@
+///
+/// \file     IrrigationMgr.c
+/// \brief    Closed-loop irrigation controller
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "IrrigationMgr.h"
+#include "SensorHealth.h"
+#include "SystemTime.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool IrrigationMgrOpen(poIrrigationMgrTy this, UINT32 u32For);
+static void IrrigationMgrClose(poIrrigationMgrTy this);
+static void IrrigationMgrMeter(poIrrigationMgrTy this, UINT32 u32Until);
+static void IrrigationMgrNewDay(poIrrigationMgrTy this);
+static UINT32 IrrigationMgrTimeLeft(poIrrigationMgrTy this);
+static void IrrigationMgrPI(poIrrigationMgrTy this, UINT8 u8Value, UINT32 u32Dt);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oIrrigationMgrTy oIrrigationMgr = {FALSE};
+
+MEMSTATS_REGISTER(IrrigationMgr, sizeof(oIrrigationMgr))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgr - Initializes the irrigation controller.
+/// \public
+/// \details	The valve is closed right away. Nothing is watered before
+///				IrrigationMgrConfigure().
+///
+/// \param[in]	u8Pin	Valve output, active high.
+///
+/// \return		Pointer to the instance.
+////////////////////////////////////////////////////////////////////////////////
+poIrrigationMgrTy IrrigationMgr(UINT8 u8Pin)
+{
+	poIrrigationMgrTy this = &oIrrigationMgr;
+
+	memset(this, 0, sizeof(*this));
+
+	this->u8Mode		= IRRIGATION_MODE;
+	this->u8Low			= IRRIGATION_LOW;
+	this->u8High		= IRRIGATION_HIGH;
+	this->u8Setpoint	= IRRIGATION_SETPOINT;
+	this->u16Kp			= IRRIGATION_KP;
+	this->u16Ki			= IRRIGATION_KI;
+	this->u32MaxOn		= IRRIGATION_MAX_ON;
+	this->u32MinOff		= IRRIGATION_MIN_OFF;
+	this->u16Flow		= IRRIGATION_FLOW;
+	this->u32DailyCap	= IRRIGATION_DAILY_CAP;
+	this->u8Pin			= u8Pin;
+
+	pinMode(u8Pin, OUTPUT);
+	digitalWrite(u8Pin, LOW);
+
+	return this;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrConfigure - Applies the settings.
+/// \public
+/// \details	Only the PI error sum is reset: the volume already given today
+///				and the minimum off-time still apply after a change.
+///
+/// \return		TRUE if success, FALSE if the settings are not usable.
+////////////////////////////////////////////////////////////////////////////////
+bool IrrigationMgrConfigure(poIrrigationMgrTy this)
+{
+	bool bRet = FALSE;
+
+	if (!this) goto END;
+
+	bRet = (this->u8Mode < IRRIGATIONMGR_MODE_MAX)
+		&& (this->u8Low < this->u8High) && (this->u8High <= 100)
+		&& (this->u8Setpoint <= 100)
+		&& this->u32MaxOn && this->u16Flow;
+	if (!bRet) goto END;
+
+	if (!this->bIsConfigured)
+	{
+		this->u32DayStart = SystemTimeGetTime();
+	}
+
+	if (this->u8Mode == IRRIGATIONMGR_MODE_OFF)
+	{
+		IrrigationMgrClose(this);
+	}
+
+	this->i32Integral	= 0;
+	this->bIsConfigured	= TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrOnReading - Runs the controller on a new reading.
+/// \public
+/// \details	Call it as soon as MoistSensorMgrIsNewReadingAvail() reports a
+///				reading, before anything else in the loop() iteration. The
+///				readings the report deadband suppresses count too.
+///
+/// \param[in]	poSensor	Sensor manager, holding the reading.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool IrrigationMgrOnReading(poIrrigationMgrTy this, const oMoistSensorMgrTy* poSensor)
+{
+	UINT32 u32Latency	= 0;
+	UINT32 u32Dt		= 0;
+
+	if (!this || !this->bIsConfigured || !poSensor)
+	{
+		return FALSE;
+	}
+
+	IrrigationMgrNewDay(this);
+
+	if (this->bHasReading)
+	{
+		u32Dt = SystemTimeGetTimeDiff(this->u32LastReading);
+	}
+
+	// The sensor settings can change at runtime (see ConfigMgrApplySensor).
+	this->u32StaleTimeout	= 2 * poSensor->u32Heartbeat + poSensor->u32ReadingIntervalMax;
+	this->u32LastReading	= SystemTimeGetTime();
+	this->bHasReading		= TRUE;
+	++this->u32Readings;
+
+	if (poSensor->u8ReadingQuality == SENSORHEALTH_QUALITY_BAD)
+	{
+		// Not a moisture value: never water on it.
+		if (this->u8Mode != IRRIGATIONMGR_MODE_OFF)
+		{
+			++this->u32BlockedFault;
+		}
+		IrrigationMgrClose(this);
+	}
+	else
+	{
+		switch (this->u8Mode)
+		{
+		case IRRIGATIONMGR_MODE_HYSTERESIS:
+			if (poSensor->u8ReadingValue >= this->u8High)
+			{
+				IrrigationMgrClose(this);
+			}
+			else if ((poSensor->u8ReadingValue < this->u8Low) && !this->bOpen)
+			{
+				// Until the high threshold, or the maximum on-time.
+				IrrigationMgrOpen(this, this->u32MaxOn);
+			}
+			break;
+
+		case IRRIGATIONMGR_MODE_PI:
+			IrrigationMgrPI(this, poSensor->u8ReadingValue, u32Dt);
+			break;
+
+		default:
+			IrrigationMgrClose(this);
+			break;
+		}
+	}
+
+	u32Latency = micros() - poSensor->u32ReadingMicros;
+
+	this->u32LatencyLast = u32Latency;
+	if (u32Latency > this->u32LatencyMax)
+	{
+		this->u32LatencyMax = u32Latency;
+	}
+	if (u32Latency > IRRIGATIONMGR_LATENCY_BUDGET)
+	{
+		++this->u32LatencyOverruns;
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrTask - Periodic processing. Call it from loop().
+/// \public
+/// \details	Ends the openings: planned duration, maximum on-time, stale
+///				sensor. Only an opening planned beyond the maximum on-time (a
+///				PI pulse extended) counts as a cutoff.
+////////////////////////////////////////////////////////////////////////////////
+void IrrigationMgrTask()
+{
+	poIrrigationMgrTy	this		= &oIrrigationMgr;
+	UINT32				u32Elapsed	= 0;
+
+	if (!this->bIsConfigured)
+	{
+		return;
+	}
+
+	IrrigationMgrNewDay(this);
+
+	if (!this->bOpen)
+	{
+		return;
+	}
+
+	u32Elapsed = SystemTimeGetTimeDiff(this->u32OpenTime);
+
+	if (u32Elapsed >= this->u32OpenFor)
+	{
+		IrrigationMgrClose(this);
+	}
+	else if (u32Elapsed >= this->u32MaxOn)
+	{
+		++this->u32MaxOnCutoffs;
+		IrrigationMgrClose(this);
+	}
+	else if (this->bHasReading && (SystemTimeGetTimeDiff(this->u32LastReading) > this->u32StaleTimeout))
+	{
+		++this->u32StaleCloses;
+		IrrigationMgrClose(this);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrOpen - Opens the valve, within the safety limits.
+///
+/// \param[in]	u32For	Wanted duration, in ms. Shortened to the maximum
+///						on-time and to the volume left today.
+///
+/// \return		TRUE if the valve is open.
+////////////////////////////////////////////////////////////////////////////////
+static bool IrrigationMgrOpen(poIrrigationMgrTy this, UINT32 u32For)
+{
+	UINT32 u32Left = 0;
+
+	if (this->bHasClosed && (SystemTimeGetTimeDiff(this->u32CloseTime) < this->u32MinOff))
+	{
+		++this->u32BlockedMinOff;
+		return FALSE;
+	}
+
+	u32Left = IrrigationMgrTimeLeft(this);
+	if (u32Left < u32For)
+	{
+		u32For = u32Left;
+	}
+
+	if (u32For > this->u32MaxOn)
+	{
+		u32For = this->u32MaxOn;
+	}
+
+	if (!u32For)
+	{
+		++this->u32BlockedCap;
+		return FALSE;
+	}
+
+	digitalWrite(this->u8Pin, HIGH);
+
+	this->bOpen			= TRUE;
+	this->u32OpenTime	= SystemTimeGetTime();
+	this->u32MeterTime	= this->u32OpenTime;
+	this->u32OpenFor	= u32For;
+	++this->u32Openings;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrClose - Closes the valve and accounts the water.
+////////////////////////////////////////////////////////////////////////////////
+static void IrrigationMgrClose(poIrrigationMgrTy this)
+{
+	if (!this->bOpen)
+	{
+		return;
+	}
+
+	digitalWrite(this->u8Pin, LOW);
+
+	this->u32CloseTime		= SystemTimeGetTime();
+	IrrigationMgrMeter(this, this->u32CloseTime);
+	this->bHasClosed		= TRUE;
+	this->bOpen				= FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrMeter - Accounts the water of the open valve.
+///
+/// \param[in]	u32Until	End of the water to account: now, or the end of
+///							the window when the opening runs across it.
+////////////////////////////////////////////////////////////////////////////////
+static void IrrigationMgrMeter(poIrrigationMgrTy this, UINT32 u32Until)
+{
+	UINT32 u32Volume = 0;
+
+	// Rounded up: the daily cap must not lose a fraction of mL per opening.
+	u32Volume = (UINT32)(((UINT64)(UINT32)(u32Until - this->u32MeterTime) * this->u16Flow + 59999) / 60000);
+
+	this->u32VolumeToday	+= u32Volume;
+	this->u32VolumeTotal	+= u32Volume;
+	this->u32MeterTime		= u32Until;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrNewDay - Restarts the volume cap window.
+////////////////////////////////////////////////////////////////////////////////
+static void IrrigationMgrNewDay(poIrrigationMgrTy this)
+{
+	while (SystemTimeGetTimeDiff(this->u32DayStart) >= IRRIGATIONMGR_DAY)
+	{
+		this->u32DayStart += IRRIGATIONMGR_DAY;
+
+		// An opening across the boundary: what ran before it belongs to the
+		// window that ends, the rest to the new one.
+		if (this->bOpen)
+		{
+			IrrigationMgrMeter(this, this->u32DayStart);
+		}
+
+		this->u32VolumeToday = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrTimeLeft - Watering time left under the daily cap.
+///
+/// \return		Time, in ms, from now. Counts the opening in progress.
+////////////////////////////////////////////////////////////////////////////////
+static UINT32 IrrigationMgrTimeLeft(poIrrigationMgrTy this)
+{
+	UINT64 u64Used = (UINT64)this->u32VolumeToday * 60000 / this->u16Flow;
+	UINT64 u64Cap = (UINT64)this->u32DailyCap * 60000 / this->u16Flow;
+
+	if (this->bOpen)
+	{
+		u64Used += SystemTimeGetTimeDiff(this->u32MeterTime);
+	}
+
+	return (u64Used < u64Cap) ? (UINT32)(u64Cap - u64Used) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		IrrigationMgrPI - PI step on a new reading.
+/// \details	The output is the length of the next watering pulse. A pulse
+///				in progress is extended, never shortened, except when the
+///				output falls to 0.
+///
+/// \param[in]	u8Value		Moisture, in %.
+/// \param[in]	u32Dt		Time since the previous reading, in ms.
+////////////////////////////////////////////////////////////////////////////////
+static void IrrigationMgrPI(poIrrigationMgrTy this, UINT8 u8Value, UINT32 u32Dt)
+{
+	INT32	i32Error	= (INT32)this->u8Setpoint - u8Value;
+	INT64	i64Pulse	= 0;
+	INT64	i64Integral	= this->i32Integral;
+	INT64	i64Bound	= (INT64)IRRIGATIONMGR_INTEGRAL_MAX * IRRIGATIONMGR_INTEGRAL_PERIOD;
+	INT32	i32Pulse	= 0;
+	UINT32	u32Elapsed	= 0;
+	UINT32	u32Left		= 0;
+
+	i64Pulse = (INT64)i32Error * this->u16Kp + i64Integral * this->u16Ki / IRRIGATIONMGR_INTEGRAL_PERIOD;
+
+	// Anti-windup: do not integrate further into the saturation.
+	if (!((i64Pulse >= this->u32MaxOn) && (i32Error > 0)) && !((i64Pulse <= 0) && (i32Error < 0)))
+	{
+		// The error held since the previous reading.
+		i64Integral += (INT64)i32Error * u32Dt / 1000;
+		if (i64Integral > i64Bound)		i64Integral = i64Bound;
+		if (i64Integral < -i64Bound)	i64Integral = -i64Bound;
+		this->i32Integral = (INT32)i64Integral;
+	}
+
+	if (i64Pulse <= 0)
+	{
+		IrrigationMgrClose(this);
+		return;
+	}
+
+	if (i64Pulse > this->u32MaxOn)
+	{
+		i64Pulse = this->u32MaxOn;
+	}
+	i32Pulse = (INT32)i64Pulse;
+
+	if (!this->bOpen)
+	{
+		IrrigationMgrOpen(this, (UINT32)i32Pulse);
+		return;
+	}
+
+	// Still bounded by the maximum on-time from IrrigationMgrTask().
+	u32Left = IrrigationMgrTimeLeft(this);
+	if (u32Left < (UINT32)i32Pulse)
+	{
+		i32Pulse = (INT32)u32Left;
+	}
+
+	u32Elapsed = SystemTimeGetTimeDiff(this->u32OpenTime);
+	if (u32Elapsed + (UINT32)i32Pulse > this->u32OpenFor)
+	{
+		this->u32OpenFor = u32Elapsed + (UINT32)i32Pulse;
+	}
+}
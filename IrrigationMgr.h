@@ -0,0 +1,142 @@
+///
+/// \file     IrrigationMgr.h
+/// \brief    Closed-loop irrigation controller
+/// \details  Drives a valve (or pump) output from the readings of
+///           MoistSensorMgr, every one of them: the report deadband must not
+///           slow the control loop down. With either:
+///           - hysteresis: open below a low threshold, close at a high one;
+///           - PI: at each reading, water for a pulse proportional to the
+///             error to the set point and to its sum over time (anti-windup:
+///             the sum is bounded and frozen while the pulse is saturated).
+///             The sum is weighted by the time between the readings, so the
+///             gain does not depend on the reading interval.
+///
+///           Safety limits, checked before any opening and enforced from
+///           IrrigationMgrTask() whatever the controller asks:
+///           - maximum on-time of one opening;
+///           - minimum off-time between two openings;
+///           - daily volume cap (from the flow rate and the on-time);
+///           - no opening on a BAD quality reading, and the valve closes
+///             when the readings stop coming (stale sensor: twice the
+///             heartbeat plus the longest reading interval of the sensor).
+///
+///           Reading-to-actuation latency: IrrigationMgrOnReading() is called
+///           in the same loop() iteration as the MoistSensorMgrTask() that
+///           processed the reading, before any network work, and decides in
+///           constant time; the output is written right away. The delay from
+///           the processing (u32ReadingMicros of the sensor) to the output
+///           write is measured at each reading and checked against
+///           IRRIGATIONMGR_LATENCY_BUDGET.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef IRRIGATIONMGR_H
+#define IRRIGATIONMGR_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "MoistSensorMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+// Default tunables. The values actually used at runtime come from the
+// configuration block (see ConfigMgr).
+#define IRRIGATION_MODE             IRRIGATIONMGR_MODE_OFF  ///< Nothing is watered until configured.
+#define IRRIGATION_LOW              30          ///< Hysteresis: open below, in %.
+#define IRRIGATION_HIGH             45          ///< Hysteresis: close at or above, in %.
+#define IRRIGATION_SETPOINT         40          ///< PI: target moisture, in %.
+#define IRRIGATION_KP               2000        ///< PI: watering per % of error, in ms.
+#define IRRIGATION_KI               200         ///< PI: watering per % of error held for IRRIGATIONMGR_INTEGRAL_PERIOD, in ms.
+#define IRRIGATION_MAX_ON           300000UL    ///< Longest opening, in ms.
+#define IRRIGATION_MIN_OFF          900000UL    ///< Shortest time closed between two openings, in ms.
+#define IRRIGATION_FLOW             2000        ///< Flow when open, in mL/min.
+#define IRRIGATION_DAILY_CAP        20000UL     ///< Water per day, in mL.
+
+#define IRRIGATIONMGR_INTEGRAL_PERIOD   900     ///< Unit of time of the PI error sum, in s.
+#define IRRIGATIONMGR_INTEGRAL_MAX  500         ///< Bound of the PI error sum, in % * IRRIGATIONMGR_INTEGRAL_PERIOD.
+#define IRRIGATIONMGR_LATENCY_BUDGET    2000    ///< Longest accepted reading-to-actuation delay, in us.
+#define IRRIGATIONMGR_DAY               86400000UL  ///< Volume cap window, in ms.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   IrrigationMgrModeTy
+/// \brief  Controller.
+///
+typedef enum
+{
+	IRRIGATIONMGR_MODE_OFF		= 0,	///< Valve always closed.
+	IRRIGATIONMGR_MODE_HYSTERESIS,		///< On/off between two thresholds.
+	IRRIGATIONMGR_MODE_PI,				///< Pulses sized by a PI controller.
+
+	IRRIGATIONMGR_MODE_MAX,
+} IrrigationMgrModeTy;
+
+///
+/// \struct	oIrrigationMgrTy
+/// \brief 	IrrigationMgr object.
+///
+typedef struct
+{
+	bool			bIsConfigured;
+
+	// Settings (see ConfigMgrApplyIrrigation).
+	UINT8			u8Mode;							///< IrrigationMgrModeTy.
+	UINT8			u8Low;
+	UINT8			u8High;
+	UINT8			u8Setpoint;
+	UINT16			u16Kp;
+	UINT16			u16Ki;
+	UINT32			u32MaxOn;
+	UINT32			u32MinOff;
+	UINT16			u16Flow;
+	UINT32			u32DailyCap;
+
+	// Hardware configuration
+	UINT8			u8Pin;							///< Valve output, active high.
+
+	// State.
+	bool			bOpen;
+	UINT32			u32OpenTime;					///< Time of the last opening.
+	UINT32			u32OpenFor;						///< Planned duration of the current opening, in ms.
+	UINT32			u32MeterTime;					///< Start of the water of the opening not accounted yet.
+	UINT32			u32CloseTime;					///< Time of the last closing.
+	bool			bHasClosed;						///< u32CloseTime is valid.
+	INT32			i32Integral;					///< PI error sum, in % * s.
+	UINT32			u32LastReading;					///< Time of the last reading.
+	bool			bHasReading;
+	UINT32			u32StaleTimeout;				///< Time without a reading before closing, in ms, from the sensor settings.
+	UINT32			u32DayStart;					///< Start of the volume cap window.
+	UINT32			u32VolumeToday;					///< Water in the window, in mL (accounted up to u32MeterTime).
+
+	// Statistics.
+	UINT32			u32Readings;					///< Readings handled.
+	UINT32			u32Openings;
+	UINT32			u32BlockedMinOff;				///< Openings refused: minimum off-time.
+	UINT32			u32BlockedCap;					///< Openings refused: daily volume reached.
+	UINT32			u32BlockedFault;				///< Openings refused: BAD reading.
+	UINT32			u32MaxOnCutoffs;				///< Openings forced off by the maximum on-time before their planned end.
+	UINT32			u32StaleCloses;					///< Closings for lack of readings.
+	UINT32			u32LatencyLast;					///< Reading-to-actuation delay of the last reading, in us.
+	UINT32			u32LatencyMax;					///< Longest reading-to-actuation delay, in us.
+	UINT32			u32LatencyOverruns;				///< Readings over IRRIGATIONMGR_LATENCY_BUDGET.
+	UINT32			u32VolumeTotal;					///< Water since boot, in mL.
+} oIrrigationMgrTy, *poIrrigationMgrTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+poIrrigationMgrTy IrrigationMgr(UINT8 u8Pin);
+bool IrrigationMgrConfigure(poIrrigationMgrTy);
+bool IrrigationMgrOnReading(poIrrigationMgrTy, const oMoistSensorMgrTy* poSensor);
+void IrrigationMgrTask();
+
+#endif
@@ -0,0 +1,391 @@
+///
+/// \file     MemStats.c
+/// \brief    Runtime memory accounting
+/// \details  On the ESP8266 loop() runs on the 4 KiB "cont" stack. The core
+///           paints it at boot with CONT_STACKGUARD; the same pattern is used
+///           here so the core's own free stack count stays meaningful. As a
+///           repaint hides deeper past uses from that count, the lowest value
+///           is sampled before each repaint.
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include "MemStats.h"
+
+#ifdef ARDUINO_ARCH_ESP8266
+#include "user_interface.h"
+#include "cont.h"
+#include "umm_malloc/umm_malloc.h"
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#ifdef ARDUINO_ARCH_ESP8266
+#define MEMSTATS_PAINT          CONT_STACKGUARD
+#else
+#define MEMSTATS_PAINT          0xFEEFEFFEUL
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+	const char*	pszName;
+	UINT32		u32Bytes;
+} oMemStatsModuleTy;
+
+///
+/// \struct	oMemStatsTy
+/// \brief 	MemStats object.
+///
+typedef struct
+{
+	oMemStatsModuleTy	aoModule[MEMSTATS_MODULE_MAX];	///< Static footprint table.
+	UINT8				u8ModuleCount;
+	UINT8				u8ModuleDropped;				///< Modules that did not fit in the table.
+	UINT32				u32DroppedBytes;				///< Static RAM of these modules.
+
+	oMemStatsTaskTy		aoTask[MEMSTATS_TASK_MAX];		///< Stack high-water marks.
+	UINT8				au8Countdown[MEMSTATS_TASK_MAX];	///< Calls before the next sample.
+	UINT8				u8TaskCount;
+
+	UINT8				u8Active;						///< Task being measured, MEMSTATS_TASK_NONE if none.
+	UINT8*				pu8Ref;							///< Stack reference of the measured call.
+	volatile UINT32*	pu32PaintLow;					///< Lowest painted word.
+	volatile UINT32*	pu32PaintHigh;					///< One past the highest painted word.
+
+	UINT32				u32HeapMinFree;					///< Lowest free heap seen.
+	UINT32				u32StackMinFree;				///< Lowest free cont stack seen.
+} oMemStatsTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void MemStatsSampleStack();
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+// Zero initialized (.bss), ready before the constructors of MEMSTATS_REGISTER()
+// run, whatever their order.
+static oMemStatsTy oMemStats;
+
+#ifdef ARDUINO_ARCH_ESP8266
+extern cont_t* g_pcont;									///< Context of loop(), from the core.
+#endif
+
+MEMSTATS_REGISTER(MemStats, sizeof(oMemStats))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsRegisterModule - Adds a module to the footprint table.
+/// \public
+/// \details	Normally called through MEMSTATS_REGISTER(). A module that does
+///				not fit in the table is still counted in the total.
+///
+/// \param[in]	pszName		Module name (static string).
+/// \param[in]	u32Bytes	Static RAM of the module.
+////////////////////////////////////////////////////////////////////////////////
+void MemStatsRegisterModule(const char* pszName, UINT32 u32Bytes)
+{
+	if (oMemStats.u8ModuleCount < MEMSTATS_MODULE_MAX)
+	{
+		oMemStats.aoModule[oMemStats.u8ModuleCount].pszName	= pszName;
+		oMemStats.aoModule[oMemStats.u8ModuleCount].u32Bytes	= u32Bytes;
+		++oMemStats.u8ModuleCount;
+	}
+	else
+	{
+		++oMemStats.u8ModuleDropped;
+		oMemStats.u32DroppedBytes += u32Bytes;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsTaskRegister - Declares a task to measure.
+/// \public
+///
+/// \param[in]	pszName		Task name (static string).
+///
+/// \return		Task ID, MEMSTATS_TASK_NONE if the table is full.
+////////////////////////////////////////////////////////////////////////////////
+UINT8 MemStatsTaskRegister(const char* pszName)
+{
+	UINT8 u8Task = MEMSTATS_TASK_NONE;
+
+	if (oMemStats.u8TaskCount < MEMSTATS_TASK_MAX)
+	{
+		u8Task = oMemStats.u8TaskCount++;
+
+		memset(&oMemStats.aoTask[u8Task], 0, sizeof(oMemStats.aoTask[u8Task]));
+		oMemStats.aoTask[u8Task].pszName	= pszName;
+		oMemStats.au8Countdown[u8Task]		= 1;
+		oMemStats.u8Active					= MEMSTATS_TASK_NONE;
+	}
+
+	return u8Task;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsTaskBegin - Call right before a task.
+/// \public
+/// \details	One call out of MEMSTATS_SAMPLE_EVERY paints the stack below
+///				the caller. Must be paired with MemStatsTaskEnd() in the same
+///				function, not nested.
+///
+/// \param[in]	u8Task		Task ID.
+////////////////////////////////////////////////////////////////////////////////
+void MemStatsTaskBegin(UINT8 u8Task)
+{
+	UINT8*				pu8Ref	= (UINT8*)__builtin_frame_address(0);
+	volatile UINT32*	pu32Low		= NULL;
+	volatile UINT32*	pu32Word	= NULL;
+
+	if ((u8Task >= oMemStats.u8TaskCount) || (oMemStats.u8Active != MEMSTATS_TASK_NONE))
+	{
+		return;
+	}
+
+	if (--oMemStats.au8Countdown[u8Task])
+	{
+		return;
+	}
+	oMemStats.au8Countdown[u8Task] = MEMSTATS_SAMPLE_EVERY;
+
+	MemStatsSampleStack();
+
+	pu32Low = (volatile UINT32*)(((size_t)pu8Ref - MEMSTATS_PAINT_DEPTH) & ~(size_t)3);
+
+#ifdef ARDUINO_ARCH_ESP8266
+	// Never below the cont stack, keep its first guard words.
+	if (pu32Low < (volatile UINT32*)&g_pcont->stack[4])
+	{
+		pu32Low = (volatile UINT32*)&g_pcont->stack[4];
+	}
+#endif
+
+	oMemStats.pu32PaintLow	= pu32Low;
+	oMemStats.pu32PaintHigh	= (volatile UINT32*)(((size_t)pu8Ref - MEMSTATS_PAINT_GAP) & ~(size_t)3);
+	oMemStats.pu8Ref		= pu8Ref;
+	oMemStats.u8Active		= u8Task;
+
+	for (pu32Word = pu32Low; pu32Word < oMemStats.pu32PaintHigh; ++pu32Word)
+	{
+		*pu32Word = MEMSTATS_PAINT;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsTaskEnd - Call right after a task.
+/// \public
+/// \details	A result of MEMSTATS_PAINT_GAP means "at most that much", one of
+///				MEMSTATS_PAINT_DEPTH means "at least".
+///
+/// \param[in]	u8Task		Task ID.
+////////////////////////////////////////////////////////////////////////////////
+void MemStatsTaskEnd(UINT8 u8Task)
+{
+	volatile UINT32*	pu32Word	= NULL;
+	poMemStatsTaskTy	poTask		= NULL;
+
+	if ((u8Task >= oMemStats.u8TaskCount) || (oMemStats.u8Active != u8Task))
+	{
+		return;
+	}
+
+	poTask = &oMemStats.aoTask[u8Task];
+
+	// The stack grows down: the first overwritten word from the bottom is
+	// the deepest point reached.
+	for (pu32Word = oMemStats.pu32PaintLow; (pu32Word < oMemStats.pu32PaintHigh) && (*pu32Word == MEMSTATS_PAINT); ++pu32Word)
+	{
+	}
+
+	poTask->u16StackLast = (UINT16)(oMemStats.pu8Ref - (UINT8*)pu32Word);
+	if (poTask->u16StackLast > poTask->u16StackMax)
+	{
+		poTask->u16StackMax = poTask->u16StackLast;
+	}
+	++poTask->u32Samples;
+
+	oMemStats.u8Active = MEMSTATS_TASK_NONE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsGetHeap - Gets the heap state.
+/// \public
+///
+/// \param[out]	poHeap		Heap state.
+///
+/// \return		TRUE if success, FALSE if not available on this target.
+////////////////////////////////////////////////////////////////////////////////
+bool MemStatsGetHeap(poMemStatsHeapTy poHeap)
+{
+	bool bRet = FALSE;
+
+	if (!poHeap) goto END;
+
+	memset(poHeap, 0, sizeof(*poHeap));
+
+#ifdef ARDUINO_ARCH_ESP8266
+	poHeap->u32Free			= system_get_free_heap_size();
+	poHeap->u32LargestBlock	= umm_max_block_size();
+
+	if (poHeap->u32Free)
+	{
+		poHeap->u8Fragmentation = (UINT8)(100 - (poHeap->u32LargestBlock * 100) / poHeap->u32Free);
+	}
+
+	if (!oMemStats.u32HeapMinFree || (poHeap->u32Free < oMemStats.u32HeapMinFree))
+	{
+		oMemStats.u32HeapMinFree = poHeap->u32Free;
+	}
+	poHeap->u32MinFree = oMemStats.u32HeapMinFree;
+
+	bRet = TRUE;
+#endif
+
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsGetTask - Gets the stack usage of a task.
+/// \public
+///
+/// \param[in]	u8Task		Task ID.
+/// \param[out]	poTask		Stack usage.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool MemStatsGetTask(UINT8 u8Task, poMemStatsTaskTy poTask)
+{
+	if ((u8Task >= oMemStats.u8TaskCount) || !poTask)
+	{
+		return FALSE;
+	}
+
+	*poTask = oMemStats.aoTask[u8Task];
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsGetStackFree - Gets the lowest free space of the loop()
+///				stack since boot.
+/// \public
+///
+/// \return		Bytes never used, 0 if not available on this target.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 MemStatsGetStackFree()
+{
+	MemStatsSampleStack();
+
+	return oMemStats.u32StackMinFree;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsFormatLine - Writes one line of the text report.
+/// \public
+/// \details	Call it with u8Line = 0, 1, 2... until it returns 0. One line at
+///				a time keeps the caller's buffer (and stack) small.
+///
+/// \param[in]	u8Line		Line number.
+/// \param[out]	pszBuffer	Destination, always NUL terminated.
+/// \param[in]	u16Size		Size of the destination.
+///
+/// \return		Length of the line (truncated to the buffer), 0 past the end.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 MemStatsFormatLine(UINT8 u8Line, char* pszBuffer, UINT16 u16Size)
+{
+	oMemStatsHeapTy	oHeap;
+	UINT32			u32Total	= 0;
+	UINT8			u8Idx		= 0;
+	int				iLen		= 0;
+
+	if (!pszBuffer || !u16Size)
+	{
+		return 0;
+	}
+
+	// Line 0: heap, line 1: stack, then the tasks, the modules and the total.
+	if (u8Line == 0)
+	{
+		if (MemStatsGetHeap(&oHeap))
+		{
+			iLen = snprintf(pszBuffer, u16Size, "heap free %lu (min %lu) largest %lu frag %u%%",
+				(unsigned long)oHeap.u32Free, (unsigned long)oHeap.u32MinFree, (unsigned long)oHeap.u32LargestBlock, oHeap.u8Fragmentation);
+		}
+		else
+		{
+			iLen = snprintf(pszBuffer, u16Size, "heap n/a");
+		}
+	}
+	else if (u8Line == 1)
+	{
+		iLen = snprintf(pszBuffer, u16Size, "stack free (min) %lu", (unsigned long)MemStatsGetStackFree());
+	}
+	else if ((u8Idx = u8Line - 2) < oMemStats.u8TaskCount)
+	{
+		iLen = snprintf(pszBuffer, u16Size, "task %-10s stack max %u last %u", oMemStats.aoTask[u8Idx].pszName,
+			oMemStats.aoTask[u8Idx].u16StackMax, oMemStats.aoTask[u8Idx].u16StackLast);
+	}
+	else if ((u8Idx = u8Line - 2 - oMemStats.u8TaskCount) < oMemStats.u8ModuleCount)
+	{
+		iLen = snprintf(pszBuffer, u16Size, "static %-14s %lu", oMemStats.aoModule[u8Idx].pszName, (unsigned long)oMemStats.aoModule[u8Idx].u32Bytes);
+	}
+	else if (u8Idx == oMemStats.u8ModuleCount)
+	{
+		u32Total = oMemStats.u32DroppedBytes;
+		for (u8Idx = 0; u8Idx < oMemStats.u8ModuleCount; ++u8Idx)
+		{
+			u32Total += oMemStats.aoModule[u8Idx].u32Bytes;
+		}
+
+		if (oMemStats.u8ModuleDropped)
+		{
+			iLen = snprintf(pszBuffer, u16Size, "static total %lu, %u modules not listed (table full)",
+				(unsigned long)u32Total, oMemStats.u8ModuleDropped);
+		}
+		else
+		{
+			iLen = snprintf(pszBuffer, u16Size, "static total %lu", (unsigned long)u32Total);
+		}
+	}
+	else
+	{
+		pszBuffer[0] = '\0';
+	}
+
+	if (iLen < 0)
+	{
+		iLen = 0;
+		pszBuffer[0] = '\0';
+	}
+
+	return (iLen < u16Size) ? (UINT16)iLen : (UINT16)(u16Size - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MemStatsSampleStack - Updates the lowest free loop() stack.
+////////////////////////////////////////////////////////////////////////////////
+static void MemStatsSampleStack()
+{
+#ifdef ARDUINO_ARCH_ESP8266
+	UINT32 u32Free = (UINT32)cont_get_free_stack(g_pcont);
+
+	if (!oMemStats.u32StackMinFree || (u32Free < oMemStats.u32StackMinFree))
+	{
+		oMemStats.u32StackMinFree = u32Free;
+	}
+#endif
+}
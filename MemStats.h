@@ -0,0 +1,88 @@
+///
+/// \file     MemStats.h
+/// \brief    Runtime memory accounting
+/// \details  - Heap: free bytes, largest free block and fragmentation.
+///           - Stack: high-water mark of each task called from loop(),
+///             measured by painting the unused stack below the caller
+///             before the task runs and looking for the deepest overwritten
+///             word after it returns. Sampled, not done at every call.
+///           - Static: RAM reserved by each module for its objects, declared
+///             in the module with MEMSTATS_REGISTER().
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define MEMSTATS_MODULE_MAX     32          ///< Modules in the static footprint table (24 registered).
+#define MEMSTATS_TASK_MAX       8           ///< Tasks with a stack high-water mark.
+#define MEMSTATS_TASK_NONE      0xFF        ///< Invalid task ID.
+#define MEMSTATS_PAINT_DEPTH    2048        ///< Stack painted below the caller, in bytes.
+#define MEMSTATS_PAINT_GAP      128         ///< Stack left untouched right below the caller (own frame), in bytes.
+#define MEMSTATS_SAMPLE_EVERY   16          ///< Measure one task call out of this many.
+#define MEMSTATS_LINE_MAX       64          ///< Longest line of MemStatsFormatLine(), with the NUL.
+
+///
+/// Declares the static RAM of a module, at file scope, e.g.
+/// MEMSTATS_REGISTER(ConfigMgr, sizeof(oConfigMgr)). The entry is added
+/// before setup() runs. Does nothing in the host builds.
+///
+#ifdef ARDUINO_ARCH_ESP8266
+#define MEMSTATS_REGISTER(name, bytes) \
+	static void __attribute__((constructor)) MemStatsRegister_##name(void) { MemStatsRegisterModule(#name, (UINT32)(bytes)); }
+#else
+#define MEMSTATS_REGISTER(name, bytes)
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oMemStatsHeapTy
+/// \brief 	Heap state, for the serial output and the metrics.
+///
+typedef struct
+{
+	UINT32		u32Free;				///< Free heap, in bytes.
+	UINT32		u32LargestBlock;		///< Largest block that can be allocated, in bytes.
+	UINT8		u8Fragmentation;		///< 0 %: all the free heap in one block.
+	UINT32		u32MinFree;				///< Lowest free heap seen by MemStatsGetHeap().
+} oMemStatsHeapTy, *poMemStatsHeapTy;
+
+///
+/// \struct	oMemStatsTaskTy
+/// \brief 	Stack usage of a task.
+///
+typedef struct
+{
+	const char*	pszName;
+	UINT16		u16StackMax;			///< Deepest stack use below the caller, in bytes.
+	UINT16		u16StackLast;			///< Stack use of the last sampled call, in bytes.
+	UINT32		u32Samples;				///< Sampled calls.
+} oMemStatsTaskTy, *poMemStatsTaskTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+void    MemStatsRegisterModule(const char* pszName, UINT32 u32Bytes);
+UINT8   MemStatsTaskRegister(const char* pszName);
+void    MemStatsTaskBegin(UINT8 u8Task);
+void    MemStatsTaskEnd(UINT8 u8Task);
+bool    MemStatsGetHeap(poMemStatsHeapTy poHeap);
+bool    MemStatsGetTask(UINT8 u8Task, poMemStatsTaskTy poTask);
+UINT32  MemStatsGetStackFree();
+UINT16  MemStatsFormatLine(UINT8 u8Line, char* pszBuffer, UINT16 u16Size);
+
+#endif
@@ -11,18 +11,29 @@
 #include "Arduino.h"
 #include "MoistSensorMgr.h"
 #include "SystemTime.h"
+#include "CalibMgr.h"
+#include "SensorHealth.h"
+#include "TraceMgr.h"
+#include "StreamStats.h"
+#include "MemStats.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
 ////////////////////////////////////////////////////////////////////////////////
-#define MOISTURE_DELAY 15000
-#define POLL_DELAY 100
-#define POLLING_TIME 10 * POLL_DELAY
-
 #define SERIAL_DELAY 1000
 
-#define MAP_MAX 1024
-#define MAP_MIN 350
+// Optional stages. Always there when the pipeline is configured at runtime.
+#if defined(MOISTURE_PIPELINE_FIXED) && !MOISTURE_FIXED_ADAPT
+#define STAGE_ADAPT 0
+#else
+#define STAGE_ADAPT 1
+#endif
+
+#if defined(MOISTURE_PIPELINE_FIXED) && !MOISTURE_FIXED_STATS
+#define STAGE_STATS 0
+#else
+#define STAGE_STATS 1
+#endif
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -34,10 +45,22 @@ enum moisture_SM {BOOTING, WAITING, POLLING, REPORTING};
 ////////////////////////////////////////////////////////////////////////////////
 // Private functions
 ////////////////////////////////////////////////////////////////////////////////
+#define to_percent(raw) (oMoistSensorMgr.pu8CalibTable[((raw) < CALIBMGR_LUT_SIZE) ? (raw) : (CALIBMGR_LUT_SIZE - 1)])
+
 void booting_state(UINT32);
 void waiting_state(UINT32);
 void polling_state(UINT32);
+void reading_done();
 void reporting(UINT32);
+#if STAGE_ADAPT
+void adapt_interval(UINT16 average, UINT16 variance);
+#endif
+UINT32 phase_wait(UINT32 planned);
+bool is_reportable(UINT8 value, UINT8 fault);
+void stats_configure();
+void stats_update(UINT8 average);
+void probe_power(bool on);
+UINT16 probe_read();
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Local variables
@@ -46,9 +69,13 @@ oMoistSensorMgrTy oMoistSensorMgr			= {FALSE};
 
 enum moisture_SM current_state = BOOTING;
 
+// Time accumulators, in ms. Fed with unsigned differences of the system
+// time, so they stay right across its wrap-around and after long stalls.
 UINT32 moisture_acc = MOISTURE_DELAY;
-int polling_time_acc = 0;
-int poll_acc = 0;
+UINT32 moisture_wait = MOISTURE_DELAY;
+UINT32 reading_start = 0;
+UINT32 polling_time_acc = 0;
+UINT32 poll_acc = 0;
 int serial_acc = 0;
 
 int poll_count = 0;
@@ -60,10 +87,32 @@ UINT32 dT = 0;
 UINT16 moisture_average = 0;
 UINT16 moisture_min = 0;
 UINT16 moisture_max = 1024;
-UINT16 moisture_sum = 0;
+UINT32 moisture_sum = 0;
+UINT32 moisture_sum_sq = 0;
+UINT16 moisture_variance = 0;
+UINT16 moisture_last_average = 0;
+bool has_last_average = false;
+
+UINT32 heartbeat_acc = 0;
+UINT8 last_emitted_value = 0;
+UINT8 last_emitted_fault = SENSORHEALTH_FAULT_NONE;
+bool has_emitted = false;
 
 bool is_dirty = false;
 
+#if STAGE_STATS
+// Window statistics of the averages, and the settings they were built with.
+oStreamStatsTy moisture_stats;
+UINT32 stats_window = 0;
+UINT16 stats_samples = 0;
+UINT8 stats_percentile = 0;
+bool has_stats = false;
+
+MEMSTATS_REGISTER(MoistSensorMgr, sizeof(oMoistSensorMgr) + sizeof(moisture_stats))
+#else
+MEMSTATS_REGISTER(MoistSensorMgr, sizeof(oMoistSensorMgr))
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief 		TODO DESCRIPTION HERE
 /// \public
@@ -78,18 +127,50 @@ poMoistSensorMgrTy MoistSensorMgr(UINT8 u8PinNumber)
 	this->u8Pin = u8PinNumber;
 
 	this->bNewResultAvail = false;
+	this->bNewReadingAvail = false;
 
 	this->u16CurrentValueRaw = 0;
+	this->u16AverageValueRaw = 0;
+	this->u16ReadingValueRaw = 0;
+	this->u8ReadingValue = 0;
+	this->u8ReadingQuality = SENSORHEALTH_QUALITY_GOOD;
+	this->u32ReadingMicros = 0;
+	this->u8ProbeId = 0;
+	this->pu8CalibTable = NULL;
 
 	this->u8CurrentValue = 0; 	
 	this->u8MaximumValue = 0;
 	this->u8MinimumValue = MAX_VAL_UINT32; ///< Values are inverted for moisture sensor
 	this->u8AverageValue = 0;
-
-	this->u16ReadingInterval = MOISTURE_DELAY;
+	this->u8WindowMinimumValue = 0;
+	this->u8WindowMaximumValue = 0;
+	this->u8MedianValue = 0;
+	this->u8PercentileValue = 0;
+	this->u8Quality = SENSORHEALTH_QUALITY_GOOD;
+	this->u8FaultCode = SENSORHEALTH_FAULT_NONE;
+
+	this->u32ReadingInterval = MOISTURE_DELAY;
+	this->u32ReadingIntervalMin = MOISTURE_DELAY;
+	this->u32ReadingIntervalMax = MOISTURE_DELAY_MAX;
+	this->u16AdaptDelta = MOISTURE_ADAPT_DELTA;
+	this->u16AdaptVariance = MOISTURE_ADAPT_VARIANCE;
+
+	this->u8DeadbandAbs = MOISTURE_DEADBAND_ABS;
+	this->u8DeadbandPct = MOISTURE_DEADBAND_PCT;
+	this->u32Heartbeat = MOISTURE_HEARTBEAT;
+	this->u32StatsWindow = MOISTURE_STATS_WINDOW;
+	this->u16StatsSamples = MOISTURE_STATS_SAMPLES;
+	this->u8StatsPercentile = MOISTURE_STATS_PERCENTILE;
+	this->u32PhaseCycle = 0;
+	this->u32PhaseStart = 0;
+	this->u32ReportsEmitted = 0;
+	this->u32ReportsSuppressed = 0;
     this->u16PollingInterval = POLL_DELAY;
     this->u16PollingDuration = POLLING_TIME;
 
+	this->u16MapMax = MAP_MAX;
+	this->u16MapMin = MAP_MIN;
+
 
 	return this;
 }
@@ -107,12 +188,44 @@ bool MoistSensorMgrConfigure(poMoistSensorMgrTy this)
 
 	this->bIsConfigured = true;
 
+	// The table is built by CalibMgrBuild(), see ConfigMgrApplySensor().
+	this->pu8CalibTable = CalibMgrGetTable(this->u8ProbeId);
+	if (!this->pu8CalibTable) goto END;
+
 	pinMode(this->u8Pin, OUTPUT);
 
+#ifdef MOISTURE_PIPELINE_FIXED
+	// The build decides: show it to the rest of the application (reading
+	// phase, traces).
+	this->u16PollingInterval = MOISTURE_FIXED_POLL_INTERVAL;
+	this->u16PollingDuration = MOISTURE_FIXED_SAMPLES * MOISTURE_FIXED_POLL_INTERVAL;
+#endif
+
 
 	cT = SystemTimeGetTime();
-	pT = 0;
+	pT = cT;
 
+	// Restart the state machine from scratch. The first reading starts as
+	// soon as the sensor is up.
+	current_state = BOOTING;
+	this->u32ReadingInterval = this->u32ReadingIntervalMin;
+	moisture_acc = this->u32ReadingInterval;
+	moisture_wait = this->u32ReadingInterval;
+	poll_acc = 0;
+	polling_time_acc = 0;
+	poll_count = 0;
+	moisture_sum = 0;
+	moisture_sum_sq = 0;
+	moisture_min = 0;
+	moisture_max = 1024;
+	is_dirty = false;
+	has_last_average = false;
+	has_emitted = false;
+	heartbeat_acc = 0;
+	SensorHealthReset();
+	stats_configure();
+
+	TraceMgrConfigure(cT, this);
 
 	bRet = true;
 END:
@@ -155,33 +268,45 @@ END:
 }
 
 void booting_state(UINT32 dT) {
-  digitalWrite (oMoistSensorMgr.u8Pin, true);
-  oMoistSensorMgr.u16CurrentValueRaw = analogRead(A0);
-  digitalWrite (oMoistSensorMgr.u8Pin, false);
+  probe_power(true);
+  oMoistSensorMgr.u16CurrentValueRaw = probe_read();
+  probe_power(false);
 
+  // moisture_acc starts at the reading interval, so the first reading
+  // begins right away instead of one full interval after boot.
+  current_state = WAITING;
 }
 
 void waiting_state(UINT32 delta) {
-  moisture_acc += (delta & 0xFFFF);
+  moisture_acc += delta;
   
-  if (moisture_acc >= oMoistSensorMgr.u16ReadingInterval) {
+  if (moisture_acc >= moisture_wait) {
     moisture_acc = 0;
+    reading_start = cT;
+
+    // The extremes belong to this reading only.
+    moisture_min = 0;
+    moisture_max = 1024;
 
     current_state = POLLING;
-    digitalWrite (oMoistSensorMgr.u8Pin, true);
+    probe_power(true);
   }
 }
 
 void polling_state(UINT32 delta) {
-  poll_acc += (delta & 0xFFFF);
-  
-  polling_time_acc += (delta & 0xFFFF);
+  poll_acc += delta;
+
+#ifdef MOISTURE_PIPELINE_FIXED
+  if (poll_acc >= MOISTURE_FIXED_POLL_INTERVAL) {
+#else
+  polling_time_acc += delta;
 
   if (poll_acc >= oMoistSensorMgr.u16PollingInterval) {
+#endif
     poll_acc = 0;
     poll_count++;
     
-    oMoistSensorMgr.u16CurrentValueRaw = analogRead(A0);    
+    oMoistSensorMgr.u16CurrentValueRaw = probe_read();
 
     // Values are inverted, that's the reason
     // for the inverted comparators
@@ -193,35 +318,323 @@ void polling_state(UINT32 delta) {
       moisture_min = oMoistSensorMgr.u16CurrentValueRaw;
     }
 
-    moisture_sum += oMoistSensorMgr.u16CurrentValueRaw;    
+    SensorHealthSample(oMoistSensorMgr.u16CurrentValueRaw);
+
+    moisture_sum += oMoistSensorMgr.u16CurrentValueRaw;
+    moisture_sum_sq += (UINT32)oMoistSensorMgr.u16CurrentValueRaw * oMoistSensorMgr.u16CurrentValueRaw;
   }
 
+#ifdef MOISTURE_PIPELINE_FIXED
+  if (poll_count >= MOISTURE_FIXED_SAMPLES) {
+    reading_done();
+    is_dirty = true;
+  }
+#else
   if (polling_time_acc >= oMoistSensorMgr.u16PollingDuration) {
     polling_time_acc = 0;
     
     if (poll_count > 0) {
-      moisture_average = moisture_sum / poll_count;
-      moisture_sum = 0;
-      poll_count = 0;
-      digitalWrite (oMoistSensorMgr.u8Pin, false);
+      reading_done();
     }
     
     is_dirty = true;
   }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		reading_done - Filters the samples of the reading into its
+///				average and variance, and powers the probe down.
+/// \details	With MOISTURE_PIPELINE_FIXED the sample count is a constant
+///				power of two (once trimmed): the divides are shifts.
+////////////////////////////////////////////////////////////////////////////////
+void reading_done() {
+  UINT32 sum = moisture_sum;
+  UINT32 sum_sq = moisture_sum_sq;
+  UINT32 variance = 0;
+
+#if MOISTURE_FILTER == MOISTURE_FILTER_TRIMMED
+  // moisture_max holds the lowest raw value, moisture_min the highest.
+#ifndef MOISTURE_PIPELINE_FIXED
+  if (poll_count > 2)
+#endif
+  {
+    sum -= (UINT32)moisture_max + moisture_min;
+    sum_sq -= (UINT32)moisture_max * moisture_max + (UINT32)moisture_min * moisture_min;
+    poll_count -= 2;
+  }
+#endif
+
+#ifdef MOISTURE_PIPELINE_FIXED
+  moisture_average = sum >> MOISTURE_FIXED_SAMPLES_LOG2;
+  variance = (sum_sq >> MOISTURE_FIXED_SAMPLES_LOG2) - ((UINT32)moisture_average * moisture_average);
+#else
+  moisture_average = sum / poll_count;
+  variance = (sum_sq / poll_count) - ((UINT32)moisture_average * moisture_average);
+#endif
+
+  moisture_variance = (variance > 0xFFFF) ? 0xFFFF : variance;
+  moisture_sum = 0;
+  moisture_sum_sq = 0;
+  poll_count = 0;
+  probe_power(false);
 }
 
 void reporting (UINT32 dT) {
+	UINT8 average = 0;
+	UINT8 quality = SENSORHEALTH_QUALITY_GOOD;
+	UINT8 fault = SENSORHEALTH_FAULT_NONE;
+
+	heartbeat_acc += dT;
+
 	if (is_dirty) {
 		is_dirty = false;
     	current_state = WAITING;
 
-		oMoistSensorMgr.u8CurrentValue = map (oMoistSensorMgr.u16CurrentValueRaw, MAP_MAX, MAP_MIN, 0, 100);		
-		oMoistSensorMgr.u8AverageValue = map (moisture_average, MAP_MAX, MAP_MIN, 0, 100);
-		oMoistSensorMgr.u8AverageValue = map (moisture_max, MAP_MAX, MAP_MIN, 0, 100);
-		oMoistSensorMgr.u8AverageValue = map (moisture_min, MAP_MAX, MAP_MIN, 0, 100);
+		SensorHealthReading(moisture_average, moisture_variance, &quality, &fault);
+
+#if STAGE_ADAPT
+		adapt_interval(moisture_average, moisture_variance);
+#endif
+
+		// Time to the next reading: the interval, moved to the grid when
+		// the readings are aligned on the uplink slot.
+		moisture_wait = oMoistSensorMgr.u32PhaseCycle ? phase_wait(reading_start + oMoistSensorMgr.u32ReadingInterval) : oMoistSensorMgr.u32ReadingInterval;
+
+		average = to_percent(moisture_average);
+
+		// Every reading, even when the result is suppressed: calibration
+		// captures and the irrigation control need fresh values.
+		oMoistSensorMgr.u16ReadingValueRaw = moisture_average;
+		oMoistSensorMgr.u8ReadingValue = average;
+		oMoistSensorMgr.u8ReadingQuality = quality;
+		oMoistSensorMgr.u32ReadingMicros = micros();
+		oMoistSensorMgr.bNewReadingAvail = true;
+
+		// Every reading counts in the window statistics, published or not.
+		stats_update(average);
+
+		// Report by exception: keep the last published result unless the
+		// average moved out of the deadband, the faults changed or the
+		// heartbeat expired.
+		if (!is_reportable(average, fault)) {
+			oMoistSensorMgr.u32ReportsSuppressed++;
+			return;
+		}
+
+		oMoistSensorMgr.u16AverageValueRaw = moisture_average;
+		oMoistSensorMgr.u8CurrentValue = to_percent(oMoistSensorMgr.u16CurrentValueRaw);
+		oMoistSensorMgr.u8AverageValue = average;
+		oMoistSensorMgr.u8MaximumValue = to_percent(moisture_max);
+		oMoistSensorMgr.u8MinimumValue = to_percent(moisture_min);
+		oMoistSensorMgr.u8Quality = quality;
+		oMoistSensorMgr.u8FaultCode = fault;
+
+		last_emitted_value = average;
+		last_emitted_fault = fault;
+		has_emitted = true;
+		heartbeat_acc = 0;
+
+		oMoistSensorMgr.u32ReportsEmitted++;
+		oMoistSensorMgr.u32ResultMicros = micros();
+		oMoistSensorMgr.bNewResultAvail = true;
+
+		TraceMgrResult(cT, &oMoistSensorMgr);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		is_reportable - Deadband, fault and heartbeat check of a new average.
+///
+/// \return		TRUE if the value must be published.
+////////////////////////////////////////////////////////////////////////////////
+bool is_reportable(UINT8 value, UINT8 fault) {
+	UINT8 delta = 0;
+	UINT16 band = 0;
+
+	if (!has_emitted || (fault != last_emitted_fault) || (heartbeat_acc >= oMoistSensorMgr.u32Heartbeat)) {
+		return true;
+	}
+
+	delta = (value > last_emitted_value) ? (value - last_emitted_value) : (last_emitted_value - value);
+
+	if (oMoistSensorMgr.u8DeadbandAbs && (delta >= oMoistSensorMgr.u8DeadbandAbs)) {
+		return true;
+	}
+
+	if (oMoistSensorMgr.u8DeadbandPct) {
+		// In hundredths of %, never narrower than the floor.
+		band = (UINT16)oMoistSensorMgr.u8DeadbandPct * last_emitted_value;
+		if (band < MOISTURE_DEADBAND_PCT_FLOOR * 100) {
+			band = MOISTURE_DEADBAND_PCT_FLOOR * 100;
+		}
+
+		if ((UINT16)delta * 100 >= band) {
+			return true;
+		}
+	}
+
+	// Both deadbands disabled: every reading is published.
+	return !oMoistSensorMgr.u8DeadbandAbs && !oMoistSensorMgr.u8DeadbandPct;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		stats_configure - Restarts the window statistics with the
+///				current settings.
+/// \details	An invalid percentile leaves them disabled: the window fields
+///				then follow the average.
+////////////////////////////////////////////////////////////////////////////////
+void stats_configure() {
+#if STAGE_STATS
+	bool time = (oMoistSensorMgr.u16StatsSamples == 0);
+
+	stats_window = oMoistSensorMgr.u32StatsWindow;
+	stats_samples = oMoistSensorMgr.u16StatsSamples;
+	stats_percentile = oMoistSensorMgr.u8StatsPercentile;
+
+	has_stats = StreamStatsInit(&moisture_stats, time, time ? stats_window : stats_samples, stats_percentile, cT);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		stats_update - Adds an average to the window statistics and
+///				refreshes the window fields.
+////////////////////////////////////////////////////////////////////////////////
+void stats_update(UINT8 average) {
+#if STAGE_STATS
+	oStreamStatsResultTy result;
+
+	// Settings changed at runtime (ConfigMgrApplySensor).
+	if ((stats_window != oMoistSensorMgr.u32StatsWindow) || (stats_samples != oMoistSensorMgr.u16StatsSamples) ||
+		(stats_percentile != oMoistSensorMgr.u8StatsPercentile)) {
+		stats_configure();
+	}
+
+	if (has_stats) {
+		StreamStatsPush(&moisture_stats, cT, average);
+
+		if (StreamStatsGet(&moisture_stats, cT, &result)) {
+			oMoistSensorMgr.u8WindowMinimumValue = (UINT8)result.u16Minimum;
+			oMoistSensorMgr.u8WindowMaximumValue = (UINT8)result.u16Maximum;
+			oMoistSensorMgr.u8MedianValue = (UINT8)result.u16Median;
+			oMoistSensorMgr.u8PercentileValue = (UINT8)result.u16Percentile;
+		}
+		return;
+	}
+#endif
+
+	oMoistSensorMgr.u8WindowMinimumValue = average;
+	oMoistSensorMgr.u8WindowMaximumValue = average;
+	oMoistSensorMgr.u8MedianValue = average;
+	oMoistSensorMgr.u8PercentileValue = average;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		probe_power - Switches the probe supply.
+////////////////////////////////////////////////////////////////////////////////
+void probe_power(bool on) {
+	digitalWrite(oMoistSensorMgr.u8Pin, on);
+	TraceMgrPin(cT, oMoistSensorMgr.u8Pin, on);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		probe_read - Samples the probe.
+///
+/// \return		Raw ADC value.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 probe_read() {
+	UINT16 raw = analogRead(A0);
+
+	TraceMgrAdc(cT, A0, raw);
+	return raw;
+}
+
+#if STAGE_ADAPT
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		adapt_interval - Chooses the time until the next reading.
+/// \details	While the readings are stable the interval doubles at each
+///				report, up to u32ReadingIntervalMax. As soon as the average
+///				moved by more than u16AdaptDelta since the last reading, or
+///				the samples of this reading are spread more than
+///				u16AdaptVariance, it snaps back to u32ReadingIntervalMin.
+///				Setting min == max disables the adaptation.
+////////////////////////////////////////////////////////////////////////////////
+void adapt_interval(UINT16 average, UINT16 variance) {
+	UINT16 delta = 0;
+	UINT32 next = oMoistSensorMgr.u32ReadingInterval;
+
+	delta = (average > moisture_last_average) ? (average - moisture_last_average) : (moisture_last_average - average);
+
+	if (!has_last_average || (delta > oMoistSensorMgr.u16AdaptDelta) || (variance > oMoistSensorMgr.u16AdaptVariance)) {
+		next = oMoistSensorMgr.u32ReadingIntervalMin;
+	}
+	else if (next <= oMoistSensorMgr.u32ReadingIntervalMax / 2) {
+		next *= 2;
+	}
+	else {
+		next = oMoistSensorMgr.u32ReadingIntervalMax;
+	}
+
+	oMoistSensorMgr.u32ReadingInterval = next;
+	moisture_last_average = average;
+	has_last_average = true;
+}
+#endif
 
-		oMoistSensorMgr.bNewResultAvail = true;		
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		phase_wait - Time until the grid point nearest to a planned
+///				reading start.
+///
+/// \return		Time from now, in ms. Never in the past.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 phase_wait(UINT32 planned) {
+	UINT32 cycle = oMoistSensorMgr.u32PhaseCycle;
+	INT32 delta = (INT32)(planned - oMoistSensorMgr.u32PhaseStart);
+	UINT32 late = (delta >= 0) ? (UINT32)delta % cycle : (cycle - (UINT32)(-delta) % cycle) % cycle;
+	UINT32 next = (late > cycle / 2) ? planned + (cycle - late) : planned - late;
+
+	while ((INT32)(next - cT) < 0) {
+		next += cycle;
 	}
+
+	return next - cT;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MoistSensorMgrSetPhase - Aligns the readings on a time grid.
+/// \public
+/// \details	Each reading then starts on a grid point, the one nearest to
+///				where the adaptive interval would start it, so that the
+///				result is fresh when the uplink slot opens (see
+///				CommMgrGetReadingPhase). Cheap when nothing changed: can be
+///				called at every loop. The pending reading moves to the new
+///				grid.
+///
+/// \param[in]	u32Cycle	Grid period, in ms. 0 to run free.
+/// \param[in]	u32Start	System time of any grid point.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool MoistSensorMgrSetPhase(poMoistSensorMgrTy this, UINT32 u32Cycle, UINT32 u32Start) {
+	UINT32 planned = 0;
+
+	if (!this) {
+		return false;
+	}
+
+	if ((u32Cycle == this->u32PhaseCycle) && (!u32Cycle || ((u32Start - this->u32PhaseStart) % u32Cycle == 0))) {
+		return true;
+	}
+
+	this->u32PhaseCycle = u32Cycle;
+	this->u32PhaseStart = u32Start;
+
+	if (u32Cycle && (current_state == WAITING) && (moisture_acc < moisture_wait)) {
+		planned = cT + (moisture_wait - moisture_acc);
+		moisture_wait = moisture_acc + phase_wait(planned);
+	}
+
+	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -248,3 +661,25 @@ bool MoistSensorMgrIsNewResultAvail(BOOL* pbNewResultAvail) {
 
 	return false;	
 }
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		MoistSensorMgrIsNewReadingAvail - Check if a reading was
+///				processed, published or not (see u8ReadingValue).
+/// \public
+///
+/// \param[out]	pbNewReadingAvail	A new reading is available or not.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool MoistSensorMgrIsNewReadingAvail(BOOL* pbNewReadingAvail) {
+
+	if (oMoistSensorMgr.bIsConfigured && pbNewReadingAvail)
+	{
+		*pbNewReadingAvail 	= oMoistSensorMgr.bNewReadingAvail;
+		oMoistSensorMgr.bNewReadingAvail 	= false;
+
+		return true;
+	}
+
+	return false;
+}
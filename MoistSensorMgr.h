@@ -15,11 +15,66 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "Arduino.h"
 #include "TypeDefs.h"
+#include "StreamStats.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
 ////////////////////////////////////////////////////////////////////////////////
+// Default tunables. The values actually used at runtime come from the
+// configuration block (see ConfigMgr) when one is stored in flash.
+#define MOISTURE_DELAY 15000
+#define MOISTURE_DELAY_MAX 900000UL     ///< Longest interval reached while readings are stable.
+#define MOISTURE_ADAPT_DELTA 8          ///< Change of average (raw counts) that snaps back to the fast rate.
+#define MOISTURE_ADAPT_VARIANCE 16      ///< Variance within a reading (raw counts^2) that snaps back to the fast rate.
+
+#define MOISTURE_DEADBAND_ABS 2         ///< Change of average (%) that triggers a new result. 0 to disable.
+#define MOISTURE_DEADBAND_PCT 0         ///< Relative change of average (% of the last value) that triggers a new result. 0 to disable.
+#define MOISTURE_DEADBAND_PCT_FLOOR 1   ///< Narrowest relative deadband, in %: near a last value of 0 % it would be empty.
+#define MOISTURE_HEARTBEAT 3600000UL    ///< Longest time without a new result, in ms.
+#define MOISTURE_STATS_WINDOW 86400000UL ///< Span of the window statistics, in ms.
+#define MOISTURE_STATS_SAMPLES 0        ///< Span of the window statistics, in readings. 0: use MOISTURE_STATS_WINDOW.
+#define MOISTURE_STATS_PERCENTILE 90    ///< Percentile of the window statistics (1 to 99).
+#define POLL_DELAY 100
+#define POLLING_TIME (10 * POLL_DELAY)
+
+#define MAP_MAX 1024
+#define MAP_MIN 350
+
+// Filter of the samples of a reading. Chosen at compile time.
+#define MOISTURE_FILTER_MEAN 0          ///< Average of the samples.
+#define MOISTURE_FILTER_TRIMMED 1       ///< Average without the lowest and the highest sample (drops one spike each way).
+#ifndef MOISTURE_FILTER
+#define MOISTURE_FILTER MOISTURE_FILTER_MEAN
+#endif
+
+// Pipeline fixed at compile time: build with MOISTURE_PIPELINE_FIXED and a
+// reading takes exactly 2^MOISTURE_FIXED_SAMPLES_LOG2 samples (plus the two
+// dropped by MOISTURE_FILTER_TRIMMED), MOISTURE_FIXED_POLL_INTERVAL ms
+// apart, whatever the configuration says. The divides by the sample count
+// become shifts and the stages turned off are not compiled in. Without it,
+// the polling settings are read at runtime.
+#ifdef MOISTURE_PIPELINE_FIXED
+#ifndef MOISTURE_FIXED_SAMPLES_LOG2
+#define MOISTURE_FIXED_SAMPLES_LOG2 3   ///< 8 samples averaged per reading.
+#endif
+#ifndef MOISTURE_FIXED_POLL_INTERVAL
+#define MOISTURE_FIXED_POLL_INTERVAL POLL_DELAY
+#endif
+#ifndef MOISTURE_FIXED_ADAPT
+#define MOISTURE_FIXED_ADAPT 1          ///< 0: no adaptive interval, the readings are u32ReadingIntervalMin apart.
+#endif
+#ifndef MOISTURE_FIXED_STATS
+#define MOISTURE_FIXED_STATS 1          ///< 0: no window statistics, the window fields follow the average.
+#endif
+
+#define MOISTURE_FIXED_TRIM ((MOISTURE_FILTER == MOISTURE_FILTER_TRIMMED) ? 2 : 0)
+#define MOISTURE_FIXED_SAMPLES ((1 << MOISTURE_FIXED_SAMPLES_LOG2) + MOISTURE_FIXED_TRIM)   ///< Samples taken per reading.
+
+#if MOISTURE_FIXED_SAMPLES_LOG2 > 12
+#error "MOISTURE_FIXED_SAMPLES_LOG2: the sum of squares would overflow"
+#endif
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 // Data types
@@ -28,20 +83,53 @@ typedef struct
 {
 	bool			bIsConfigured;					///< Flag indicating that the module is configured or not.
 
-    UINT16          u16ReadingInterval;
+    UINT32          u32ReadingInterval;             ///< Current time between two readings, in ms. Adapted at each report.
+    UINT32          u32ReadingIntervalMin;          ///< Fast rate, used while the moisture is changing.
+    UINT32          u32ReadingIntervalMax;          ///< Slow rate, reached while the moisture is stable.
+    UINT16          u16AdaptDelta;                  ///< See MOISTURE_ADAPT_DELTA.
+    UINT16          u16AdaptVariance;               ///< See MOISTURE_ADAPT_VARIANCE.
+    UINT8           u8DeadbandAbs;                  ///< See MOISTURE_DEADBAND_ABS.
+    UINT8           u8DeadbandPct;                  ///< See MOISTURE_DEADBAND_PCT.
+    UINT32          u32Heartbeat;                   ///< See MOISTURE_HEARTBEAT.
+    UINT32          u32StatsWindow;                 ///< See MOISTURE_STATS_WINDOW.
+    UINT16          u16StatsSamples;                ///< See MOISTURE_STATS_SAMPLES.
+    UINT8           u8StatsPercentile;              ///< See MOISTURE_STATS_PERCENTILE.
+    UINT32          u32PhaseCycle;                  ///< Readings start on a grid of this period, in ms. 0: free running.
+    UINT32          u32PhaseStart;                  ///< System time of one grid point (see MoistSensorMgrSetPhase).
     UINT16          u16PollingInterval;
     UINT16          u16PollingDuration;
+    UINT16          u16MapMax;                      ///< Raw value mapped to 0 % (dry).
+    UINT16          u16MapMin;                      ///< Raw value mapped to 100 % (wet).
 	
     // Hardware configuration
     UINT8           u8Pin;
+    UINT8           u8ProbeId;                      ///< Calibration curve of the probe (see CalibMgr).
+    const UINT8*    pu8CalibTable;                  ///< Raw to % lookup table of the probe.
 
  	// Housekeeping results.
 	bool			bNewResultAvail;				///< Flag indicating that a new processed result is available.
+	bool			bNewReadingAvail;				///< Flag indicating that a reading was processed, published or not.
 	UINT16			u16CurrentValueRaw;			    ///< The last processed raw value.
+	UINT16			u16AverageValueRaw;			    ///< The last processed raw average.
+	UINT16			u16ReadingValueRaw;			    ///< Raw average of the last reading, published or not. Used for calibration captures.
+    UINT8			u8ReadingValue;				    ///< Average of the last reading, published or not, in %. Drives the irrigation.
+    UINT8           u8ReadingQuality;               ///< SensorHealthQualityTy of the last reading.
+    UINT32          u32ReadingMicros;               ///< micros() when the last reading was processed (start of the actuation latency).
     UINT8			u8CurrentValue;			        ///< The last processed value.
 	UINT8			u8MaximumValue;				    ///< The last processed maximum value.
 	UINT8			u8MinimumValue;				    ///< The last processed minimum value.
     UINT8			u8AverageValue;				    ///< The last processed average value.
+    UINT8			u8WindowMinimumValue;			///< Driest average over the stats window.
+    UINT8			u8WindowMaximumValue;			///< Wettest average over the stats window.
+    UINT8			u8MedianValue;				    ///< Median average over the stats window (estimate).
+    UINT8			u8PercentileValue;				///< u8StatsPercentile-th percentile average over the stats window (estimate).
+    UINT8           u8Quality;                      ///< SensorHealthQualityTy of the last processed result.
+    UINT8           u8FaultCode;                    ///< SENSORHEALTH_FAULT_* mask of the last processed result.
+    UINT32          u32ResultMicros;                ///< micros() when the last result was published.
+
+    // Report-by-exception statistics.
+    UINT32          u32ReportsEmitted;              ///< Readings published as a new result.
+    UINT32          u32ReportsSuppressed;           ///< Readings dropped by the deadband.
 
 } oMoistSensorMgrTy, *poMoistSensorMgrTy;
 
@@ -52,5 +140,7 @@ poMoistSensorMgrTy MoistSensorMgr(UINT8 pin);
 bool MoistSensorMgrTask();
 bool MoistSensorMgrConfigure(poMoistSensorMgrTy);
 bool MoistSensorMgrIsNewResultAvail(bool* pbNewResultAvail);
+bool MoistSensorMgrIsNewReadingAvail(bool* pbNewReadingAvail);
+bool MoistSensorMgrSetPhase(poMoistSensorMgrTy, UINT32 u32Cycle, UINT32 u32Start);
 
 #endif
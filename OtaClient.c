@@ -0,0 +1,432 @@
+///
+/// \file     OtaClient.c
+/// \brief    Firmware update client. Fetches an image over TCP into OtaMgr.
+/// \details  Uses the lwIP raw TCP API. The receive callback only queues the
+///           segments; they are written to flash from OtaClientTask(), in
+///           loop(), within a work budget (see WorkBudget), and acknowledged
+///           to the TCP window afterwards. The server is therefore paced by
+///           the flash and at most one TCP window of the image is ever in RAM.
+///
+///           After a drop the client reconnects and asks for the image from
+///           the last committed chunk (see OtaMgr).
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include "OtaClient.h"
+#include "MemStats.h"
+#include "SystemTime.h"
+#include "WorkBudget.h"
+
+#ifdef ARDUINO_ARCH_ESP8266
+#include "lwip/tcp.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   OtaClientStateTy
+/// \brief  Connection state machine.
+///
+typedef enum
+{
+	OTACLIENT_SM_IDLE		= 0,	///< Not started, finished or failed.
+	OTACLIENT_SM_CONNECT,			///< Open a connection.
+	OTACLIENT_SM_CONNECTING,		///< Waiting for the connection.
+	OTACLIENT_SM_HEADER,			///< Receiving the stream header.
+	OTACLIENT_SM_DATA,				///< Receiving the image.
+	OTACLIENT_SM_RETRY,				///< Waiting before reconnecting.
+} OtaClientStateTy;
+
+///
+/// \struct	oOtaClientTy
+/// \brief 	OtaClient object.
+///
+typedef struct
+{
+	OtaClientStateTy	eState;
+	OtaClientStatusTy	eStatus;
+	UINT32				u32Ip;							///< Server address, host byte order.
+	UINT16				u16Port;						///< Server port.
+	UINT32				u32Requested;					///< Offset asked to the server.
+	UINT32				u32ImageSize;					///< Size announced by the server.
+	UINT32				u32Received;					///< Image bytes handed to OtaMgr (absolute offset).
+	UINT8				au8Header[OTAMGR_HEADER_SIZE];	///< Header being received.
+	UINT8				u8HeaderLen;					///< Bytes in au8Header.
+	bool				bRequestSent;					///< The request line went out on this connection.
+	UINT8				u8Retries;						///< Reconnections without progress.
+	UINT32				u32RetryTime;					///< Time of the drop.
+	bool				bDropped;						///< Set by the callbacks when the connection is gone.
+#ifdef ARDUINO_ARCH_ESP8266
+	struct tcp_pcb*		poPcb;							///< TCP control block.
+	struct pbuf*		poQueue;						///< Segments received, not processed yet.
+#endif
+} oOtaClientTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool OtaClientConsume(const UINT8* pu8Data, UINT32 u32Size);
+static void OtaClientClose(bool bRetry);
+
+#ifdef ARDUINO_ARCH_ESP8266
+static err_t OtaClientOnConnected(void* pvArg, struct tcp_pcb* poPcb, err_t eErr);
+static err_t OtaClientOnRecv(void* pvArg, struct tcp_pcb* poPcb, struct pbuf* poBuf, err_t eErr);
+static void OtaClientOnError(void* pvArg, err_t eErr);
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oOtaClientTy oOtaClient = {OTACLIENT_SM_IDLE};
+
+MEMSTATS_REGISTER(OtaClient, sizeof(oOtaClient))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaClientStart - Starts fetching an image.
+/// \public
+///
+/// \param[in]	u32Ip		Server address, host byte order.
+/// \param[in]	u16Port		Server port.
+///
+/// \return		TRUE if success, FALSE if busy or not supported.
+////////////////////////////////////////////////////////////////////////////////
+bool OtaClientStart(UINT32 u32Ip, UINT16 u16Port)
+{
+	bool bRet = FALSE;
+
+#ifdef ARDUINO_ARCH_ESP8266
+	if (oOtaClient.eStatus == OTACLIENT_BUSY) goto END;
+
+	bRet = OtaMgr();
+	if (!bRet) goto END;
+
+	oOtaClient.u32Ip		= u32Ip;
+	oOtaClient.u16Port		= u16Port;
+	oOtaClient.u8Retries	= 0;
+	oOtaClient.u32Requested	= OtaMgrGetOffset();
+	oOtaClient.eStatus		= OTACLIENT_BUSY;
+	oOtaClient.eState		= OTACLIENT_SM_CONNECT;
+
+	bRet = TRUE;
+END:
+#endif
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaClientGetStatus - Gets the client status.
+/// \public
+///
+/// \return		See OtaClientStatusTy.
+////////////////////////////////////////////////////////////////////////////////
+OtaClientStatusTy OtaClientGetStatus()
+{
+	return oOtaClient.eStatus;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaClientTask - Periodic processing. Call it from loop().
+/// \public
+////////////////////////////////////////////////////////////////////////////////
+void OtaClientTask()
+{
+#ifdef ARDUINO_ARCH_ESP8266
+	struct pbuf*	poBuf			= NULL;
+	UINT32			u32SliceStart	= 0;
+	UINT32			u32Steps		= 0;
+	ip_addr_t		oAddr;
+	char			szRequest[OTAMGR_REQUEST_MAX];
+	int				iLen	= 0;
+
+	switch (oOtaClient.eState)
+	{
+	case OTACLIENT_SM_CONNECT:
+		oOtaClient.u8HeaderLen	= 0;
+		oOtaClient.bRequestSent	= FALSE;
+		oOtaClient.bDropped		= FALSE;
+		oOtaClient.poQueue		= NULL;
+		oOtaClient.poPcb		= tcp_new();
+		if (!oOtaClient.poPcb)
+		{
+			OtaClientClose(TRUE);
+			break;
+		}
+
+		IP_ADDR4(&oAddr, (oOtaClient.u32Ip >> 24) & 0xFF, (oOtaClient.u32Ip >> 16) & 0xFF, (oOtaClient.u32Ip >> 8) & 0xFF, oOtaClient.u32Ip & 0xFF);
+
+		tcp_arg(oOtaClient.poPcb, &oOtaClient);
+		tcp_recv(oOtaClient.poPcb, OtaClientOnRecv);
+		tcp_err(oOtaClient.poPcb, OtaClientOnError);
+
+		if (tcp_connect(oOtaClient.poPcb, &oAddr, oOtaClient.u16Port, OtaClientOnConnected) != ERR_OK)
+		{
+			OtaClientClose(TRUE);
+			break;
+		}
+
+		oOtaClient.eState = OTACLIENT_SM_CONNECTING;
+		break;
+
+	case OTACLIENT_SM_CONNECTING:
+		// Left by OtaClientOnConnected().
+		if (oOtaClient.bDropped)
+		{
+			OtaClientClose(TRUE);
+		}
+		break;
+
+	case OTACLIENT_SM_HEADER:
+	case OTACLIENT_SM_DATA:
+		if (!oOtaClient.bRequestSent && oOtaClient.poPcb)
+		{
+			iLen = snprintf(szRequest, sizeof(szRequest), "OTA %lu\n", (unsigned long)oOtaClient.u32Requested);
+
+			if ((tcp_write(oOtaClient.poPcb, szRequest, (u16_t)iLen, TCP_WRITE_FLAG_COPY) != ERR_OK) || (tcp_output(oOtaClient.poPcb) != ERR_OK))
+			{
+				OtaClientClose(TRUE);
+				break;
+			}
+
+			oOtaClient.u32Received	= oOtaClient.u32Requested;
+			oOtaClient.bRequestSent	= TRUE;
+		}
+
+		// One segment per step: a step programs at most one sector, and
+		// the slice ends when its budget is spent. The rest stays queued
+		// (and unacknowledged) for the next loop() iteration.
+		u32SliceStart	= SystemTimeGetTime();
+		u32Steps		= 0;
+
+		while (oOtaClient.poQueue && ((oOtaClient.eState == OTACLIENT_SM_HEADER) || (oOtaClient.eState == OTACLIENT_SM_DATA)))
+		{
+			// The chain holds the only reference to the rest: take one
+			// before unlinking it, or pbuf_dechain() frees it.
+			poBuf = oOtaClient.poQueue;
+			if (poBuf->next)
+			{
+				pbuf_ref(poBuf->next);
+			}
+			oOtaClient.poQueue = pbuf_dechain(poBuf);
+
+			OtaClientConsume((const UINT8*)poBuf->payload, poBuf->len);
+			++u32Steps;
+
+			if (oOtaClient.poPcb)
+			{
+				tcp_recved(oOtaClient.poPcb, poBuf->len);
+			}
+			pbuf_free(poBuf);
+
+			if (WorkBudgetIsExpired(u32SliceStart, OTACLIENT_SLICE_BUDGET))
+			{
+				break;
+			}
+		}
+
+		if (u32Steps)
+		{
+			WorkBudgetAccount(u32SliceStart, OTACLIENT_SLICE_BUDGET, u32Steps);
+		}
+
+		if (oOtaClient.bDropped && !oOtaClient.poQueue && ((oOtaClient.eState == OTACLIENT_SM_HEADER) || (oOtaClient.eState == OTACLIENT_SM_DATA)))
+		{
+			OtaClientClose(TRUE);
+		}
+		break;
+
+	case OTACLIENT_SM_RETRY:
+		if (SystemTimeGetTimeDiff(oOtaClient.u32RetryTime) < OTACLIENT_RETRY_DELAY)
+		{
+			break;
+		}
+
+		if (++oOtaClient.u8Retries > OTACLIENT_RETRY_MAX)
+		{
+			oOtaClient.eStatus	= OTACLIENT_FAILED;
+			oOtaClient.eState	= OTACLIENT_SM_IDLE;
+			break;
+		}
+
+		oOtaClient.u32Requested	= OtaMgrGetOffset();
+		oOtaClient.eState		= OTACLIENT_SM_CONNECT;
+		break;
+
+	default:
+		break;
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaClientConsume - Processes received stream bytes.
+///
+/// \return		TRUE to continue, FALSE if the connection was closed.
+////////////////////////////////////////////////////////////////////////////////
+static bool OtaClientConsume(const UINT8* pu8Data, UINT32 u32Size)
+{
+	UINT8	au8Digest[SHA256_DIGEST_SIZE];
+	UINT32	u32Copy		= 0;
+	UINT32	u32Offset	= 0;
+
+	if (oOtaClient.eState == OTACLIENT_SM_HEADER)
+	{
+		u32Copy = OTAMGR_HEADER_SIZE - oOtaClient.u8HeaderLen;
+		if (u32Copy > u32Size)
+		{
+			u32Copy = u32Size;
+		}
+
+		memcpy(&oOtaClient.au8Header[oOtaClient.u8HeaderLen], pu8Data, u32Copy);
+		oOtaClient.u8HeaderLen	+= (UINT8)u32Copy;
+		pu8Data					+= u32Copy;
+		u32Size					-= u32Copy;
+
+		if (oOtaClient.u8HeaderLen < OTAMGR_HEADER_SIZE)
+		{
+			return TRUE;
+		}
+
+		if (!OtaMgrDecodeHeader(oOtaClient.au8Header, &oOtaClient.u32ImageSize, au8Digest) ||
+			!OtaMgrBegin(oOtaClient.u32ImageSize, au8Digest, &u32Offset))
+		{
+			OtaClientClose(FALSE);
+			return FALSE;
+		}
+
+		// Another image than the recorded one: ask again from the right place.
+		if (u32Offset != oOtaClient.u32Requested)
+		{
+			oOtaClient.u32Requested = u32Offset;
+			OtaClientClose(TRUE);
+
+			// No reason to wait.
+			oOtaClient.u32RetryTime -= OTACLIENT_RETRY_DELAY;
+			return FALSE;
+		}
+
+		oOtaClient.eState = OTACLIENT_SM_DATA;
+	}
+
+	if (u32Size)
+	{
+		if (!OtaMgrWrite(pu8Data, u32Size))
+		{
+			OtaClientClose(FALSE);
+			return FALSE;
+		}
+
+		oOtaClient.u32Received	+= u32Size;
+		oOtaClient.u8Retries	= 0;
+	}
+
+	if (oOtaClient.u32Received >= oOtaClient.u32ImageSize)
+	{
+		if (OtaMgrEnd())
+		{
+			oOtaClient.eStatus = OTACLIENT_DONE;
+		}
+		else
+		{
+			oOtaClient.eStatus = OTACLIENT_FAILED;
+		}
+
+		OtaClientClose(FALSE);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaClientClose - Closes the connection.
+///
+/// \param[in]	bRetry		Reconnect later, else stop (the status is kept).
+////////////////////////////////////////////////////////////////////////////////
+static void OtaClientClose(bool bRetry)
+{
+#ifdef ARDUINO_ARCH_ESP8266
+	if (oOtaClient.poPcb)
+	{
+		tcp_arg(oOtaClient.poPcb, NULL);
+		tcp_recv(oOtaClient.poPcb, NULL);
+		tcp_err(oOtaClient.poPcb, NULL);
+
+		if (tcp_close(oOtaClient.poPcb) != ERR_OK)
+		{
+			tcp_abort(oOtaClient.poPcb);
+		}
+		oOtaClient.poPcb = NULL;
+	}
+
+	if (oOtaClient.poQueue)
+	{
+		pbuf_free(oOtaClient.poQueue);
+		oOtaClient.poQueue = NULL;
+	}
+#endif
+
+	if (bRetry)
+	{
+		oOtaClient.u32RetryTime	= SystemTimeGetTime();
+		oOtaClient.eState		= OTACLIENT_SM_RETRY;
+	}
+	else
+	{
+		if (oOtaClient.eStatus == OTACLIENT_BUSY)
+		{
+			oOtaClient.eStatus = OTACLIENT_FAILED;
+		}
+		oOtaClient.eState = OTACLIENT_SM_IDLE;
+	}
+}
+
+#ifdef ARDUINO_ARCH_ESP8266
+
+static err_t OtaClientOnConnected(void* pvArg, struct tcp_pcb* poPcb, err_t eErr)
+{
+	// The request is sent from OtaClientTask().
+	oOtaClient.eState = OTACLIENT_SM_HEADER;
+
+	return ERR_OK;
+}
+
+static err_t OtaClientOnRecv(void* pvArg, struct tcp_pcb* poPcb, struct pbuf* poBuf, err_t eErr)
+{
+	if (!poBuf)
+	{
+		// Closed by the server.
+		oOtaClient.bDropped = TRUE;
+		return ERR_OK;
+	}
+
+	if (oOtaClient.poQueue)
+	{
+		pbuf_cat(oOtaClient.poQueue, poBuf);
+	}
+	else
+	{
+		oOtaClient.poQueue = poBuf;
+	}
+
+	return ERR_OK;
+}
+
+static void OtaClientOnError(void* pvArg, err_t eErr)
+{
+	// lwIP already freed the control block.
+	oOtaClient.poPcb	= NULL;
+	oOtaClient.bDropped	= TRUE;
+}
+
+#endif
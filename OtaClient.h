@@ -0,0 +1,50 @@
+///
+/// \file     OtaClient.h
+/// \brief    Firmware update client. Fetches an image over TCP into OtaMgr.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef OTACLIENT_H
+#define OTACLIENT_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "OtaMgr.h"
+#include "WorkBudget.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define OTACLIENT_RETRY_DELAY   2000        ///< Time before reconnecting after a drop, in ms.
+#define OTACLIENT_RETRY_MAX     20          ///< Reconnections without progress before giving up.
+#define OTACLIENT_SLICE_BUDGET  WORKBUDGET_SLICE_DEFAULT    ///< Time spent writing per loop() iteration, in ms.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   OtaClientStatusTy
+/// \brief  Client status.
+///
+typedef enum
+{
+	OTACLIENT_IDLE		= 0,	///< Nothing to do.
+	OTACLIENT_BUSY,				///< Connecting or receiving.
+	OTACLIENT_DONE,				///< Image received and verified, see OtaMgrApply().
+	OTACLIENT_FAILED,			///< Gave up, the progress is kept for a next attempt.
+} OtaClientStatusTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool OtaClientStart(UINT32 u32Ip, UINT16 u16Port);
+void OtaClientTask();
+OtaClientStatusTy OtaClientGetStatus();
+
+#endif
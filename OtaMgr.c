@@ -0,0 +1,548 @@
+///
+/// \file     OtaMgr.c
+/// \brief    Firmware update manager
+/// \details  Progress records are appended one after the other in the
+///           OTA_STATE sector, so a commit is a small write and the sector is
+///           only erased once every OTAMGR_RECORD_SLOTS chunks. The last
+///           valid record wins. A record is written only after its chunk was
+///           programmed and read back, so a power loss at any time leaves a
+///           record that matches the flash content.
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stddef.h>
+#include "OtaMgr.h"
+#include "MemStats.h"
+#include "Crc.h"
+
+#ifdef ARDUINO_ARCH_ESP8266
+#include "user_interface.h"
+#include "eboot_command.h"
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define OTAMGR_RECORD_MAGIC     0x5344544FUL            ///< "OTDS", marks a progress record.
+#define OTAMGR_RECORD_SLOT      128                     ///< Space taken by a record in the OTA_STATE sector.
+#define OTAMGR_RECORD_SLOTS     (FLASHMGR_SECTOR_SIZE / OTAMGR_RECORD_SLOT)
+
+#define OTAMGR_STATUS_RECEIVING 1                       ///< Chunks up to u32Offset are in flash.
+#define OTAMGR_STATUS_VERIFIED  2                       ///< Whole image in flash, hash checked.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oOtaMgrRecordTy
+/// \brief 	Progress record, as stored in flash.
+///
+typedef struct
+{
+	UINT32		u32Magic;							///< OTAMGR_RECORD_MAGIC.
+	UINT32		u32Status;							///< OTAMGR_STATUS_*.
+	UINT32		u32ImageSize;						///< Size of the image being received.
+	UINT32		u32Offset;							///< Bytes committed to flash.
+	UINT8		au8Digest[SHA256_DIGEST_SIZE];		///< Expected hash of the image.
+	UINT32		au32Hash[SHA256_STATE_WORDS];		///< Hash state after u32Offset bytes.
+	UINT32		u32Crc;								///< CRC-32 of the record. Must stay last.
+} oOtaMgrRecordTy;
+
+///
+/// \struct	oOtaMgrTy
+/// \brief 	OtaMgr object.
+///
+typedef struct
+{
+	bool			bIsInitialized;					///< Flag indicating if this object is ready to use.
+	bool			bIsActive;						///< An update is in progress (OtaMgrBegin() done).
+	bool			bIsVerified;					///< The image in the partition is complete and checked.
+	UINT32			u32PartAddr;					///< Start of the update partition.
+	UINT32			u32PartSize;					///< Size of the update partition.
+	UINT32			u32StateAddr;					///< Start of the progress records sector.
+	UINT8			u8NextSlot;						///< Next free record slot.
+	bool			bHasRecord;						///< oRecord holds the last valid record.
+	oOtaMgrRecordTy	oRecord;						///< Last valid record.
+
+	UINT32			u32ImageSize;					///< Size of the image being received.
+	UINT8			au8Digest[SHA256_DIGEST_SIZE];	///< Expected hash of the image.
+	UINT32			u32Offset;						///< Bytes programmed and hashed.
+	oSha256Ty		oSha;							///< Hash of the programmed bytes, as read back.
+	UINT8			au8Stage[SHA256_BLOCK_SIZE];	///< Bytes received but not programmed yet.
+	UINT8			u8StageLen;						///< Bytes in au8Stage.
+} oOtaMgrTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool OtaMgrFlush();
+static bool OtaMgrCommit(UINT32 u32Status);
+static bool OtaMgrClearState();
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oOtaMgrTy oOtaMgr = {FALSE};
+
+MEMSTATS_REGISTER(OtaMgr, sizeof(oOtaMgr))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgr - Initializes the update manager.
+/// \public
+/// \details	Reads back the last progress record, if any.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool OtaMgr()
+{
+	bool			bRet		= FALSE;
+	UINT32			u32Size		= 0;
+	UINT8			u8Slot		= 0;
+	oOtaMgrRecordTy	oRecord;
+
+	memset(&oOtaMgr, 0, sizeof(oOtaMgr));
+
+	bRet = FlashMgrInit();
+	if (!bRet) goto END;
+
+	bRet = FlashMgrGetPartition(FLASHMGR_PART_OTA, &oOtaMgr.u32PartAddr, &oOtaMgr.u32PartSize);
+	if (!bRet) goto END;
+
+	bRet = FlashMgrGetPartition(FLASHMGR_PART_OTA_STATE, &oOtaMgr.u32StateAddr, &u32Size);
+	if (!bRet) goto END;
+
+	// No room beside the running sketch (see FlashMgrInit()): the state
+	// sector may hold its code. OtaMgrBegin() refuses every image.
+	if (oOtaMgr.u32PartSize == 0)
+	{
+		oOtaMgr.bIsInitialized = TRUE;
+		goto END;
+	}
+
+	for (u8Slot = 0; u8Slot < OTAMGR_RECORD_SLOTS; ++u8Slot)
+	{
+		bRet = FlashMgrRead(oOtaMgr.u32StateAddr + (UINT32)u8Slot * OTAMGR_RECORD_SLOT, &oRecord, sizeof(oRecord));
+		if (!bRet) goto END;
+
+		// First erased slot: end of the log.
+		if (oRecord.u32Magic == 0xFFFFFFFFUL)
+		{
+			break;
+		}
+
+		// A torn record (power loss while writing it) is skipped, the
+		// previous one still describes the flash content.
+		if ((oRecord.u32Magic == OTAMGR_RECORD_MAGIC) && (oRecord.u32Crc == Crc32(&oRecord, offsetof(oOtaMgrRecordTy, u32Crc))))
+		{
+			oOtaMgr.oRecord		= oRecord;
+			oOtaMgr.bHasRecord	= TRUE;
+		}
+	}
+
+	oOtaMgr.u8NextSlot		= u8Slot;
+	oOtaMgr.bIsInitialized	= TRUE;
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrBegin - Starts or resumes the reception of an image.
+/// \public
+/// \details	If the last progress record is for the same image (same size
+///				and hash), the reception resumes where it stopped. Otherwise
+///				it restarts from the beginning of the partition.
+///
+/// \param[in]	u32ImageSize	Size of the image, in bytes.
+/// \param[in]	pu8Digest		Expected SHA-256 of the image.
+/// \param[out]	pu32Offset		Offset the transport must send from.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool OtaMgrBegin(UINT32 u32ImageSize, const UINT8* pu8Digest, UINT32* pu32Offset)
+{
+	bool bRet = FALSE;
+
+	if (!oOtaMgr.bIsInitialized || !pu8Digest || !pu32Offset || (u32ImageSize == 0) || (u32ImageSize > oOtaMgr.u32PartSize))
+	{
+		goto END;
+	}
+
+	oOtaMgr.bIsActive		= FALSE;
+	oOtaMgr.bIsVerified		= FALSE;
+	oOtaMgr.u32ImageSize	= u32ImageSize;
+	oOtaMgr.u8StageLen		= 0;
+	memcpy(oOtaMgr.au8Digest, pu8Digest, SHA256_DIGEST_SIZE);
+
+	if (oOtaMgr.bHasRecord && (oOtaMgr.oRecord.u32ImageSize == u32ImageSize) && !memcmp(oOtaMgr.oRecord.au8Digest, pu8Digest, SHA256_DIGEST_SIZE) &&
+		Sha256Restore(&oOtaMgr.oSha, oOtaMgr.oRecord.au32Hash, oOtaMgr.oRecord.u32Offset))
+	{
+		oOtaMgr.u32Offset	= oOtaMgr.oRecord.u32Offset;
+		oOtaMgr.bIsVerified	= (oOtaMgr.oRecord.u32Status == OTAMGR_STATUS_VERIFIED);
+	}
+	else
+	{
+		bRet = OtaMgrClearState();
+		if (!bRet) goto END;
+
+		Sha256Init(&oOtaMgr.oSha);
+		oOtaMgr.u32Offset = 0;
+
+		// Record the new image right away, so a resume is possible even
+		// before the first chunk is committed.
+		bRet = OtaMgrCommit(OTAMGR_STATUS_RECEIVING);
+		if (!bRet) goto END;
+	}
+
+	*pu32Offset			= oOtaMgr.u32Offset;
+	oOtaMgr.bIsActive	= TRUE;
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrWrite - Adds the next bytes of the image.
+/// \public
+///
+/// \param[in]	pvData		Image bytes, following the previous ones.
+/// \param[in]	u32Size		Number of bytes.
+///
+/// \return		TRUE if success, FALSE otherwise (the update must be restarted
+///				with OtaMgrBegin()).
+////////////////////////////////////////////////////////////////////////////////
+bool OtaMgrWrite(const void* pvData, UINT32 u32Size)
+{
+	bool			bRet	= FALSE;
+	const UINT8*	pu8Data	= (const UINT8*)pvData;
+	UINT32			u32Copy	= 0;
+
+	if (!oOtaMgr.bIsActive || oOtaMgr.bIsVerified || !pvData ||
+		(u32Size > oOtaMgr.u32ImageSize - oOtaMgr.u32Offset - oOtaMgr.u8StageLen))
+	{
+		goto END;
+	}
+
+	while (u32Size > 0)
+	{
+		u32Copy = sizeof(oOtaMgr.au8Stage) - oOtaMgr.u8StageLen;
+		if (u32Copy > u32Size)
+		{
+			u32Copy = u32Size;
+		}
+
+		memcpy(&oOtaMgr.au8Stage[oOtaMgr.u8StageLen], pu8Data, u32Copy);
+		oOtaMgr.u8StageLen	+= (UINT8)u32Copy;
+		pu8Data				+= u32Copy;
+		u32Size				-= u32Copy;
+
+		if (oOtaMgr.u8StageLen == sizeof(oOtaMgr.au8Stage))
+		{
+			bRet = OtaMgrFlush();
+			if (!bRet) goto END;
+		}
+	}
+
+	bRet = TRUE;
+END:
+	if (!bRet)
+	{
+		oOtaMgr.bIsActive = FALSE;
+	}
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrEnd - Completes the reception and checks the image.
+/// \public
+/// \details	A hash mismatch discards the progress: the next OtaMgrBegin()
+///				starts from scratch.
+///
+/// \return		TRUE if the whole image is in flash and matches its hash.
+////////////////////////////////////////////////////////////////////////////////
+bool OtaMgrEnd()
+{
+	bool		bRet							= FALSE;
+	UINT8		au8Digest[SHA256_DIGEST_SIZE];
+
+	if (!oOtaMgr.bIsActive) goto END;
+
+	if (oOtaMgr.bIsVerified)
+	{
+		bRet = TRUE;
+		goto END;
+	}
+
+	if (oOtaMgr.u8StageLen)
+	{
+		bRet = OtaMgrFlush();
+		if (!bRet) goto END;
+	}
+
+	if (oOtaMgr.u32Offset != oOtaMgr.u32ImageSize) goto END;
+
+	Sha256Final(&oOtaMgr.oSha, au8Digest);
+
+	if (memcmp(au8Digest, oOtaMgr.au8Digest, SHA256_DIGEST_SIZE))
+	{
+		OtaMgrAbort();
+		goto END;
+	}
+
+	oOtaMgr.bIsVerified = TRUE;
+
+	bRet = OtaMgrCommit(OTAMGR_STATUS_VERIFIED);
+	if (!bRet) goto END;
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrApply - Installs the verified image.
+/// \public
+/// \details	On the ESP8266 the boot loader is asked to copy the update
+///				partition over the running sketch, then the chip restarts and
+///				this function does not return. On the host it only forgets the
+///				progress.
+///
+/// \return		FALSE if there is no verified image.
+////////////////////////////////////////////////////////////////////////////////
+bool OtaMgrApply()
+{
+	bool bRet = FALSE;
+
+	if (!oOtaMgr.bIsActive || !oOtaMgr.bIsVerified) goto END;
+
+	// The new firmware must not find a finished update at boot.
+	bRet = OtaMgrClearState();
+	if (!bRet) goto END;
+
+#ifdef ARDUINO_ARCH_ESP8266
+	{
+		struct eboot_command oCommand;
+
+		memset(&oCommand, 0, sizeof(oCommand));
+		oCommand.action		= ACTION_COPY_RAW;
+		oCommand.args[0]	= oOtaMgr.u32PartAddr;
+		oCommand.args[1]	= 0;
+		oCommand.args[2]	= oOtaMgr.u32ImageSize;
+		eboot_command_write(&oCommand);
+
+		system_restart();
+	}
+#endif
+
+	oOtaMgr.bIsActive	= FALSE;
+	oOtaMgr.bIsVerified	= FALSE;
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrAbort - Cancels the update and forgets its progress.
+/// \public
+////////////////////////////////////////////////////////////////////////////////
+void OtaMgrAbort()
+{
+	OtaMgrClearState();
+
+	oOtaMgr.bIsActive	= FALSE;
+	oOtaMgr.bIsVerified	= FALSE;
+	oOtaMgr.u32Offset	= 0;
+	oOtaMgr.u8StageLen	= 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrIsActive - Checks if an update is in progress.
+/// \public
+///
+/// \return		TRUE between OtaMgrBegin() and OtaMgrApply() or a failure.
+////////////////////////////////////////////////////////////////////////////////
+bool OtaMgrIsActive()
+{
+	return oOtaMgr.bIsActive;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrGetOffset - Gets the resume point.
+/// \public
+/// \details	Offset of the last committed chunk, whatever the image. A
+///				transport can use it in its first request and only reconnect
+///				if OtaMgrBegin() disagrees.
+///
+/// \return		Bytes already committed.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 OtaMgrGetOffset()
+{
+	return oOtaMgr.bHasRecord ? oOtaMgr.oRecord.u32Offset : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrEncodeHeader - Serializes the stream header.
+/// \public
+///
+/// \param[in]	u32ImageSize	Size of the image, in bytes.
+/// \param[in]	pu8Digest		SHA-256 of the image.
+/// \param[out]	pu8Header		OTAMGR_HEADER_SIZE bytes.
+////////////////////////////////////////////////////////////////////////////////
+void OtaMgrEncodeHeader(UINT32 u32ImageSize, const UINT8* pu8Digest, UINT8* pu8Header)
+{
+	UINT8 u8Idx = 0;
+
+	for (u8Idx = 0; u8Idx < 4; ++u8Idx)
+	{
+		pu8Header[u8Idx]		= (UINT8)(OTAMGR_MAGIC >> (8 * u8Idx));
+		pu8Header[4 + u8Idx]	= (UINT8)(u32ImageSize >> (8 * u8Idx));
+	}
+
+	memcpy(&pu8Header[8], pu8Digest, SHA256_DIGEST_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrDecodeHeader - Parses the stream header.
+/// \public
+///
+/// \param[in]	pu8Header		OTAMGR_HEADER_SIZE bytes.
+/// \param[out]	pu32ImageSize	Size of the image, in bytes.
+/// \param[out]	pu8Digest		SHA-256 of the image.
+///
+/// \return		TRUE if success, FALSE if this is not a stream header.
+////////////////////////////////////////////////////////////////////////////////
+bool OtaMgrDecodeHeader(const UINT8* pu8Header, UINT32* pu32ImageSize, UINT8* pu8Digest)
+{
+	UINT32	u32Magic	= 0;
+	UINT32	u32Size		= 0;
+	UINT8	u8Idx		= 0;
+
+	for (u8Idx = 0; u8Idx < 4; ++u8Idx)
+	{
+		u32Magic	|= (UINT32)pu8Header[u8Idx] << (8 * u8Idx);
+		u32Size		|= (UINT32)pu8Header[4 + u8Idx] << (8 * u8Idx);
+	}
+
+	if (u32Magic != OTAMGR_MAGIC)
+	{
+		return FALSE;
+	}
+
+	*pu32ImageSize = u32Size;
+	memcpy(pu8Digest, &pu8Header[8], SHA256_DIGEST_SIZE);
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrFlush - Programs the staged bytes.
+/// \details	The bytes are read back from flash and the hash is computed on
+///				what was actually programmed. A sector is erased when the first
+///				block of it is programmed, and a progress record is committed
+///				at the end of each chunk.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+static bool OtaMgrFlush()
+{
+	bool	bRet							= FALSE;
+	UINT32	u32Addr							= oOtaMgr.u32PartAddr + oOtaMgr.u32Offset;
+	UINT8	au8Check[SHA256_BLOCK_SIZE];
+
+	if ((oOtaMgr.u32Offset % FLASHMGR_SECTOR_SIZE) == 0)
+	{
+		bRet = FlashMgrErase(u32Addr, FLASHMGR_SECTOR_SIZE);
+		if (!bRet) goto END;
+	}
+
+	bRet = FlashMgrWrite(u32Addr, oOtaMgr.au8Stage, oOtaMgr.u8StageLen);
+	if (!bRet) goto END;
+
+	bRet = FlashMgrRead(u32Addr, au8Check, oOtaMgr.u8StageLen);
+	if (!bRet) goto END;
+
+	if (memcmp(au8Check, oOtaMgr.au8Stage, oOtaMgr.u8StageLen))
+	{
+		bRet = FALSE;
+		goto END;
+	}
+
+	Sha256Update(&oOtaMgr.oSha, au8Check, oOtaMgr.u8StageLen);
+	oOtaMgr.u32Offset	+= oOtaMgr.u8StageLen;
+	oOtaMgr.u8StageLen	= 0;
+
+	if (((oOtaMgr.u32Offset % OTAMGR_CHUNK_SIZE) == 0) && (oOtaMgr.u32Offset < oOtaMgr.u32ImageSize))
+	{
+		bRet = OtaMgrCommit(OTAMGR_STATUS_RECEIVING);
+		if (!bRet) goto END;
+	}
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrCommit - Appends a progress record.
+///
+/// \param[in]	u32Status	OTAMGR_STATUS_*.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+static bool OtaMgrCommit(UINT32 u32Status)
+{
+	bool			bRet	= FALSE;
+	oOtaMgrRecordTy	oRecord;
+
+	memset(&oRecord, 0, sizeof(oRecord));
+	oRecord.u32Magic		= OTAMGR_RECORD_MAGIC;
+	oRecord.u32Status		= u32Status;
+	oRecord.u32ImageSize	= oOtaMgr.u32ImageSize;
+	oRecord.u32Offset		= oOtaMgr.u32Offset;
+	memcpy(oRecord.au8Digest, oOtaMgr.au8Digest, SHA256_DIGEST_SIZE);
+	memcpy(oRecord.au32Hash, oOtaMgr.oSha.au32State, sizeof(oRecord.au32Hash));
+	oRecord.u32Crc			= Crc32(&oRecord, offsetof(oOtaMgrRecordTy, u32Crc));
+
+	if (oOtaMgr.u8NextSlot >= OTAMGR_RECORD_SLOTS)
+	{
+		bRet = FlashMgrErase(oOtaMgr.u32StateAddr, FLASHMGR_SECTOR_SIZE);
+		if (!bRet) goto END;
+
+		oOtaMgr.u8NextSlot = 0;
+	}
+
+	bRet = FlashMgrWrite(oOtaMgr.u32StateAddr + (UINT32)oOtaMgr.u8NextSlot * OTAMGR_RECORD_SLOT, &oRecord, sizeof(oRecord));
+	++oOtaMgr.u8NextSlot;
+	if (!bRet) goto END;
+
+	oOtaMgr.oRecord		= oRecord;
+	oOtaMgr.bHasRecord	= TRUE;
+
+	bRet = TRUE;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		OtaMgrClearState - Erases all the progress records.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+static bool OtaMgrClearState()
+{
+	oOtaMgr.bHasRecord	= FALSE;
+	oOtaMgr.u8NextSlot	= 0;
+
+	return FlashMgrErase(oOtaMgr.u32StateAddr, FLASHMGR_SECTOR_SIZE);
+}
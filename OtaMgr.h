@@ -0,0 +1,62 @@
+///
+/// \file     OtaMgr.h
+/// \brief    Firmware update manager
+/// \details  Streams a firmware image into the inactive flash partition as it
+///           arrives. Nothing bigger than one SHA-256 block is kept in RAM.
+///           Each time a full chunk (one flash sector) is programmed, a
+///           progress record holding the offset and the running hash state
+///           is appended in the OTA_STATE sector. After a disconnect or a
+///           reboot the transfer resumes from the last committed chunk.
+///
+///           The transport only has to deliver the image bytes in order from
+///           the offset given by OtaMgrBegin(). The one used by the firmware
+///           (see OtaClient) is a plain TCP stream:
+///             client -> server    "OTA <offset>\n"
+///             server -> client    header (OTAMGR_HEADER_SIZE bytes), then the
+///                                 image from <offset> to the end.
+///           Header, little endian:
+///             Offset  Size  Field
+///             0       4     Magic (OTAMGR_MAGIC)
+///             4       4     Image size, in bytes
+///             8       32    SHA-256 of the whole image
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef OTAMGR_H
+#define OTAMGR_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "Sha256.h"
+#include "FlashMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define OTAMGR_PORT             4211                    ///< Default TCP port of the update server.
+#define OTAMGR_MAGIC            0x3141544FUL            ///< "OTA1" on the wire.
+#define OTAMGR_HEADER_SIZE      (8 + SHA256_DIGEST_SIZE)    ///< Size of the stream header, in bytes.
+#define OTAMGR_CHUNK_SIZE       FLASHMGR_SECTOR_SIZE    ///< Commit granularity, in bytes.
+#define OTAMGR_REQUEST_MAX      24                      ///< Longest request line, in bytes.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool    OtaMgr();
+bool    OtaMgrBegin(UINT32 u32ImageSize, const UINT8* pu8Digest, UINT32* pu32Offset);
+bool    OtaMgrWrite(const void* pvData, UINT32 u32Size);
+bool    OtaMgrEnd();
+bool    OtaMgrApply();
+void    OtaMgrAbort();
+bool    OtaMgrIsActive();
+UINT32  OtaMgrGetOffset();
+
+void    OtaMgrEncodeHeader(UINT32 u32ImageSize, const UINT8* pu8Digest, UINT8* pu8Header);
+bool    OtaMgrDecodeHeader(const UINT8* pu8Header, UINT32* pu32ImageSize, UINT8* pu8Digest);
+
+#endif
@@ -0,0 +1,212 @@
+///
+/// \file     SensorHealth.c
+/// \brief    Moisture probe health and fault detection
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "SensorHealth.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oSensorHealthTy
+/// \brief 	SensorHealth object.
+///
+typedef struct
+{
+	// Current reading.
+	UINT16		u16SampleCount;					///< Samples of the current reading.
+	UINT16		u16RailLowCount;				///< Samples at the low rail.
+	UINT16		u16RailHighCount;				///< Samples at the high rail.
+
+	// History.
+	bool		bHasPrevious;					///< At least one reading done.
+	UINT16		u16PrevAverage;					///< Average of the previous reading.
+	UINT8		u8StuckCount;					///< Identical readings in a row.
+	UINT16		u16ReadingCount;				///< Readings since reset, saturated.
+	UINT32		u32Baseline;					///< Long-term EWMA of the average, fixed point (<< SHIFT).
+	UINT16		u16Reference;					///< Baseline the drift is measured from.
+	bool		bHasReference;					///< u16Reference is valid.
+} oSensorHealthTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oSensorHealthTy oSensorHealth = {0};
+
+MEMSTATS_REGISTER(SensorHealth, sizeof(oSensorHealth))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SensorHealthReset - Forgets everything learnt about the probe.
+/// \public
+/// \details	Call it after replacing or moving a probe.
+////////////////////////////////////////////////////////////////////////////////
+void SensorHealthReset()
+{
+	memset(&oSensorHealth, 0, sizeof(oSensorHealth));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SensorHealthRebase - Takes the current baseline as the drift
+///				reference.
+/// \public
+/// \details	Call it when the probe is recalibrated: what it reads now is
+///				the new normal. Before the first reference, does nothing.
+////////////////////////////////////////////////////////////////////////////////
+void SensorHealthRebase()
+{
+	if (oSensorHealth.bHasReference)
+	{
+		oSensorHealth.u16Reference = (UINT16)(oSensorHealth.u32Baseline >> SENSORHEALTH_BASELINE_SHIFT);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SensorHealthSample - Feeds one polling sample.
+/// \public
+///
+/// \param[in]	u16Raw	Raw ADC value.
+////////////////////////////////////////////////////////////////////////////////
+void SensorHealthSample(UINT16 u16Raw)
+{
+	++oSensorHealth.u16SampleCount;
+
+	if (u16Raw <= SENSORHEALTH_RAIL_LOW)
+	{
+		++oSensorHealth.u16RailLowCount;
+	}
+	else if (u16Raw >= SENSORHEALTH_RAIL_HIGH)
+	{
+		++oSensorHealth.u16RailHighCount;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SensorHealthReading - Evaluates a completed reading.
+/// \public
+/// \details	Must be called once per reading, after its samples.
+///
+/// \param[in]	u16Average		Raw average of the reading.
+/// \param[in]	u16Variance		Raw variance of the reading.
+/// \param[out]	pu8Quality		SensorHealthQualityTy of the reading.
+/// \param[out]	pu8FaultCode	SENSORHEALTH_FAULT_* mask.
+////////////////////////////////////////////////////////////////////////////////
+void SensorHealthReading(UINT16 u16Average, UINT16 u16Variance, UINT8* pu8Quality, UINT8* pu8FaultCode)
+{
+	UINT8	u8Fault		= SENSORHEALTH_FAULT_NONE;
+	UINT16	u16Step		= 0;
+	UINT16	u16Baseline	= 0;
+	UINT16	u16Drift	= 0;
+
+	// Rails: most of the samples pinned to one end.
+	if (oSensorHealth.u16SampleCount)
+	{
+		if (oSensorHealth.u16RailLowCount * 2 > oSensorHealth.u16SampleCount)
+		{
+			u8Fault |= SENSORHEALTH_FAULT_RAIL_LOW;
+		}
+		if (oSensorHealth.u16RailHighCount * 2 > oSensorHealth.u16SampleCount)
+		{
+			u8Fault |= SENSORHEALTH_FAULT_RAIL_HIGH;
+		}
+	}
+
+	if (oSensorHealth.bHasPrevious)
+	{
+		// Stuck: a live ADC always has some noise.
+		if ((u16Variance == 0) && (u16Average == oSensorHealth.u16PrevAverage))
+		{
+			if (oSensorHealth.u8StuckCount < SENSORHEALTH_STUCK_READINGS)
+			{
+				++oSensorHealth.u8StuckCount;
+			}
+		}
+		else
+		{
+			oSensorHealth.u8StuckCount = 0;
+		}
+
+		if (oSensorHealth.u8StuckCount >= SENSORHEALTH_STUCK_READINGS)
+		{
+			u8Fault |= SENSORHEALTH_FAULT_STUCK;
+		}
+
+		u16Step = (u16Average > oSensorHealth.u16PrevAverage) ? (u16Average - oSensorHealth.u16PrevAverage) : (oSensorHealth.u16PrevAverage - u16Average);
+		if (u16Step > SENSORHEALTH_STEP_MAX)
+		{
+			u8Fault |= SENSORHEALTH_FAULT_STEP;
+		}
+	}
+
+	// Drift: only healthy readings feed the baseline.
+	if (!(u8Fault & (SENSORHEALTH_FAULT_RAIL_LOW | SENSORHEALTH_FAULT_RAIL_HIGH | SENSORHEALTH_FAULT_STUCK)))
+	{
+		if (oSensorHealth.u16ReadingCount == 0)
+		{
+			oSensorHealth.u32Baseline = (UINT32)u16Average << SENSORHEALTH_BASELINE_SHIFT;
+		}
+		else
+		{
+			oSensorHealth.u32Baseline += u16Average;
+			oSensorHealth.u32Baseline -= oSensorHealth.u32Baseline >> SENSORHEALTH_BASELINE_SHIFT;
+		}
+
+		if (oSensorHealth.u16ReadingCount < 0xFFFF)
+		{
+			++oSensorHealth.u16ReadingCount;
+		}
+
+		u16Baseline = (UINT16)(oSensorHealth.u32Baseline >> SENSORHEALTH_BASELINE_SHIFT);
+
+		if (!oSensorHealth.bHasReference && (oSensorHealth.u16ReadingCount >= SENSORHEALTH_BASELINE_READINGS))
+		{
+			oSensorHealth.u16Reference	= u16Baseline;
+			oSensorHealth.bHasReference	= TRUE;
+		}
+	}
+
+	if (oSensorHealth.bHasReference)
+	{
+		u16Baseline	= (UINT16)(oSensorHealth.u32Baseline >> SENSORHEALTH_BASELINE_SHIFT);
+		u16Drift	= (u16Baseline > oSensorHealth.u16Reference) ? (u16Baseline - oSensorHealth.u16Reference) : (oSensorHealth.u16Reference - u16Baseline);
+		if (u16Drift > SENSORHEALTH_DRIFT_MAX)
+		{
+			u8Fault |= SENSORHEALTH_FAULT_DRIFT;
+		}
+	}
+
+	oSensorHealth.bHasPrevious		= TRUE;
+	oSensorHealth.u16PrevAverage	= u16Average;
+	oSensorHealth.u16SampleCount	= 0;
+	oSensorHealth.u16RailLowCount	= 0;
+	oSensorHealth.u16RailHighCount	= 0;
+
+	if (pu8FaultCode)
+	{
+		*pu8FaultCode = u8Fault;
+	}
+
+	if (pu8Quality)
+	{
+		if (u8Fault & (SENSORHEALTH_FAULT_RAIL_LOW | SENSORHEALTH_FAULT_RAIL_HIGH | SENSORHEALTH_FAULT_STUCK))
+		{
+			*pu8Quality = SENSORHEALTH_QUALITY_BAD;
+		}
+		else if (u8Fault)
+		{
+			*pu8Quality = SENSORHEALTH_QUALITY_SUSPECT;
+		}
+		else
+		{
+			*pu8Quality = SENSORHEALTH_QUALITY_GOOD;
+		}
+	}
+}
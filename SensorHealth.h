@@ -0,0 +1,71 @@
+///
+/// \file     SensorHealth.h
+/// \brief    Moisture probe health and fault detection
+/// \details  Online detectors fed by the polling samples and by the result
+///           of each reading:
+///           - rails: the ADC sits at 0 (shorted line) or at full scale
+///             (disconnected probe);
+///           - stuck: no variance and the same average for several readings
+///             in a row (stuck ADC or dead probe);
+///           - step: implausible change of average between two readings;
+///           - drift: the long-term baseline moved away from its reference
+///             (corrosion, probe creeping out of the soil). The reference is
+///             learnt after boot and only renewed by SensorHealthRebase(),
+///             when the probe is recalibrated.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef SENSORHEALTH_H
+#define SENSORHEALTH_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SENSORHEALTH_RAIL_LOW           2       ///< Raw value at or below: low rail.
+#define SENSORHEALTH_RAIL_HIGH          1021    ///< Raw value at or above: high rail.
+#define SENSORHEALTH_STUCK_READINGS     8       ///< Identical readings in a row for a stuck sensor.
+#define SENSORHEALTH_STEP_MAX           250     ///< Largest plausible change of average between two readings (raw).
+#define SENSORHEALTH_DRIFT_MAX          120     ///< Largest accepted move of the long-term baseline (raw).
+#define SENSORHEALTH_BASELINE_READINGS  64      ///< Readings used to learn the reference baseline.
+#define SENSORHEALTH_BASELINE_SHIFT     10      ///< Long-term EWMA weight: 1 / 2^shift per reading.
+
+// Fault codes (bit mask).
+#define SENSORHEALTH_FAULT_NONE         0x00
+#define SENSORHEALTH_FAULT_RAIL_LOW     0x01    ///< Shorted line.
+#define SENSORHEALTH_FAULT_RAIL_HIGH    0x02    ///< Disconnected probe.
+#define SENSORHEALTH_FAULT_STUCK        0x04    ///< Stuck ADC or dead probe.
+#define SENSORHEALTH_FAULT_STEP         0x08    ///< Implausible step change.
+#define SENSORHEALTH_FAULT_DRIFT        0x10    ///< Slow baseline drift.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   SensorHealthQualityTy
+/// \brief  Quality of a result.
+///
+typedef enum
+{
+	SENSORHEALTH_QUALITY_GOOD		= 0,	///< No fault.
+	SENSORHEALTH_QUALITY_SUSPECT,			///< Usable with care (step, drift).
+	SENSORHEALTH_QUALITY_BAD,				///< Not a moisture measurement (rail, stuck).
+} SensorHealthQualityTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+void SensorHealthReset();
+void SensorHealthRebase();
+void SensorHealthSample(UINT16 u16Raw);
+void SensorHealthReading(UINT16 u16Average, UINT16 u16Variance, UINT8* pu8Quality, UINT8* pu8FaultCode);
+
+#endif
@@ -0,0 +1,357 @@
+///
+/// \file     SeriesCodec.c
+/// \brief    Streaming compression of moisture time series
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "SeriesCodec.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SERIESCODEC_FIRST_BITS      (32 + 16 + 8)   ///< Size of the first (verbatim) sample.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void SeriesPutBits(UINT8* pu8Stream, UINT32* pu32Pos, UINT32 u32Value, UINT8 u8Bits);
+static UINT32 SeriesGetBits(const UINT8* pu8Stream, UINT32* pu32Pos, UINT8 u8Bits);
+static UINT32 SeriesRead(poSeriesDecoderTy this, UINT8 u8Bits);
+static UINT32 SeriesZigzag(INT32 i32Value);
+static INT32 SeriesUnzigzag(UINT32 u32Value);
+static UINT8 SeriesTimeBits(INT32 i32Dod);
+static UINT8 SeriesRawBits(UINT32 u32Zigzag);
+static UINT8 SeriesValueBits(UINT32 u32Zigzag);
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SeriesEncoderInit - Starts a new block.
+/// \public
+///
+/// \param[in]	pu8Block	Block to fill.
+/// \param[in]	u16Size		Size of the block, in bytes.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool SeriesEncoderInit(poSeriesEncoderTy this, UINT8* pu8Block, UINT16 u16Size)
+{
+	if (!this || !pu8Block || (u16Size < SERIESCODEC_HEADER_SIZE + SERIESCODEC_FIRST_BITS / 8))
+	{
+		return FALSE;
+	}
+
+	this->pu8Block		= pu8Block;
+	this->u16Size		= u16Size;
+	this->u32BitPos		= 0;
+	this->u16Count		= 0;
+
+	pu8Block[0] = 0;
+	pu8Block[1] = 0;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SeriesEncoderAppend - Adds a sample to the block.
+/// \public
+///
+/// \param[in]	u32Timestamp	Time stamp of the sample, in ms.
+/// \param[in]	u16Raw			Raw ADC value.
+/// \param[in]	u8Value			Mapped value, in %.
+///
+/// \return		TRUE if added, FALSE if the block is full.
+////////////////////////////////////////////////////////////////////////////////
+bool SeriesEncoderAppend(poSeriesEncoderTy this, UINT32 u32Timestamp, UINT16 u16Raw, UINT8 u8Value)
+{
+	UINT8*	pu8Stream	= NULL;
+	INT32	i32Delta	= 0;
+	INT32	i32Dod		= 0;
+	UINT32	u32RawZz	= 0;
+	UINT32	u32ValueZz	= 0;
+	UINT8	u8TimeBits	= 0;
+	UINT8	u8RawBits	= 0;
+	UINT8	u8ValueBits	= 0;
+
+	if (!this || !this->pu8Block || (this->u16Count == 0xFFFF))
+	{
+		return FALSE;
+	}
+
+	pu8Stream = &this->pu8Block[SERIESCODEC_HEADER_SIZE];
+
+	if (this->u16Count == 0)
+	{
+		SeriesPutBits(pu8Stream, &this->u32BitPos, u32Timestamp, 32);
+		SeriesPutBits(pu8Stream, &this->u32BitPos, u16Raw, 16);
+		SeriesPutBits(pu8Stream, &this->u32BitPos, u8Value, 8);
+
+		this->i32PrevDelta = 0;
+	}
+	else
+	{
+		i32Delta	= (INT32)(u32Timestamp - this->u32PrevTimestamp);
+		i32Dod		= i32Delta - this->i32PrevDelta;
+		u32RawZz	= SeriesZigzag((INT32)u16Raw - this->u16PrevRaw);
+		u32ValueZz	= SeriesZigzag((INT32)u8Value - this->u8PrevValue);
+
+		u8TimeBits	= SeriesTimeBits(i32Dod);
+		u8RawBits	= SeriesRawBits(u32RawZz);
+		u8ValueBits	= SeriesValueBits(u32ValueZz);
+
+		// Exact size known up front: nothing to roll back when full.
+		if (SERIESCODEC_HEADER_SIZE + (this->u32BitPos + u8TimeBits + u8RawBits + u8ValueBits + 7) / 8 > this->u16Size)
+		{
+			return FALSE;
+		}
+
+		switch (u8TimeBits)
+		{
+		case 1:		SeriesPutBits(pu8Stream, &this->u32BitPos, 0x0, 1); break;
+		case 9:		SeriesPutBits(pu8Stream, &this->u32BitPos, 0x2, 2); SeriesPutBits(pu8Stream, &this->u32BitPos, i32Dod + 63, 7); break;
+		case 12:	SeriesPutBits(pu8Stream, &this->u32BitPos, 0x6, 3); SeriesPutBits(pu8Stream, &this->u32BitPos, i32Dod + 255, 9); break;
+		case 16:	SeriesPutBits(pu8Stream, &this->u32BitPos, 0xE, 4); SeriesPutBits(pu8Stream, &this->u32BitPos, i32Dod + 2047, 12); break;
+		default:	SeriesPutBits(pu8Stream, &this->u32BitPos, 0xF, 4); SeriesPutBits(pu8Stream, &this->u32BitPos, (UINT32)i32Dod, 32); break;
+		}
+
+		switch (u8RawBits)
+		{
+		case 1:		SeriesPutBits(pu8Stream, &this->u32BitPos, 0x0, 1); break;
+		case 6:		SeriesPutBits(pu8Stream, &this->u32BitPos, 0x2, 2); SeriesPutBits(pu8Stream, &this->u32BitPos, u32RawZz, 4); break;
+		case 10:	SeriesPutBits(pu8Stream, &this->u32BitPos, 0x6, 3); SeriesPutBits(pu8Stream, &this->u32BitPos, u32RawZz, 7); break;
+		default:	SeriesPutBits(pu8Stream, &this->u32BitPos, 0x7, 3); SeriesPutBits(pu8Stream, &this->u32BitPos, u16Raw, 16); break;
+		}
+
+		switch (u8ValueBits)
+		{
+		case 1:		SeriesPutBits(pu8Stream, &this->u32BitPos, 0x0, 1); break;
+		case 6:		SeriesPutBits(pu8Stream, &this->u32BitPos, 0x2, 2); SeriesPutBits(pu8Stream, &this->u32BitPos, u32ValueZz, 4); break;
+		default:	SeriesPutBits(pu8Stream, &this->u32BitPos, 0x3, 2); SeriesPutBits(pu8Stream, &this->u32BitPos, u8Value, 8); break;
+		}
+
+		this->i32PrevDelta = i32Delta;
+	}
+
+	this->u32PrevTimestamp	= u32Timestamp;
+	this->u16PrevRaw		= u16Raw;
+	this->u8PrevValue		= u8Value;
+
+	// Keep the block decodable at any time.
+	++this->u16Count;
+	this->pu8Block[0] = (UINT8)(this->u16Count);
+	this->pu8Block[1] = (UINT8)(this->u16Count >> 8);
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SeriesEncoderGetSize - Gets the number of bytes used in the block.
+/// \public
+///
+/// \return		Bytes to store or send.
+////////////////////////////////////////////////////////////////////////////////
+UINT16 SeriesEncoderGetSize(poSeriesEncoderTy this)
+{
+	if (!this)
+	{
+		return 0;
+	}
+
+	return SERIESCODEC_HEADER_SIZE + (this->u32BitPos + 7) / 8;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SeriesDecoderInit - Starts decoding a block.
+/// \public
+///
+/// \param[in]	pu8Block	Block produced by the encoder.
+/// \param[in]	u16Size		Number of bytes available in the block.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool SeriesDecoderInit(poSeriesDecoderTy this, const UINT8* pu8Block, UINT16 u16Size)
+{
+	if (!this || !pu8Block || (u16Size < SERIESCODEC_HEADER_SIZE))
+	{
+		return FALSE;
+	}
+
+	this->pu8Block		= pu8Block;
+	this->u16Size		= u16Size;
+	this->u32BitPos		= 0;
+	this->u16Count		= pu8Block[0] | (pu8Block[1] << 8);
+	this->u16Index		= 0;
+	this->bOverrun		= FALSE;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SeriesDecoderNext - Decodes the next sample.
+/// \public
+///
+/// \param[out]	pu32Timestamp	Time stamp, in ms.
+/// \param[out]	pu16Raw			Raw ADC value.
+/// \param[out]	pu8Value		Mapped value, in %.
+///
+/// \return		TRUE if a sample was decoded, FALSE at the end of the block.
+////////////////////////////////////////////////////////////////////////////////
+bool SeriesDecoderNext(poSeriesDecoderTy this, UINT32* pu32Timestamp, UINT16* pu16Raw, UINT8* pu8Value)
+{
+	INT32			i32Dod		= 0;
+	UINT32			u32Bits		= 0;
+
+	if (!this || !pu32Timestamp || !pu16Raw || !pu8Value || (this->u16Index >= this->u16Count))
+	{
+		return FALSE;
+	}
+
+	if (this->u16Index == 0)
+	{
+		this->u32PrevTimestamp	= SeriesRead(this, 32);
+		this->u16PrevRaw		= (UINT16)SeriesRead(this, 16);
+		this->u8PrevValue		= (UINT8)SeriesRead(this, 8);
+		this->i32PrevDelta		= 0;
+	}
+	else
+	{
+		if		(!SeriesRead(this, 1))	i32Dod = 0;
+		else if (!SeriesRead(this, 1))	i32Dod = (INT32)SeriesRead(this, 7) - 63;
+		else if (!SeriesRead(this, 1))	i32Dod = (INT32)SeriesRead(this, 9) - 255;
+		else if (!SeriesRead(this, 1))	i32Dod = (INT32)SeriesRead(this, 12) - 2047;
+		else							i32Dod = (INT32)SeriesRead(this, 32);
+
+		this->i32PrevDelta		+= i32Dod;
+		this->u32PrevTimestamp	+= (UINT32)this->i32PrevDelta;
+
+		if		(!SeriesRead(this, 1))	u32Bits = 0;
+		else if (!SeriesRead(this, 1))	u32Bits = SeriesRead(this, 4);
+		else if (!SeriesRead(this, 1))	u32Bits = SeriesRead(this, 7);
+		else
+		{
+			this->u16PrevRaw	= (UINT16)SeriesRead(this, 16);
+			u32Bits				= 0;
+		}
+		this->u16PrevRaw = (UINT16)(this->u16PrevRaw + SeriesUnzigzag(u32Bits));
+
+		if		(!SeriesRead(this, 1))	u32Bits = 0;
+		else if (!SeriesRead(this, 1))	u32Bits = SeriesRead(this, 4);
+		else
+		{
+			this->u8PrevValue	= (UINT8)SeriesRead(this, 8);
+			u32Bits				= 0;
+		}
+		this->u8PrevValue = (UINT8)(this->u8PrevValue + SeriesUnzigzag(u32Bits));
+	}
+
+	// Truncated or corrupted block.
+	if (this->bOverrun)
+	{
+		this->u16Index = this->u16Count;
+		return FALSE;
+	}
+
+	++this->u16Index;
+
+	*pu32Timestamp	= this->u32PrevTimestamp;
+	*pu16Raw		= this->u16PrevRaw;
+	*pu8Value		= this->u8PrevValue;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void SeriesPutBits(UINT8* pu8Stream, UINT32* pu32Pos, UINT32 u32Value, UINT8 u8Bits)
+{
+	UINT32	u32Byte	= 0;
+	UINT8	u8Free	= 0;
+	UINT8	u8Count	= 0;
+
+	while (u8Bits)
+	{
+		u32Byte	= *pu32Pos >> 3;
+		u8Free	= 8 - (*pu32Pos & 7);
+		u8Count	= (u8Bits < u8Free) ? u8Bits : u8Free;
+
+		if (u8Free == 8)
+		{
+			pu8Stream[u32Byte] = 0;
+		}
+
+		pu8Stream[u32Byte] |= ((u32Value >> (u8Bits - u8Count)) & ((1U << u8Count) - 1)) << (u8Free - u8Count);
+
+		*pu32Pos	+= u8Count;
+		u8Bits		-= u8Count;
+	}
+}
+
+static UINT32 SeriesGetBits(const UINT8* pu8Stream, UINT32* pu32Pos, UINT8 u8Bits)
+{
+	UINT32	u32Value	= 0;
+	UINT8	u8Avail		= 0;
+	UINT8	u8Count		= 0;
+
+	while (u8Bits)
+	{
+		u8Avail	= 8 - (*pu32Pos & 7);
+		u8Count	= (u8Bits < u8Avail) ? u8Bits : u8Avail;
+
+		u32Value = (u32Value << u8Count) | ((pu8Stream[*pu32Pos >> 3] >> (u8Avail - u8Count)) & ((1U << u8Count) - 1));
+
+		*pu32Pos	+= u8Count;
+		u8Bits		-= u8Count;
+	}
+
+	return u32Value;
+}
+
+static UINT32 SeriesRead(poSeriesDecoderTy this, UINT8 u8Bits)
+{
+	if (this->bOverrun || ((this->u32BitPos + u8Bits + 7) / 8 > (UINT32)(this->u16Size - SERIESCODEC_HEADER_SIZE)))
+	{
+		this->bOverrun = TRUE;
+		return 0;
+	}
+
+	return SeriesGetBits(&this->pu8Block[SERIESCODEC_HEADER_SIZE], &this->u32BitPos, u8Bits);
+}
+
+static UINT32 SeriesZigzag(INT32 i32Value)
+{
+	return ((UINT32)i32Value << 1) ^ (UINT32)(i32Value >> 31);
+}
+
+static INT32 SeriesUnzigzag(UINT32 u32Value)
+{
+	return (INT32)(u32Value >> 1) ^ -(INT32)(u32Value & 1);
+}
+
+static UINT8 SeriesTimeBits(INT32 i32Dod)
+{
+	if (i32Dod == 0)								return 1;
+	if ((i32Dod >= -63) && (i32Dod <= 64))			return 2 + 7;
+	if ((i32Dod >= -255) && (i32Dod <= 256))		return 3 + 9;
+	if ((i32Dod >= -2047) && (i32Dod <= 2048))		return 4 + 12;
+	return 4 + 32;
+}
+
+static UINT8 SeriesRawBits(UINT32 u32Zigzag)
+{
+	if (u32Zigzag == 0)		return 1;
+	if (u32Zigzag < 16)		return 2 + 4;
+	if (u32Zigzag < 128)	return 3 + 7;
+	return 3 + 16;
+}
+
+static UINT8 SeriesValueBits(UINT32 u32Zigzag)
+{
+	if (u32Zigzag == 0)		return 1;
+	if (u32Zigzag < 16)		return 2 + 4;
+	return 2 + 8;
+}
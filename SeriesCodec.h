@@ -0,0 +1,84 @@
+///
+/// \file     SeriesCodec.h
+/// \brief    Streaming compression of moisture time series
+/// \details  Gorilla style encoding of (time stamp, raw value, mapped value)
+///           samples into a caller supplied block:
+///           - time stamps: delta-of-delta, so a regular reading interval
+///             costs 1 bit per sample;
+///           - raw and mapped values: zigzag delta with short prefixes, so
+///             an unchanged value costs 1 bit.
+///           The block always holds its sample count, so it can be decoded
+///           (or uploaded) at any time while it is being filled. The format
+///           is target independent and the decoder is used on the host.
+///
+///           Block layout: [count, 16 bits LE][first sample: 32 + 16 + 8
+///           bits][encoded samples...], bits packed MSB first.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef SERIESCODEC_H
+#define SERIESCODEC_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SERIESCODEC_HEADER_SIZE     2       ///< Bytes before the bit stream.
+#define SERIESCODEC_MAX_SAMPLE_BITS 65      ///< Worst case size of one encoded sample.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oSeriesEncoderTy
+/// \brief 	Encoder state. Only the block itself holds the encoded data.
+///
+typedef struct
+{
+	UINT8*		pu8Block;				///< Destination block.
+	UINT16		u16Size;				///< Size of the block, in bytes.
+	UINT32		u32BitPos;				///< Next bit to write, from the start of the bit stream.
+	UINT16		u16Count;				///< Number of samples in the block.
+	UINT32		u32PrevTimestamp;		///< Last time stamp.
+	INT32		i32PrevDelta;			///< Last time stamp delta.
+	UINT16		u16PrevRaw;				///< Last raw value.
+	UINT8		u8PrevValue;			///< Last mapped value.
+} oSeriesEncoderTy, *poSeriesEncoderTy;
+
+///
+/// \struct	oSeriesDecoderTy
+/// \brief 	Decoder state.
+///
+typedef struct
+{
+	const UINT8*	pu8Block;			///< Source block.
+	UINT16			u16Size;			///< Size of the block, in bytes.
+	UINT32			u32BitPos;			///< Next bit to read, from the start of the bit stream.
+	UINT16			u16Count;			///< Number of samples in the block.
+	UINT16			u16Index;			///< Number of samples already decoded.
+	UINT32			u32PrevTimestamp;	///< Last time stamp.
+	INT32			i32PrevDelta;		///< Last time stamp delta.
+	UINT16			u16PrevRaw;			///< Last raw value.
+	UINT8			u8PrevValue;		///< Last mapped value.
+	bool			bOverrun;			///< The bit stream ended before the sample count.
+} oSeriesDecoderTy, *poSeriesDecoderTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool SeriesEncoderInit(poSeriesEncoderTy, UINT8* pu8Block, UINT16 u16Size);
+bool SeriesEncoderAppend(poSeriesEncoderTy, UINT32 u32Timestamp, UINT16 u16Raw, UINT8 u8Value);
+UINT16 SeriesEncoderGetSize(poSeriesEncoderTy);
+
+bool SeriesDecoderInit(poSeriesDecoderTy, const UINT8* pu8Block, UINT16 u16Size);
+bool SeriesDecoderNext(poSeriesDecoderTy, UINT32* pu32Timestamp, UINT16* pu16Raw, UINT8* pu8Value);
+
+#endif
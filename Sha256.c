@@ -0,0 +1,210 @@
+///
+/// \file     Sha256.c
+/// \brief    SHA-256 utility (FIPS 180-4)
+/// \details  Plain C, no table other than the round constants. The chaining
+///           state can be saved at a block boundary and restored later, which
+///           lets a long transfer be hashed across reboots.
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "Sha256.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SHA256_ROR(x, n)        (((x) >> (n)) | ((x) << (32 - (n))))
+#define SHA256_CH(x, y, z)      (((x) & (y)) ^ (~(x) & (z)))
+#define SHA256_MAJ(x, y, z)     (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define SHA256_S0(x)            (SHA256_ROR(x, 2) ^ SHA256_ROR(x, 13) ^ SHA256_ROR(x, 22))
+#define SHA256_S1(x)            (SHA256_ROR(x, 6) ^ SHA256_ROR(x, 11) ^ SHA256_ROR(x, 25))
+#define SHA256_G0(x)            (SHA256_ROR(x, 7) ^ SHA256_ROR(x, 18) ^ ((x) >> 3))
+#define SHA256_G1(x)            (SHA256_ROR(x, 17) ^ SHA256_ROR(x, 19) ^ ((x) >> 10))
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void Sha256Compress(UINT32* pu32State, const UINT8* pu8Block);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static const UINT32 au32Sha256Init[SHA256_STATE_WORDS] =
+{
+	0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+	0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+static const UINT32 au32Sha256K[64] =
+{
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		Sha256Init - Starts a new hash.
+/// \public
+///
+/// \param[out]	poSha		Running hash.
+////////////////////////////////////////////////////////////////////////////////
+void Sha256Init(poSha256Ty poSha)
+{
+	memcpy(poSha->au32State, au32Sha256Init, sizeof(poSha->au32State));
+	poSha->u64Length = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		Sha256Restore - Resumes a hash from a saved chaining state.
+/// \public
+///
+/// \param[out]	poSha		Running hash.
+/// \param[in]	pu32State	Chaining state saved from au32State.
+/// \param[in]	u64Length	Bytes hashed when the state was saved.
+///
+/// \return		TRUE if success, FALSE if the length is not on a block boundary.
+////////////////////////////////////////////////////////////////////////////////
+bool Sha256Restore(poSha256Ty poSha, const UINT32* pu32State, UINT64 u64Length)
+{
+	if (u64Length % SHA256_BLOCK_SIZE)
+	{
+		return FALSE;
+	}
+
+	memcpy(poSha->au32State, pu32State, sizeof(poSha->au32State));
+	poSha->u64Length = u64Length;
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		Sha256Update - Adds a block of data to a running hash.
+/// \public
+///
+/// \param[in]	poSha		Running hash.
+/// \param[in]	pvData		Data to add.
+/// \param[in]	u32Size		Number of bytes to add.
+////////////////////////////////////////////////////////////////////////////////
+void Sha256Update(poSha256Ty poSha, const void* pvData, UINT32 u32Size)
+{
+	const UINT8*	pu8Data	= (const UINT8*)pvData;
+	UINT32			u32Fill	= (UINT32)(poSha->u64Length % SHA256_BLOCK_SIZE);
+	UINT32			u32Copy	= 0;
+
+	poSha->u64Length += u32Size;
+
+	// Complete a pending block first.
+	if (u32Fill)
+	{
+		u32Copy = SHA256_BLOCK_SIZE - u32Fill;
+		if (u32Copy > u32Size)
+		{
+			u32Copy = u32Size;
+		}
+
+		memcpy(&poSha->au8Block[u32Fill], pu8Data, u32Copy);
+		pu8Data	+= u32Copy;
+		u32Size	-= u32Copy;
+
+		if (u32Fill + u32Copy < SHA256_BLOCK_SIZE)
+		{
+			return;
+		}
+
+		Sha256Compress(poSha->au32State, poSha->au8Block);
+	}
+
+	// Full blocks straight from the caller's buffer.
+	for (; u32Size >= SHA256_BLOCK_SIZE; u32Size -= SHA256_BLOCK_SIZE, pu8Data += SHA256_BLOCK_SIZE)
+	{
+		Sha256Compress(poSha->au32State, pu8Data);
+	}
+
+	memcpy(poSha->au8Block, pu8Data, u32Size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		Sha256Final - Finalizes a running hash.
+/// \public
+///
+/// \param[in]	poSha		Running hash. Must be initialized again to be reused.
+/// \param[out]	pu8Digest	SHA256_DIGEST_SIZE bytes.
+////////////////////////////////////////////////////////////////////////////////
+void Sha256Final(poSha256Ty poSha, UINT8* pu8Digest)
+{
+	UINT64	u64Bits	= poSha->u64Length * 8;
+	UINT32	u32Fill	= (UINT32)(poSha->u64Length % SHA256_BLOCK_SIZE);
+	UINT8	u8Idx	= 0;
+
+	poSha->au8Block[u32Fill++] = 0x80;
+
+	if (u32Fill > SHA256_BLOCK_SIZE - 8)
+	{
+		memset(&poSha->au8Block[u32Fill], 0, SHA256_BLOCK_SIZE - u32Fill);
+		Sha256Compress(poSha->au32State, poSha->au8Block);
+		u32Fill = 0;
+	}
+
+	memset(&poSha->au8Block[u32Fill], 0, SHA256_BLOCK_SIZE - 8 - u32Fill);
+
+	for (u8Idx = 0; u8Idx < 8; ++u8Idx)
+	{
+		poSha->au8Block[SHA256_BLOCK_SIZE - 1 - u8Idx] = (UINT8)(u64Bits >> (8 * u8Idx));
+	}
+
+	Sha256Compress(poSha->au32State, poSha->au8Block);
+
+	for (u8Idx = 0; u8Idx < SHA256_STATE_WORDS; ++u8Idx)
+	{
+		pu8Digest[4 * u8Idx + 0] = (UINT8)(poSha->au32State[u8Idx] >> 24);
+		pu8Digest[4 * u8Idx + 1] = (UINT8)(poSha->au32State[u8Idx] >> 16);
+		pu8Digest[4 * u8Idx + 2] = (UINT8)(poSha->au32State[u8Idx] >> 8);
+		pu8Digest[4 * u8Idx + 3] = (UINT8)(poSha->au32State[u8Idx]);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		Sha256Compress - Processes one 64 bytes block.
+////////////////////////////////////////////////////////////////////////////////
+static void Sha256Compress(UINT32* pu32State, const UINT8* pu8Block)
+{
+	UINT32	au32W[64];
+	UINT32	a, b, c, d, e, f, g, h, t1, t2;
+	UINT8	u8Idx	= 0;
+
+	for (u8Idx = 0; u8Idx < 16; ++u8Idx)
+	{
+		au32W[u8Idx] =	((UINT32)pu8Block[4 * u8Idx] << 24) | ((UINT32)pu8Block[4 * u8Idx + 1] << 16) |
+						((UINT32)pu8Block[4 * u8Idx + 2] << 8) | (UINT32)pu8Block[4 * u8Idx + 3];
+	}
+
+	for (; u8Idx < 64; ++u8Idx)
+	{
+		au32W[u8Idx] = SHA256_G1(au32W[u8Idx - 2]) + au32W[u8Idx - 7] + SHA256_G0(au32W[u8Idx - 15]) + au32W[u8Idx - 16];
+	}
+
+	a = pu32State[0]; b = pu32State[1]; c = pu32State[2]; d = pu32State[3];
+	e = pu32State[4]; f = pu32State[5]; g = pu32State[6]; h = pu32State[7];
+
+	for (u8Idx = 0; u8Idx < 64; ++u8Idx)
+	{
+		t1 = h + SHA256_S1(e) + SHA256_CH(e, f, g) + au32Sha256K[u8Idx] + au32W[u8Idx];
+		t2 = SHA256_S0(a) + SHA256_MAJ(a, b, c);
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	pu32State[0] += a; pu32State[1] += b; pu32State[2] += c; pu32State[3] += d;
+	pu32State[4] += e; pu32State[5] += f; pu32State[6] += g; pu32State[7] += h;
+}
@@ -0,0 +1,48 @@
+///
+/// \file     Sha256.h
+/// \brief    SHA-256 utility (FIPS 180-4)
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef SHA256_H
+#define SHA256_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SHA256_BLOCK_SIZE       64          ///< Size of a compression block, in bytes.
+#define SHA256_DIGEST_SIZE      32          ///< Size of a digest, in bytes.
+#define SHA256_STATE_WORDS      8           ///< Size of the chaining state, in 32 bits words.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oSha256Ty
+/// \brief 	Running SHA-256.
+///
+typedef struct
+{
+	UINT32		au32State[SHA256_STATE_WORDS];		///< Chaining state.
+	UINT64		u64Length;							///< Bytes added so far.
+	UINT8		au8Block[SHA256_BLOCK_SIZE];		///< Pending bytes of the current block.
+} oSha256Ty, *poSha256Ty;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+void    Sha256Init(poSha256Ty poSha);
+bool    Sha256Restore(poSha256Ty poSha, const UINT32* pu32State, UINT64 u64Length);
+void    Sha256Update(poSha256Ty poSha, const void* pvData, UINT32 u32Size);
+void    Sha256Final(poSha256Ty poSha, UINT8* pu8Digest);
+
+#endif
@@ -0,0 +1,364 @@
+///
+/// \file     StreamStats.c
+/// \brief    Sliding-window statistics in constant memory
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <string.h>
+#include "StreamStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void StreamStatsAdvance(poStreamStatsTy poStats, UINT32 u32Pos);
+static void StreamStatsRestart(poStreamStatsTy poStats, UINT8 u8Est);
+static void StreamDequePush(oStreamDequeTy* poDeque, UINT16 u16Bucket, UINT16 u16Value, bool bMax);
+static void StreamDequeExpire(oStreamDequeTy* poDeque, UINT16 u16Bucket, UINT16 u16Buckets);
+static float StreamQuantileParabolic(const oStreamQuantileTy* poEst, UINT8 u8Idx, INT32 i32Dir);
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		StreamStatsInit - Starts empty statistics.
+/// \public
+///
+/// \param[in]	bTime			The span is in ms, else in values.
+/// \param[in]	u32Span			Window length.
+/// \param[in]	u8Percentile	Percentile to estimate besides the median, 1 to 99.
+/// \param[in]	u32Now			Current time, for a time span.
+///
+/// \return		TRUE if success, FALSE if the settings are not valid.
+////////////////////////////////////////////////////////////////////////////////
+bool StreamStatsInit(poStreamStatsTy this, bool bTime, UINT32 u32Span, UINT8 u8Percentile, UINT32 u32Now)
+{
+	if (!this || !u32Span || !u8Percentile || (u8Percentile >= 100))
+	{
+		return FALSE;
+	}
+
+	memset(this, 0, sizeof(*this));
+	this->bTime				= bTime;
+	this->u32Span			= u32Span;
+	this->u8Percentile		= u8Percentile;
+	this->u32Width			= (u32Span + STREAMSTATS_BUCKETS - 1) / STREAMSTATS_BUCKETS;
+	this->u16Buckets		= (UINT16)((u32Span + this->u32Width - 1) / this->u32Width);
+	this->u32BucketStart	= bTime ? u32Now : 0;
+
+	StreamStatsRestart(this, 0);
+	StreamStatsRestart(this, 1);
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		StreamStatsPush - Adds a value.
+/// \public
+///
+/// \param[in]	u32Now		Current time, for a time span. Wraps.
+/// \param[in]	u16Value	New value.
+////////////////////////////////////////////////////////////////////////////////
+void StreamStatsPush(poStreamStatsTy this, UINT32 u32Now, UINT16 u16Value)
+{
+	UINT8 u8Est = 0;
+
+	StreamStatsAdvance(this, this->bTime ? u32Now : this->u32Values);
+	++this->u32Values;
+
+	StreamDequePush(&this->oMin, this->u16Bucket, u16Value, FALSE);
+	StreamDequePush(&this->oMax, this->u16Bucket, u16Value, TRUE);
+
+	for (u8Est = 0; u8Est < 2; ++u8Est)
+	{
+		StreamQuantilePush(&this->aoMedian[u8Est], u16Value);
+		StreamQuantilePush(&this->aoPercentile[u8Est], u16Value);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		StreamStatsGet - Statistics over the window.
+/// \public
+/// \details	If no value reached the quantile estimators since their last
+///				restart (values older than half a span only), the median and
+///				the percentile are the middle of the extremes.
+///
+/// \param[in]	u32Now		Current time, for a time span.
+/// \param[out]	poResult	Statistics.
+///
+/// \return		TRUE if the window holds values, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool StreamStatsGet(poStreamStatsTy this, UINT32 u32Now, oStreamStatsResultTy* poResult)
+{
+	UINT8	u8Est	= this->u8Older;
+	float	fValue	= 0;
+
+	if (this->bTime)
+	{
+		StreamStatsAdvance(this, u32Now);
+	}
+
+	if (!this->oMax.u8Len || !poResult)
+	{
+		return FALSE;
+	}
+
+	poResult->u16Minimum = this->oMin.au16Value[this->oMin.u8Head];
+	poResult->u16Maximum = this->oMax.au16Value[this->oMax.u8Head];
+
+	if (!this->aoMedian[u8Est].u32Count)
+	{
+		u8Est ^= 1;
+	}
+
+	poResult->u16Median		= (poResult->u16Minimum + poResult->u16Maximum) / 2;
+	poResult->u16Percentile	= poResult->u16Median;
+
+	if (StreamQuantileGet(&this->aoMedian[u8Est], &fValue))
+	{
+		poResult->u16Median = (UINT16)(fValue + 0.5f);
+	}
+	if (StreamQuantileGet(&this->aoPercentile[u8Est], &fValue))
+	{
+		poResult->u16Percentile = (UINT16)(fValue + 0.5f);
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		StreamQuantileInit - Starts an empty P² estimator.
+/// \public
+///
+/// \param[in]	fQuantile	Quantile to estimate, 0 to 1.
+////////////////////////////////////////////////////////////////////////////////
+void StreamQuantileInit(poStreamQuantileTy this, float fQuantile)
+{
+	memset(this, 0, sizeof(*this));
+	this->fQuantile = fQuantile;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		StreamQuantilePush - Adds a value to a P² estimator.
+/// \public
+///
+/// \param[in]	fValue		New value.
+////////////////////////////////////////////////////////////////////////////////
+void StreamQuantilePush(poStreamQuantileTy this, float fValue)
+{
+	const float	fP		= this->fQuantile;
+	const float	afInc[STREAMSTATS_MARKERS] = {0, fP / 2, fP, (1 + fP) / 2, 1};
+	UINT8		u8Idx	= 0;
+	UINT8		u8Cell	= 0;
+	INT32		i32Dir	= 0;
+	float		fDelta	= 0;
+	float		fHeight	= 0;
+
+	// The first values: sorted, they are the markers.
+	if (this->u32Count < STREAMSTATS_MARKERS)
+	{
+		for (u8Idx = (UINT8)this->u32Count; (u8Idx > 0) && (this->afHeight[u8Idx - 1] > fValue); --u8Idx)
+		{
+			this->afHeight[u8Idx] = this->afHeight[u8Idx - 1];
+		}
+		this->afHeight[u8Idx] = fValue;
+
+		if (++this->u32Count == STREAMSTATS_MARKERS)
+		{
+			for (u8Idx = 0; u8Idx < STREAMSTATS_MARKERS; ++u8Idx)
+			{
+				this->ai32Pos[u8Idx] = u8Idx + 1;
+			}
+			this->afDesired[0] = 1;
+			this->afDesired[1] = 1 + 2 * fP;
+			this->afDesired[2] = 1 + 4 * fP;
+			this->afDesired[3] = 3 + 2 * fP;
+			this->afDesired[4] = 5;
+		}
+		return;
+	}
+	++this->u32Count;
+
+	// Cell of the value, the extreme markers follow the extremes.
+	if (fValue < this->afHeight[0])
+	{
+		this->afHeight[0]	= fValue;
+		u8Cell				= 0;
+	}
+	else if (fValue >= this->afHeight[4])
+	{
+		this->afHeight[4]	= fValue;
+		u8Cell				= 3;
+	}
+	else
+	{
+		for (u8Cell = 0; fValue >= this->afHeight[u8Cell + 1]; ++u8Cell);
+	}
+
+	for (u8Idx = u8Cell + 1; u8Idx < STREAMSTATS_MARKERS; ++u8Idx)
+	{
+		++this->ai32Pos[u8Idx];
+	}
+	for (u8Idx = 0; u8Idx < STREAMSTATS_MARKERS; ++u8Idx)
+	{
+		this->afDesired[u8Idx] += afInc[u8Idx];
+	}
+
+	// Move the middle markers toward their desired positions, one step at
+	// most, along a parabola through the neighbours (or a line if the
+	// parabola leaves them out of order).
+	for (u8Idx = 1; u8Idx < STREAMSTATS_MARKERS - 1; ++u8Idx)
+	{
+		fDelta = this->afDesired[u8Idx] - this->ai32Pos[u8Idx];
+
+		if (((fDelta >= 1) && (this->ai32Pos[u8Idx + 1] - this->ai32Pos[u8Idx] > 1))
+			|| ((fDelta <= -1) && (this->ai32Pos[u8Idx - 1] - this->ai32Pos[u8Idx] < -1)))
+		{
+			i32Dir	= (fDelta >= 0) ? 1 : -1;
+			fHeight	= StreamQuantileParabolic(this, u8Idx, i32Dir);
+
+			if ((this->afHeight[u8Idx - 1] < fHeight) && (fHeight < this->afHeight[u8Idx + 1]))
+			{
+				this->afHeight[u8Idx] = fHeight;
+			}
+			else
+			{
+				this->afHeight[u8Idx] += i32Dir * (this->afHeight[u8Idx + i32Dir] - this->afHeight[u8Idx])
+					/ (this->ai32Pos[u8Idx + i32Dir] - this->ai32Pos[u8Idx]);
+			}
+			this->ai32Pos[u8Idx] += i32Dir;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		StreamQuantileGet - Current estimate of a P² estimator.
+/// \public
+/// \details	Exact while there are fewer values than markers.
+///
+/// \param[out]	pfValue		Estimate.
+///
+/// \return		TRUE if the estimator has values, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool StreamQuantileGet(const oStreamQuantileTy* this, float* pfValue)
+{
+	if (!this->u32Count || !pfValue)
+	{
+		return FALSE;
+	}
+
+	if (this->u32Count < STREAMSTATS_MARKERS)
+	{
+		*pfValue = this->afHeight[(UINT8)(this->fQuantile * (this->u32Count - 1) + 0.5f)];
+	}
+	else
+	{
+		*pfValue = this->afHeight[2];
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		StreamStatsAdvance - Moves the window to a time (or a value
+///				count).
+/// \details	Unsigned differences only, so a time span stays right across
+///				the wrap-around of the system time.
+////////////////////////////////////////////////////////////////////////////////
+static void StreamStatsAdvance(poStreamStatsTy this, UINT32 u32Pos)
+{
+	UINT32 u32Steps	= (u32Pos - this->u32BucketStart) / this->u32Width;
+	UINT16 u16Half	= (this->u16Buckets > 1) ? this->u16Buckets / 2 : 1;
+
+	if (!u32Steps)
+	{
+		return;
+	}
+
+	this->u32BucketStart	+= u32Steps * this->u32Width;
+	this->u16Bucket			+= (UINT16)u32Steps;
+
+	// Nothing left in the window.
+	if (u32Steps >= this->u16Buckets)
+	{
+		this->oMin.u8Len		= 0;
+		this->oMax.u8Len		= 0;
+		this->u16SinceRestart	= 0;
+		StreamStatsRestart(this, 0);
+		StreamStatsRestart(this, 1);
+		return;
+	}
+
+	StreamDequeExpire(&this->oMin, this->u16Bucket, this->u16Buckets);
+	StreamDequeExpire(&this->oMax, this->u16Bucket, this->u16Buckets);
+
+	// Every half span, the older estimators start over and the other ones
+	// become the older.
+	this->u16SinceRestart += (UINT16)u32Steps;
+	while (this->u16SinceRestart >= u16Half)
+	{
+		this->u16SinceRestart -= u16Half;
+		StreamStatsRestart(this, this->u8Older);
+		this->u8Older ^= 1;
+	}
+}
+
+static void StreamStatsRestart(poStreamStatsTy this, UINT8 u8Est)
+{
+	StreamQuantileInit(&this->aoMedian[u8Est], 0.5f);
+	StreamQuantileInit(&this->aoPercentile[u8Est], this->u8Percentile / 100.0f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		StreamDequePush - Adds a value to a monotonic deque.
+/// \details	Drops the entries the value dominates from the back: they can
+///				no longer be the extreme. A value dominated by an entry of its
+///				own bucket is not kept: they leave the window together.
+////////////////////////////////////////////////////////////////////////////////
+static void StreamDequePush(oStreamDequeTy* poDeque, UINT16 u16Bucket, UINT16 u16Value, bool bMax)
+{
+	UINT8 u8Back = 0;
+
+	while (poDeque->u8Len)
+	{
+		u8Back = (poDeque->u8Head + poDeque->u8Len - 1) % STREAMSTATS_BUCKETS;
+
+		if (bMax ? (poDeque->au16Value[u8Back] > u16Value) : (poDeque->au16Value[u8Back] < u16Value))
+		{
+			if (poDeque->au16Bucket[u8Back] == u16Bucket)
+			{
+				return;
+			}
+			break;
+		}
+		--poDeque->u8Len;
+	}
+
+	u8Back = (poDeque->u8Head + poDeque->u8Len) % STREAMSTATS_BUCKETS;
+	poDeque->au16Bucket[u8Back]	= u16Bucket;
+	poDeque->au16Value[u8Back]	= u16Value;
+	++poDeque->u8Len;
+}
+
+static void StreamDequeExpire(oStreamDequeTy* poDeque, UINT16 u16Bucket, UINT16 u16Buckets)
+{
+	while (poDeque->u8Len && ((UINT16)(u16Bucket - poDeque->au16Bucket[poDeque->u8Head]) >= u16Buckets))
+	{
+		poDeque->u8Head = (poDeque->u8Head + 1) % STREAMSTATS_BUCKETS;
+		--poDeque->u8Len;
+	}
+}
+
+static float StreamQuantileParabolic(const oStreamQuantileTy* this, UINT8 u8Idx, INT32 i32Dir)
+{
+	const float*	pfQ	= this->afHeight;
+	const INT32*	piN	= this->ai32Pos;
+
+	return pfQ[u8Idx] + (float)i32Dir / (piN[u8Idx + 1] - piN[u8Idx - 1])
+		* ((piN[u8Idx] - piN[u8Idx - 1] + i32Dir) * (pfQ[u8Idx + 1] - pfQ[u8Idx]) / (piN[u8Idx + 1] - piN[u8Idx])
+		+ (piN[u8Idx + 1] - piN[u8Idx] - i32Dir) * (pfQ[u8Idx] - pfQ[u8Idx - 1]) / (piN[u8Idx] - piN[u8Idx - 1]));
+}
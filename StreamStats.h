@@ -0,0 +1,113 @@
+///
+/// \file     StreamStats.h
+/// \brief    Sliding-window statistics in constant memory
+/// \details  Extremes and quantiles of a stream of values over its last N
+///           values or its last T ms, without storing the values.
+///
+///           - Minimum and maximum: monotonic deques. The span is cut into
+///             STREAMSTATS_BUCKETS buckets and a bucket only keeps its
+///             extreme, so the deques never hold more than one entry per
+///             bucket. The window start moves one bucket at a time: it
+///             covers between span - span / STREAMSTATS_BUCKETS and span.
+///           - Quantiles: P² estimators (Jain & Chlamtac), five markers
+///             each. A P² estimator never forgets, so two of them run
+///             staggered by half a span, each restarted every span, and the
+///             older one answers: it covers between span / 2 and span.
+///
+///           Does not depend on the hardware (the replay and soak tools
+///           run it on the host).
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef STREAMSTATS_H
+#define STREAMSTATS_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define STREAMSTATS_BUCKETS         48          ///< Buckets per span: 30 min for a day.
+#define STREAMSTATS_MARKERS         5           ///< P² markers.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oStreamDequeTy
+/// \brief 	Monotonic deque of bucket extremes, oldest first.
+///
+typedef struct
+{
+	UINT16		au16Bucket[STREAMSTATS_BUCKETS];
+	UINT16		au16Value[STREAMSTATS_BUCKETS];
+	UINT8		u8Head;
+	UINT8		u8Len;
+} oStreamDequeTy;
+
+///
+/// \struct	oStreamQuantileTy
+/// \brief 	P² estimator of one quantile.
+///
+typedef struct
+{
+	float		fQuantile;							///< 0 to 1.
+	UINT32		u32Count;							///< Values seen.
+	float		afHeight[STREAMSTATS_MARKERS];		///< Marker heights. The first values, sorted, until there are 5.
+	INT32		ai32Pos[STREAMSTATS_MARKERS];		///< Marker positions, from 1.
+	float		afDesired[STREAMSTATS_MARKERS];		///< Desired marker positions.
+} oStreamQuantileTy, *poStreamQuantileTy;
+
+///
+/// \struct	oStreamStatsTy
+/// \brief 	Minimum, maximum, median and one percentile over a sliding span.
+///
+typedef struct
+{
+	bool				bTime;						///< Span in ms, else in values.
+	UINT32				u32Span;
+	UINT8				u8Percentile;
+	UINT32				u32Width;					///< Bucket width, in ms or in values.
+	UINT32				u32BucketStart;				///< Time (or value count) at the start of the current bucket.
+	UINT32				u32Values;					///< Values pushed.
+	UINT16				u16Bucket;					///< Current bucket number. Wraps.
+	UINT16				u16Buckets;					///< Buckets per span.
+	UINT16				u16SinceRestart;			///< Buckets since the last restart of a quantile estimator.
+	oStreamDequeTy		oMin;
+	oStreamDequeTy		oMax;
+	oStreamQuantileTy	aoMedian[2];
+	oStreamQuantileTy	aoPercentile[2];
+	UINT8				u8Older;					///< Quantile estimators that started first.
+} oStreamStatsTy, *poStreamStatsTy;
+
+///
+/// \struct	oStreamStatsResultTy
+/// \brief 	Statistics over the window.
+///
+typedef struct
+{
+	UINT16		u16Minimum;
+	UINT16		u16Maximum;
+	UINT16		u16Median;
+	UINT16		u16Percentile;
+} oStreamStatsResultTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool StreamStatsInit(poStreamStatsTy, bool bTime, UINT32 u32Span, UINT8 u8Percentile, UINT32 u32Now);
+void StreamStatsPush(poStreamStatsTy, UINT32 u32Now, UINT16 u16Value);
+bool StreamStatsGet(poStreamStatsTy, UINT32 u32Now, oStreamStatsResultTy* poResult);
+
+void StreamQuantileInit(poStreamQuantileTy, float fQuantile);
+void StreamQuantilePush(poStreamQuantileTy, float fValue);
+bool StreamQuantileGet(const oStreamQuantileTy*, float* pfValue);
+
+#endif
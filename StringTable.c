@@ -7,12 +7,24 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Includes
 ////////////////////////////////////////////////////////////////////////////////
+#include <string.h>
 #include "StringTable.h"
+#include "FlashMgr.h"
+#include "Crc.h"
+#include "MemStats.h"
+
+#ifndef ARDUINO_ARCH_ESP8266
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
 ////////////////////////////////////////////////////////////////////////////////
+#define STRINGTABLE_PACK_ALIGN    4         ///< Alignment of the packs in the partition.
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -23,24 +35,172 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Private functions
 ////////////////////////////////////////////////////////////////////////////////
+static bool StringTablePackRead(UINT32 u32Offset, void* pvData, UINT32 u32Size);
+static bool StringTablePackFind(UINT8 u8Pack, UINT32* pu32Offset, oStringTablePackHdrTy* poHdr);
+static bool StringTablePackLoad(UINT8 u8Pack);
+static bool StringTablePackIsSane(const UINT8* pu8Pack);
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // Local variables
 ////////////////////////////////////////////////////////////////////////////////
 static    StringTableLangTy g_stringTableLang = STRINGTABLE_LANG_EN;        ///< Configured system language.
-static char g_customString[STRINGTABLE_LANG_MAX][STRINGTABLE_CUSTOM_MAX];     ///< Custom string.
+static char g_customString[STRINGTABLE_LANG_BUILTIN + 1][STRINGTABLE_CUSTOM_MAX];     ///< Custom string. The packs share the last one.
+
+static const UINT8* g_pack = NULL;                      ///< Pack of the language in use, NULL for a built-in one.
+static UINT32 g_packBuf[STRINGTABLE_PACK_MAX / 4];      ///< Pack loaded from flash (32 bits aligned).
+static char g_codeBuf[STRINGTABLE_CODE_MAX];            ///< Code of a pack not in use.
+
+static const char* const g_builtinCode[STRINGTABLE_LANG_BUILTIN] = {"en", "fr"};
+
+#ifndef ARDUINO_ARCH_ESP8266
+static const UINT8* g_packMap = NULL;                   ///< Pack file mapped by StringTablePackAttach(), instead of the flash.
+static UINT32 g_packMapSize = 0;
+#endif
+
+// Defined here and not in the header: every file including the header used
+// to get its own copy of the pointer table.
+static const char* const StringTable[STRINGTABLE_ID_MAX][STRINGTABLE_LANG_BUILTIN] = {
+  {"", ""},                                // STRINGTABLE_ID_000_EMPTY
+  {"Time", "Temps"},                       // STRINGTABLE_ID_001_HEADER_TIME
+  {"Temperature", "Temperature"},          // STRINGTABLE_ID_002_HEADER_TEMP
+  {"Temp. max", "Temp. max"},              // STRINGTABLE_ID_003_HEADER_TEMP_MAX
+  {"Temp. min", "Temp. min"},              // STRINGTABLE_ID_004_HEADER_TEMP_MIN
+  {"Temp. avg", "Temp. avg"},              // STRINGTABLE_ID_005_HEADER_TEMP_AVG
+  {"Soil moisture", "Humidite du sol"},    // STRINGTABLE_ID_006_WEB_TITLE
+  {"Moisture", "Humidite"},                // STRINGTABLE_ID_007_WEB_MOISTURE
+  {"Average", "Moyenne"},                  // STRINGTABLE_ID_008_WEB_AVERAGE
+  {"Minimum", "Minimum"},                  // STRINGTABLE_ID_009_WEB_MINIMUM
+  {"Maximum", "Maximum"},                  // STRINGTABLE_ID_010_WEB_MAXIMUM
+  {"Raw value", "Valeur brute"},           // STRINGTABLE_ID_011_WEB_RAW
+  {"Quality", "Qualite"},                  // STRINGTABLE_ID_012_WEB_QUALITY
+  {"Faults", "Defauts"},                   // STRINGTABLE_ID_013_WEB_FAULTS
+  {"Uptime", "En marche depuis"},          // STRINGTABLE_ID_014_WEB_UPTIME
+  {"History", "Historique"},               // STRINGTABLE_ID_015_WEB_HISTORY
+  {"Download CSV", "Telecharger CSV"},     // STRINGTABLE_ID_016_WEB_DOWNLOAD
+  {"Good", "Bonne"},                       // STRINGTABLE_ID_017_WEB_GOOD
+  {"Suspect", "Douteuse"},                 // STRINGTABLE_ID_018_WEB_SUSPECT
+  {"Bad", "Mauvaise"},                     // STRINGTABLE_ID_019_WEB_BAD
+
+  {"", ""},                      // STRINGTABLE_ID_999_CUSTOM
+};
+
+MEMSTATS_REGISTER(StringTable, sizeof(g_customString) + sizeof(StringTable) + sizeof(g_packBuf))
 
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief    StringTableSetLang - Set system language.
 /// \public
+/// \details  A language pack is loaded here, and only here.
 ///
 /// \param[in]  lang  Language to use in the string table.
+///
+/// \return   TRUE if success, FALSE if the language pack is missing or
+///           damaged: the language is left unchanged (English if the pack in
+///           use can no longer be read either).
 ////////////////////////////////////////////////////////////////////////////////
-void StringTableSetLang(StringTableLangTy lang)
+bool StringTableSetLang(StringTableLangTy lang)
 {
+  if (lang >= STRINGTABLE_LANG_MAX)
+  {
+    return FALSE;
+  }
+
+  if ((lang >= STRINGTABLE_LANG_PACK) && ((lang != g_stringTableLang) || !g_pack))
+  {
+    if (!StringTablePackLoad(lang - STRINGTABLE_LANG_PACK))
+    {
+      // The buffer may hold part of the new pack: back to the old one.
+      if ((g_stringTableLang >= STRINGTABLE_LANG_PACK) && !StringTablePackLoad(g_stringTableLang - STRINGTABLE_LANG_PACK))
+      {
+        g_stringTableLang = STRINGTABLE_LANG_EN;
+      }
+      return FALSE;
+    }
+  }
+  else if (lang < STRINGTABLE_LANG_PACK)
+  {
+    g_pack = NULL;
+  }
+
   g_stringTableLang = lang;
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    StringTableGetLang - Get system language.
+/// \public
+///
+/// \return   Language used in the string table.
+////////////////////////////////////////////////////////////////////////////////
+StringTableLangTy StringTableGetLang()
+{
+  return g_stringTableLang;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    StringTableFindLang - Looks for a language by its code.
+/// \public
+///
+/// \param[in]  pszCode Language code, like "en".
+/// \param[out] peLang  Language, for StringTableSetLang().
+///
+/// \return   TRUE if the language is built in or has a pack.
+////////////////////////////////////////////////////////////////////////////////
+bool StringTableFindLang(const char* pszCode, StringTableLangTy* peLang)
+{
+  const char* pszLang = NULL;
+  UINT8       u8Lang  = 0;
+
+  for (u8Lang = 0; u8Lang < STRINGTABLE_LANG_MAX; ++u8Lang)
+  {
+    pszLang = StringTableGetLangCode((StringTableLangTy)u8Lang);
+    if (!pszLang)
+    {
+      break;
+    }
+
+    if (!strcmp(pszLang, pszCode))
+    {
+      *peLang = (StringTableLangTy)u8Lang;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    StringTableGetLangCode - Get the code of a language.
+/// \public
+///
+/// \param[in]  lang  Language.
+///
+/// \return   Language code, NULL if there is no such language. The code of a
+///           pack not in use is only valid until the next call.
+////////////////////////////////////////////////////////////////////////////////
+const char* StringTableGetLangCode(StringTableLangTy lang)
+{
+  oStringTablePackHdrTy oHdr;
+  UINT32                u32Offset = 0;
+
+  if (lang < STRINGTABLE_LANG_BUILTIN)
+  {
+    return g_builtinCode[lang];
+  }
+
+  if ((lang == g_stringTableLang) && g_pack)
+  {
+    return ((const oStringTablePackHdrTy*)g_pack)->acCode;
+  }
+
+  if ((lang >= STRINGTABLE_LANG_MAX) || !StringTablePackFind(lang - STRINGTABLE_LANG_PACK, &u32Offset, &oHdr))
+  {
+    return NULL;
+  }
+
+  memcpy(g_codeBuf, oHdr.acCode, STRINGTABLE_CODE_MAX);
+  return g_codeBuf;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -53,7 +213,21 @@ void StringTableSetLang(StringTableLangTy lang)
 ////////////////////////////////////////////////////////////////////////////////
 const char* StringTableGetStr(StringTableIDTy strID)
 {
-  return StringTable[strID][g_stringTableLang];
+  const oStringTablePackHdrTy*  poHdr = (const oStringTablePackHdrTy*)g_pack;
+  const UINT16*                 pu16Index = NULL;
+
+  if (!poHdr)
+  {
+    return StringTable[strID][g_stringTableLang];
+  }
+
+  pu16Index = (const UINT16*)(g_pack + sizeof(oStringTablePackHdrTy));
+  if ((strID >= poHdr->u16Count) || (pu16Index[strID] == STRINGTABLE_PACK_NONE))
+  {
+    return StringTable[strID][STRINGTABLE_LANG_EN];
+  }
+
+  return (const char*)&pu16Index[poHdr->u16Count] + pu16Index[strID];
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -63,11 +237,21 @@ const char* StringTableGetStr(StringTableIDTy strID)
 /// \param[in]  lang  Langage of the string to retrieve.
 /// \param[in]  strID ID of the string to retrieve.
 ///
-/// \return   Pointer to the string.
+/// \return   Pointer to the string. In English for a pack not in use.
 ////////////////////////////////////////////////////////////////////////////////
 const char* StringTableGetStrInLang(StringTableLangTy lang, StringTableIDTy strID)
 {
-  return StringTable[strID][lang];
+  if (lang < STRINGTABLE_LANG_BUILTIN)
+  {
+    return StringTable[strID][lang];
+  }
+
+  if ((lang == g_stringTableLang) && g_pack)
+  {
+    return StringTableGetStr(strID);
+  }
+
+  return StringTable[strID][STRINGTABLE_LANG_EN];
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -79,5 +263,206 @@ const char* StringTableGetStrInLang(StringTableLangTy lang, StringTableIDTy strI
 ////////////////////////////////////////////////////////////////////////////////
 char* StringTableGetCustomStr()
 {
-  return g_customString[g_stringTableLang];
+  return g_customString[(g_stringTableLang < STRINGTABLE_LANG_BUILTIN) ? g_stringTableLang : STRINGTABLE_LANG_BUILTIN];
+}
+
+#ifndef ARDUINO_ARCH_ESP8266
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    StringTablePackAttach - Takes the packs from a file instead of
+///                     the flash partition.
+/// \public
+/// \details  Host builds only. The file (a pack, or a partition image made
+///           by tools/langpack) is mapped, not copied: the strings of the
+///           pack in use point into the mapping, whatever its size.
+///
+/// \param[in]  pszPath File to map.
+///
+/// \return   TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool StringTablePackAttach(const char* pszPath)
+{
+  bool        bRet  = FALSE;
+  int         iFd   = -1;
+  struct stat oStat;
+  void*       pvMap = MAP_FAILED;
+
+  if (g_packMap || !pszPath)
+  {
+    goto END;
+  }
+
+  iFd = open(pszPath, O_RDONLY);
+  if ((iFd < 0) || fstat(iFd, &oStat) || (oStat.st_size < (off_t)sizeof(oStringTablePackHdrTy))) goto END;
+
+  pvMap = mmap(NULL, oStat.st_size, PROT_READ, MAP_SHARED, iFd, 0);
+  if (pvMap == MAP_FAILED) goto END;
+
+  g_packMap     = (const UINT8*)pvMap;
+  g_packMapSize = (UINT32)oStat.st_size;
+
+  bRet = TRUE;
+END:
+  if (iFd >= 0)
+  {
+    close(iFd);
+  }
+  return bRet;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    StringTablePackRead - Reads from the pack storage.
+///
+/// \param[in]  u32Offset Offset in the partition (or attached file).
+///
+/// \return   TRUE if success, FALSE if out of the storage.
+////////////////////////////////////////////////////////////////////////////////
+static bool StringTablePackRead(UINT32 u32Offset, void* pvData, UINT32 u32Size)
+{
+  UINT32 u32Addr = 0;
+  UINT32 u32Part = 0;
+
+#ifndef ARDUINO_ARCH_ESP8266
+  if (g_packMap)
+  {
+    if ((u32Offset > g_packMapSize) || (u32Size > g_packMapSize - u32Offset))
+    {
+      return FALSE;
+    }
+
+    memcpy(pvData, &g_packMap[u32Offset], u32Size);
+    return TRUE;
+  }
+#endif
+
+  if (!FlashMgrGetPartition(FLASHMGR_PART_LANG, &u32Addr, &u32Part) || (u32Offset > u32Part) || (u32Size > u32Part - u32Offset))
+  {
+    return FALSE;
+  }
+
+  return FlashMgrRead(u32Addr + u32Offset, pvData, u32Size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    StringTablePackFind - Walks the partition up to a pack.
+///
+/// \param[in]  u8Pack      Pack number, from 0.
+/// \param[out] pu32Offset  Offset of the pack.
+/// \param[out] poHdr       Header of the pack.
+///
+/// \return   TRUE if found. The content is not checked.
+////////////////////////////////////////////////////////////////////////////////
+static bool StringTablePackFind(UINT8 u8Pack, UINT32* pu32Offset, oStringTablePackHdrTy* poHdr)
+{
+  UINT32  u32Offset = 0;
+  UINT8   u8Idx     = 0;
+
+  for (u8Idx = 0; u8Idx <= u8Pack; ++u8Idx)
+  {
+    // Erased flash ends the list.
+    if (!StringTablePackRead(u32Offset, poHdr, sizeof(*poHdr))
+      || (poHdr->u32Magic != STRINGTABLE_PACK_MAGIC)
+      || (poHdr->u16Version != STRINGTABLE_PACK_VERSION)
+      || (poHdr->u32Size < sizeof(*poHdr) + (UINT32)poHdr->u16Count * sizeof(UINT16))
+      || (poHdr->acCode[STRINGTABLE_CODE_MAX - 1] != '\0'))
+    {
+      return FALSE;
+    }
+
+    if (u8Idx == u8Pack)
+    {
+      *pu32Offset = u32Offset;
+      return TRUE;
+    }
+
+    u32Offset += (poHdr->u32Size + STRINGTABLE_PACK_ALIGN - 1) & ~(STRINGTABLE_PACK_ALIGN - 1);
+  }
+
+  return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    StringTablePackLoad - Makes a pack the one in use.
+/// \details  Copied to g_packBuf from flash: the mapped flash of the ESP8266
+///           only allows 32 bits reads, which string functions do not do.
+///
+/// \param[in]  u8Pack  Pack number, from 0.
+///
+/// \return   TRUE if success. The pack in use is dropped otherwise.
+////////////////////////////////////////////////////////////////////////////////
+static bool StringTablePackLoad(UINT8 u8Pack)
+{
+  oStringTablePackHdrTy oHdr;
+  UINT32                u32Offset = 0;
+  const UINT8*          pu8Pack   = (const UINT8*)g_packBuf;
+
+  g_pack = NULL;
+
+  if (!StringTablePackFind(u8Pack, &u32Offset, &oHdr))
+  {
+    return FALSE;
+  }
+
+#ifndef ARDUINO_ARCH_ESP8266
+  if (g_packMap)
+  {
+    if (oHdr.u32Size > g_packMapSize - u32Offset)
+    {
+      return FALSE;
+    }
+    pu8Pack = &g_packMap[u32Offset];
+  }
+  else
+#endif
+  if ((oHdr.u32Size > sizeof(g_packBuf)) || !StringTablePackRead(u32Offset, g_packBuf, oHdr.u32Size))
+  {
+    return FALSE;
+  }
+
+  if (!StringTablePackIsSane(pu8Pack))
+  {
+    return FALSE;
+  }
+
+  g_pack = pu8Pack;
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    StringTablePackIsSane - Checks a whole pack once, so that
+///                     StringTableGetStr() does not have to.
+///
+/// \return   TRUE if the CRC matches and every string is in the blob.
+////////////////////////////////////////////////////////////////////////////////
+static bool StringTablePackIsSane(const UINT8* pu8Pack)
+{
+  const oStringTablePackHdrTy*  poHdr     = (const oStringTablePackHdrTy*)pu8Pack;
+  const UINT16*                 pu16Index = (const UINT16*)(pu8Pack + sizeof(oStringTablePackHdrTy));
+  const char*                   pszBlob   = (const char*)&pu16Index[poHdr->u16Count];
+  UINT32                        u32Blob   = poHdr->u32Size - (UINT32)(pszBlob - (const char*)pu8Pack);
+  UINT16                        u16Idx    = 0;
+
+  if (Crc32(pu16Index, poHdr->u32Size - sizeof(oStringTablePackHdrTy)) != poHdr->u32Crc)
+  {
+    return FALSE;
+  }
+
+  // The blob ends with a NUL: no string can run past it.
+  if (!u32Blob || (pszBlob[u32Blob - 1] != '\0'))
+  {
+    return FALSE;
+  }
+
+  for (u16Idx = 0; u16Idx < poHdr->u16Count; ++u16Idx)
+  {
+    if ((pu16Index[u16Idx] != STRINGTABLE_PACK_NONE) && (pu16Index[u16Idx] >= u32Blob))
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
 }
@@ -2,8 +2,18 @@
 /// \brief    List of strings
 ///           HOW TO ADD STRING A STRING
 ///           1. Add an ID to the StringTableIDTy
-///           2. Add the string pair in the StringTable array
+///           2. Add the string pair in the StringTable array (StringTable.c)
 ///           3. IMPORTANT! The number of pairs must match the IDs up to CUSTOM_ID
+///
+///           LANGUAGE PACKS
+///           English and French are built in. Other languages come as packs
+///           (built by tools/langpack) stored in the FLASHMGR_PART_LANG
+///           partition, one after the other: no new firmware is needed for
+///           a new language. A pack is a header, an index of string offsets
+///           by ID and the blob of the strings. StringTableSetLang() loads
+///           the selected pack only, in one static buffer, and
+///           StringTableGetStr() indexes it directly. A string missing from
+///           a pack (new ID, older pack) is taken from English.
 /// \author   Nicolas Bourré
 ///
 
@@ -14,6 +24,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Includes
 ////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -21,6 +32,13 @@
 ////////////////////////////////////////////////////////////////////////////////
 #define STRINGTABLE_CUSTOM_MAX    150
 
+#define STRINGTABLE_PACK_MAGIC    0x4B41504CUL  ///< "LPAK".
+#define STRINGTABLE_PACK_VERSION  1
+#define STRINGTABLE_PACK_MAX      2048          ///< Largest pack loaded from flash, in bytes (RAM buffer).
+#define STRINGTABLE_PACK_COUNT    8             ///< Most packs in the partition.
+#define STRINGTABLE_PACK_NONE     0xFFFF        ///< Index entry of a string missing from the pack.
+#define STRINGTABLE_CODE_MAX      8             ///< Language code size, NUL included ("pt-BR").
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Data types
@@ -35,7 +53,10 @@ typedef enum
   STRINGTABLE_LANG_EN   = 0,    ///< English.
   STRINGTABLE_LANG_FR,        ///< French.
   
-  STRINGTABLE_LANG_MAX        ///< Maximum number of supported languages.
+  STRINGTABLE_LANG_BUILTIN,   ///< Number of built-in languages.
+  STRINGTABLE_LANG_PACK = STRINGTABLE_LANG_BUILTIN,   ///< First language pack, in partition order.
+
+  STRINGTABLE_LANG_MAX = STRINGTABLE_LANG_PACK + STRINGTABLE_PACK_COUNT   ///< Maximum number of supported languages.
 } StringTableLangTy;
 
 ///
@@ -50,6 +71,20 @@ typedef enum {
   STRINGTABLE_ID_003_HEADER_TEMP_MAX,
   STRINGTABLE_ID_004_HEADER_TEMP_MIN,
   STRINGTABLE_ID_005_HEADER_TEMP_AVG,
+  STRINGTABLE_ID_006_WEB_TITLE,
+  STRINGTABLE_ID_007_WEB_MOISTURE,
+  STRINGTABLE_ID_008_WEB_AVERAGE,
+  STRINGTABLE_ID_009_WEB_MINIMUM,
+  STRINGTABLE_ID_010_WEB_MAXIMUM,
+  STRINGTABLE_ID_011_WEB_RAW,
+  STRINGTABLE_ID_012_WEB_QUALITY,
+  STRINGTABLE_ID_013_WEB_FAULTS,
+  STRINGTABLE_ID_014_WEB_UPTIME,
+  STRINGTABLE_ID_015_WEB_HISTORY,
+  STRINGTABLE_ID_016_WEB_DOWNLOAD,
+  STRINGTABLE_ID_017_WEB_GOOD,
+  STRINGTABLE_ID_018_WEB_SUSPECT,
+  STRINGTABLE_ID_019_WEB_BAD,
   
   STRINGTABLE_ID_999_CUSTOM,        ///< Custom string. Used to allow precise formatting in specific contexts.
   
@@ -57,23 +92,36 @@ typedef enum {
   STRINGTABLE_ID_NONE,              ///< String ID for no string. 
 } StringTableIDTy;
 
-static const char *StringTable[STRINGTABLE_ID_MAX][STRINGTABLE_LANG_MAX] = {
-  {"", ""},                                // STRINGTABLE_ID_000_EMPTY
-  {"Time", "Temps"},                       // STRINGTABLE_ID_001_HEADER_TIME
-  {"Temperature", "Temperature"},          // STRINGTABLE_ID_002_HEADER_TEMP
-  {"Temp. max", "Temp. max"},              // STRINGTABLE_ID_003_HEADER_TEMP_MAX
-  {"Temp. min", "Temp. min"},              // STRINGTABLE_ID_004_HEADER_TEMP_MIN
-  {"Temp. avg", "Temp. avg"},              // STRINGTABLE_ID_005_HEADER_TEMP_AVG
-
-  {"", ""},                      // STRINGTABLE_ID_999_CUSTOM
-};
+///
+/// \struct oStringTablePackHdrTy
+/// \brief  Header of a language pack, little endian.
+///
+/// Followed by u16Count UINT16 offsets of the strings in the blob, by ID,
+/// then by the blob of the NUL terminated strings. The next pack of the
+/// partition starts at the next 4 bytes boundary.
+typedef struct
+{
+  UINT32    u32Magic;                       ///< STRINGTABLE_PACK_MAGIC.
+  UINT16    u16Version;                     ///< STRINGTABLE_PACK_VERSION.
+  UINT16    u16Count;                       ///< Entries of the index.
+  char      acCode[STRINGTABLE_CODE_MAX];   ///< Language code, NUL terminated.
+  UINT32    u32Size;                        ///< Size of the pack, header included.
+  UINT32    u32Crc;                         ///< CRC-32 of the index and the blob.
+} oStringTablePackHdrTy;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Prototypes
 ////////////////////////////////////////////////////////////////////////////////
-void     StringTableSetLang(StringTableLangTy lang);
+bool     StringTableSetLang(StringTableLangTy lang);
+StringTableLangTy StringTableGetLang();
+bool     StringTableFindLang(const char* pszCode, StringTableLangTy* peLang);
+const char* StringTableGetLangCode(StringTableLangTy lang);
 const char* StringTableGetStr(StringTableIDTy strID);
 const char* StringTableGetStrInLang(StringTableLangTy lang, StringTableIDTy strID);
 char*     StringTableGetCustomStr();
 
+#ifndef ARDUINO_ARCH_ESP8266
+bool     StringTablePackAttach(const char* pszPath);
+#endif
+
 #endif
@@ -8,6 +8,7 @@
 // Includes
 ////////////////////////////////////////////////////////////////////////////////
 #include "SystemTime.h"
+#include "MemStats.h"
 //#include "NBSP.h"
 
 #ifdef RTC_H
@@ -38,6 +39,11 @@ typedef struct
 #endif
 	UINT8		  u8RTCInitStep;				///< Needed to avoid system lock (MCU requirement).
 	UINT32		u32TimeStampLastRTCInit;	///< Timestamp for RTC initialization. Needed to add time in-between RTC init steps to avoid system lock (MCU requirement)
+#ifdef SYSTEMTIME_VIRTUAL_CLOCK
+	UINT32		u32VirtualBase;				///< Virtual time at u32VirtualAnchor.
+	UINT32		u32VirtualAnchor;			///< millis() when the virtual clock was last set.
+	UINT16		u16VirtualRate;				///< Virtual ms per real ms. 0: only moves when advanced.
+#endif
 	
 }oSystemTimeTy, *poSystemTimeTy;
 
@@ -54,6 +60,8 @@ oSystemTimeTy	oSystemTime = {FALSE};		///< System time object instance.
 
 extern volatile unsigned long timer0_overflow_count;
 
+MEMSTATS_REGISTER(SystemTime, sizeof(oSystemTime))
+
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief 		SystemTimeInit - Initializes the system time module.
@@ -75,6 +83,11 @@ bool SystemTimeInit()
 #endif
 		oSystemTime.u32TimeStampLastRTCInit = 0;
 		oSystemTime.u8RTCInitStep			= 0;
+#ifdef SYSTEMTIME_VIRTUAL_CLOCK
+		oSystemTime.u32VirtualBase			= millis();
+		oSystemTime.u32VirtualAnchor		= millis();
+		oSystemTime.u16VirtualRate			= 1;
+#endif
 
 #ifdef NBSP_H
 		// If not already done, initialize the BSP since it's needed for system time.
@@ -106,7 +119,12 @@ UINT32 SystemTimeGetTime()
 {
 	if (oSystemTime.bIsInitialized)
 	{
+#ifdef SYSTEMTIME_VIRTUAL_CLOCK
+		// Wraps at 2^32 like millis(), whatever the rate.
+		return oSystemTime.u32VirtualBase + (UINT32)(millis() - oSystemTime.u32VirtualAnchor) * oSystemTime.u16VirtualRate;
+#else
 		return millis();
+#endif
 	}
 	
 	return 0;
@@ -116,8 +134,9 @@ UINT32 SystemTimeGetTime()
 ///				system time and the argument.
 /// \public
 /// \details	This function handles the possible wrap-around when calculating
-///				the difference. Note that the reference time in argument must
-///				use the same units as the system time.
+///				the difference: unsigned subtraction is exact modulo 2^32, as
+///				long as less than 49.7 days elapsed. Note that the reference
+///				time in argument must use the same units as the system time.
 ///
 /// \param[in] 	u32SysTimeToCompare 	The time to compare with the current
 ///										system time.
@@ -126,26 +145,54 @@ UINT32 SystemTimeGetTime()
 ////////////////////////////////////////////////////////////////////////////////
 UINT32 SystemTimeGetTimeDiff(UINT32 u32SysTimeToCompare)
 {
-	UINT32 u32CurrentSysTime 	= 0;
 	UINT32 u32SysTimeDiff		= 0;
 	
 	if (oSystemTime.bIsInitialized)
 	{
-		u32CurrentSysTime = SystemTimeGetTime();
-		
-		// Check is a wrap-around occured.
-		if (u32CurrentSysTime >= u32SysTimeToCompare)
-		{
-			u32SysTimeDiff = u32CurrentSysTime - u32SysTimeToCompare;
-		}
-		else
-		{
-			u32SysTimeDiff = (MAX_VAL_UINT32 - u32SysTimeToCompare) + u32CurrentSysTime;
-		}
+		u32SysTimeDiff = SystemTimeGetTime() - u32SysTimeToCompare;
 	}
 	
 	return u32SysTimeDiff;
 }
+#ifdef SYSTEMTIME_VIRTUAL_CLOCK
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SystemTimeVirtualSet - Sets the virtual system time.
+/// \public
+/// \details	Only with SYSTEMTIME_VIRTUAL_CLOCK, for soak tests. E.g. set it
+///				a few minutes before 2^32 to go through the wrap-around.
+///
+/// \param[in] 	u32Time 	New system time.
+////////////////////////////////////////////////////////////////////////////////
+void SystemTimeVirtualSet(UINT32 u32Time)
+{
+	oSystemTime.u32VirtualBase		= u32Time;
+	oSystemTime.u32VirtualAnchor	= millis();
+}
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SystemTimeVirtualAdvance - Jumps the virtual system time forward.
+/// \public
+///
+/// \param[in] 	u32Ms 	Time to skip.
+////////////////////////////////////////////////////////////////////////////////
+void SystemTimeVirtualAdvance(UINT32 u32Ms)
+{
+	oSystemTime.u32VirtualBase += u32Ms;
+}
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SystemTimeVirtualSetRate - Accelerates (or freezes) the virtual clock.
+/// \public
+/// \details	With a rate of 0 the time only moves through
+///				SystemTimeVirtualAdvance(), and SystemTimeDelay() never returns.
+///
+/// \param[in] 	u16Rate 	Virtual ms per real ms.
+////////////////////////////////////////////////////////////////////////////////
+void SystemTimeVirtualSetRate(UINT16 u16Rate)
+{
+	oSystemTime.u32VirtualBase		= SystemTimeGetTime();
+	oSystemTime.u32VirtualAnchor	= millis();
+	oSystemTime.u16VirtualRate		= u16Rate;
+}
+#endif
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief 		SystemTimeDelay - Delay the caller for a specific time.
 /// \public
@@ -32,6 +32,9 @@
 #define SYSTEMTIME_RTC_SECOND_MIN   0     ///< Minimum RTC second.
 #define SYSTEMTIME_RTC_SECOND_MAX   59      ///< Maximum RTC second per minute.
 
+// Build with SYSTEMTIME_VIRTUAL_CLOCK defined to replace millis() by a
+// virtual clock that can be set, jumped and accelerated (soak tests).
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Type definitions
@@ -46,6 +49,13 @@ void  SystemTimeDelay(unsigned long tick);
 UINT32  SystemTimeGetTime();
 UINT32  SystemTimeGetTimeDiff(UINT32 u32SysTimeToCompare);
 
+#ifdef SYSTEMTIME_VIRTUAL_CLOCK
+// Soak tests: controllable time source.
+void  SystemTimeVirtualSet(UINT32 u32Time);
+void  SystemTimeVirtualAdvance(UINT32 u32Ms);
+void  SystemTimeVirtualSetRate(UINT16 u16Rate);
+#endif
+
 // RTC related.
 bool  SystemTimeRTCInit();
 bool  SystemTimeRTCIsInit();
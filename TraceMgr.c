@@ -0,0 +1,236 @@
+///
+/// \file     TraceMgr.c
+/// \brief    Trace recorder of the moisture sensor inputs and results
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdarg.h>
+#include "TraceMgr.h"
+#include "CalibMgr.h"
+#include "SystemTime.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oTraceMgrTy
+/// \brief 	TraceMgr object.
+///
+typedef struct
+{
+	bool				bActive;				///< Recording.
+	TraceMgrWriteFuncTy	pfWrite;				///< Line output (the serial port on the node).
+	UINT32				u32Lines;				///< Lines written since the start.
+} oTraceMgrTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void TraceMgrWrite(UINT32 u32Time, const char* pszFormat, ...);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oTraceMgrTy oTraceMgr = {FALSE};
+
+MEMSTATS_REGISTER(TraceMgr, sizeof(oTraceMgr))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrStart - Starts recording.
+/// \public
+/// \details	Only writes the version line. Restart the sensor with
+///				MoistSensorMgrConfigure() right after, so the trace begins
+///				with the settings and from a known state.
+///
+/// \param[in]	pfWrite		Line output.
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool TraceMgrStart(TraceMgrWriteFuncTy pfWrite)
+{
+	if (!pfWrite)
+	{
+		return FALSE;
+	}
+
+	oTraceMgr.pfWrite	= pfWrite;
+	oTraceMgr.u32Lines	= 0;
+	oTraceMgr.bActive	= TRUE;
+
+	TraceMgrWrite(SystemTimeGetTime(), "V %u", TRACEMGR_VERSION);
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrStop - Stops recording.
+/// \public
+////////////////////////////////////////////////////////////////////////////////
+void TraceMgrStop()
+{
+	oTraceMgr.bActive = FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrIsActive - Tells if a trace is being recorded.
+/// \public
+///
+/// \return		TRUE if recording.
+////////////////////////////////////////////////////////////////////////////////
+bool TraceMgrIsActive()
+{
+	return oTraceMgr.bActive;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrGetLineCount - Gets the number of lines recorded.
+/// \public
+///
+/// \return		Lines written since TraceMgrStart().
+////////////////////////////////////////////////////////////////////////////////
+UINT32 TraceMgrGetLineCount()
+{
+	return oTraceMgr.u32Lines;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrSettings - Records the settings of the sensor.
+/// \public
+/// \details	Call it each time the settings change (see ConfigMgrApplySensor).
+///				The calibration is recorded as its lookup table, one line per
+///				step, so the replay does not depend on how it was built.
+///
+/// \param[in]	u32Time		Time of the change.
+/// \param[in]	poSensor	Sensor manager.
+////////////////////////////////////////////////////////////////////////////////
+void TraceMgrSettings(UINT32 u32Time, const oMoistSensorMgrTy* poSensor)
+{
+	UINT16 u16Raw = 0;
+
+	if (!oTraceMgr.bActive || !poSensor)
+	{
+		return;
+	}
+
+	TraceMgrWrite(u32Time, "S reading_min %lu", (unsigned long)poSensor->u32ReadingIntervalMin);
+	TraceMgrWrite(u32Time, "S reading_max %lu", (unsigned long)poSensor->u32ReadingIntervalMax);
+	TraceMgrWrite(u32Time, "S adapt_delta %u", poSensor->u16AdaptDelta);
+	TraceMgrWrite(u32Time, "S adapt_var %u", poSensor->u16AdaptVariance);
+	TraceMgrWrite(u32Time, "S polling %u", poSensor->u16PollingInterval);
+	TraceMgrWrite(u32Time, "S duration %u", poSensor->u16PollingDuration);
+	TraceMgrWrite(u32Time, "S deadband %u", poSensor->u8DeadbandAbs);
+	TraceMgrWrite(u32Time, "S deadband_pct %u", poSensor->u8DeadbandPct);
+	TraceMgrWrite(u32Time, "S heartbeat %lu", (unsigned long)poSensor->u32Heartbeat);
+
+	if (!poSensor->pu8CalibTable)
+	{
+		return;
+	}
+
+	for (u16Raw = 0; u16Raw < CALIBMGR_LUT_SIZE; ++u16Raw)
+	{
+		if (!u16Raw || (poSensor->pu8CalibTable[u16Raw] != poSensor->pu8CalibTable[u16Raw - 1]))
+		{
+			TraceMgrWrite(u32Time, "L %u %u", u16Raw, poSensor->pu8CalibTable[u16Raw]);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrConfigure - Records a restart of the sensor state machine.
+/// \public
+///
+/// \param[in]	u32Time		Time of the restart.
+/// \param[in]	poSensor	Sensor manager.
+////////////////////////////////////////////////////////////////////////////////
+void TraceMgrConfigure(UINT32 u32Time, const oMoistSensorMgrTy* poSensor)
+{
+	TraceMgrSettings(u32Time, poSensor);
+	TraceMgrWrite(u32Time, "I");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrAdc - Records an ADC sample.
+/// \public
+///
+/// \param[in]	u32Time		Time of the sample.
+/// \param[in]	u8Pin		Analog input.
+/// \param[in]	u16Raw		Value read.
+////////////////////////////////////////////////////////////////////////////////
+void TraceMgrAdc(UINT32 u32Time, UINT8 u8Pin, UINT16 u16Raw)
+{
+	TraceMgrWrite(u32Time, "A %u %u", u8Pin, u16Raw);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrPin - Records a digital output change.
+/// \public
+///
+/// \param[in]	u32Time		Time of the change.
+/// \param[in]	u8Pin		Digital output.
+/// \param[in]	u8Level		New level.
+////////////////////////////////////////////////////////////////////////////////
+void TraceMgrPin(UINT32 u32Time, UINT8 u8Pin, UINT8 u8Level)
+{
+	TraceMgrWrite(u32Time, "D %u %u", u8Pin, u8Level ? 1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TraceMgrResult - Records a published result.
+/// \public
+///
+/// \param[in]	u32Time		Time of the result.
+/// \param[in]	poSensor	Sensor manager, holding the result.
+////////////////////////////////////////////////////////////////////////////////
+void TraceMgrResult(UINT32 u32Time, const oMoistSensorMgrTy* poSensor)
+{
+	if (!poSensor)
+	{
+		return;
+	}
+
+	TraceMgrWrite(u32Time, "R %u %u %u %u %u %u", poSensor->u8AverageValue, poSensor->u8CurrentValue,
+		poSensor->u8MinimumValue, poSensor->u8MaximumValue, poSensor->u8Quality, poSensor->u8FaultCode);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void TraceMgrWrite(UINT32 u32Time, const char* pszFormat, ...)
+{
+	char	szLine[TRACEMGR_LINE_MAX];
+	va_list	oArgs;
+	int		iLen	= 0;
+
+	if (!oTraceMgr.bActive)
+	{
+		return;
+	}
+
+	iLen = snprintf(szLine, sizeof(szLine), TRACEMGR_PREFIX " %lu ", (unsigned long)u32Time);
+
+	va_start(oArgs, pszFormat);
+	iLen += vsnprintf(&szLine[iLen], sizeof(szLine) - 2 - iLen, pszFormat, oArgs);
+	va_end(oArgs);
+
+	// The format strings are short, nothing is ever truncated.
+	if (iLen > (int)sizeof(szLine) - 3)
+	{
+		iLen = sizeof(szLine) - 3;
+	}
+
+	szLine[iLen++] = '\n';
+	szLine[iLen] = '\0';
+
+	oTraceMgr.pfWrite(szLine);
+	++oTraceMgr.u32Lines;
+}
@@ -0,0 +1,65 @@
+///
+/// \file     TraceMgr.h
+/// \brief    Trace recorder of the moisture sensor inputs and results
+/// \details  Records, as text lines on the serial port, everything the
+///           sensor state machine sees and decides: ADC samples, probe power
+///           switching, settings and published results. tools/replay feeds
+///           such a trace back into MoistSensorMgr on Linux, faster than real
+///           time, and prints the results it gets for diffing.
+///
+///           Every line is "#TRC <ms> <type> <args...>", <ms> being the
+///           sensor task time. The prefix lets the trace be extracted from a
+///           serial log that has other output in it.
+///             V <version>                 Format version, first line.
+///             S <key> <value>             Sensor setting (ConfigMgr key names).
+///             L <raw> <percent>           Calibration table: raw and above
+///                                         read as percent (until the next L).
+///             I                           Sensor state machine (re)started.
+///             A <pin> <raw>               ADC sample.
+///             D <pin> <level>             Probe power switched.
+///             R <avg> <cur> <min> <max> <quality> <fault>
+///                                         Result published.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef TRACEMGR_H
+#define TRACEMGR_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "MoistSensorMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define TRACEMGR_VERSION        1           ///< Bump each time the line format changes.
+#define TRACEMGR_PREFIX         "#TRC"      ///< Start of every trace line.
+#define TRACEMGR_LINE_MAX       64          ///< Longest trace line, with the end of line and the NUL.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef void (*TraceMgrWriteFuncTy)(const char* pszLine);  ///< Writes one complete line, end of line included.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool TraceMgrStart(TraceMgrWriteFuncTy pfWrite);
+void TraceMgrStop();
+bool TraceMgrIsActive();
+UINT32 TraceMgrGetLineCount();
+
+// Hooks, called by MoistSensorMgr. They return at once when not recording.
+void TraceMgrSettings(UINT32 u32Time, const oMoistSensorMgrTy* poSensor);
+void TraceMgrConfigure(UINT32 u32Time, const oMoistSensorMgrTy* poSensor);
+void TraceMgrAdc(UINT32 u32Time, UINT8 u8Pin, UINT16 u16Raw);
+void TraceMgrPin(UINT32 u32Time, UINT8 u8Pin, UINT8 u8Level);
+void TraceMgrResult(UINT32 u32Time, const oMoistSensorMgrTy* poSensor);
+
+#endif
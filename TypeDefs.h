@@ -30,6 +30,8 @@ typedef uint16_t  UINT16;       ///< Unsigned integer, 16 bits
 typedef int16_t   INT16;        ///< Signed integer, 16 bits
 typedef uint32_t  UINT32;       ///< Unsigned integer, 32 bits
 typedef int32_t   INT32;        ///< Signed integer, 32 bits
+typedef uint64_t  UINT64;       ///< Unsigned integer, 64 bits
+typedef int64_t   INT64;        ///< Signed integer, 64 bits
 typedef float     FLOAT32;      ///< Floating point, 32 bits
 
 typedef void (*CallbackFuncTy) (UINT32);  ///< Default callback function type.
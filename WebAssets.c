@@ -0,0 +1,170 @@
+///
+/// \file     WebAssets.c
+/// \brief    Static files of the web dashboard
+/// \details  GENERATED by tools/web/gen_assets.py, do not edit.
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "WebAssets.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+// index.html: 1033 bytes, 472 compressed.
+static const UINT8 au8WebAsset_index_html[472] PROGMEM = {
+	0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8D, 0x93, 0xBD, 0x6E, 0xDC, 0x30,
+	0x0C, 0x80, 0xF7, 0x3C, 0x85, 0x2A, 0xA0, 0x5B, 0x1D, 0xE7, 0x6E, 0x28, 0x3A, 0xC8, 0xEE, 0x90,
+	0xA4, 0xE8, 0x52, 0xF4, 0x27, 0x6D, 0x80, 0x8E, 0x3C, 0x49, 0x17, 0x29, 0x95, 0x2D, 0x57, 0xA2,
+	0xED, 0xDC, 0xDB, 0x97, 0x92, 0xEC, 0x16, 0xBE, 0xA1, 0xB8, 0x45, 0xA4, 0x48, 0xEA, 0x23, 0x09,
+	0x91, 0xE2, 0xD5, 0xDD, 0xE7, 0xDB, 0xEF, 0x3F, 0xBF, 0xDC, 0x33, 0x83, 0x9D, 0x6B, 0xAF, 0xC4,
+	0x2A, 0x34, 0x28, 0x12, 0x9D, 0x46, 0x60, 0xD2, 0x40, 0x88, 0x1A, 0x1B, 0x3E, 0xE2, 0xB1, 0x7A,
+	0xC7, 0x57, 0x73, 0x0F, 0x9D, 0x6E, 0xF8, 0x64, 0xF5, 0x3C, 0xF8, 0x80, 0x9C, 0x49, 0xDF, 0xA3,
+	0xEE, 0x29, 0x6C, 0xB6, 0x0A, 0x4D, 0xA3, 0xF4, 0x64, 0xA5, 0xAE, 0xF2, 0xE5, 0x0D, 0xB3, 0xBD,
+	0x45, 0x0B, 0xAE, 0x8A, 0x12, 0x9C, 0x6E, 0x76, 0x09, 0x82, 0x16, 0x9D, 0x6E, 0x1F, 0xBC, 0x75,
+	0xAC, 0xF3, 0x36, 0xE2, 0x18, 0xB4, 0xA8, 0x8B, 0xF1, 0x4A, 0x38, 0xDB, 0xFF, 0x62, 0x41, 0xBB,
+	0x86, 0x47, 0x3C, 0x39, 0x1D, 0x8D, 0xD6, 0x94, 0xC2, 0x04, 0x7D, 0x6C, 0x78, 0x9D, 0x4D, 0xD7,
+	0x32, 0xC6, 0x84, 0xA9, 0x97, 0x52, 0x0F, 0x5E, 0x9D, 0x52, 0xE1, 0x3B, 0xA6, 0x00, 0xA1, 0x72,
+	0x70, 0x48, 0xAF, 0x33, 0x8F, 0x9F, 0x67, 0x31, 0x3B, 0x8A, 0x8C, 0x5A, 0xA2, 0xF5, 0x3D, 0x93,
+	0x0E, 0x62, 0x6C, 0x78, 0xEF, 0x67, 0xC2, 0x31, 0x26, 0x94, 0x9D, 0x56, 0xDB, 0xC1, 0x3E, 0xF1,
+	0x56, 0xC4, 0x01, 0x7A, 0x66, 0x55, 0xC3, 0x61, 0xA2, 0x6B, 0x55, 0x89, 0x3A, 0x59, 0x5A, 0xF6,
+	0x5A, 0xD4, 0x14, 0x9B, 0xDF, 0x20, 0x1C, 0x52, 0xD9, 0x8C, 0x25, 0x3D, 0xB4, 0x02, 0xCD, 0xA6,
+	0x8A, 0x8E, 0xDA, 0xEF, 0xC6, 0x8E, 0xB7, 0x9F, 0x8A, 0x42, 0x7D, 0x1A, 0x0A, 0x52, 0x99, 0x4A,
+	0xCE, 0x42, 0x45, 0xD5, 0xD2, 0x11, 0xFE, 0x83, 0x81, 0x97, 0x05, 0x53, 0x94, 0x2D, 0x06, 0x5E,
+	0x2E, 0xC4, 0x04, 0xA0, 0x4E, 0xBF, 0xC1, 0xCC, 0x26, 0x70, 0xA3, 0xDE, 0x40, 0xB2, 0xEB, 0x22,
+	0xC8, 0xEF, 0x11, 0x9C, 0xC5, 0x13, 0x6F, 0xBF, 0x16, 0x65, 0x83, 0xF9, 0xEB, 0xBC, 0x08, 0x75,
+	0x84, 0xD1, 0x21, 0xFD, 0xE5, 0x87, 0x2C, 0x37, 0xA0, 0xD5, 0x75, 0x11, 0x67, 0x1C, 0xD0, 0x76,
+	0xF4, 0xD9, 0x3F, 0xB2, 0xDC, 0x70, 0x56, 0xD7, 0x19, 0x87, 0x64, 0xF9, 0x38, 0xFA, 0xD2, 0x32,
+	0x0D, 0xFF, 0xE6, 0x22, 0xFB, 0xCD, 0x7E, 0x93, 0xC1, 0xD0, 0x00, 0xF9, 0x40, 0x7D, 0x7D, 0x2C,
+	0x0A, 0x4D, 0xD2, 0x3E, 0xC7, 0x49, 0xE8, 0x27, 0x88, 0x39, 0x55, 0xDA, 0x16, 0x1A, 0xD5, 0xB2,
+	0x04, 0xFC, 0xED, 0xCD, 0x0D, 0x8D, 0xAD, 0xB6, 0x4F, 0x86, 0x16, 0x63, 0x4F, 0x17, 0xCA, 0x5D,
+	0x82, 0xF3, 0xBB, 0xA1, 0x15, 0xB0, 0x4E, 0x35, 0x0C, 0xB6, 0x5E, 0x12, 0xBC, 0x3F, 0xFA, 0xD0,
+	0x01, 0x36, 0x32, 0x4E, 0x7C, 0x53, 0x80, 0xF2, 0x73, 0xEF, 0x3C, 0x28, 0xDE, 0xDE, 0x2D, 0x1A,
+	0xBB, 0x7D, 0x78, 0x14, 0x35, 0x10, 0x76, 0x38, 0x6B, 0x43, 0x06, 0x3B, 0x20, 0x8B, 0x41, 0x66,
+	0xF6, 0x70, 0xFD, 0x1C, 0x53, 0xF2, 0x62, 0x4E, 0xA1, 0xCB, 0xC2, 0xD4, 0x65, 0xE3, 0xFF, 0x00,
+	0x17, 0xC1, 0xD6, 0xA9, 0x09, 0x04, 0x00, 0x00,
+};
+
+// app.js: 1990 bytes, 981 compressed.
+static const UINT8 au8WebAsset_app_js[981] PROGMEM = {
+	0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x75, 0x55, 0x7B, 0x6F, 0xDB, 0x36,
+	0x10, 0xFF, 0x3F, 0x9F, 0xE2, 0x80, 0xB5, 0x20, 0xB5, 0xA8, 0xB2, 0xE2, 0x14, 0xC6, 0x50, 0x2F,
+	0x28, 0xB2, 0xAD, 0xE8, 0x32, 0xB8, 0xAF, 0x24, 0x03, 0x36, 0x18, 0xC6, 0x40, 0x4B, 0x67, 0x49,
+	0x0B, 0x45, 0x3A, 0x24, 0xE5, 0xD8, 0x68, 0xF3, 0xDD, 0x77, 0x24, 0x65, 0x3B, 0x9E, 0x53, 0x40,
+	0x80, 0xCF, 0x77, 0xBF, 0x7B, 0x3F, 0x38, 0x18, 0xC0, 0x6F, 0xC2, 0xD6, 0x73, 0x2D, 0x4C, 0x09,
+	0x7A, 0x01, 0xAE, 0x46, 0x50, 0xBA, 0xC4, 0x0C, 0x26, 0x62, 0x8E, 0xD2, 0x42, 0xA1, 0x5B, 0x84,
+	0x85, 0xD1, 0x2D, 0x0C, 0xC4, 0xB2, 0x19, 0xC8, 0xC8, 0xE5, 0xA2, 0x70, 0xCD, 0x0A, 0x41, 0x0A,
+	0x55, 0x75, 0xA2, 0xC2, 0x24, 0x3B, 0x59, 0x09, 0x03, 0x13, 0xB8, 0x80, 0xAF, 0x8F, 0xE3, 0x40,
+	0x7F, 0xF9, 0xF3, 0x72, 0x72, 0x75, 0xFB, 0x37, 0x71, 0xA6, 0xAC, 0xD2, 0xBA, 0x64, 0x29, 0x30,
+	0xDB, 0xD9, 0x25, 0x16, 0xCE, 0x93, 0x73, 0x51, 0xB2, 0xD9, 0xF8, 0xE4, 0x64, 0xD1, 0x29, 0x32,
+	0xA5, 0x15, 0x54, 0xE8, 0x78, 0x67, 0x64, 0x0A, 0xC5, 0x3C, 0x81, 0xAF, 0x27, 0x00, 0xDE, 0xC8,
+	0x9A, 0xD4, 0x15, 0x3E, 0xC0, 0x5F, 0x1F, 0x26, 0xBF, 0x3B, 0xB7, 0xBC, 0xC6, 0xFB, 0x0E, 0xAD,
+	0xE3, 0xC9, 0x98, 0xE4, 0xEB, 0x4C, 0x2B, 0xA9, 0x45, 0x49, 0x90, 0x9D, 0x11, 0x4E, 0xAA, 0xD0,
+	0x2C, 0x80, 0xAF, 0x33, 0xEB, 0x84, 0xEB, 0x2C, 0x5C, 0x5C, 0xC0, 0x30, 0xCF, 0x13, 0xB2, 0xCA,
+	0xFF, 0xB8, 0xF9, 0xF4, 0x31, 0x5B, 0x0A, 0x63, 0x91, 0xC4, 0x06, 0xED, 0x52, 0x2B, 0x8B, 0xB7,
+	0xB8, 0x76, 0x49, 0x32, 0x86, 0xC7, 0xDE, 0xE4, 0x12, 0x15, 0x67, 0xEF, 0xDF, 0xDD, 0x52, 0x8C,
+	0x14, 0x4D, 0xEF, 0xC8, 0xA2, 0x2A, 0xBD, 0xD3, 0xC7, 0x27, 0xF1, 0xBE, 0xE0, 0x4D, 0xE9, 0xBD,
+	0x19, 0x74, 0x9D, 0x51, 0x50, 0xEA, 0xA2, 0x6B, 0x51, 0xB9, 0x8C, 0xF2, 0x78, 0x27, 0xD1, 0x93,
+	0xBF, 0x6C, 0xAE, 0x4A, 0x0F, 0x22, 0xE3, 0x4F, 0xF4, 0xCA, 0xCE, 0x08, 0x4F, 0xF0, 0xD6, 0xEE,
+	0xF3, 0xA4, 0x38, 0xE1, 0x83, 0x70, 0x75, 0xB6, 0x90, 0x5A, 0x1B, 0x12, 0xC1, 0x00, 0xCE, 0x72,
+	0x8A, 0x3B, 0x85, 0xF2, 0x50, 0xE4, 0x25, 0x3F, 0x8D, 0x5E, 0x93, 0x68, 0xDC, 0xEB, 0xD6, 0xC7,
+	0x80, 0xF3, 0x91, 0x4F, 0xF9, 0x25, 0x0C, 0x5F, 0xA7, 0xD0, 0x1E, 0x8B, 0x47, 0x41, 0x38, 0xCA,
+	0xBD, 0x85, 0x3E, 0x7C, 0x5E, 0xC2, 0x5B, 0x72, 0x75, 0x0A, 0xAC, 0x04, 0x06, 0x6F, 0x80, 0xB1,
+	0x84, 0xFE, 0xD4, 0x9E, 0x51, 0x13, 0xE3, 0x94, 0xCC, 0x10, 0xD9, 0xB2, 0xC3, 0x1A, 0xC4, 0x69,
+	0xE0, 0x32, 0x26, 0xE2, 0xBB, 0x2F, 0xBD, 0xCD, 0x5D, 0x2D, 0xB6, 0x44, 0x5F, 0x90, 0xCC, 0x8F,
+	0x8B, 0x07, 0x05, 0xE2, 0x00, 0xE9, 0x1A, 0x27, 0x31, 0x88, 0x02, 0xB5, 0xCD, 0xCD, 0xB3, 0x76,
+	0x18, 0xEA, 0xBD, 0xD9, 0xDC, 0xA0, 0xA4, 0x09, 0xD2, 0xE6, 0x52, 0x4A, 0xCE, 0xA6, 0xA5, 0x70,
+	0xE2, 0x55, 0x88, 0x62, 0xC6, 0x42, 0x41, 0x16, 0xDA, 0x00, 0xF7, 0x9A, 0x0D, 0x69, 0xE6, 0x63,
+	0xFA, 0xF9, 0x19, 0x30, 0x93, 0xA8, 0x2A, 0x57, 0xD3, 0xBF, 0xD3, 0xD3, 0x18, 0x6A, 0xB4, 0x7E,
+	0x47, 0x18, 0x9C, 0x36, 0x33, 0xDF, 0xB3, 0x4B, 0xE7, 0x4C, 0x33, 0xEF, 0x1C, 0x72, 0xB6, 0x37,
+	0x1A, 0x6D, 0x42, 0x98, 0x28, 0x39, 0xBD, 0x9B, 0x25, 0x11, 0xEE, 0x68, 0x66, 0x7E, 0xD5, 0xCA,
+	0x51, 0x50, 0x3E, 0x64, 0x12, 0x78, 0xD8, 0xE3, 0x41, 0x69, 0xE2, 0xF8, 0xF1, 0xBE, 0xC7, 0x2F,
+	0x38, 0x13, 0xAB, 0x8A, 0x25, 0xFF, 0x53, 0xB5, 0x19, 0x71, 0xC7, 0x51, 0xDE, 0x36, 0xEA, 0x19,
+	0x39, 0x71, 0x7D, 0xE1, 0xE1, 0x25, 0xDB, 0xC2, 0xC4, 0xFA, 0x39, 0x98, 0x58, 0x1F, 0xC2, 0x8C,
+	0x78, 0x78, 0x06, 0x46, 0xDC, 0x6D, 0x65, 0xEF, 0x89, 0xD1, 0xAF, 0xE8, 0xD4, 0x52, 0x69, 0x85,
+	0x6C, 0xDC, 0x66, 0x06, 0xDF, 0xBE, 0xC5, 0xD5, 0xEC, 0xCD, 0xF4, 0xFC, 0x23, 0x53, 0x93, 0xE9,
+	0x7D, 0xC0, 0xDE, 0x1F, 0xE1, 0x0A, 0x29, 0xAC, 0xFD, 0x28, 0x5A, 0xDF, 0xB9, 0xAD, 0x74, 0x21,
+	0x3A, 0xE9, 0xEC, 0x91, 0x11, 0x96, 0xAF, 0xFD, 0x64, 0xD9, 0x2C, 0xCA, 0x33, 0xA7, 0x6F, 0xA8,
+	0x07, 0xAA, 0xE2, 0x67, 0xA3, 0xA4, 0xD7, 0xEC, 0x96, 0xAE, 0x69, 0xF1, 0x48, 0x73, 0xB7, 0x43,
+	0x36, 0x53, 0xFA, 0x21, 0x2E, 0xE6, 0x60, 0x00, 0xD7, 0x28, 0x4A, 0xD2, 0xB7, 0x20, 0x0C, 0xC2,
+	0xD4, 0x6B, 0xFE, 0xD3, 0xDA, 0x14, 0x28, 0xEB, 0x14, 0x96, 0x85, 0x9B, 0xA5, 0xA0, 0x65, 0x49,
+	0xF7, 0x03, 0x16, 0x8D, 0xB1, 0x2E, 0xDB, 0x37, 0xAB, 0xA8, 0x85, 0x71, 0xBC, 0xDE, 0xEF, 0x63,
+	0x41, 0x4E, 0xC8, 0x7D, 0xE0, 0x33, 0x5A, 0x42, 0x3F, 0xB5, 0x85, 0x1F, 0x93, 0x10, 0xC3, 0xDA,
+	0x71, 0x36, 0x2C, 0x3D, 0xDF, 0x10, 0xBF, 0xA6, 0x5B, 0x12, 0xFD, 0xFA, 0xA0, 0x2B, 0xAA, 0x00,
+	0x0A, 0x73, 0x4D, 0x43, 0xCA, 0xF3, 0x14, 0xE8, 0x2B, 0xB2, 0x87, 0xA6, 0x74, 0xB5, 0x27, 0x6A,
+	0x6C, 0xAA, 0xDA, 0x85, 0xE4, 0xFC, 0x48, 0x99, 0x7E, 0x30, 0x69, 0x46, 0x87, 0x49, 0xBF, 0x89,
+	0xDB, 0xFE, 0xB8, 0x9C, 0x4C, 0x9B, 0x69, 0x3E, 0xA3, 0x2F, 0x05, 0xBB, 0x14, 0x6A, 0xBB, 0xC7,
+	0xD4, 0x6B, 0x5E, 0xFB, 0xBC, 0xE1, 0x15, 0xA1, 0x52, 0x38, 0x4B, 0xA2, 0x5F, 0xEB, 0x8C, 0xBE,
+	0xC3, 0x1B, 0xB7, 0x09, 0x8B, 0xC4, 0x7E, 0x38, 0x1F, 0x15, 0x2C, 0x4A, 0xE6, 0x58, 0x35, 0xEA,
+	0x33, 0xE9, 0xF2, 0xEF, 0xEE, 0x88, 0xF9, 0xDE, 0x8E, 0xF8, 0x0B, 0xCC, 0x0D, 0x4D, 0x3D, 0xC5,
+	0x11, 0x1C, 0x26, 0xF0, 0xE3, 0x36, 0x25, 0x3A, 0x25, 0x3E, 0xB0, 0xF1, 0x0E, 0xBC, 0x09, 0x65,
+	0x8A, 0x59, 0x12, 0x38, 0xA8, 0x0D, 0x67, 0x41, 0xA1, 0x67, 0x86, 0xB3, 0xD6, 0x2F, 0x15, 0x5D,
+	0x9C, 0x2A, 0x93, 0x8D, 0xC2, 0x5B, 0xCD, 0xD7, 0x29, 0x6C, 0x12, 0xBA, 0x3B, 0x55, 0xD6, 0xEA,
+	0xD5, 0x8E, 0x11, 0xD7, 0x6A, 0x9F, 0x1C, 0xDF, 0xB5, 0xFA, 0x93, 0x42, 0x2A, 0x58, 0x78, 0x0D,
+	0x40, 0xD0, 0x07, 0xBE, 0xDB, 0x6F, 0x76, 0xCF, 0x17, 0x58, 0x34, 0x2B, 0xB4, 0xB0, 0xA0, 0xB7,
+	0xA3, 0xD0, 0x4A, 0x61, 0xE8, 0xB3, 0x7D, 0xD2, 0x72, 0x83, 0x0B, 0x7A, 0x02, 0x6A, 0x1E, 0x73,
+	0xF5, 0x8F, 0x0F, 0x0B, 0x0F, 0x5C, 0xDC, 0x5B, 0xBA, 0xFE, 0xFB, 0x37, 0xC5, 0x6E, 0xEB, 0xB1,
+	0xDB, 0xE9, 0x98, 0xC0, 0x5E, 0xA9, 0x6E, 0x2C, 0x9D, 0xA4, 0xCD, 0x5B, 0xAA, 0x6C, 0x2B, 0xDC,
+	0xC5, 0xBF, 0x56, 0x2B, 0xB2, 0x10, 0xA6, 0x27, 0xE6, 0x10, 0xE3, 0xDE, 0x2B, 0xC4, 0xC3, 0x79,
+	0xE0, 0xC5, 0x1F, 0xD1, 0xFD, 0x41, 0x1D, 0xEF, 0x03, 0x1C, 0x07, 0x75, 0x8B, 0xEE, 0x8A, 0x46,
+	0xCF, 0xAC, 0x84, 0xE4, 0xBD, 0x28, 0x85, 0xF3, 0x3C, 0x0F, 0x0F, 0xC1, 0x7F, 0x82, 0x79, 0x67,
+	0x27, 0xC6, 0x07, 0x00, 0x00,
+};
+
+// style.css: 424 bytes, 255 compressed.
+static const UINT8 au8WebAsset_style_css[255] PROGMEM = {
+	0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x5D, 0x90, 0xDD, 0x6E, 0xC3, 0x20,
+	0x0C, 0x85, 0xEF, 0xF7, 0x14, 0x96, 0xAA, 0x5E, 0x52, 0x91, 0xAC, 0x8B, 0x26, 0x78, 0x1A, 0x07,
+	0x08, 0x41, 0x22, 0x80, 0x80, 0xAE, 0xE9, 0xAA, 0xBD, 0xFB, 0x20, 0x34, 0xFB, 0xE9, 0x1D, 0xF6,
+	0xF9, 0x7C, 0xEC, 0xC3, 0xE8, 0xE5, 0x0D, 0xEE, 0x30, 0x79, 0x97, 0xC9, 0x84, 0x8B, 0xB1, 0x37,
+	0x06, 0x09, 0x5D, 0x22, 0x49, 0x45, 0x33, 0x71, 0x58, 0x30, 0x6A, 0xE3, 0x18, 0x74, 0x6A, 0x01,
+	0xBC, 0x64, 0x5F, 0x3B, 0x2B, 0xB9, 0x1A, 0x99, 0x67, 0x06, 0xC3, 0x99, 0x86, 0x95, 0x43, 0x40,
+	0x29, 0x8D, 0xD3, 0x0C, 0x68, 0xC5, 0x38, 0x08, 0x6F, 0x7D, 0x64, 0x70, 0xE8, 0xFB, 0x9E, 0xC3,
+	0xD7, 0xCB, 0xDC, 0xED, 0x0B, 0x92, 0xF9, 0x54, 0xC5, 0xEA, 0x74, 0xAE, 0x54, 0x11, 0xFA, 0x67,
+	0x61, 0x1B, 0x6F, 0x2B, 0x49, 0xF6, 0xA1, 0xB6, 0xDE, 0x1A, 0x7B, 0x1A, 0x8D, 0xFE, 0x4F, 0xBF,
+	0x56, 0x61, 0xAB, 0xAF, 0xCA, 0xE8, 0x39, 0x33, 0x18, 0xBD, 0x95, 0x95, 0xCD, 0x38, 0x5A, 0x55,
+	0xE0, 0xD1, 0x47, 0xA9, 0x22, 0x29, 0xE7, 0x58, 0x0C, 0xA9, 0x8C, 0xEC, 0xAF, 0x0D, 0x9A, 0x0B,
+	0x91, 0xD5, 0x9A, 0x09, 0x5A, 0xA3, 0x4B, 0x42, 0xAB, 0xA6, 0xFC, 0x64, 0xE8, 0x7C, 0x5C, 0xD0,
+	0xFE, 0x06, 0x1A, 0x86, 0xE1, 0x27, 0x2D, 0x89, 0x8D, 0xE9, 0xDA, 0x7D, 0x02, 0xDD, 0x07, 0xA6,
+	0x62, 0xF9, 0xF8, 0x9A, 0x8E, 0xD2, 0x23, 0x7F, 0x5C, 0x50, 0xAA, 0xB0, 0x42, 0xF2, 0xD6, 0x48,
+	0x38, 0x08, 0x21, 0x5A, 0x1E, 0x94, 0x85, 0xDE, 0x9D, 0x05, 0xA5, 0x5B, 0x37, 0x5D, 0x52, 0x50,
+	0x22, 0xFF, 0x55, 0xDE, 0x37, 0xE5, 0x1B, 0xC1, 0xCD, 0x5B, 0x17, 0xA8, 0x01, 0x00, 0x00,
+};
+
+static const oWebAssetTy aoWebAssets[] = {
+	{"/", "text/html; charset=utf-8", au8WebAsset_index_html, sizeof(au8WebAsset_index_html)},
+	{"/app.js", "application/javascript", au8WebAsset_app_js, sizeof(au8WebAsset_app_js)},
+	{"/style.css", "text/css", au8WebAsset_style_css, sizeof(au8WebAsset_style_css)},
+};
+
+// In flash, only the table is in RAM.
+MEMSTATS_REGISTER(WebAssets, sizeof(aoWebAssets))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebAssetsFind - Looks up a static file.
+/// \public
+///
+/// \param[in]	pszPath		Request path, not necessarily terminated.
+/// \param[in]	u8PathLen	Length of the path.
+///
+/// \return		The file, NULL if none.
+////////////////////////////////////////////////////////////////////////////////
+const oWebAssetTy* WebAssetsFind(const char* pszPath, UINT8 u8PathLen)
+{
+	UINT8 u8Asset = 0;
+
+	for (u8Asset = 0; u8Asset < sizeof(aoWebAssets) / sizeof(aoWebAssets[0]); ++u8Asset)
+	{
+		if ((strlen(aoWebAssets[u8Asset].pszPath) == u8PathLen) && !strncmp(aoWebAssets[u8Asset].pszPath, pszPath, u8PathLen))
+		{
+			return &aoWebAssets[u8Asset];
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,43 @@
+///
+/// \file     WebAssets.h
+/// \brief    Static files of the web dashboard
+/// \details  WebAssets.c is generated by tools/web/gen_assets.py from the
+///           sources in tools/web/. Each file is gzip compressed at build
+///           time and kept in flash; WebMgr sends it unchanged with a
+///           "Content-Encoding: gzip" header. Do not edit WebAssets.c, edit
+///           the sources and run the script again.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef WEBASSETS_H
+#define WEBASSETS_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oWebAssetTy
+/// \brief 	One static file.
+///
+typedef struct
+{
+	const char*		pszPath;			///< Request path.
+	const char*		pszType;			///< Content-Type.
+	const UINT8*	pu8Data;			///< Gzip data, in flash (PROGMEM).
+	UINT32			u32Size;			///< Size of the gzip data, in bytes.
+} oWebAssetTy, *poWebAssetTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+const oWebAssetTy* WebAssetsFind(const char* pszPath, UINT8 u8PathLen);
+
+#endif
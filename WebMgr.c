@@ -0,0 +1,776 @@
+///
+/// \file     WebMgr.c
+/// \brief    On-node web dashboard
+/// \details  Uses the lwIP raw TCP API, like OtaClient. The callbacks only
+///           record: the request line is copied and the connection marked.
+///           The responses are produced from WebMgrTask(), in loop(), one
+///           buffer of WEBMGR_CHUNK_MAX bytes at a time and only when the
+///           TCP send buffer has room for it, within a work budget (see
+///           WorkBudget). A slow client therefore holds one buffer, never a
+///           whole response:
+///           - the static files are copied from flash as they are stored
+///             (already gzip compressed, see WebAssets);
+///           - the history rows are formatted straight from a HistoryMgr
+///             reader into the next chunk.
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include "WebMgr.h"
+#include "WebAssets.h"
+#include "HistoryMgr.h"
+#include "StringTable.h"
+#include "SystemTime.h"
+#include "MemStats.h"
+
+#ifdef ARDUINO_ARCH_ESP8266
+#include "lwip/tcp.h"
+#include "lwip/pbuf.h"
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define WEBMGR_CHUNK_HEAD   5           ///< Chunk size line: 3 hex digits and CRLF.
+#define WEBMGR_CHUNK_TAIL   2           ///< CRLF after the chunk data.
+#define WEBMGR_ROW_MAX      40          ///< Longest formatted history row.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   WebMgrRouteTy
+/// \brief  What a request asked for.
+///
+typedef enum
+{
+	WEBMGR_ROUTE_NONE		= 0,	///< Request not parsed yet.
+	WEBMGR_ROUTE_ASSET,				///< Static file.
+	WEBMGR_ROUTE_STATUS,			///< /api/status.
+	WEBMGR_ROUTE_LABELS,			///< /api/labels.
+	WEBMGR_ROUTE_HISTORY,			///< /api/history.
+	WEBMGR_ROUTE_BAD_REQUEST,		///< Not a GET.
+	WEBMGR_ROUTE_NOT_FOUND,			///< Unknown path.
+} WebMgrRouteTy;
+
+///
+/// \enum   WebMgrPhaseTy
+/// \brief  Progress of a response.
+///
+typedef enum
+{
+	WEBMGR_PHASE_HEADER		= 0,	///< Status line and headers.
+	WEBMGR_PHASE_BODY,				///< File data or chunks.
+	WEBMGR_PHASE_LAST_CHUNK,		///< Terminating chunk of a chunked body.
+	WEBMGR_PHASE_DONE,				///< Everything handed to TCP.
+} WebMgrPhaseTy;
+
+///
+/// \struct	oWebConnTy
+/// \brief 	One client connection.
+///
+typedef struct
+{
+	bool				bUsed;								///< Slot taken.
+	bool				bRequestDone;						///< The request line is complete.
+	bool				bDropped;							///< Closed by the client before the request.
+	char				szRequest[WEBMGR_REQUEST_MAX];		///< Request line, without CRLF.
+	UINT8				u8RequestLen;
+	UINT32				u32LastActivity;					///< Time of the last progress.
+
+	WebMgrRouteTy		eRoute;
+	WebMgrPhaseTy		ePhase;
+	const oWebAssetTy*	poAsset;							///< WEBMGR_ROUTE_ASSET: file sent.
+	UINT32				u32AssetOffset;						///< WEBMGR_ROUTE_ASSET: bytes already copied.
+	oHistoryReaderTy	oReader;							///< WEBMGR_ROUTE_HISTORY: next row.
+	bool				bJson;								///< WEBMGR_ROUTE_HISTORY: JSON, else CSV.
+	bool				bPreambleSent;						///< WEBMGR_ROUTE_HISTORY: column names or opening bracket sent.
+	bool				bFirstRow;							///< WEBMGR_ROUTE_HISTORY: no row sent yet.
+	bool				bHeld;								///< WEBMGR_ROUTE_HISTORY: row read but not sent (chunk full).
+	UINT32				u32HeldTimestamp;
+	UINT16				u16HeldRaw;
+	UINT8				u8HeldValue;
+	bool				bBodyDone;							///< The body has been entirely produced.
+
+	char				acBuf[WEBMGR_CHUNK_MAX];			///< Bytes being handed to TCP.
+	UINT16				u16BufLen;
+	UINT16				u16BufPos;							///< Bytes of acBuf already written.
+#ifdef ARDUINO_ARCH_ESP8266
+	struct tcp_pcb*		poPcb;								///< NULL once lwIP freed it.
+#endif
+} oWebConnTy, *poWebConnTy;
+
+///
+/// \struct	oWebMgrTy
+/// \brief 	WebMgr object.
+///
+typedef struct
+{
+	bool				bStarted;
+	UINT16				u16Port;
+	poMoistSensorMgrTy	poSensor;							///< Source of /api/status.
+	oWebConnTy			aoConn[WEBMGR_CONN_MAX];
+#ifdef ARDUINO_ARCH_ESP8266
+	struct tcp_pcb*		poListen;							///< Listening control block.
+#endif
+} oWebMgrTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+#ifdef ARDUINO_ARCH_ESP8266
+static void WebMgrRoute(poWebConnTy poConn);
+static bool WebMgrProduce(poWebConnTy poConn);
+static UINT16 WebMgrHeader(poWebConnTy poConn, char* pszBuf, UINT16 u16Size);
+static UINT16 WebMgrStatusBody(char* pszBuf, UINT16 u16Size);
+static UINT16 WebMgrLabelsBody(char* pszBuf, UINT16 u16Size);
+static UINT16 WebMgrHistoryBody(poWebConnTy poConn, char* pszBuf, UINT16 u16Size);
+static void WebMgrClose(poWebConnTy poConn);
+static err_t WebMgrOnAccept(void* pvArg, struct tcp_pcb* poPcb, err_t eErr);
+static err_t WebMgrOnRecv(void* pvArg, struct tcp_pcb* poPcb, struct pbuf* poBuf, err_t eErr);
+static void WebMgrOnError(void* pvArg, err_t eErr);
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+// Nothing is served on the host: only the public functions are built there.
+#ifdef ARDUINO_ARCH_ESP8266
+static oWebMgrTy oWebMgr = {FALSE};
+
+MEMSTATS_REGISTER(WebMgr, sizeof(oWebMgr))
+
+///
+/// Labels of the dashboard, in the order of /api/labels.
+///
+static const struct
+{
+	const char*		pszKey;
+	StringTableIDTy	eID;
+} aoWebMgrLabels[] = {
+	{"title",		STRINGTABLE_ID_006_WEB_TITLE},
+	{"moisture",	STRINGTABLE_ID_007_WEB_MOISTURE},
+	{"average",		STRINGTABLE_ID_008_WEB_AVERAGE},
+	{"minimum",		STRINGTABLE_ID_009_WEB_MINIMUM},
+	{"maximum",		STRINGTABLE_ID_010_WEB_MAXIMUM},
+	{"raw",			STRINGTABLE_ID_011_WEB_RAW},
+	{"quality",		STRINGTABLE_ID_012_WEB_QUALITY},
+	{"faults",		STRINGTABLE_ID_013_WEB_FAULTS},
+	{"uptime",		STRINGTABLE_ID_014_WEB_UPTIME},
+	{"history",		STRINGTABLE_ID_015_WEB_HISTORY},
+	{"download",	STRINGTABLE_ID_016_WEB_DOWNLOAD},
+	{"good",		STRINGTABLE_ID_017_WEB_GOOD},
+	{"suspect",		STRINGTABLE_ID_018_WEB_SUSPECT},
+	{"bad",			STRINGTABLE_ID_019_WEB_BAD},
+};
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrStart - Starts listening.
+/// \public
+/// \details	Can be called again (the boot stage retries), it only updates
+///				the sensor then.
+///
+/// \param[in]	u16Port		TCP port, WEBMGR_PORT normally.
+/// \param[in]	poSensor	Sensor shown on the dashboard.
+///
+/// \return		TRUE if success, FALSE otherwise or if not supported.
+////////////////////////////////////////////////////////////////////////////////
+bool WebMgrStart(UINT16 u16Port, poMoistSensorMgrTy poSensor)
+{
+	bool bRet = FALSE;
+
+#ifdef ARDUINO_ARCH_ESP8266
+	struct tcp_pcb* poPcb = NULL;
+
+	oWebMgr.poSensor = poSensor;
+
+	if (oWebMgr.bStarted)
+	{
+		bRet = TRUE;
+		goto END;
+	}
+
+	poPcb = tcp_new();
+	if (!poPcb) goto END;
+
+	if (tcp_bind(poPcb, IP_ADDR_ANY, u16Port) != ERR_OK)
+	{
+		tcp_close(poPcb);
+		goto END;
+	}
+
+	// Frees poPcb on success.
+	oWebMgr.poListen = tcp_listen(poPcb);
+	if (!oWebMgr.poListen)
+	{
+		tcp_close(poPcb);
+		goto END;
+	}
+
+	tcp_accept(oWebMgr.poListen, WebMgrOnAccept);
+
+	oWebMgr.u16Port		= u16Port;
+	oWebMgr.bStarted	= TRUE;
+
+	bRet = TRUE;
+END:
+#else
+	(void)u16Port;
+	(void)poSensor;
+#endif
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrTask - Periodic processing. Call it from loop().
+/// \public
+////////////////////////////////////////////////////////////////////////////////
+void WebMgrTask()
+{
+#ifdef ARDUINO_ARCH_ESP8266
+	poWebConnTy	poConn			= NULL;
+	UINT32		u32SliceStart	= SystemTimeGetTime();
+	UINT32		u32Steps		= 0;
+	UINT16		u16Len			= 0;
+	UINT8		u8Conn			= 0;
+	bool		bWritten		= FALSE;
+	bool		bExpired		= FALSE;
+
+	for (u8Conn = 0; u8Conn < WEBMGR_CONN_MAX; ++u8Conn)
+	{
+		poConn = &oWebMgr.aoConn[u8Conn];
+		if (!poConn->bUsed)
+		{
+			continue;
+		}
+
+		// Reset by the client or dropped before asking anything.
+		if (!poConn->poPcb || (poConn->bDropped && !poConn->bRequestDone) ||
+			(SystemTimeGetTimeDiff(poConn->u32LastActivity) > WEBMGR_IDLE_TIMEOUT))
+		{
+			WebMgrClose(poConn);
+			continue;
+		}
+
+		if (!poConn->bRequestDone || bExpired)
+		{
+			continue;
+		}
+
+		if (poConn->eRoute == WEBMGR_ROUTE_NONE)
+		{
+			WebMgrRoute(poConn);
+		}
+
+		bWritten = FALSE;
+
+		while (TRUE)
+		{
+			if (poConn->u16BufPos >= poConn->u16BufLen)
+			{
+				if (!WebMgrProduce(poConn))
+				{
+					// Queued data is still sent after the close.
+					if (bWritten)
+					{
+						tcp_output(poConn->poPcb);
+						bWritten = FALSE;
+					}
+					WebMgrClose(poConn);
+					break;
+				}
+				++u32Steps;
+			}
+
+			// Wait for the client to acknowledge what is in flight.
+			u16Len = tcp_sndbuf(poConn->poPcb);
+			if (u16Len > poConn->u16BufLen - poConn->u16BufPos)
+			{
+				u16Len = poConn->u16BufLen - poConn->u16BufPos;
+			}
+
+			if (!u16Len || (tcp_write(poConn->poPcb, &poConn->acBuf[poConn->u16BufPos], u16Len, TCP_WRITE_FLAG_COPY) != ERR_OK))
+			{
+				break;
+			}
+
+			poConn->u16BufPos			+= u16Len;
+			poConn->u32LastActivity		= SystemTimeGetTime();
+			bWritten					= TRUE;
+
+			if (WorkBudgetIsExpired(u32SliceStart, WEBMGR_SLICE_BUDGET))
+			{
+				bExpired = TRUE;
+				break;
+			}
+		}
+
+		if (bWritten)
+		{
+			tcp_output(poConn->poPcb);
+		}
+	}
+
+	if (u32Steps)
+	{
+		WorkBudgetAccount(u32SliceStart, WEBMGR_SLICE_BUDGET, u32Steps);
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+#ifdef ARDUINO_ARCH_ESP8266
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrRoute - Parses the request line.
+///
+/// \param[in]	poConn	Connection with a complete request line.
+////////////////////////////////////////////////////////////////////////////////
+static void WebMgrRoute(poWebConnTy poConn)
+{
+	const char*	pszPath		= NULL;
+	const char*	pszQuery	= NULL;
+	UINT8		u8PathLen	= 0;
+
+	poConn->ePhase = WEBMGR_PHASE_HEADER;
+
+	if (strncmp(poConn->szRequest, "GET ", 4))
+	{
+		poConn->eRoute = WEBMGR_ROUTE_BAD_REQUEST;
+		return;
+	}
+
+	pszPath		= &poConn->szRequest[4];
+	u8PathLen	= (UINT8)strcspn(pszPath, " ?");
+	pszQuery	= (pszPath[u8PathLen] == '?') ? &pszPath[u8PathLen + 1] : "";
+
+	poConn->poAsset = WebAssetsFind(pszPath, u8PathLen);
+	if (poConn->poAsset)
+	{
+		poConn->eRoute			= WEBMGR_ROUTE_ASSET;
+		poConn->u32AssetOffset	= 0;
+	}
+	else if ((u8PathLen == 11) && !strncmp(pszPath, "/api/status", 11))
+	{
+		poConn->eRoute = WEBMGR_ROUTE_STATUS;
+	}
+	else if ((u8PathLen == 11) && !strncmp(pszPath, "/api/labels", 11))
+	{
+		poConn->eRoute = WEBMGR_ROUTE_LABELS;
+	}
+	else if ((u8PathLen == 12) && !strncmp(pszPath, "/api/history", 12))
+	{
+		poConn->eRoute			= WEBMGR_ROUTE_HISTORY;
+		poConn->bJson			= !strncmp(pszQuery, "format=json", 11);
+		poConn->bPreambleSent	= FALSE;
+		poConn->bFirstRow		= TRUE;
+		poConn->bHeld			= FALSE;
+		HistoryReaderInit(&poConn->oReader);
+	}
+	else
+	{
+		poConn->eRoute = WEBMGR_ROUTE_NOT_FOUND;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrProduce - Fills the buffer with the next part of the response.
+///
+/// \param[in]	poConn	Connection with an empty buffer.
+///
+/// \return		TRUE if the buffer was filled, FALSE if the response is complete.
+////////////////////////////////////////////////////////////////////////////////
+static bool WebMgrProduce(poWebConnTy poConn)
+{
+	UINT16	u16Len	= 0;
+	char	szHead[8];
+
+	poConn->u16BufPos = 0;
+	poConn->u16BufLen = 0;
+
+	switch (poConn->ePhase)
+	{
+	case WEBMGR_PHASE_HEADER:
+		poConn->u16BufLen	= WebMgrHeader(poConn, poConn->acBuf, sizeof(poConn->acBuf));
+		poConn->bBodyDone	= FALSE;
+		poConn->ePhase		= ((poConn->eRoute == WEBMGR_ROUTE_BAD_REQUEST) || (poConn->eRoute == WEBMGR_ROUTE_NOT_FOUND)) ?
+								WEBMGR_PHASE_DONE : WEBMGR_PHASE_BODY;
+		break;
+
+	case WEBMGR_PHASE_BODY:
+		if (poConn->eRoute == WEBMGR_ROUTE_ASSET)
+		{
+			// Flash is only readable by aligned words: copy before writing.
+			u16Len = sizeof(poConn->acBuf);
+			if (u16Len > poConn->poAsset->u32Size - poConn->u32AssetOffset)
+			{
+				u16Len = (UINT16)(poConn->poAsset->u32Size - poConn->u32AssetOffset);
+			}
+
+			memcpy_P(poConn->acBuf, &poConn->poAsset->pu8Data[poConn->u32AssetOffset], u16Len);
+			poConn->u32AssetOffset	+= u16Len;
+			poConn->u16BufLen		= u16Len;
+
+			if (poConn->u32AssetOffset >= poConn->poAsset->u32Size)
+			{
+				poConn->ePhase = WEBMGR_PHASE_DONE;
+			}
+			break;
+		}
+
+		// Chunked: the data goes after the room kept for its size line.
+		switch (poConn->eRoute)
+		{
+		case WEBMGR_ROUTE_STATUS:
+			u16Len = WebMgrStatusBody(&poConn->acBuf[WEBMGR_CHUNK_HEAD], sizeof(poConn->acBuf) - WEBMGR_CHUNK_HEAD - WEBMGR_CHUNK_TAIL);
+			poConn->bBodyDone = TRUE;
+			break;
+
+		case WEBMGR_ROUTE_LABELS:
+			u16Len = WebMgrLabelsBody(&poConn->acBuf[WEBMGR_CHUNK_HEAD], sizeof(poConn->acBuf) - WEBMGR_CHUNK_HEAD - WEBMGR_CHUNK_TAIL);
+			poConn->bBodyDone = TRUE;
+			break;
+
+		case WEBMGR_ROUTE_HISTORY:
+			u16Len = WebMgrHistoryBody(poConn, &poConn->acBuf[WEBMGR_CHUNK_HEAD], sizeof(poConn->acBuf) - WEBMGR_CHUNK_HEAD - WEBMGR_CHUNK_TAIL);
+			break;
+
+		default:
+			poConn->bBodyDone = TRUE;
+			break;
+		}
+
+		if (poConn->bBodyDone)
+		{
+			poConn->ePhase = WEBMGR_PHASE_LAST_CHUNK;
+		}
+
+		// A chunk of size 0 would end the body.
+		if (!u16Len)
+		{
+			return WebMgrProduce(poConn);
+		}
+
+		snprintf(szHead, sizeof(szHead), "%03X\r\n", u16Len);
+		memcpy(poConn->acBuf, szHead, WEBMGR_CHUNK_HEAD);
+		memcpy(&poConn->acBuf[WEBMGR_CHUNK_HEAD + u16Len], "\r\n", WEBMGR_CHUNK_TAIL);
+		poConn->u16BufLen = WEBMGR_CHUNK_HEAD + u16Len + WEBMGR_CHUNK_TAIL;
+		break;
+
+	case WEBMGR_PHASE_LAST_CHUNK:
+		memcpy(poConn->acBuf, "0\r\n\r\n", 5);
+		poConn->u16BufLen	= 5;
+		poConn->ePhase		= WEBMGR_PHASE_DONE;
+		break;
+
+	default:
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrHeader - Formats the status line and the headers.
+///
+/// \return		Length written.
+////////////////////////////////////////////////////////////////////////////////
+static UINT16 WebMgrHeader(poWebConnTy poConn, char* pszBuf, UINT16 u16Size)
+{
+	const char*	pszType	= "application/json";
+	int			iLen	= 0;
+
+	switch (poConn->eRoute)
+	{
+	case WEBMGR_ROUTE_ASSET:
+		iLen = snprintf(pszBuf, u16Size,
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Type: %s\r\n"
+			"Content-Encoding: gzip\r\n"
+			"Content-Length: %lu\r\n"
+			"Cache-Control: no-cache\r\n"
+			"Connection: close\r\n\r\n",
+			poConn->poAsset->pszType, (unsigned long)poConn->poAsset->u32Size);
+		break;
+
+	case WEBMGR_ROUTE_HISTORY:
+		if (!poConn->bJson)
+		{
+			pszType = "text/csv\r\nContent-Disposition: attachment; filename=\"history.csv\"";
+		}
+		// No break.
+	case WEBMGR_ROUTE_STATUS:
+	case WEBMGR_ROUTE_LABELS:
+		iLen = snprintf(pszBuf, u16Size,
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Type: %s\r\n"
+			"Transfer-Encoding: chunked\r\n"
+			"Cache-Control: no-store\r\n"
+			"Connection: close\r\n\r\n",
+			pszType);
+		break;
+
+	default:
+		iLen = snprintf(pszBuf, u16Size,
+			"HTTP/1.1 %s\r\n"
+			"Content-Length: 0\r\n"
+			"Connection: close\r\n\r\n",
+			(poConn->eRoute == WEBMGR_ROUTE_BAD_REQUEST) ? "400 Bad Request" : "404 Not Found");
+		break;
+	}
+
+	return (iLen < (int)u16Size) ? (UINT16)iLen : u16Size - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrStatusBody - Formats /api/status.
+///
+/// \return		Length written.
+////////////////////////////////////////////////////////////////////////////////
+static UINT16 WebMgrStatusBody(char* pszBuf, UINT16 u16Size)
+{
+	poMoistSensorMgrTy	poSensor	= oWebMgr.poSensor;
+	int					iLen		= 0;
+
+	if (!poSensor)
+	{
+		iLen = snprintf(pszBuf, u16Size, "{\"now\":%lu}", (unsigned long)SystemTimeGetTime());
+	}
+	else
+	{
+		iLen = snprintf(pszBuf, u16Size,
+			"{\"now\":%lu,\"avg\":%u,\"cur\":%u,\"min\":%u,\"max\":%u,\"raw\":%u,"
+			"\"wmin\":%u,\"wmax\":%u,\"median\":%u,\"pct\":%u,"
+			"\"quality\":%u,\"faults\":%u,\"interval\":%lu,\"count\":%lu}",
+			(unsigned long)SystemTimeGetTime(), poSensor->u8AverageValue, poSensor->u8CurrentValue,
+			poSensor->u8MinimumValue, poSensor->u8MaximumValue, poSensor->u16AverageValueRaw,
+			poSensor->u8WindowMinimumValue, poSensor->u8WindowMaximumValue, poSensor->u8MedianValue, poSensor->u8PercentileValue,
+			poSensor->u8Quality, poSensor->u8FaultCode, (unsigned long)poSensor->u32ReadingInterval,
+			(unsigned long)HistoryMgrGetCount());
+	}
+
+	return (iLen < (int)u16Size) ? (UINT16)iLen : u16Size - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrLabelsBody - Formats /api/labels.
+/// \details	The strings of the table, and of the language packs (see
+///				tools/langpack), hold no quote nor backslash.
+///
+/// \return		Length written.
+////////////////////////////////////////////////////////////////////////////////
+static UINT16 WebMgrLabelsBody(char* pszBuf, UINT16 u16Size)
+{
+	UINT8	u8Label	= 0;
+	int		iLen	= 0;
+
+	iLen = snprintf(pszBuf, u16Size, "{\"lang\":\"%s\"", StringTableGetLangCode(StringTableGetLang()));
+
+	for (u8Label = 0; (u8Label < sizeof(aoWebMgrLabels) / sizeof(aoWebMgrLabels[0])) && (iLen < (int)u16Size); ++u8Label)
+	{
+		iLen += snprintf(&pszBuf[iLen], u16Size - iLen, ",\"%s\":\"%s\"", aoWebMgrLabels[u8Label].pszKey, StringTableGetStr(aoWebMgrLabels[u8Label].eID));
+	}
+
+	if (iLen < (int)u16Size)
+	{
+		iLen += snprintf(&pszBuf[iLen], u16Size - iLen, "}");
+	}
+
+	return (iLen < (int)u16Size) ? (UINT16)iLen : u16Size - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrHistoryBody - Formats the next rows of /api/history.
+/// \details	Sets bBodyDone after the last row. A row that does not fit is
+///				kept for the next call.
+///
+/// \return		Length written.
+////////////////////////////////////////////////////////////////////////////////
+static UINT16 WebMgrHistoryBody(poWebConnTy poConn, char* pszBuf, UINT16 u16Size)
+{
+	char	szRow[WEBMGR_ROW_MAX];
+	int		iRowLen	= 0;
+	UINT16	u16Len	= 0;
+
+	if (!poConn->bPreambleSent)
+	{
+		if (poConn->bJson)
+		{
+			u16Len = (UINT16)snprintf(pszBuf, u16Size, "{\"now\":%lu,\"readings\":[", (unsigned long)SystemTimeGetTime());
+		}
+		else
+		{
+			u16Len = (UINT16)snprintf(pszBuf, u16Size, "time_ms,raw,pct\r\n");
+		}
+		poConn->bPreambleSent = TRUE;
+	}
+
+	// Keeps room for the closing brackets.
+	while (TRUE)
+	{
+		if (!poConn->bHeld)
+		{
+			poConn->bHeld = HistoryReaderNext(&poConn->oReader, &poConn->u32HeldTimestamp, &poConn->u16HeldRaw, &poConn->u8HeldValue);
+			if (!poConn->bHeld)
+			{
+				break;
+			}
+		}
+
+		if (poConn->bJson)
+		{
+			iRowLen = snprintf(szRow, sizeof(szRow), "%s[%lu,%u,%u]", poConn->bFirstRow ? "" : ",",
+				(unsigned long)poConn->u32HeldTimestamp, poConn->u16HeldRaw, poConn->u8HeldValue);
+		}
+		else
+		{
+			iRowLen = snprintf(szRow, sizeof(szRow), "%lu,%u,%u\r\n",
+				(unsigned long)poConn->u32HeldTimestamp, poConn->u16HeldRaw, poConn->u8HeldValue);
+		}
+
+		if (u16Len + iRowLen + 2 > u16Size)
+		{
+			return u16Len;
+		}
+
+		memcpy(&pszBuf[u16Len], szRow, iRowLen);
+		u16Len				+= iRowLen;
+		poConn->bHeld		= FALSE;
+		poConn->bFirstRow	= FALSE;
+	}
+
+	if (poConn->bJson)
+	{
+		memcpy(&pszBuf[u16Len], "]}", 2);
+		u16Len += 2;
+	}
+
+	poConn->bBodyDone = TRUE;
+
+	return u16Len;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WebMgrClose - Closes a connection and frees its slot.
+///
+/// \param[in]	poConn	Connection.
+////////////////////////////////////////////////////////////////////////////////
+static void WebMgrClose(poWebConnTy poConn)
+{
+	if (poConn->poPcb)
+	{
+		tcp_arg(poConn->poPcb, NULL);
+		tcp_recv(poConn->poPcb, NULL);
+		tcp_err(poConn->poPcb, NULL);
+
+		if (tcp_close(poConn->poPcb) != ERR_OK)
+		{
+			tcp_abort(poConn->poPcb);
+		}
+		poConn->poPcb = NULL;
+	}
+
+	poConn->bUsed = FALSE;
+}
+
+static err_t WebMgrOnAccept(void* pvArg, struct tcp_pcb* poPcb, err_t eErr)
+{
+	poWebConnTy	poConn	= NULL;
+	UINT8		u8Conn	= 0;
+
+	if ((eErr != ERR_OK) || !poPcb)
+	{
+		return ERR_VAL;
+	}
+
+	for (u8Conn = 0; u8Conn < WEBMGR_CONN_MAX; ++u8Conn)
+	{
+		if (!oWebMgr.aoConn[u8Conn].bUsed)
+		{
+			poConn = &oWebMgr.aoConn[u8Conn];
+			break;
+		}
+	}
+
+	// Full: the browser retries.
+	if (!poConn)
+	{
+		tcp_abort(poPcb);
+		return ERR_ABRT;
+	}
+
+	poConn->bUsed			= TRUE;
+	poConn->bRequestDone	= FALSE;
+	poConn->bDropped		= FALSE;
+	poConn->u8RequestLen	= 0;
+	poConn->eRoute			= WEBMGR_ROUTE_NONE;
+	poConn->u16BufLen		= 0;
+	poConn->u16BufPos		= 0;
+	poConn->u32LastActivity	= SystemTimeGetTime();
+	poConn->poPcb			= poPcb;
+
+	tcp_arg(poPcb, poConn);
+	tcp_recv(poPcb, WebMgrOnRecv);
+	tcp_err(poPcb, WebMgrOnError);
+
+	return ERR_OK;
+}
+
+static err_t WebMgrOnRecv(void* pvArg, struct tcp_pcb* poPcb, struct pbuf* poBuf, err_t eErr)
+{
+	poWebConnTy		poConn	= (poWebConnTy)pvArg;
+	struct pbuf*	poPart	= NULL;
+	const char*		pcData	= NULL;
+	u16_t			u16Pos	= 0;
+
+	if (!poBuf)
+	{
+		poConn->bDropped = TRUE;
+		return ERR_OK;
+	}
+
+	// Only the request line is kept, the headers are not needed.
+	for (poPart = poBuf; poPart && !poConn->bRequestDone; poPart = poPart->next)
+	{
+		pcData = (const char*)poPart->payload;
+
+		for (u16Pos = 0; (u16Pos < poPart->len) && !poConn->bRequestDone; ++u16Pos)
+		{
+			if (pcData[u16Pos] == '\n')
+			{
+				poConn->bRequestDone = TRUE;
+			}
+			else if ((pcData[u16Pos] != '\r') && (poConn->u8RequestLen < WEBMGR_REQUEST_MAX - 1))
+			{
+				poConn->szRequest[poConn->u8RequestLen++] = pcData[u16Pos];
+			}
+		}
+	}
+
+	poConn->szRequest[poConn->u8RequestLen] = '\0';
+	poConn->u32LastActivity = SystemTimeGetTime();
+
+	tcp_recved(poPcb, poBuf->tot_len);
+	pbuf_free(poBuf);
+
+	return ERR_OK;
+}
+
+static void WebMgrOnError(void* pvArg, err_t eErr)
+{
+	// lwIP already freed the control block.
+	((poWebConnTy)pvArg)->poPcb = NULL;
+}
+
+#endif
@@ -0,0 +1,45 @@
+///
+/// \file     WebMgr.h
+/// \brief    On-node web dashboard
+/// \details  Small HTTP/1.1 server on the lwIP raw TCP API:
+///           - /, /app.js, /style.css: the dashboard (see WebAssets), stored
+///             gzip compressed in flash and sent as-is;
+///           - /api/status: last result of the sensor, in JSON;
+///           - /api/labels: dashboard labels in the active language (see
+///             StringTable), in JSON;
+///           - /api/history?format=csv|json: recent readings (see
+///             HistoryMgr), streamed with the chunked transfer encoding.
+///           Every response closes its connection.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef WEBMGR_H
+#define WEBMGR_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "MoistSensorMgr.h"
+#include "WorkBudget.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define WEBMGR_PORT             80          ///< Default listening port.
+#define WEBMGR_CONN_MAX         4           ///< Simultaneous connections (a page load opens 3). More are refused.
+#define WEBMGR_REQUEST_MAX      128         ///< Longest request line kept, the rest is ignored.
+#define WEBMGR_CHUNK_MAX        512         ///< Response buffer per connection, in bytes.
+#define WEBMGR_IDLE_TIMEOUT     10000       ///< Time without progress before dropping a connection, in ms.
+#define WEBMGR_SLICE_BUDGET     WORKBUDGET_SLICE_DEFAULT    ///< Time spent sending per loop() iteration, in ms.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool WebMgrStart(UINT16 u16Port, poMoistSensorMgrTy poSensor);
+void WebMgrTask();
+
+#endif
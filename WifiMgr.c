@@ -1 +1,141 @@
+// This is file has been prepared by a cog script.
 
+/// \file WifiMgr.c
+/// \brief    WiFi station manager
+/// \details  Non-blocking station connection using the SDK C API. The
+///           credentials come from the configuration block. On targets
+///           without WiFi (host builds) the link is reported as up.
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "WifiMgr.h"
+#include "MemStats.h"
+#include "ConfigMgr.h"
+
+#ifdef ARDUINO_ARCH_ESP8266
+#include "user_interface.h"
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+	bool			bIsConfigured;					///< Flag indicating that the module is configured or not.
+	bool			bIsConnecting;					///< A connection was requested.
+	bool			bIsConnected;					///< The station has an IP address.
+} oWifiMgrTy;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oWifiMgrTy oWifiMgr = {FALSE};
+
+MEMSTATS_REGISTER(WifiMgr, sizeof(oWifiMgr))
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WifiMgr - Initializes the WiFi manager.
+/// \public
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool WifiMgr()
+{
+	oWifiMgr.bIsConfigured	= false;
+	oWifiMgr.bIsConnecting	= false;
+	oWifiMgr.bIsConnected	= false;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WifiMgrConfigure - Sets the station mode and credentials.
+/// \public
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool WifiMgrConfigure()
+{
+	bool			bRet		= false;
+	poConfigMgrTy	poConfig	= ConfigMgr();
+
+	if (!poConfig->bIsLoaded) goto END;
+
+#ifdef ARDUINO_ARCH_ESP8266
+	{
+		struct station_config oStation;
+
+		memset(&oStation, 0, sizeof(oStation));
+		memcpy(oStation.ssid, poConfig->oData.szSSID, strlen(poConfig->oData.szSSID));
+		memcpy(oStation.password, poConfig->oData.szPW, strlen(poConfig->oData.szPW));
+
+		bRet = wifi_set_opmode_current(STATION_MODE);
+		if (!bRet) goto END;
+
+		bRet = wifi_station_set_config_current(&oStation);
+		if (!bRet) goto END;
+	}
+#endif
+
+	oWifiMgr.bIsConfigured = true;
+
+	bRet = true;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WifiMgrConnect - Starts the connection. Does not wait for it.
+/// \public
+///
+/// \return		TRUE if success, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool WifiMgrConnect()
+{
+	bool bRet = false;
+
+	if (!oWifiMgr.bIsConfigured) goto END;
+
+#ifdef ARDUINO_ARCH_ESP8266
+	bRet = wifi_station_connect();
+	if (!bRet) goto END;
+#endif
+
+	oWifiMgr.bIsConnecting = true;
+
+	bRet = true;
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WifiMgrTask - Tracks the connection state.
+/// \public
+////////////////////////////////////////////////////////////////////////////////
+void WifiMgrTask()
+{
+	if (!oWifiMgr.bIsConnecting)
+	{
+		return;
+	}
+
+#ifdef ARDUINO_ARCH_ESP8266
+	oWifiMgr.bIsConnected = (wifi_station_get_connect_status() == STATION_GOT_IP);
+#else
+	oWifiMgr.bIsConnected = HostArduinoIsLinkUp();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WifiMgrIsConnected - Checks if the station has an IP address.
+/// \public
+///
+/// \return		TRUE if connected, FALSE otherwise.
+////////////////////////////////////////////////////////////////////////////////
+bool WifiMgrIsConnected()
+{
+	return oWifiMgr.bIsConnected;
+}
@@ -11,6 +11,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Includes
 ////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
@@ -29,5 +30,6 @@ bool WifiMgr();
 void WifiMgrTask();
 bool WifiMgrConfigure();
 bool WifiMgrConnect();
+bool WifiMgrIsConnected();
 
 #endif
@@ -0,0 +1,152 @@
+///
+/// \file     WorkBudget.c
+/// \brief    Time-sliced work budgeting
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "WorkBudget.h"
+#include "MemStats.h"
+#include "SystemTime.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oWorkBudgetStatsTy oWorkBudgetStats = {0};
+static UINT32 u32LastMark = 0;
+static bool bHasMark = FALSE;
+
+MEMSTATS_REGISTER(WorkBudget, sizeof(oWorkBudgetStats) + sizeof(u32LastMark) + sizeof(bHasMark))
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WorkBudgetMark - Marks a yield point.
+/// \public
+/// \details	Call it at the top of loop(). The time since the previous call
+///				is the stretch the WiFi stack had to wait.
+////////////////////////////////////////////////////////////////////////////////
+void WorkBudgetMark()
+{
+	UINT32 u32Now = SystemTimeGetTime();
+
+	if (bHasMark)
+	{
+		oWorkBudgetStats.u32LastStretch = u32Now - u32LastMark;
+
+		if (oWorkBudgetStats.u32LastStretch > oWorkBudgetStats.u32LongestStretch)
+		{
+			oWorkBudgetStats.u32LongestStretch = oWorkBudgetStats.u32LastStretch;
+		}
+
+		if (oWorkBudgetStats.u32LastStretch > WORKBUDGET_STRETCH_WARN)
+		{
+			++oWorkBudgetStats.u32StretchWarnings;
+		}
+	}
+
+	++oWorkBudgetStats.u32Iterations;
+	u32LastMark	= u32Now;
+	bHasMark	= TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WorkBudgetRun - Executes a slice of a job.
+/// \public
+/// \details	Calls the step function until the job is done, fails, or the
+///				budget is spent. At least one step is executed per slice, so a
+///				job always makes progress.
+///
+/// \param[in]	pfStep			Step function of the job.
+/// \param[in]	pvJob			Job state, passed to the step function.
+/// \param[in]	u32BudgetMs		Slice budget, in ms.
+///
+/// \return		WORKBUDGET_MORE to call again at the next loop() iteration.
+////////////////////////////////////////////////////////////////////////////////
+WorkBudgetResultTy WorkBudgetRun(WorkBudgetStepFuncTy pfStep, void* pvJob, UINT32 u32BudgetMs)
+{
+	WorkBudgetResultTy	eRet		= WORKBUDGET_ERROR;
+	UINT32				u32Start	= SystemTimeGetTime();
+	UINT32				u32Steps	= 0;
+
+	if (!pfStep) goto END;
+
+	do
+	{
+		eRet = pfStep(pvJob);
+		++u32Steps;
+	} while ((eRet == WORKBUDGET_MORE) && !WorkBudgetIsExpired(u32Start, u32BudgetMs));
+
+	WorkBudgetAccount(u32Start, u32BudgetMs, u32Steps);
+
+END:
+	return eRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WorkBudgetIsExpired - Checks if a slice used up its budget.
+/// \public
+/// \details	For jobs that cannot be written as a step function: check it
+///				between two units of work and return to loop() when TRUE.
+///
+/// \param[in]	u32SliceStart	SystemTimeGetTime() at the start of the slice.
+/// \param[in]	u32BudgetMs		Slice budget, in ms.
+///
+/// \return		TRUE if the slice must end.
+////////////////////////////////////////////////////////////////////////////////
+bool WorkBudgetIsExpired(UINT32 u32SliceStart, UINT32 u32BudgetMs)
+{
+	return (SystemTimeGetTime() - u32SliceStart) >= u32BudgetMs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WorkBudgetAccount - Records a slice in the statistics.
+/// \public
+/// \details	Called by WorkBudgetRun(). Jobs using WorkBudgetIsExpired()
+///				directly call it at the end of their slice.
+///
+/// \param[in]	u32SliceStart	SystemTimeGetTime() at the start of the slice.
+/// \param[in]	u32BudgetMs		Slice budget, in ms.
+/// \param[in]	u32Steps		Units of work done in the slice.
+////////////////////////////////////////////////////////////////////////////////
+void WorkBudgetAccount(UINT32 u32SliceStart, UINT32 u32BudgetMs, UINT32 u32Steps)
+{
+	UINT32 u32Elapsed = SystemTimeGetTime() - u32SliceStart;
+
+	++oWorkBudgetStats.u32Slices;
+	oWorkBudgetStats.u32Steps += u32Steps;
+
+	if (u32Elapsed > oWorkBudgetStats.u32LongestSlice)
+	{
+		oWorkBudgetStats.u32LongestSlice = u32Elapsed;
+	}
+
+	// One ms of tolerance: the time base is 1 ms.
+	if (u32Elapsed > u32BudgetMs + 1)
+	{
+		++oWorkBudgetStats.u32Overruns;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WorkBudgetGetStats - Gets the instrumentation.
+/// \public
+///
+/// \return		The statistics since boot or the last reset.
+////////////////////////////////////////////////////////////////////////////////
+const oWorkBudgetStatsTy* WorkBudgetGetStats()
+{
+	return &oWorkBudgetStats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		WorkBudgetResetStats - Clears the instrumentation.
+/// \public
+////////////////////////////////////////////////////////////////////////////////
+void WorkBudgetResetStats()
+{
+	memset(&oWorkBudgetStats, 0, sizeof(oWorkBudgetStats));
+	bHasMark = FALSE;
+}
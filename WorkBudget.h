@@ -0,0 +1,79 @@
+///
+/// \file     WorkBudget.h
+/// \brief    Time-sliced work budgeting
+/// \details  On the ESP8266 the WiFi stack and the software watchdog only run
+///           when loop() returns (or yield() is called). A long job is split
+///           into small resumable steps and WorkBudgetRun() executes as many
+///           of them as fit in a time budget, then returns so loop() can
+///           yield. The job continues at the next iteration.
+///
+///           WorkBudgetMark() is called once per loop() iteration and keeps
+///           track of the longest stretch without a yield.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef WORKBUDGET_H
+#define WORKBUDGET_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define WORKBUDGET_SLICE_DEFAULT    10      ///< Default slice budget, in ms. Well below the WiFi needs (~50 ms).
+#define WORKBUDGET_STRETCH_WARN     100     ///< Stretch without a yield counted as a warning, in ms.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \enum   WorkBudgetResultTy
+/// \brief  Result of a step or of a slice.
+///
+typedef enum
+{
+	WORKBUDGET_DONE		= 0,	///< The job is finished.
+	WORKBUDGET_MORE,			///< The job has more work, call again.
+	WORKBUDGET_ERROR,			///< The job failed.
+} WorkBudgetResultTy;
+
+///
+/// Executes one small unit of a job (well below the slice budget) and keeps
+/// its progress in pvJob.
+///
+typedef WorkBudgetResultTy (*WorkBudgetStepFuncTy)(void* pvJob);
+
+///
+/// \struct	oWorkBudgetStatsTy
+/// \brief 	Instrumentation.
+///
+typedef struct
+{
+	UINT32		u32Iterations;			///< loop() iterations seen by WorkBudgetMark().
+	UINT32		u32LongestStretch;		///< Longest time between two marks, in ms.
+	UINT32		u32LastStretch;			///< Time between the last two marks, in ms.
+	UINT32		u32StretchWarnings;		///< Stretches longer than WORKBUDGET_STRETCH_WARN.
+	UINT32		u32Slices;				///< Slices executed by WorkBudgetRun().
+	UINT32		u32Steps;				///< Steps executed by WorkBudgetRun().
+	UINT32		u32Overruns;			///< Slices that went over their budget (a step was too long).
+	UINT32		u32LongestSlice;		///< Longest slice, in ms.
+} oWorkBudgetStatsTy, *poWorkBudgetStatsTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+void                WorkBudgetMark();
+WorkBudgetResultTy  WorkBudgetRun(WorkBudgetStepFuncTy pfStep, void* pvJob, UINT32 u32BudgetMs);
+bool                WorkBudgetIsExpired(UINT32 u32SliceStart, UINT32 u32BudgetMs);
+void                WorkBudgetAccount(UINT32 u32SliceStart, UINT32 u32BudgetMs, UINT32 u32Steps);
+const oWorkBudgetStatsTy* WorkBudgetGetStats();
+void                WorkBudgetResetStats();
+
+#endif
@@ -2,40 +2,111 @@
 // Includes
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <Arduino.h>
+
+// The modules are written in C.
+extern "C" {
 #include "TypeDefs.h"
 #include "SystemTime.h"
 #include "MoistSensorMgr.h"
+#include "ConfigMgr.h"
+#include "WifiMgr.h"
+#include "CommMgr.h"
+#include "CalibMgr.h"
+#include "SensorHealth.h"
+#include "OtaClient.h"
+#include "WorkBudget.h"
+#include "MemStats.h"
+#include "BufPool.h"
+#include "TraceMgr.h"
+#include "HistoryMgr.h"
+#include "WebMgr.h"
+#include "IrrigationMgr.h"
+#include "StringTable.h"
+#include "AdcCapture.h"
+#include "FlashMgr.h"
+}
 
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // Definitions
 ////////////////////////////////////////////////////////////////////////////////
+#define APP_SERIAL_BAUDRATE   115200
+#define APP_CONSOLE_LINE_MAX  100
+#define APP_VALVE_PIN         D5
+#define APP_WIFI_TIMEOUT      30000   ///< Wait for the link at boot, in ms. CommMgr queues the reports after.
 
 ////////////////////////////////////////////////////////////////////////////////
 // Data types
 ////////////////////////////////////////////////////////////////////////////////
+///
+/// Boot stages. Each stage brings up one manager and is executed from loop(),
+/// one stage per iteration, so nothing blocks. Sampling starts as soon as
+/// APP_SM_BOOT_SENSOR is done, before the network is up, and goes on while a
+/// later stage is retried.
 typedef enum
 {
-	APP_SM_INIT		= 0,		///< Application state - Initialization state.
+	APP_SM_INIT		= 0,		///< Application state - Initialization state (time base).
+	APP_SM_BOOT_CONFIG,			///< Application state - Load the persistent configuration.
+	APP_SM_BOOT_SENSOR,			///< Application state - Bring up the moisture sensor and the irrigation.
+	APP_SM_BOOT_WIFI,			///< Application state - Start the WiFi connection.
+	APP_SM_BOOT_WIFI_WAIT,		///< Application state - Wait for the WiFi link.
+	APP_SM_BOOT_COMM,			///< Application state - Open the link toward the gateway and the web dashboard.
 	APP_SM_NORMAL,				///< Application state - Normal operation state.
 
+	APP_SM_MAX,					///< Number of states.
 } ApplicationStateTy;
 
 
 typedef struct {
   bool isInit;
 
+  ApplicationStateTy  eState;
+
+  // Boot timing, in ms since power up.
+  UINT32  au32StageDone[APP_SM_MAX];    ///< Time stamp at the end of each stage.
+  UINT32  u32FirstReading;              ///< Time stamp of the first processed reading (0 if none yet).
+  UINT32  u32FirstUplink;               ///< Time stamp of the first report sent (0 if none yet).
+  bool    bPendingReport;               ///< A result is waiting for CommMgr (not up yet, or no buffer).
+  bool    bBootReported;                ///< Boot timing already printed.
+  OtaClientStatusTy eOtaStatus;         ///< Last firmware update status printed.
+
+  // Stack accounting (see MemStats).
+  UINT8   u8TaskSensor;
+  UINT8   u8TaskWifi;
+  UINT8   u8TaskOta;
+  UINT8   u8TaskConsole;
+  UINT8   u8TaskWeb;
+
+  // Serial console.
+  char    szLine[APP_CONSOLE_LINE_MAX + 1];
+  UINT8   u8LineLen;
 
   // Modules
+  poConfigMgrTy       poConfigMgr;
   poMoistSensorMgrTy  poMoistSensorMgr;
+  poIrrigationMgrTy   poIrrigationMgr;
 
 } oApplicationTy, *poApplicationTy;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Private functions
 ////////////////////////////////////////////////////////////////////////////////
-bool ApplicationInit();
+bool ApplicationBootTask();
+void ApplicationTask();
+void ApplicationReportBoot();
+void ApplicationReportPerf();
+void ApplicationReportMem();
+void ApplicationReportIrrigation();
+void ApplicationReportSchedule();
+void ApplicationScheduleTask();
+void ApplicationTraceWrite(const char* pszLine);
+void ApplicationReportCapture();
+void ApplicationReportLang();
+UINT32 ApplicationCaptureWrite(const UINT8* pu8Data, UINT32 u32Size);
+void ApplicationConsoleTask();
+void ApplicationConsoleExecute(char* pszLine);
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -43,46 +114,641 @@ bool ApplicationInit();
 ////////////////////////////////////////////////////////////////////////////////
 oApplicationTy oApplication = {false};
 
+static const char* const apszStageName[APP_SM_MAX] = {
+  "time", "config", "sensor", "wifi", "wifi link", "comm", "normal"
+};
+
 
 void setup() {
 
-  //ApplicationInit();
-  // For testing purpose, this line just crashes...
-  SystemTimeInit();
+  Serial.begin(APP_SERIAL_BAUDRATE);
+
+  MemStatsRegisterModule("Application", sizeof(oApplication));
+  oApplication.u8TaskSensor  = MemStatsTaskRegister("sensor");
+  oApplication.u8TaskWifi    = MemStatsTaskRegister("wifi");
+  oApplication.u8TaskOta     = MemStatsTaskRegister("ota");
+  oApplication.u8TaskConsole = MemStatsTaskRegister("console");
+  oApplication.u8TaskWeb     = MemStatsTaskRegister("web");
+
+  // Message buffers, before any networking module.
+  BufPoolInit();
+
+  // Everything else is brought up from loop(), see ApplicationBootTask().
+  oApplication.eState = APP_SM_INIT;
 
 }
 
 void loop() {
-  // put your main code here, to run repeatedly:
+
+  // loop() returning is where the WiFi stack runs.
+  WorkBudgetMark();
+
+  // A stage that failed is retried on the next iteration. Meanwhile the
+  // managers already up keep running: the valve cutoffs must not wait.
+  ApplicationBootTask();
+
+  ApplicationTask();
+
+  MemStatsTaskBegin(oApplication.u8TaskConsole);
+  ApplicationConsoleTask();
+  MemStatsTaskEnd(oApplication.u8TaskConsole);
 
 }
 
 
-bool ApplicationInit() {
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationBootTask - Executes the current boot stage.
+///
+/// \return   TRUE if success, FALSE if the current stage failed.
+////////////////////////////////////////////////////////////////////////////////
+bool ApplicationBootTask() {
   bool bRet = false;
 
-  if (!oApplication.isInit) {
-
+  switch (oApplication.eState) {
+  case APP_SM_INIT:
     // Before anything, initialize the SystemTime utility.
     bRet = SystemTimeInit();
     if (!bRet) goto END;
+    break;
+
+  case APP_SM_BOOT_CONFIG:
+    // Falls back to the defaults if nothing valid is stored.
+    oApplication.poConfigMgr = ConfigMgr();
+    bRet = ConfigMgrLoad(oApplication.poConfigMgr);
+    if (!bRet) goto END;
+    break;
+
+  case APP_SM_BOOT_SENSOR:
+    // Initializing the moist sensor to D8
+    oApplication.poMoistSensorMgr = MoistSensorMgr(D8);
+    if (oApplication.poMoistSensorMgr == NULL) goto END;
+
+    bRet = ConfigMgrApplySensor(oApplication.poConfigMgr, oApplication.poMoistSensorMgr);
+    if (!bRet) goto END;
+
+    bRet = MoistSensorMgrConfigure(oApplication.poMoistSensorMgr);
+    if (!bRet) goto END;
+
+    // The valve is closed from here on, whatever the settings.
+    oApplication.poIrrigationMgr = IrrigationMgr(APP_VALVE_PIN);
+    bRet = ConfigMgrApplyIrrigation(oApplication.poConfigMgr, oApplication.poIrrigationMgr)
+        && IrrigationMgrConfigure(oApplication.poIrrigationMgr);
+    if (!bRet) goto END;
+    break;
 
-    // // Once the system time is initialized, wait some time for electrical setup.
-    // SystemTimeDelay(100);
+  case APP_SM_BOOT_WIFI:
+    bRet = WifiMgr() && WifiMgrConfigure() && WifiMgrConnect();
+    if (!bRet) goto END;
+    break;
+
+  case APP_SM_BOOT_WIFI_WAIT:
+    WifiMgrTask();
+    if (!WifiMgrIsConnected()
+        && (SystemTimeGetTimeDiff(oApplication.au32StageDone[APP_SM_BOOT_WIFI]) < APP_WIFI_TIMEOUT)) {
+      // Not an error, just not there yet.
+      bRet = true;
+      goto END;
+    }
+    if (!WifiMgrIsConnected()) {
+      // The station keeps reconnecting by itself, the reports wait in the queue.
+      Serial.println(F("No WiFi link yet, going on offline"));
+    }
+    break;
 
-    // // Initializing the moist sensor to D8
-    // oApplication.poMoistSensorMgr = MoistSensorMgr(D8);
-    // if (oApplication.poMoistSensorMgr == NULL) {
-    //   goto END;
-    // }
+  case APP_SM_BOOT_COMM:
+    bRet = CommMgr() && CommMgrConfigure() && WebMgrStart(WEBMGR_PORT, oApplication.poMoistSensorMgr);
+    if (!bRet) goto END;
+    break;
+
+  default:
+    bRet = true;
+    goto END;
+  }
 
-    // bRet = MoistSensorMgrConfigure(oApplication.poMoistSensorMgr);
-    // if (!bRet) goto END;
+  oApplication.au32StageDone[oApplication.eState] = SystemTimeGetTime();
+  oApplication.eState = (ApplicationStateTy)(oApplication.eState + 1);
 
+  if (oApplication.eState == APP_SM_NORMAL) {
+    oApplication.au32StageDone[APP_SM_NORMAL] = SystemTimeGetTime();
+    oApplication.isInit = true;
   }
 
   bRet = true;
 END:
   return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationTask - Runs the managers that are already up.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationTask() {
+  BOOL bNewResult = false;
+  BOOL bNewReading = false;
+  oCommMgrStatsTy oCommStats;
+
+  if (oApplication.eState <= APP_SM_BOOT_SENSOR) {
+    return;
+  }
 
+  // The capture drives the probe: no readings meanwhile.
+  MemStatsTaskBegin(oApplication.u8TaskSensor);
+  if (AdcCaptureIsActive()) {
+    AdcCaptureTask();
+  }
+  else {
+    MoistSensorMgrTask();
+  }
+  MemStatsTaskEnd(oApplication.u8TaskSensor);
+
+  // First: the reading-to-actuation latency must not depend on the rest.
+  if (MoistSensorMgrIsNewReadingAvail(&bNewReading) && bNewReading) {
+    IrrigationMgrOnReading(oApplication.poIrrigationMgr, oApplication.poMoistSensorMgr);
+  }
+
+  if (MoistSensorMgrIsNewResultAvail(&bNewResult) && bNewResult) {
+    if (oApplication.u32FirstReading == 0) {
+      oApplication.u32FirstReading = SystemTimeGetTime();
+    }
+    oApplication.bPendingReport = true;
+
+    HistoryMgrAppend(SystemTimeGetTime(), oApplication.poMoistSensorMgr->u16AverageValueRaw, oApplication.poMoistSensorMgr->u8AverageValue);
+  }
+
+  IrrigationMgrTask();
+
+  if (oApplication.eState > APP_SM_BOOT_WIFI_WAIT) {
+    MemStatsTaskBegin(oApplication.u8TaskWifi);
+    WifiMgrTask();
+    MemStatsTaskEnd(oApplication.u8TaskWifi);
+  }
+
+  if (oApplication.eState > APP_SM_BOOT_COMM) {
+    ApplicationScheduleTask();
+  }
+
+  // Queued by CommMgr until the link is up and, in slotted mode, the slot
+  // of the node is open.
+  if (oApplication.bPendingReport && CommMgrSendReading(oApplication.poMoistSensorMgr)) {
+    oApplication.bPendingReport = false;
+  }
+
+  if ((oApplication.u32FirstUplink == 0) && CommMgrGetStats(&oCommStats) && oCommStats.u32Sent) {
+    oApplication.u32FirstUplink = SystemTimeGetTime();
+  }
+
+  if (oApplication.eState > APP_SM_BOOT_COMM) {
+    MemStatsTaskBegin(oApplication.u8TaskOta);
+    OtaClientTask();
+    MemStatsTaskEnd(oApplication.u8TaskOta);
+
+    MemStatsTaskBegin(oApplication.u8TaskWeb);
+    WebMgrTask();
+    MemStatsTaskEnd(oApplication.u8TaskWeb);
+
+    if (OtaClientGetStatus() != oApplication.eOtaStatus) {
+      oApplication.eOtaStatus = OtaClientGetStatus();
+
+      if (oApplication.eOtaStatus == OTACLIENT_DONE) {
+        Serial.println(F("Update verified, restarting"));
+        Serial.flush();
+        OtaMgrApply();
+      }
+      else if (oApplication.eOtaStatus == OTACLIENT_FAILED) {
+        Serial.println(F("Update failed"));
+      }
+    }
+  }
+
+  if (!oApplication.bBootReported && oApplication.u32FirstUplink) {
+    ApplicationReportBoot();
+    oApplication.bBootReported = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationScheduleTask - Applies the gateway beacons and keeps the
+///           readings aligned on the uplink slot.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationScheduleTask() {
+  UINT32 u32Cycle = 0;
+  UINT32 u32Start = 0;
+
+  CommMgrTask();
+
+  // No-op unless a beacon or a setting moved the slot.
+  if (!CommMgrGetReadingPhase(oApplication.poMoistSensorMgr->u16PollingDuration, &u32Cycle, &u32Start)) {
+    u32Cycle = 0;
+  }
+  MoistSensorMgrSetPhase(oApplication.poMoistSensorMgr, u32Cycle, u32Start);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationReportBoot - Prints the boot timing on the serial port.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationReportBoot() {
+  UINT8 u8Stage = 0;
+
+  Serial.println(F("Boot timing (ms since power up):"));
+  for (u8Stage = 0; u8Stage < APP_SM_MAX; ++u8Stage) {
+    Serial.print(F("  "));
+    Serial.print(apszStageName[u8Stage]);
+    Serial.print(F(": "));
+    Serial.println(oApplication.au32StageDone[u8Stage]);
+  }
+
+  Serial.print(F("  config from flash: "));
+  Serial.println(oApplication.poConfigMgr->bFromFlash ? F("yes") : F("no (defaults)"));
+  Serial.print(F("  time to first reading: "));
+  Serial.println(oApplication.u32FirstReading);
+  Serial.print(F("  time to first uplink: "));
+  Serial.println(oApplication.u32FirstUplink);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationReportPerf - Prints the work budget statistics.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationReportPerf() {
+  const oWorkBudgetStatsTy* poStats = WorkBudgetGetStats();
+
+  Serial.print(F("loop iterations: "));
+  Serial.println(poStats->u32Iterations);
+  Serial.print(F("longest stretch without yield (ms): "));
+  Serial.println(poStats->u32LongestStretch);
+  Serial.print(F("stretches over "));
+  Serial.print(WORKBUDGET_STRETCH_WARN);
+  Serial.print(F(" ms: "));
+  Serial.println(poStats->u32StretchWarnings);
+  Serial.print(F("slices / steps / overruns: "));
+  Serial.print(poStats->u32Slices);
+  Serial.print(F(" / "));
+  Serial.print(poStats->u32Steps);
+  Serial.print(F(" / "));
+  Serial.println(poStats->u32Overruns);
+  Serial.print(F("longest slice (ms): "));
+  Serial.println(poStats->u32LongestSlice);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationReportMem - Prints the heap, stack, static memory and
+///           buffer pool usage.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationReportMem() {
+  char  szLine[MEMSTATS_LINE_MAX];
+  UINT8 u8Line = 0;
+
+  while (MemStatsFormatLine(u8Line++, szLine, sizeof(szLine))) {
+    Serial.println(szLine);
+  }
+
+  u8Line = 0;
+  while (BufPoolFormatLine(u8Line++, szLine, sizeof(szLine))) {
+    Serial.println(szLine);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationReportIrrigation - Prints the irrigation state and statistics.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationReportIrrigation() {
+  poIrrigationMgrTy poIrr = oApplication.poIrrigationMgr;
+
+  Serial.print(F("mode / valve: "));
+  Serial.print(poIrr->u8Mode);
+  Serial.print(F(" / "));
+  Serial.println(poIrr->bOpen ? F("open") : F("closed"));
+  Serial.print(F("readings / openings: "));
+  Serial.print(poIrr->u32Readings);
+  Serial.print(F(" / "));
+  Serial.println(poIrr->u32Openings);
+  Serial.print(F("water today / total (mL): "));
+  Serial.print(poIrr->u32VolumeToday);
+  Serial.print(F(" / "));
+  Serial.println(poIrr->u32VolumeTotal);
+  Serial.print(F("refused min-off / cap / fault: "));
+  Serial.print(poIrr->u32BlockedMinOff);
+  Serial.print(F(" / "));
+  Serial.print(poIrr->u32BlockedCap);
+  Serial.print(F(" / "));
+  Serial.println(poIrr->u32BlockedFault);
+  Serial.print(F("max-on cutoffs / stale closings: "));
+  Serial.print(poIrr->u32MaxOnCutoffs);
+  Serial.print(F(" / "));
+  Serial.println(poIrr->u32StaleCloses);
+  Serial.print(F("actuation latency last / max (us): "));
+  Serial.print(poIrr->u32LatencyLast);
+  Serial.print(F(" / "));
+  Serial.print(poIrr->u32LatencyMax);
+  Serial.print(F(", over "));
+  Serial.print(IRRIGATIONMGR_LATENCY_BUDGET);
+  Serial.print(F(" us: "));
+  Serial.println(poIrr->u32LatencyOverruns);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationReportSchedule - Prints the uplink schedule.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationReportSchedule() {
+  const oCommSchedTy* poSched = CommMgrGetSchedule();
+
+  Serial.print(F("mode: "));
+  Serial.println(CommSchedHasSlot(poSched) ? F("slotted")
+    : ((poSched->u8Mode == COMMSCHED_MODE_SLOTTED) ? F("slotted, free until the gateway assigns the slot") : F("free")));
+  Serial.print(F("slot / count / cycle (ms): "));
+  Serial.print(poSched->u16Slot);
+  Serial.print(F(" / "));
+  Serial.print(poSched->u16SlotCount);
+  Serial.print(F(" / "));
+  Serial.println(poSched->u32Cycle);
+  Serial.print(F("slot from: "));
+  Serial.println(poSched->bAssigned ? F("gateway") : ((poSched->u16SlotConfig == COMMSCHED_SLOT_AUTO) ? F("node ID") : F("configuration")));
+  Serial.print(F("beacons applied / last correction (ms): "));
+  Serial.print(poSched->u32Syncs);
+  Serial.print(F(" / "));
+  Serial.println(poSched->i32LastCorrection);
+  Serial.print(F("next slot in (ms): "));
+  Serial.println(CommSchedTimeToSlot(poSched, SystemTimeGetTime()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationTraceWrite - Sends a trace line on the serial port.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationTraceWrite(const char* pszLine) {
+  Serial.print(pszLine);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationCaptureWrite - Sends capture frame bytes on the serial
+///           port, never more than the transmit FIFO takes right now.
+///
+/// \return   Number of bytes taken.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 ApplicationCaptureWrite(const UINT8* pu8Data, UINT32 u32Size) {
+  UINT32 u32Room = Serial.availableForWrite();
+
+  if (u32Size > u32Room) {
+    u32Size = u32Room;
+  }
+
+  return u32Size ? Serial.write(pu8Data, u32Size) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationReportCapture - Prints the statistics of the last capture.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationReportCapture() {
+  const oAdcCaptureStatsTy* poStats = AdcCaptureGetStats();
+  UINT32 u32Elapsed = SystemTimeGetTimeDiff(poStats->u32StartTime);
+
+  Serial.print(F("bursts: "));
+  Serial.println(poStats->u32Bursts);
+  Serial.print(F("frames sent: "));
+  Serial.print(poStats->u32Frames);
+  Serial.print(F(", dropped: "));
+  Serial.println(poStats->u32Dropped);
+  Serial.print(F("burst rate (samples/s) min/last/max: "));
+  Serial.print(poStats->u32MinRate);
+  Serial.print('/');
+  Serial.print(poStats->u32LastRate);
+  Serial.print('/');
+  Serial.println(poStats->u32MaxRate);
+  Serial.print(F("delivered (samples/s): "));
+  Serial.println(u32Elapsed ? (UINT32)((UINT64)poStats->u32SamplesSent * 1000 / u32Elapsed) : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationReportLang - Prints the languages and where the
+///           language packs go.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationReportLang() {
+  const char* pszCode = NULL;
+  UINT32 u32Addr = 0;
+  UINT32 u32Size = 0;
+  UINT8 u8Lang = 0;
+
+  Serial.print(F("languages:"));
+  for (u8Lang = 0; u8Lang < STRINGTABLE_LANG_MAX; ++u8Lang) {
+    pszCode = StringTableGetLangCode((StringTableLangTy)u8Lang);
+    if (!pszCode) {
+      break;
+    }
+    Serial.print(' ');
+    Serial.print(pszCode);
+    if (u8Lang == StringTableGetLang()) {
+      Serial.print('*');
+    }
+  }
+  Serial.println();
+
+  if (FlashMgrGetPartition(FLASHMGR_PART_LANG, &u32Addr, &u32Size)) {
+    Serial.print(F("pack partition (offset / size): 0x"));
+    Serial.print(u32Addr, HEX);
+    Serial.print(F(" / "));
+    Serial.println(u32Size);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief    ApplicationConsoleTask - Reads the serial console, one line at a time.
+/// \details  Commands:
+///             set <key> <value>   Change a setting (see ConfigMgrSetValue).
+///             save                Write the configuration to flash.
+///             cal <percent>       Capture a calibration point with the raw
+///                                 average of the last reading, published or
+///                                 not (probe in a reference medium).
+///             cal clear           Remove all the calibration points.
+///             ota [port]          Fetch a firmware update from the gateway
+///                                 (resumes an interrupted one).
+///             perf [reset]        Print (or clear) the work budget statistics.
+///             mem                 Print the heap, the stack high-water marks,
+///                                 the static footprint of each module and
+///                                 the buffer pool occupancy and failures.
+///             trace on|off        Record the sensor inputs and results on the
+///                                 serial port, for tools/replay. Restarts the
+///                                 sensor state machine.
+///             capture on [baud]   Stream raw ADC bursts (see AdcCapture) for
+///                                 tools/adcrecv, at another speed if given.
+///                                 Pauses the readings.
+///             capture off         Back to the readings and the console speed,
+///                                 then print the capture statistics.
+///             irrig               Print the irrigation state and statistics.
+///             slot                Print the uplink schedule.
+///             lang [code]         Language of the web dashboard labels: en,
+///                                 fr or a language pack (see StringTable).
+///                                 Without code, list the languages.
+///             clock set|jump|rate <n>
+///                                 Soak builds (SYSTEMTIME_VIRTUAL_CLOCK) only:
+///                                 set the system time, jump it forward, or
+///                                 run it n times faster.
+///           Settings and calibration take effect immediately for the
+///           sensor, the irrigation and the uplink schedule; WiFi settings
+///           at the next boot.
+////////////////////////////////////////////////////////////////////////////////
+void ApplicationConsoleTask() {
+  int iChar = 0;
+
+  while ((iChar = Serial.read()) >= 0) {
+    if ((iChar == '\n') || (iChar == '\r')) {
+      if (oApplication.u8LineLen) {
+        oApplication.szLine[oApplication.u8LineLen] = '\0';
+        ApplicationConsoleExecute(oApplication.szLine);
+        oApplication.u8LineLen = 0;
+      }
+    }
+    else if (oApplication.u8LineLen < APP_CONSOLE_LINE_MAX) {
+      oApplication.szLine[oApplication.u8LineLen++] = (char)iChar;
+    }
+  }
+}
+
+void ApplicationConsoleExecute(char* pszLine) {
+  bool  bRet    = false;
+  bool  bIrrig  = false;
+  char* pszCmd  = strtok(pszLine, " ");
+  char* pszArg1 = strtok(NULL, " ");
+  char* pszArg2 = strtok(NULL, "");
+
+  // The sensor must be up for anything else than the configuration.
+  if (!pszCmd || !oApplication.poConfigMgr) goto END;
+
+  if (!strcmp(pszCmd, "set") && pszArg1 && pszArg2) {
+    bRet = ConfigMgrSetValue(oApplication.poConfigMgr, pszArg1, pszArg2);
+    bIrrig = bRet && !strncmp(pszArg1, "irr_", 4);
+
+    // New dry and wet ends: a recalibration in raw values.
+    if (bRet && !strncmp(pszArg1, "map_", 4)) {
+      SensorHealthRebase();
+    }
+  }
+  else if (!strcmp(pszCmd, "save")) {
+    bRet = ConfigMgrSave(oApplication.poConfigMgr);
+  }
+  else if (!strcmp(pszCmd, "cal") && pszArg1 && oApplication.poMoistSensorMgr) {
+    oCalibCurveTy* poCurve = &oApplication.poConfigMgr->oData.aoCalib[oApplication.poMoistSensorMgr->u8ProbeId];
+
+    if (!strcmp(pszArg1, "clear")) {
+      bRet = CalibMgrClear(poCurve);
+    }
+    else if (oApplication.poMoistSensorMgr->u16ReadingValueRaw) {
+      // Not the last result: the deadband may hold it for hours.
+      bRet = CalibMgrCapturePoint(poCurve, (UINT8)atoi(pszArg1), oApplication.poMoistSensorMgr->u16ReadingValueRaw);
+    }
+
+    // The probe was just checked against the soil: its drift starts over.
+    if (bRet) {
+      SensorHealthRebase();
+    }
+  }
+  else if (!strcmp(pszCmd, "perf")) {
+    if (pszArg1 && !strcmp(pszArg1, "reset")) {
+      WorkBudgetResetStats();
+    }
+    else {
+      ApplicationReportPerf();
+    }
+    bRet = true;
+    goto END;
+  }
+  else if (!strcmp(pszCmd, "mem")) {
+    ApplicationReportMem();
+    bRet = true;
+    goto END;
+  }
+  else if (!strcmp(pszCmd, "trace") && pszArg1) {
+    if (!strcmp(pszArg1, "on")) {
+      bRet = TraceMgrStart(ApplicationTraceWrite);
+
+      // Not up yet: recorded when the boot configures it.
+      if (bRet && oApplication.poMoistSensorMgr && oApplication.poMoistSensorMgr->bIsConfigured) {
+        bRet = MoistSensorMgrConfigure(oApplication.poMoistSensorMgr);
+      }
+    }
+    else if (!strcmp(pszArg1, "off")) {
+      TraceMgrStop();
+      bRet = true;
+    }
+    goto END;
+  }
+  else if (!strcmp(pszCmd, "capture") && pszArg1 && oApplication.poMoistSensorMgr) {
+    if (!strcmp(pszArg1, "on") && !AdcCaptureIsActive()) {
+      // Acknowledged at the console speed, the frames follow.
+      Serial.println(F("OK"));
+      Serial.flush();
+      if (pszArg2) {
+        Serial.begin(strtoul(pszArg2, NULL, 0));
+      }
+      AdcCaptureStart(A0, oApplication.poMoistSensorMgr->u8Pin, ApplicationCaptureWrite);
+      return;
+    }
+    else if (!strcmp(pszArg1, "off") && AdcCaptureIsActive()) {
+      AdcCaptureStop();
+      Serial.flush();
+      Serial.begin(APP_SERIAL_BAUDRATE);
+      Serial.println();
+      ApplicationReportCapture();
+
+      // From a known state, like after a trace start.
+      bRet = MoistSensorMgrConfigure(oApplication.poMoistSensorMgr);
+    }
+    goto END;
+  }
+  else if (!strcmp(pszCmd, "irrig") && oApplication.poIrrigationMgr) {
+    ApplicationReportIrrigation();
+    bRet = true;
+    goto END;
+  }
+  else if (!strcmp(pszCmd, "slot") && (oApplication.eState > APP_SM_BOOT_COMM)) {
+    ApplicationReportSchedule();
+    bRet = true;
+    goto END;
+  }
+  else if (!strcmp(pszCmd, "lang")) {
+    StringTableLangTy eLang = STRINGTABLE_LANG_EN;
+
+    if (!pszArg1) {
+      ApplicationReportLang();
+      bRet = true;
+    }
+    else {
+      bRet = StringTableFindLang(pszArg1, &eLang) && StringTableSetLang(eLang);
+    }
+    goto END;
+  }
+#ifdef SYSTEMTIME_VIRTUAL_CLOCK
+  else if (!strcmp(pszCmd, "clock") && pszArg1 && pszArg2) {
+    bRet = true;
+    if (!strcmp(pszArg1, "set"))        SystemTimeVirtualSet(strtoul(pszArg2, NULL, 0));
+    else if (!strcmp(pszArg1, "jump"))  SystemTimeVirtualAdvance(strtoul(pszArg2, NULL, 0));
+    else if (!strcmp(pszArg1, "rate"))  SystemTimeVirtualSetRate((UINT16)atoi(pszArg2));
+    else                                bRet = false;
+    goto END;
+  }
+#endif
+  else if (!strcmp(pszCmd, "ota") && (oApplication.eState > APP_SM_BOOT_COMM)) {
+    // Needs a unicast gateway address, see "set gw_ip".
+    if (oApplication.poConfigMgr->oData.u32GatewayIp != COMM_GATEWAY_IP) {
+      bRet = OtaClientStart(oApplication.poConfigMgr->oData.u32GatewayIp, pszArg1 ? (UINT16)atoi(pszArg1) : OTAMGR_PORT);
+    }
+    goto END;
+  }
+
+  if (bRet && oApplication.poMoistSensorMgr) {
+    bRet = ConfigMgrApplySensor(oApplication.poConfigMgr, oApplication.poMoistSensorMgr);
+
+    if (bRet) {
+      TraceMgrSettings(SystemTimeGetTime(), oApplication.poMoistSensorMgr);
+    }
+  }
+
+  // Only on its own settings: a new configuration clears the PI error sum.
+  if (bRet && bIrrig && oApplication.poIrrigationMgr) {
+    bRet = ConfigMgrApplyIrrigation(oApplication.poConfigMgr, oApplication.poIrrigationMgr)
+        && IrrigationMgrConfigure(oApplication.poIrrigationMgr);
+  }
+
+  if (bRet && (oApplication.eState > APP_SM_BOOT_COMM)) {
+    bRet = CommMgrConfigure();
+  }
+
+END:
+  Serial.println(bRet ? F("OK") : F("ERROR"));
 }
@@ -0,0 +1,462 @@
+///
+/// \file     adcrecv.c
+/// \brief    Receiver of the raw ADC capture stream (Linux)
+/// \details  Reads the AdcFrame frames sent by a node in capture mode (see
+///           AdcCapture.h) from its serial port, checks them and writes the
+///           samples to disk. Console text in the stream is skipped.
+///
+///           Output: CSV "sequence,time_us,raw", one line per sample, the
+///           time being the node time of the sample (burst start plus its
+///           share of the burst duration); comment lines mark the probe
+///           power on and the missing frames. -r writes the bare samples
+///           instead (little endian 16 bits).
+///
+///           Every second, and at the end, prints on stderr the sample rate
+///           within the bursts, the rate actually delivered, and the frames
+///           lost: dropped by the node (output too slow) or lost on the
+///           link (CRC errors, overruns).
+///
+///           Build:
+///             gcc -O2 -Itools/host -I. -o adcrecv tools/adcrecv/adcrecv.c
+///                 AdcFrame.c Crc.c
+///
+///           Examples:
+///             ./adcrecv -d /dev/ttyUSB0 -s -b 921600 -t 60 -o probe.csv
+///                                       (starts and stops the capture)
+///             ./adcrecv -i capture.bin  (stream recorded beforehand)
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AdcFrame.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define RX_DEFAULT_DEVICE       "/dev/ttyUSB0"
+#define RX_DEFAULT_OUTPUT       "capture.csv"
+#define RX_CONSOLE_BAUDRATE     115200      ///< APP_SERIAL_BAUDRATE of the node.
+#define RX_BUFFER_SIZE          65536
+#define RX_POLL_MS              200
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oRxStatsTy
+/// \brief 	Counters, since the start or since the last print.
+///
+typedef struct
+{
+	UINT64		u64Frames;
+	UINT64		u64Samples;
+	UINT64		u64BurstUs;				///< Sum of the burst durations.
+	UINT64		u64NodeDropped;			///< Frames dropped by the node.
+	UINT64		u64LinkLost;			///< Frames missing, not dropped by the node.
+	UINT64		u64Bad;					///< Candidate frames that failed the checks.
+	UINT64		u64Skipped;				///< Bytes outside of the frames.
+} oRxStatsTy;
+
+///
+/// \struct	oRxTy
+/// \brief 	Receiver.
+///
+typedef struct
+{
+	int			iFd;
+	bool		bDevice;				///< iFd is a serial port.
+	FILE*		pfOut;
+	bool		bRaw;
+	bool		bHaveLast;
+	UINT16		u16LastSeq;
+	UINT32		u32LastDropped;
+	oRxStatsTy	oTotal;
+	oRxStatsTy	oPeriod;
+	UINT8		au8Buf[RX_BUFFER_SIZE];
+	UINT32		u32Len;
+} oRxTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool RxOpenSerial(oRxTy* poRx, const char* pszDevice, UINT32 u32Baud);
+static bool RxSetBaud(int iFd, UINT32 u32Baud);
+static void RxSendCommand(oRxTy* poRx, const char* pszCommand);
+static void RxScan(oRxTy* poRx);
+static void RxFrame(oRxTy* poRx, const UINT8* pu8Frame, const oAdcFrameTy* poFrame);
+static void RxPrint(const char* pszWhat, const oRxStatsTy* poStats, double dSeconds);
+static double RxNow();
+static void RxOnSignal(int iSignal);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oRxTy oRx;
+static volatile sig_atomic_t bStop = 0;
+
+
+int main(int argc, char** argv)
+{
+	const char*		pszDevice	= RX_DEFAULT_DEVICE;
+	const char*		pszInput	= NULL;
+	const char*		pszOutput	= RX_DEFAULT_OUTPUT;
+	UINT32			u32Baud		= RX_CONSOLE_BAUDRATE;
+	UINT32			u32Seconds	= 0;
+	bool			bControl	= FALSE;
+	char			szCommand[32];
+	struct pollfd	oPoll;
+	ssize_t			iRead		= 0;
+	double			dStart		= 0;
+	double			dLastPrint	= 0;
+	double			dNow		= 0;
+	int				iOpt		= 0;
+
+	while ((iOpt = getopt(argc, argv, "d:i:b:o:rst:h")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'd': pszDevice		= optarg; break;
+		case 'i': pszInput		= optarg; break;
+		case 'b': u32Baud		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'o': pszOutput		= optarg; break;
+		case 'r': oRx.bRaw		= TRUE; break;
+		case 's': bControl		= TRUE; break;
+		case 't': u32Seconds	= (UINT32)strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "Usage: %s [-d device] [-b baud] [-s] [-t seconds] [-o output] [-r]\n", argv[0]);
+			fprintf(stderr, "       %s -i recorded_stream [-o output] [-r]\n", argv[0]);
+			fprintf(stderr, "  -s  send \"capture on\" first and \"capture off\" at the end\n");
+			return 1;
+		}
+	}
+
+	if (pszInput)
+	{
+		oRx.iFd = open(pszInput, O_RDONLY);
+		if (oRx.iFd < 0)
+		{
+			perror(pszInput);
+			return 1;
+		}
+	}
+	else
+	{
+		// The command goes at the console speed, the frames come at the
+		// capture one.
+		if (!RxOpenSerial(&oRx, pszDevice, bControl ? RX_CONSOLE_BAUDRATE : u32Baud))
+		{
+			return 1;
+		}
+
+		if (bControl)
+		{
+			if (u32Baud != RX_CONSOLE_BAUDRATE)
+			{
+				snprintf(szCommand, sizeof(szCommand), "capture on %u", u32Baud);
+			}
+			else
+			{
+				snprintf(szCommand, sizeof(szCommand), "capture on");
+			}
+			RxSendCommand(&oRx, szCommand);
+			tcdrain(oRx.iFd);
+			usleep(50000);
+			if (!RxSetBaud(oRx.iFd, u32Baud))
+			{
+				return 1;
+			}
+		}
+	}
+
+	oRx.pfOut = fopen(pszOutput, oRx.bRaw ? "wb" : "w");
+	if (!oRx.pfOut)
+	{
+		perror(pszOutput);
+		return 1;
+	}
+	if (!oRx.bRaw)
+	{
+		fprintf(oRx.pfOut, "sequence,time_us,raw\n");
+	}
+
+	signal(SIGINT, RxOnSignal);
+	signal(SIGTERM, RxOnSignal);
+
+	oPoll.fd		= oRx.iFd;
+	oPoll.events	= POLLIN;
+	dStart			= RxNow();
+	dLastPrint		= dStart;
+
+	while (!bStop)
+	{
+		if (oRx.bDevice && (poll(&oPoll, 1, RX_POLL_MS) < 0) && (errno != EINTR))
+		{
+			perror("poll");
+			break;
+		}
+
+		iRead = read(oRx.iFd, &oRx.au8Buf[oRx.u32Len], RX_BUFFER_SIZE - oRx.u32Len);
+		if (iRead > 0)
+		{
+			oRx.u32Len += (UINT32)iRead;
+			RxScan(&oRx);
+		}
+		else if (!oRx.bDevice && (iRead == 0))
+		{
+			break;
+		}
+		else if ((iRead < 0) && (errno != EINTR) && (errno != EAGAIN))
+		{
+			perror("read");
+			break;
+		}
+
+		dNow = RxNow();
+		if (oRx.bDevice && (dNow - dLastPrint >= 1.0))
+		{
+			RxPrint("last second", &oRx.oPeriod, dNow - dLastPrint);
+			memset(&oRx.oPeriod, 0, sizeof(oRx.oPeriod));
+			dLastPrint = dNow;
+		}
+
+		if (u32Seconds && (dNow - dStart >= u32Seconds))
+		{
+			break;
+		}
+	}
+
+	if (oRx.bDevice && bControl)
+	{
+		RxSendCommand(&oRx, "capture off");
+	}
+
+	oRx.oTotal.u64Skipped += oRx.u32Len;
+	RxPrint("total", &oRx.oTotal, oRx.bDevice ? RxNow() - dStart : 0);
+
+	fclose(oRx.pfOut);
+	close(oRx.iFd);
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool RxOpenSerial(oRxTy* poRx, const char* pszDevice, UINT32 u32Baud)
+{
+	struct termios oTio;
+
+	poRx->iFd = open(pszDevice, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (poRx->iFd < 0)
+	{
+		perror(pszDevice);
+		return FALSE;
+	}
+	poRx->bDevice = TRUE;
+
+	if (tcgetattr(poRx->iFd, &oTio) < 0)
+	{
+		perror("tcgetattr");
+		return FALSE;
+	}
+
+	cfmakeraw(&oTio);
+	oTio.c_cflag |= CLOCAL | CREAD;
+	oTio.c_cflag &= ~CRTSCTS;
+	if (tcsetattr(poRx->iFd, TCSANOW, &oTio) < 0)
+	{
+		perror("tcsetattr");
+		return FALSE;
+	}
+
+	return RxSetBaud(poRx->iFd, u32Baud);
+}
+
+static bool RxSetBaud(int iFd, UINT32 u32Baud)
+{
+	static const struct { UINT32 u32Baud; speed_t tSpeed; } aoSpeeds[] =
+	{
+		{9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600},
+		{115200, B115200}, {230400, B230400}, {460800, B460800}, {500000, B500000},
+		{576000, B576000}, {921600, B921600}, {1000000, B1000000}, {1500000, B1500000},
+		{2000000, B2000000}, {3000000, B3000000},
+	};
+	struct termios	oTio;
+	UINT32			u32Idx = 0;
+
+	for (u32Idx = 0; u32Idx < sizeof(aoSpeeds) / sizeof(aoSpeeds[0]); ++u32Idx)
+	{
+		if (aoSpeeds[u32Idx].u32Baud == u32Baud)
+		{
+			break;
+		}
+	}
+
+	if ((u32Idx == sizeof(aoSpeeds) / sizeof(aoSpeeds[0])) || (tcgetattr(iFd, &oTio) < 0))
+	{
+		fprintf(stderr, "Unsupported speed: %u\n", u32Baud);
+		return FALSE;
+	}
+
+	cfsetispeed(&oTio, aoSpeeds[u32Idx].tSpeed);
+	cfsetospeed(&oTio, aoSpeeds[u32Idx].tSpeed);
+
+	return tcsetattr(iFd, TCSADRAIN, &oTio) == 0;
+}
+
+static void RxSendCommand(oRxTy* poRx, const char* pszCommand)
+{
+	if ((write(poRx->iFd, pszCommand, strlen(pszCommand)) < 0) || (write(poRx->iFd, "\n", 1) < 0))
+	{
+		perror("write");
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		RxScan - Extracts the frames from the received bytes.
+/// \details	Keeps an incomplete frame at the start of the buffer for the
+///				next read.
+////////////////////////////////////////////////////////////////////////////////
+static void RxScan(oRxTy* poRx)
+{
+	oAdcFrameTy			oFrame;
+	AdcFrameResultTy	eResult		= ADCFRAME_INVALID;
+	UINT32				u32Pos		= 0;
+	UINT32				u32Size		= 0;
+
+	while (u32Pos < poRx->u32Len)
+	{
+		eResult = AdcFrameDecode(&poRx->au8Buf[u32Pos], poRx->u32Len - u32Pos, &oFrame, &u32Size);
+
+		if (eResult == ADCFRAME_OK)
+		{
+			RxFrame(poRx, &poRx->au8Buf[u32Pos], &oFrame);
+			u32Pos += u32Size;
+		}
+		else if (eResult == ADCFRAME_INCOMPLETE)
+		{
+			break;
+		}
+		else
+		{
+			// Only a header that passed the first checks counts as a bad frame.
+			if ((poRx->u32Len - u32Pos >= ADCFRAME_HEADER_SIZE)
+				&& (poRx->au8Buf[u32Pos] == (UINT8)ADCFRAME_MAGIC) && (poRx->au8Buf[u32Pos + 1] == (UINT8)(ADCFRAME_MAGIC >> 8))
+				&& (poRx->au8Buf[u32Pos + 2] == ADCFRAME_VERSION))
+			{
+				++poRx->oTotal.u64Bad;
+				++poRx->oPeriod.u64Bad;
+			}
+			++poRx->oTotal.u64Skipped;
+			++poRx->oPeriod.u64Skipped;
+			++u32Pos;
+		}
+	}
+
+	memmove(poRx->au8Buf, &poRx->au8Buf[u32Pos], poRx->u32Len - u32Pos);
+	poRx->u32Len -= u32Pos;
+}
+
+static void RxFrame(oRxTy* poRx, const UINT8* pu8Frame, const oAdcFrameTy* poFrame)
+{
+	UINT16	u16Idx		= 0;
+	UINT16	u16Sample	= 0;
+	UINT32	u32Gap		= 0;
+	UINT32	u32Dropped	= 0;
+
+	if (poRx->bHaveLast)
+	{
+		u32Gap		= (UINT16)(poFrame->u16Sequence - poRx->u16LastSeq - 1);
+		u32Dropped	= poFrame->u32Dropped - poRx->u32LastDropped;
+		if (u32Dropped > u32Gap)
+		{
+			u32Dropped = u32Gap;
+		}
+
+		poRx->oTotal.u64NodeDropped	+= u32Dropped;
+		poRx->oPeriod.u64NodeDropped	+= u32Dropped;
+		poRx->oTotal.u64LinkLost	+= u32Gap - u32Dropped;
+		poRx->oPeriod.u64LinkLost	+= u32Gap - u32Dropped;
+
+		if (u32Gap && !poRx->bRaw)
+		{
+			fprintf(poRx->pfOut, "# %u frames missing, %u dropped by the node\n", u32Gap, u32Dropped);
+		}
+	}
+	poRx->bHaveLast			= TRUE;
+	poRx->u16LastSeq		= poFrame->u16Sequence;
+	poRx->u32LastDropped	= poFrame->u32Dropped;
+
+	if ((poFrame->u8Flags & ADCFRAME_FLAG_POWER_ON) && !poRx->bRaw)
+	{
+		fprintf(poRx->pfOut, "# probe power on\n");
+	}
+
+	for (u16Idx = 0; u16Idx < poFrame->u16Count; ++u16Idx)
+	{
+		u16Sample = AdcFrameGetSample(pu8Frame, u16Idx);
+
+		if (poRx->bRaw)
+		{
+			fputc(u16Sample & 0xFF, poRx->pfOut);
+			fputc(u16Sample >> 8, poRx->pfOut);
+		}
+		else
+		{
+			fprintf(poRx->pfOut, "%u,%u,%u\n", poFrame->u16Sequence,
+				poFrame->u32Start + (UINT32)((UINT64)poFrame->u32Duration * u16Idx / poFrame->u16Count), u16Sample);
+		}
+	}
+
+	++poRx->oTotal.u64Frames;
+	++poRx->oPeriod.u64Frames;
+	poRx->oTotal.u64Samples		+= poFrame->u16Count;
+	poRx->oPeriod.u64Samples	+= poFrame->u16Count;
+	poRx->oTotal.u64BurstUs		+= poFrame->u32Duration;
+	poRx->oPeriod.u64BurstUs	+= poFrame->u32Duration;
+}
+
+static void RxPrint(const char* pszWhat, const oRxStatsTy* poStats, double dSeconds)
+{
+	fprintf(stderr, "%s: %llu frames, %llu samples, burst rate %.0f samples/s",
+		pszWhat, (unsigned long long)poStats->u64Frames, (unsigned long long)poStats->u64Samples,
+		poStats->u64BurstUs ? poStats->u64Samples * 1e6 / poStats->u64BurstUs : 0.0);
+	if (dSeconds > 0)
+	{
+		fprintf(stderr, ", delivered %.0f samples/s", poStats->u64Samples / dSeconds);
+	}
+	fprintf(stderr, ", frames dropped by the node %llu, lost on the link %llu, bad %llu, other bytes %llu\n",
+		(unsigned long long)poStats->u64NodeDropped, (unsigned long long)poStats->u64LinkLost,
+		(unsigned long long)poStats->u64Bad, (unsigned long long)poStats->u64Skipped);
+}
+
+static double RxNow()
+{
+	struct timespec oTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &oTs);
+	return oTs.tv_sec + oTs.tv_nsec * 1e-9;
+}
+
+static void RxOnSignal(int iSignal)
+{
+	(void)iSignal;
+	bStop = 1;
+}
@@ -0,0 +1,130 @@
+///
+/// \file     cfgcheck.c
+/// \brief    Console settings accepted and refused by ConfigMgr (Linux)
+/// \details  Plays "set <key> <value>" commands, as typed on the console,
+///           against ConfigMgrSetValue() and checks that each one is
+///           accepted or refused as expected. A refused setting must leave
+///           the configuration as it was. Each case starts from the
+///           defaults.
+///
+///           Cases:
+///           - samples per reading (duration / polling): up to
+///             CONFIGMGR_SAMPLES_MAX, where the sum of their squares still
+///             fits in 32 bits, not one more;
+///           - numbers: signs, garbage and values out of the field range.
+///
+///           Build:
+///             gcc -O2 -Itools/host -I. -o cfgcheck tools/cfgcheck/cfgcheck.c
+///                 tools/host/HostArduino.c ConfigMgr.c FlashMgr.c Crc.c
+///                 CalibMgr.c SystemTime.c
+///
+///           Usage: ./cfgcheck
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <string.h>
+
+#include "ConfigMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oCfgStepTy
+/// \brief 	One console setting and its expected outcome. A NULL key starts
+///			a new case from the defaults.
+///
+typedef struct
+{
+	const char*	pszKey;
+	const char*	pszValue;
+	bool		bAccepted;
+} oCfgStepTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static const oCfgStepTy aoCfgSteps[] =
+{
+	// 10 ms polling: 4096 samples fill the sum of squares, 4097 overflow it.
+	{ NULL,				NULL,			FALSE },
+	{ "polling",		"10",			TRUE },
+	{ "duration",		"40960",		TRUE },
+	{ "duration",		"40970",		FALSE },
+	{ "duration",		"65535",		FALSE },
+
+	// Same bound reached by shortening the polling.
+	{ NULL,				NULL,			FALSE },
+	{ "duration",		"65535",		TRUE },
+	{ "polling",		"16",			TRUE },
+	{ "polling",		"15",			FALSE },
+
+	// Numbers.
+	{ NULL,				NULL,			FALSE },
+	{ "heartbeat",		"-1",			FALSE },
+	{ "heartbeat",		"4294967296",	FALSE },
+	{ "heartbeat",		"4294967295",	TRUE },
+	{ "polling",		"12abc",		FALSE },
+	{ "polling",		"65536",		FALSE },
+	{ "deadband",		"256",			FALSE },
+	{ "polling",		"",				FALSE },
+};
+
+
+int main()
+{
+	poConfigMgrTy		poConfig	= ConfigMgr();
+	oConfigMgrDataTy	oBefore;
+	const oCfgStepTy*	poStep		= NULL;
+	UINT16				u16Idx		= 0;
+	UINT16				u16Failed	= 0;
+	bool				bAccepted	= FALSE;
+
+	if (!poConfig || !ConfigMgrLoad(poConfig))
+	{
+		fprintf(stderr, "Configuration load failed\n");
+		return 1;
+	}
+
+	for (u16Idx = 0; u16Idx < sizeof(aoCfgSteps) / sizeof(aoCfgSteps[0]); ++u16Idx)
+	{
+		poStep = &aoCfgSteps[u16Idx];
+
+		if (!poStep->pszKey)
+		{
+			ConfigMgrSetDefaults(poConfig);
+			printf("defaults\n");
+			continue;
+		}
+
+		oBefore		= poConfig->oData;
+		bAccepted	= ConfigMgrSetValue(poConfig, poStep->pszKey, poStep->pszValue);
+
+		printf("  set %-10s %-12s %-8s", poStep->pszKey, poStep->pszValue, bAccepted ? "OK" : "ERROR");
+
+		if (bAccepted != poStep->bAccepted)
+		{
+			printf(" FAILED, expected %s\n", poStep->bAccepted ? "OK" : "ERROR");
+			++u16Failed;
+		}
+		else if (!bAccepted && memcmp(&oBefore, &poConfig->oData, sizeof(oBefore)))
+		{
+			printf(" FAILED, configuration changed\n");
+			++u16Failed;
+		}
+		else
+		{
+			printf(" ok\n");
+		}
+	}
+
+	printf("%u failed\n", u16Failed);
+
+	return u16Failed ? 1 : 0;
+}
@@ -0,0 +1,226 @@
+///
+/// \file     codecbench.c
+/// \brief    SeriesCodec benchmark (Linux)
+/// \details  Encodes synthetic moisture series into fixed size blocks,
+///           checks that every block decodes back to the input and prints
+///           the compression ratio and the encode/decode time per sample.
+///           The uncompressed reference is 7 bytes per sample (32 bits time
+///           stamp, 16 bits raw value, 8 bits mapped value).
+///
+///           Build:
+///             gcc -O2 -Itools/host -I. -o codecbench
+///                 tools/codecbench/codecbench.c SeriesCodec.c
+///
+///           Usage: ./codecbench [samples] [block size]
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SeriesCodec.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define BENCH_RAW_SAMPLE_SIZE   7       ///< Bytes per sample without compression.
+#define BENCH_MAP_MAX           1024
+#define BENCH_MAP_MIN           350
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+	UINT32	u32Timestamp;
+	UINT16	u16Raw;
+	UINT8	u8Value;
+} oBenchSampleTy;
+
+typedef enum
+{
+	BENCH_SERIES_FIXED = 0,		///< Fixed 15 s interval, slow drying, a watering per day.
+	BENCH_SERIES_ADAPTIVE,		///< Adaptive interval (15 s .. 15 min) with the same soil.
+	BENCH_SERIES_NOISY,			///< Fixed interval, jittered time stamps, noisy ADC.
+
+	BENCH_SERIES_MAX
+} BenchSeriesTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static const char* apszSeriesName[BENCH_SERIES_MAX] = { "fixed 15 s", "adaptive", "noisy + jitter" };
+static UINT32 u32Random = 1;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static UINT32 BenchRand()
+{
+	u32Random = u32Random * 1103515245 + 12345;
+	return u32Random >> 8;
+}
+
+static double BenchNow()
+{
+	struct timespec oTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &oTs);
+	return oTs.tv_sec + oTs.tv_nsec / 1e9;
+}
+
+static UINT8 BenchMap(UINT16 u16Raw)
+{
+	INT32 i32Value = ((INT32)u16Raw - BENCH_MAP_MAX) * 100 / (BENCH_MAP_MIN - BENCH_MAP_MAX);
+
+	return (UINT8)((i32Value < 0) ? 0 : (i32Value > 100) ? 100 : i32Value);
+}
+
+static void BenchGenerate(BenchSeriesTy eSeries, oBenchSampleTy* paoSamples, UINT32 u32Count)
+{
+	UINT32	u32Idx		= 0;
+	UINT32	u32Time		= 1000;
+	UINT32	u32Interval	= 15000;
+	double	dRaw		= 500.0;
+	double	dPrevRaw	= 500.0;
+	INT32	i32Noise	= 0;
+
+	for (u32Idx = 0; u32Idx < u32Count; ++u32Idx)
+	{
+		// Soil dries slowly (raw value rises), watered once a day.
+		dRaw += u32Interval * (400.0 / 86400000.0);
+		if ((u32Time / 86400000) != ((u32Time + u32Interval) / 86400000))
+		{
+			dRaw = 480.0;
+		}
+		if (dRaw > 1000.0) dRaw = 1000.0;
+
+		i32Noise = (eSeries == BENCH_SERIES_NOISY) ? (INT32)(BenchRand() % 7) - 3 : (INT32)(BenchRand() % 3) - 1;
+
+		paoSamples[u32Idx].u32Timestamp	= u32Time;
+		paoSamples[u32Idx].u16Raw		= (UINT16)(dRaw + i32Noise);
+		paoSamples[u32Idx].u8Value		= BenchMap(paoSamples[u32Idx].u16Raw);
+
+		if (eSeries == BENCH_SERIES_ADAPTIVE)
+		{
+			// Same rule as the sensor manager: double while stable.
+			u32Interval = (dRaw - dPrevRaw > 8.0 || dPrevRaw - dRaw > 8.0) ? 15000 : (u32Interval * 2 > 900000 ? 900000 : u32Interval * 2);
+		}
+		dPrevRaw = dRaw;
+
+		u32Time += u32Interval;
+		if (eSeries == BENCH_SERIES_NOISY)
+		{
+			u32Time += BenchRand() % 40;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	UINT32				u32Count		= (argc > 1) ? (UINT32)atoi(argv[1]) : 1000000;
+	UINT16				u16BlockSize	= (argc > 2) ? (UINT16)atoi(argv[2]) : 512;
+	oBenchSampleTy*		paoSamples		= malloc(u32Count * sizeof(oBenchSampleTy));
+	UINT8*				pu8Blocks		= malloc((size_t)u32Count * BENCH_RAW_SAMPLE_SIZE + u16BlockSize);
+	UINT16*				pu16BlockLen	= malloc(u32Count * sizeof(UINT16));
+	oSeriesEncoderTy	oEncoder;
+	oSeriesDecoderTy	oDecoder;
+	UINT32				u32Idx			= 0;
+	UINT32				u32Blocks		= 0;
+	UINT32				u32Block		= 0;
+	size_t				szUsed			= 0;
+	size_t				szOffset		= 0;
+	double				dStart			= 0;
+	double				dEncode			= 0;
+	double				dDecode			= 0;
+	int					iSeries			= 0;
+	bool				bOk				= TRUE;
+	UINT32				u32Ts;
+	UINT16				u16Raw;
+	UINT8				u8Value;
+
+	if (!paoSamples || !pu8Blocks || !pu16BlockLen || (u32Count == 0) || (u16BlockSize < 16))
+	{
+		fprintf(stderr, "Usage: %s [samples] [block size >= 16]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%u samples, %u byte blocks\n", u32Count, u16BlockSize);
+	printf("%-16s %10s %10s %8s %10s %12s %12s\n", "series", "raw", "encoded", "ratio", "bits/smp", "enc ns/smp", "dec ns/smp");
+
+	for (iSeries = 0; iSeries < BENCH_SERIES_MAX; ++iSeries)
+	{
+		u32Random = 1;
+		BenchGenerate((BenchSeriesTy)iSeries, paoSamples, u32Count);
+
+		// Encode: fill a block, start the next one when full.
+		dStart		= BenchNow();
+		szUsed		= 0;
+		u32Blocks	= 0;
+		SeriesEncoderInit(&oEncoder, pu8Blocks, u16BlockSize);
+
+		for (u32Idx = 0; u32Idx < u32Count; ++u32Idx)
+		{
+			if (!SeriesEncoderAppend(&oEncoder, paoSamples[u32Idx].u32Timestamp, paoSamples[u32Idx].u16Raw, paoSamples[u32Idx].u8Value))
+			{
+				pu16BlockLen[u32Blocks++]	= SeriesEncoderGetSize(&oEncoder);
+				szUsed						+= u16BlockSize;
+				SeriesEncoderInit(&oEncoder, &pu8Blocks[szUsed], u16BlockSize);
+				SeriesEncoderAppend(&oEncoder, paoSamples[u32Idx].u32Timestamp, paoSamples[u32Idx].u16Raw, paoSamples[u32Idx].u8Value);
+			}
+		}
+		pu16BlockLen[u32Blocks++] = SeriesEncoderGetSize(&oEncoder);
+		dEncode = BenchNow() - dStart;
+
+		// Decode and compare.
+		dStart		= BenchNow();
+		szOffset	= 0;
+		u32Idx		= 0;
+		szUsed		= 0;
+
+		for (u32Block = 0; u32Block < u32Blocks; ++u32Block)
+		{
+			SeriesDecoderInit(&oDecoder, &pu8Blocks[szOffset], pu16BlockLen[u32Block]);
+
+			while (SeriesDecoderNext(&oDecoder, &u32Ts, &u16Raw, &u8Value))
+			{
+				if ((u32Idx >= u32Count)
+					|| (u32Ts != paoSamples[u32Idx].u32Timestamp)
+					|| (u16Raw != paoSamples[u32Idx].u16Raw)
+					|| (u8Value != paoSamples[u32Idx].u8Value))
+				{
+					bOk = FALSE;
+				}
+				++u32Idx;
+			}
+
+			szUsed		+= pu16BlockLen[u32Block];
+			szOffset	+= u16BlockSize;
+		}
+		dDecode = BenchNow() - dStart;
+
+		if (u32Idx != u32Count)
+		{
+			bOk = FALSE;
+		}
+
+		printf("%-16s %10zu %10zu %7.1fx %10.2f %12.1f %12.1f\n",
+			apszSeriesName[iSeries],
+			(size_t)u32Count * BENCH_RAW_SAMPLE_SIZE, szUsed,
+			(double)u32Count * BENCH_RAW_SAMPLE_SIZE / szUsed,
+			szUsed * 8.0 / u32Count,
+			dEncode * 1e9 / u32Count, dDecode * 1e9 / u32Count);
+	}
+
+	printf("round trip: %s\n", bOk ? "OK" : "MISMATCH");
+
+	return bOk ? 0 : 1;
+}
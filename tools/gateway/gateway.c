@@ -0,0 +1,1241 @@
+///
+/// \file     gateway.c
+/// \brief    Telemetry ingest gateway (Linux)
+/// \details  Receives the UDP reports of the nodes (see CommReport.h),
+///           removes the retransmits and appends every reading to a per
+///           node time series.
+///
+///           Threads:
+///           - Receivers: one UDP socket each (SO_REUSEPORT, so the kernel
+///             spreads the nodes across them), batch receive and decode.
+///           - Workers: one per core. Each worker owns a shard of the nodes
+///             (node ID hash) and its own queue, so the node state is never
+///             shared and needs no lock.
+///           - Load generator (optional): simulates N nodes on loopback.
+///           - Beacon (optional): broadcasts the reporting cycle to the
+///             nodes in slotted mode (see CommSched), with the slot
+///             assignments read from a file ("<node ID> <slot>" per line).
+///
+///           With -q, the workers also keep the readings in the query store
+///           (see tsquery.h) and the summary ends with an hourly query of
+///           the whole fleet. The store is bounded like the samples: the
+///           last -m raw points of each node (whole blocks), and the
+///           rollups for TSQ_LEVEL_RETENTION.
+///
+///           Build:
+///             gcc -O2 -pthread -Itools/host -I. -o gateway
+///                 tools/gateway/gateway.c tools/gateway/tsquery.c CommReport.c
+///
+///           Examples:
+///             ./gateway -p 4210 -o /var/lib/moisture
+///             ./gateway -n 50000 -i 1000 -t 10      (50k simulated nodes,
+///                                                    one report/s each)
+///             ./gateway -b 15000 -k 64 -a slots.txt (beacon every 15 s)
+///             ./gateway -n 1000 -i 1000 -t 60 -q    (query store)
+/// \author   Infinition - Nicolas Bourré
+///
+
+#define _GNU_SOURCE
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "CommMgr.h"
+#include "CommReport.h"
+#include "gateway.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define GW_DEFAULT_PORT         COMM_GATEWAY_PORT
+#define GW_QUEUE_SIZE           65536       ///< Reports per worker queue. Power of 2.
+#define GW_BATCH                64          ///< Datagrams per recvmmsg/sendmmsg and per queue operation.
+#define GW_DEDUP_WINDOW         64          ///< Out of order window for duplicate detection, in sequence numbers.
+#define GW_FLUSH_SAMPLES        256         ///< Unsaved samples of a node that trigger a write to its file.
+#define GW_SERIES_LIMIT         8192        ///< Default samples per node in memory (-m), about 200 kB.
+#define GW_RCVBUF               (8 * 1024 * 1024)
+#define GW_MAX_THREADS          64
+#define GW_BEACON_ASSIGN        8           ///< Slot assignments sent per cycle.
+#define GW_ASSIGN_MAX           4096        ///< Slot assignments read from the file.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oGwQueueTy
+/// \brief 	Bounded queue feeding one worker.
+///
+typedef struct
+{
+	pthread_mutex_t	oLock;
+	pthread_cond_t	oNotEmpty;
+	oCommReportTy*	paoItems;
+	UINT32			u32Head;							///< Next item to pop.
+	UINT32			u32Tail;							///< Next free slot.
+	UINT64			u64Dropped;							///< Reports lost because the queue was full.
+} oGwQueueTy;
+
+///
+/// \struct	oGwWorkerTy
+/// \brief 	Worker and its shard of nodes.
+///
+typedef struct
+{
+	pthread_t		oThread;
+	UINT32			u32Index;
+	oGwQueueTy		oQueue;
+	oGwShardTy		oShard;
+	UINT64			u64Accepted;						///< New readings appended.
+	UINT64			u64Duplicates;						///< Retransmits dropped.
+	UINT64			u64StoreFailed;						///< Readings the query store refused (clock step back, out of memory).
+} oGwWorkerTy;
+
+///
+/// \struct	oGwReceiverTy
+/// \brief 	UDP receiver.
+///
+typedef struct
+{
+	pthread_t		oThread;
+	int				iSocket;
+	UINT64			u64Datagrams;						///< Datagrams received.
+	UINT64			u64Invalid;							///< Datagrams that are not valid reports.
+} oGwReceiverTy;
+
+///
+/// \struct	oGwLoadGenTy
+/// \brief 	Load generator thread, simulating a slice of the nodes.
+///
+typedef struct
+{
+	pthread_t		oThread;
+	UINT32			u32FirstNode;
+	UINT32			u32NodeCount;
+	UINT32*			pu32Sequence;						///< Next sequence number of each simulated node.
+	UINT64*			pu64NextSend;						///< Next send time of each simulated node, in ns.
+	UINT64			u64Sent;							///< Datagrams sent, retransmits included.
+	UINT64			u64Retransmits;						///< Duplicates sent on purpose.
+} oGwLoadGenTy;
+
+///
+/// \struct	oGwAssignTy
+/// \brief 	Slot of a node.
+///
+typedef struct
+{
+	UINT32			u32NodeId;
+	UINT16			u16Slot;
+} oGwAssignTy;
+
+///
+/// \struct	oGatewayTy
+/// \brief 	Gateway object.
+///
+typedef struct
+{
+	volatile bool	bStopReceive;
+	volatile bool	bStopWork;
+	volatile bool	bStopLoad;
+
+	UINT16			u16Port;
+	UINT32			u32WorkerCount;
+	UINT32			u32ReceiverCount;
+	const char*		pszOutputDir;
+	UINT32			u32SeriesLimit;
+	bool			bQueryStore;						///< Readings kept in the query store.
+
+	UINT32			u32LoadNodes;
+	UINT32			u32LoadIntervalMs;
+	UINT32			u32LoadDupPct;
+	UINT32			u32LoadSeconds;
+
+	oGwWorkerTy		aoWorkers[GW_MAX_THREADS];
+	oGwReceiverTy	aoReceivers[GW_MAX_THREADS];
+	oGwLoadGenTy	aoLoadGens[GW_MAX_THREADS];
+	UINT32			u32LoadGenCount;
+
+	UINT32			u32BeaconCycle;						///< Reporting cycle, in ms. 0: no beacon.
+	UINT16			u16BeaconSlots;
+	oGwAssignTy		aoAssign[GW_ASSIGN_MAX];
+	UINT32			u32AssignCount;
+	pthread_t		oBeaconThread;
+	UINT64			u64Beacons;							///< Beacons sent.
+} oGatewayTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static UINT64 GwNow();
+static UINT32 GwHash(UINT32 u32NodeId);
+static bool GwQueueInit(oGwQueueTy* poQueue);
+static void GwQueuePush(oGwQueueTy* poQueue, const oCommReportTy* paoItems, UINT32 u32Count);
+static UINT32 GwQueuePop(oGwQueueTy* poQueue, oCommReportTy* paoItems, UINT32 u32Max, volatile bool* pbStop);
+static void* GwReceiverThread(void* pvArg);
+static void* GwWorkerThread(void* pvArg);
+static void* GwLoadGenThread(void* pvArg);
+static void* GwBeaconThread(void* pvArg);
+static bool GwLoadAssignments(const char* pszFile);
+static void GwLoadGenSend(oGwLoadGenTy* poGen, int iSocket, UINT8 aau8Buffers[][COMMREPORT_SIZE], UINT32 u32Count);
+static void GwIngest(oGwWorkerTy* poWorker, const oCommReportTy* poReport);
+static void GwFlushNode(const oGwNodeTy* poNode, UINT32 u32From);
+static void GwPrintStats(UINT64 u64Elapsed, bool bFinal);
+static void GwPrintQuery(UINT32 u32Start);
+static void GwUsage(const char* pszName);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oGatewayTy oGateway;
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		GwShardFind - Finds (or creates) the state of a node in a shard.
+/// \public
+///
+/// \return		Pointer to the node, NULL if out of memory.
+////////////////////////////////////////////////////////////////////////////////
+oGwNodeTy* GwShardFind(oGwShardTy* poShard, UINT32 u32NodeId, bool bCreate)
+{
+	UINT32		u32Idx		= 0;
+	UINT32		u32NewCap	= 0;
+	oGwNodeTy**	ppoNew		= NULL;
+	oGwNodeTy*	poNode		= NULL;
+
+	if (poShard->u32Capacity)
+	{
+		for (u32Idx = GwHash(u32NodeId) & (poShard->u32Capacity - 1); poShard->ppoNodes[u32Idx]; u32Idx = (u32Idx + 1) & (poShard->u32Capacity - 1))
+		{
+			if (poShard->ppoNodes[u32Idx]->u32NodeId == u32NodeId)
+			{
+				return poShard->ppoNodes[u32Idx];
+			}
+		}
+	}
+
+	if (!bCreate)
+	{
+		return NULL;
+	}
+
+	// Keep the open addressing table at most half full.
+	if ((poShard->u32Count + 1) * 2 > poShard->u32Capacity)
+	{
+		u32NewCap	= poShard->u32Capacity ? poShard->u32Capacity * 2 : 1024;
+		ppoNew		= calloc(u32NewCap, sizeof(oGwNodeTy*));
+		if (!ppoNew) return NULL;
+
+		for (u32Idx = 0; u32Idx < poShard->u32Capacity; ++u32Idx)
+		{
+			UINT32 u32Slot;
+
+			if (!poShard->ppoNodes[u32Idx]) continue;
+
+			for (u32Slot = GwHash(poShard->ppoNodes[u32Idx]->u32NodeId) & (u32NewCap - 1); ppoNew[u32Slot]; u32Slot = (u32Slot + 1) & (u32NewCap - 1));
+			ppoNew[u32Slot] = poShard->ppoNodes[u32Idx];
+		}
+
+		free(poShard->ppoNodes);
+		poShard->ppoNodes		= ppoNew;
+		poShard->u32Capacity	= u32NewCap;
+	}
+
+	poNode = calloc(1, sizeof(oGwNodeTy));
+	if (!poNode) return NULL;
+
+	poNode->u32NodeId = u32NodeId;
+
+	for (u32Idx = GwHash(u32NodeId) & (poShard->u32Capacity - 1); poShard->ppoNodes[u32Idx]; u32Idx = (u32Idx + 1) & (poShard->u32Capacity - 1));
+	poShard->ppoNodes[u32Idx] = poNode;
+	++poShard->u32Count;
+
+	return poNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		GwNodeIsDuplicate - Retransmit detection.
+/// \public
+/// \details	Keeps the highest sequence number seen and a bitmap of the
+///				GW_DEDUP_WINDOW sequence numbers below it. A new boot ID means
+///				the node rebooted (its counters restart at 0): the window is
+///				reset. Nodes without boot ID only get the old guess, a
+///				sequence number far behind with an older node time stamp.
+///
+/// \return		TRUE if the report was already received.
+////////////////////////////////////////////////////////////////////////////////
+bool GwNodeIsDuplicate(oGwNodeTy* poNode, const oCommReportTy* poReport)
+{
+	UINT32 u32Seq		= poReport->u32Sequence;
+	UINT32 u32Offset	= 0;
+
+	if (!poNode->bSeen
+		|| (poReport->u8BootId != poNode->u8BootId)
+		|| (!poReport->u8BootId && (poNode->u32MaxSequence - u32Seq >= GW_DEDUP_WINDOW) && (u32Seq < poNode->u32MaxSequence)
+			&& (poReport->u32Timestamp < poNode->u32LastTimestamp)))
+	{
+		poNode->bSeen				= TRUE;
+		poNode->u8BootId			= poReport->u8BootId;
+		poNode->u32MaxSequence		= u32Seq;
+		poNode->u64SeenMask			= 1;
+		poNode->u32LastTimestamp	= poReport->u32Timestamp;
+		return FALSE;
+	}
+
+	if (u32Seq > poNode->u32MaxSequence)
+	{
+		u32Offset					= u32Seq - poNode->u32MaxSequence;
+		poNode->u64SeenMask			= (u32Offset >= GW_DEDUP_WINDOW) ? 1 : ((poNode->u64SeenMask << u32Offset) | 1);
+		poNode->u32MaxSequence		= u32Seq;
+		poNode->u32LastTimestamp	= poReport->u32Timestamp;
+		return FALSE;
+	}
+
+	u32Offset = poNode->u32MaxSequence - u32Seq;
+	if ((u32Offset >= GW_DEDUP_WINDOW) || (poNode->u64SeenMask & (1ULL << u32Offset)))
+	{
+		return TRUE;
+	}
+
+	poNode->u64SeenMask |= (1ULL << u32Offset);
+	return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		GwNodeAppend - Appends a reading to the time series of a node.
+/// \public
+/// \details	When a limit is set, the oldest half of the series is dropped
+///				once the limit is reached (after being written to disk if an
+///				output directory is configured).
+///
+/// \return		TRUE if success, FALSE if out of memory.
+////////////////////////////////////////////////////////////////////////////////
+bool GwNodeAppend(oGwNodeTy* poNode, const oCommReportTy* poReport, UINT64 u64RxTime, UINT32 u32Limit)
+{
+	oGwSampleTy*	poSample	= NULL;
+	oGwSampleTy*	paoNew		= NULL;
+	UINT32			u32NewCap	= 0;
+	UINT32			u32Drop		= 0;
+
+	if (u32Limit && (poNode->u32Count >= u32Limit))
+	{
+		GwFlushNode(poNode, poNode->u32Flushed);
+
+		u32Drop = poNode->u32Count / 2;
+		memmove(poNode->paoSamples, &poNode->paoSamples[u32Drop], (poNode->u32Count - u32Drop) * sizeof(oGwSampleTy));
+		poNode->u32Count	-= u32Drop;
+		poNode->u32Flushed	= poNode->u32Count;
+	}
+
+	if (poNode->u32Count == poNode->u32Capacity)
+	{
+		u32NewCap	= poNode->u32Capacity ? poNode->u32Capacity * 2 : 64;
+		paoNew		= realloc(poNode->paoSamples, u32NewCap * sizeof(oGwSampleTy));
+		if (!paoNew) return FALSE;
+
+		poNode->paoSamples	= paoNew;
+		poNode->u32Capacity	= u32NewCap;
+	}
+
+	poSample = &poNode->paoSamples[poNode->u32Count++];
+	poSample->u64RxTime			= u64RxTime;
+	poSample->u32Sequence		= poReport->u32Sequence;
+	poSample->u32Timestamp		= poReport->u32Timestamp;
+	poSample->u16RawValue		= poReport->u16RawValue;
+	poSample->u8CurrentValue	= poReport->u8CurrentValue;
+	poSample->u8MinimumValue	= poReport->u8MinimumValue;
+	poSample->u8MaximumValue	= poReport->u8MaximumValue;
+	poSample->u8AverageValue	= poReport->u8AverageValue;
+	poSample->u8Flags			= poReport->u8Flags;
+
+	if (poNode->u32Count - poNode->u32Flushed >= GW_FLUSH_SAMPLES)
+	{
+		GwFlushNode(poNode, poNode->u32Flushed);
+		poNode->u32Flushed = poNode->u32Count;
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		main - Entry point.
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	int					iOpt		= 0;
+	int					iOne		= 1;
+	int					iRcvBuf		= GW_RCVBUF;
+	UINT32				u32Idx		= 0;
+	UINT32				u32Cores	= (UINT32)sysconf(_SC_NPROCESSORS_ONLN);
+	UINT64				u64Start	= 0;
+	UINT64				u64Stop		= 0;
+	UINT64				u64Last		= 0;
+	UINT32				u32WallStart	= 0;
+	struct sockaddr_in	oAddr;
+	struct timeval		oTimeout	= {0, 200000};
+
+	memset(&oGateway, 0, sizeof(oGateway));
+	oGateway.u16Port			= GW_DEFAULT_PORT;
+	oGateway.u32WorkerCount		= u32Cores;
+	oGateway.u32ReceiverCount	= (u32Cores > 1) ? u32Cores / 2 : 1;
+	oGateway.u32LoadIntervalMs	= 15000;
+	oGateway.u16BeaconSlots		= COMMSCHED_SLOTS;
+	oGateway.u32SeriesLimit		= GW_SERIES_LIMIT;
+
+	while ((iOpt = getopt(argc, argv, "p:w:r:o:m:qn:i:d:t:b:k:a:h")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'p': oGateway.u16Port				= (UINT16)atoi(optarg); break;
+		case 'w': oGateway.u32WorkerCount		= (UINT32)atoi(optarg); break;
+		case 'r': oGateway.u32ReceiverCount		= (UINT32)atoi(optarg); break;
+		case 'o': oGateway.pszOutputDir			= optarg; break;
+		case 'm': oGateway.u32SeriesLimit		= (UINT32)atoi(optarg); break;
+		case 'q': oGateway.bQueryStore			= TRUE; break;
+		case 'n': oGateway.u32LoadNodes			= (UINT32)atoi(optarg); break;
+		case 'i': oGateway.u32LoadIntervalMs	= (UINT32)atoi(optarg); break;
+		case 'd': oGateway.u32LoadDupPct		= (UINT32)atoi(optarg); break;
+		case 't': oGateway.u32LoadSeconds		= (UINT32)atoi(optarg); break;
+		case 'b': oGateway.u32BeaconCycle		= (UINT32)atoi(optarg); break;
+		case 'k': oGateway.u16BeaconSlots		= (UINT16)atoi(optarg); break;
+		case 'a':
+			if (!GwLoadAssignments(optarg))
+			{
+				return 1;
+			}
+			break;
+		default:  GwUsage(argv[0]); return 1;
+		}
+	}
+
+	if ((oGateway.u32WorkerCount == 0) || (oGateway.u32WorkerCount > GW_MAX_THREADS)
+		|| (oGateway.u32ReceiverCount == 0) || (oGateway.u32ReceiverCount > GW_MAX_THREADS)
+		|| (oGateway.u32LoadIntervalMs == 0)
+		|| (oGateway.u32BeaconCycle && (!oGateway.u16BeaconSlots
+			|| (oGateway.u32BeaconCycle / oGateway.u16BeaconSlots < COMMSCHED_SLOT_WIDTH_MIN))))
+	{
+		GwUsage(argv[0]);
+		return 1;
+	}
+
+	for (u32Idx = 0; u32Idx < oGateway.u32AssignCount; ++u32Idx)
+	{
+		if (oGateway.aoAssign[u32Idx].u16Slot >= oGateway.u16BeaconSlots)
+		{
+			fprintf(stderr, "Slot %u of node 0x%08X out of range\n", oGateway.aoAssign[u32Idx].u16Slot, oGateway.aoAssign[u32Idx].u32NodeId);
+			return 1;
+		}
+	}
+
+	if (oGateway.pszOutputDir)
+	{
+		mkdir(oGateway.pszOutputDir, 0755);
+	}
+
+	// Workers first, so the queues exist when the first datagram arrives.
+	for (u32Idx = 0; u32Idx < oGateway.u32WorkerCount; ++u32Idx)
+	{
+		oGwWorkerTy* poWorker = &oGateway.aoWorkers[u32Idx];
+
+		poWorker->u32Index = u32Idx;
+		if (!GwQueueInit(&poWorker->oQueue))
+		{
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		pthread_create(&poWorker->oThread, NULL, GwWorkerThread, poWorker);
+	}
+
+	memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sin_family		= AF_INET;
+	oAddr.sin_port			= htons(oGateway.u16Port);
+	oAddr.sin_addr.s_addr	= htonl(INADDR_ANY);
+
+	for (u32Idx = 0; u32Idx < oGateway.u32ReceiverCount; ++u32Idx)
+	{
+		oGwReceiverTy* poReceiver = &oGateway.aoReceivers[u32Idx];
+
+		poReceiver->iSocket = socket(AF_INET, SOCK_DGRAM, 0);
+		setsockopt(poReceiver->iSocket, SOL_SOCKET, SO_REUSEPORT, &iOne, sizeof(iOne));
+		setsockopt(poReceiver->iSocket, SOL_SOCKET, SO_RCVBUF, &iRcvBuf, sizeof(iRcvBuf));
+		setsockopt(poReceiver->iSocket, SOL_SOCKET, SO_RCVTIMEO, &oTimeout, sizeof(oTimeout));
+
+		if (bind(poReceiver->iSocket, (struct sockaddr*)&oAddr, sizeof(oAddr)) < 0)
+		{
+			perror("bind");
+			return 1;
+		}
+		pthread_create(&poReceiver->oThread, NULL, GwReceiverThread, poReceiver);
+	}
+
+	printf("Listening on UDP %u: %u receivers, %u workers\n", oGateway.u16Port, oGateway.u32ReceiverCount, oGateway.u32WorkerCount);
+
+	if (oGateway.u32LoadNodes)
+	{
+		oGateway.u32LoadGenCount = (u32Cores > 1) ? u32Cores / 2 : 1;
+		if (oGateway.u32LoadGenCount > oGateway.u32LoadNodes)
+		{
+			oGateway.u32LoadGenCount = oGateway.u32LoadNodes;
+		}
+
+		for (u32Idx = 0; u32Idx < oGateway.u32LoadGenCount; ++u32Idx)
+		{
+			oGwLoadGenTy* poGen = &oGateway.aoLoadGens[u32Idx];
+
+			poGen->u32FirstNode	= (UINT32)((UINT64)oGateway.u32LoadNodes * u32Idx / oGateway.u32LoadGenCount);
+			poGen->u32NodeCount	= (UINT32)((UINT64)oGateway.u32LoadNodes * (u32Idx + 1) / oGateway.u32LoadGenCount) - poGen->u32FirstNode;
+			pthread_create(&poGen->oThread, NULL, GwLoadGenThread, poGen);
+		}
+
+		printf("Load generator: %u nodes, one report every %u ms each (%.0f reports/s), %u%% retransmits\n",
+			oGateway.u32LoadNodes, oGateway.u32LoadIntervalMs,
+			oGateway.u32LoadNodes * 1000.0 / oGateway.u32LoadIntervalMs, oGateway.u32LoadDupPct);
+	}
+
+	if (oGateway.u32BeaconCycle)
+	{
+		pthread_create(&oGateway.oBeaconThread, NULL, GwBeaconThread, NULL);
+		printf("Beacon: cycle %u ms, %u slots, %u assignments\n", oGateway.u32BeaconCycle,
+			oGateway.u16BeaconSlots, oGateway.u32AssignCount);
+	}
+
+	u64Start		= GwNow();
+	u64Last			= u64Start;
+	u32WallStart	= (UINT32)time(NULL);
+	u64Stop		= oGateway.u32LoadSeconds ? u64Start + (UINT64)oGateway.u32LoadSeconds * 1000000000ULL : 0;
+
+	while (!u64Stop || (GwNow() < u64Stop))
+	{
+		usleep(100000);
+		if (GwNow() - u64Last >= 1000000000ULL)
+		{
+			u64Last = GwNow();
+			GwPrintStats(u64Last - u64Start, FALSE);
+		}
+	}
+
+	// Orderly shutdown: stop the load, let the sockets and queues drain.
+	oGateway.bStopLoad = TRUE;
+	for (u32Idx = 0; u32Idx < oGateway.u32LoadGenCount; ++u32Idx)
+	{
+		pthread_join(oGateway.aoLoadGens[u32Idx].oThread, NULL);
+	}
+	usleep(500000);
+
+	oGateway.bStopReceive = TRUE;
+	if (oGateway.u32BeaconCycle)
+	{
+		pthread_join(oGateway.oBeaconThread, NULL);
+	}
+	for (u32Idx = 0; u32Idx < oGateway.u32ReceiverCount; ++u32Idx)
+	{
+		pthread_join(oGateway.aoReceivers[u32Idx].oThread, NULL);
+	}
+
+	oGateway.bStopWork = TRUE;
+	for (u32Idx = 0; u32Idx < oGateway.u32WorkerCount; ++u32Idx)
+	{
+		pthread_mutex_lock(&oGateway.aoWorkers[u32Idx].oQueue.oLock);
+		pthread_cond_signal(&oGateway.aoWorkers[u32Idx].oQueue.oNotEmpty);
+		pthread_mutex_unlock(&oGateway.aoWorkers[u32Idx].oQueue.oLock);
+		pthread_join(oGateway.aoWorkers[u32Idx].oThread, NULL);
+	}
+
+	GwPrintStats(GwNow() - u64Start, TRUE);
+	if (oGateway.bQueryStore)
+	{
+		GwPrintQuery(u32WallStart);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static UINT64 GwNow()
+{
+	struct timespec oTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &oTs);
+	return (UINT64)oTs.tv_sec * 1000000000ULL + oTs.tv_nsec;
+}
+
+static UINT32 GwHash(UINT32 u32NodeId)
+{
+	// Murmur3 finalizer: chip IDs are far from uniform.
+	u32NodeId ^= u32NodeId >> 16;
+	u32NodeId *= 0x85EBCA6B;
+	u32NodeId ^= u32NodeId >> 13;
+	u32NodeId *= 0xC2B2AE35;
+	u32NodeId ^= u32NodeId >> 16;
+	return u32NodeId;
+}
+
+static bool GwQueueInit(oGwQueueTy* poQueue)
+{
+	pthread_mutex_init(&poQueue->oLock, NULL);
+	pthread_cond_init(&poQueue->oNotEmpty, NULL);
+	poQueue->paoItems = malloc(GW_QUEUE_SIZE * sizeof(oCommReportTy));
+
+	return poQueue->paoItems != NULL;
+}
+
+static void GwQueuePush(oGwQueueTy* poQueue, const oCommReportTy* paoItems, UINT32 u32Count)
+{
+	UINT32 u32Idx = 0;
+
+	pthread_mutex_lock(&poQueue->oLock);
+
+	for (u32Idx = 0; u32Idx < u32Count; ++u32Idx)
+	{
+		if (poQueue->u32Tail - poQueue->u32Head == GW_QUEUE_SIZE)
+		{
+			poQueue->u64Dropped += u32Count - u32Idx;
+			break;
+		}
+		poQueue->paoItems[poQueue->u32Tail++ & (GW_QUEUE_SIZE - 1)] = paoItems[u32Idx];
+	}
+
+	pthread_cond_signal(&poQueue->oNotEmpty);
+	pthread_mutex_unlock(&poQueue->oLock);
+}
+
+static UINT32 GwQueuePop(oGwQueueTy* poQueue, oCommReportTy* paoItems, UINT32 u32Max, volatile bool* pbStop)
+{
+	UINT32			u32Count	= 0;
+	struct timespec	oDeadline;
+
+	pthread_mutex_lock(&poQueue->oLock);
+
+	while ((poQueue->u32Tail == poQueue->u32Head) && !*pbStop)
+	{
+		clock_gettime(CLOCK_REALTIME, &oDeadline);
+		oDeadline.tv_nsec += 100000000;
+		if (oDeadline.tv_nsec >= 1000000000)
+		{
+			oDeadline.tv_sec	+= 1;
+			oDeadline.tv_nsec	-= 1000000000;
+		}
+		pthread_cond_timedwait(&poQueue->oNotEmpty, &poQueue->oLock, &oDeadline);
+	}
+
+	while ((poQueue->u32Tail != poQueue->u32Head) && (u32Count < u32Max))
+	{
+		paoItems[u32Count++] = poQueue->paoItems[poQueue->u32Head++ & (GW_QUEUE_SIZE - 1)];
+	}
+
+	pthread_mutex_unlock(&poQueue->oLock);
+
+	return u32Count;
+}
+
+static void* GwReceiverThread(void* pvArg)
+{
+	oGwReceiverTy*	poReceiver										= (oGwReceiverTy*)pvArg;
+	UINT8			aau8Buffers[GW_BATCH][COMMREPORT_SIZE + 1];
+	struct iovec	aoIov[GW_BATCH];
+	struct mmsghdr	aoMsgs[GW_BATCH];
+	oCommReportTy	aaoBatch[GW_MAX_THREADS][GW_BATCH];
+	UINT32			au32BatchCount[GW_MAX_THREADS];
+	oCommReportTy	oReport;
+	int				iCount											= 0;
+	int				iIdx											= 0;
+	UINT32			u32Shard										= 0;
+
+	for (iIdx = 0; iIdx < GW_BATCH; ++iIdx)
+	{
+		aoIov[iIdx].iov_base	= aau8Buffers[iIdx];
+		aoIov[iIdx].iov_len		= sizeof(aau8Buffers[iIdx]);
+		memset(&aoMsgs[iIdx], 0, sizeof(aoMsgs[iIdx]));
+		aoMsgs[iIdx].msg_hdr.msg_iov	= &aoIov[iIdx];
+		aoMsgs[iIdx].msg_hdr.msg_iovlen	= 1;
+	}
+
+	while (!oGateway.bStopReceive)
+	{
+		iCount = recvmmsg(poReceiver->iSocket, aoMsgs, GW_BATCH, MSG_WAITFORONE, NULL);
+		if (iCount <= 0)
+		{
+			continue;
+		}
+
+		__atomic_add_fetch(&poReceiver->u64Datagrams, iCount, __ATOMIC_RELAXED);
+
+		// Sort the batch by shard, then hand each part over with one lock.
+		memset(au32BatchCount, 0, sizeof(au32BatchCount));
+
+		for (iIdx = 0; iIdx < iCount; ++iIdx)
+		{
+			if (!CommReportDecode(aau8Buffers[iIdx], (UINT16)aoMsgs[iIdx].msg_len, &oReport))
+			{
+				__atomic_add_fetch(&poReceiver->u64Invalid, 1, __ATOMIC_RELAXED);
+				continue;
+			}
+
+			u32Shard = GwHash(oReport.u32NodeId) % oGateway.u32WorkerCount;
+			aaoBatch[u32Shard][au32BatchCount[u32Shard]++] = oReport;
+		}
+
+		for (u32Shard = 0; u32Shard < oGateway.u32WorkerCount; ++u32Shard)
+		{
+			if (au32BatchCount[u32Shard])
+			{
+				GwQueuePush(&oGateway.aoWorkers[u32Shard].oQueue, aaoBatch[u32Shard], au32BatchCount[u32Shard]);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void* GwWorkerThread(void* pvArg)
+{
+	oGwWorkerTy*	poWorker			= (oGwWorkerTy*)pvArg;
+	oCommReportTy	aoBatch[GW_BATCH];
+	UINT32			u32Count			= 0;
+	UINT32			u32Idx				= 0;
+	cpu_set_t		oCpus;
+
+	// One worker per core.
+	CPU_ZERO(&oCpus);
+	CPU_SET(poWorker->u32Index % sysconf(_SC_NPROCESSORS_ONLN), &oCpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(oCpus), &oCpus);
+
+	for (;;)
+	{
+		u32Count = GwQueuePop(&poWorker->oQueue, aoBatch, GW_BATCH, &oGateway.bStopWork);
+		if ((u32Count == 0) && oGateway.bStopWork)
+		{
+			break;
+		}
+
+		for (u32Idx = 0; u32Idx < u32Count; ++u32Idx)
+		{
+			GwIngest(poWorker, &aoBatch[u32Idx]);
+		}
+	}
+
+	// Write what is left.
+	for (u32Idx = 0; u32Idx < poWorker->oShard.u32Capacity; ++u32Idx)
+	{
+		oGwNodeTy* poNode = poWorker->oShard.ppoNodes[u32Idx];
+
+		if (poNode && (poNode->u32Flushed < poNode->u32Count))
+		{
+			GwFlushNode(poNode, poNode->u32Flushed);
+			poNode->u32Flushed = poNode->u32Count;
+		}
+	}
+
+	return NULL;
+}
+
+static void GwIngest(oGwWorkerTy* poWorker, const oCommReportTy* poReport)
+{
+	oGwNodeTy* poNode = GwShardFind(&poWorker->oShard, poReport->u32NodeId, TRUE);
+
+	if (!poNode)
+	{
+		return;
+	}
+
+	if (GwNodeIsDuplicate(poNode, poReport))
+	{
+		__atomic_add_fetch(&poWorker->u64Duplicates, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	if (!GwNodeAppend(poNode, poReport, GwNow(), oGateway.u32SeriesLimit))
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&poWorker->u64Accepted, 1, __ATOMIC_RELAXED);
+
+	if (oGateway.bQueryStore)
+	{
+		struct timespec	oTs;
+		oTsqPointTy		oPoint;
+
+		if (!poNode->poSeries)
+		{
+			poNode->poSeries = malloc(sizeof(oTsqSeriesTy));
+			if (!poNode->poSeries)
+			{
+				__atomic_add_fetch(&poWorker->u64StoreFailed, 1, __ATOMIC_RELAXED);
+				return;
+			}
+			TsqSeriesInit(poNode->poSeries, poNode->u32NodeId);
+		}
+
+		// Wall clock: the queries are in calendar time.
+		clock_gettime(CLOCK_REALTIME_COARSE, &oTs);
+		oPoint.u32Time			= (UINT32)oTs.tv_sec;
+		oPoint.u16RawValue		= poReport->u16RawValue;
+		oPoint.u8CurrentValue	= poReport->u8CurrentValue;
+		oPoint.u8MinimumValue	= poReport->u8MinimumValue;
+		oPoint.u8MaximumValue	= poReport->u8MaximumValue;
+		oPoint.u8AverageValue	= poReport->u8AverageValue;
+
+		if (!TsqAppend(poNode->poSeries, &oPoint))
+		{
+			__atomic_add_fetch(&poWorker->u64StoreFailed, 1, __ATOMIC_RELAXED);
+		}
+		else if ((poNode->poSeries->u64Points % TSQ_BLOCK_POINTS) == 0)
+		{
+			// A block is full.
+			TsqTrim(poNode->poSeries, oGateway.u32SeriesLimit, oPoint.u32Time);
+		}
+	}
+}
+
+static void GwFlushNode(const oGwNodeTy* poNode, UINT32 u32From)
+{
+	char	szPath[512];
+	FILE*	poFile	= NULL;
+	UINT32	u32Idx	= 0;
+
+	if (!oGateway.pszOutputDir || (u32From >= poNode->u32Count))
+	{
+		return;
+	}
+
+	snprintf(szPath, sizeof(szPath), "%s/%08X.csv", oGateway.pszOutputDir, poNode->u32NodeId);
+	poFile = fopen(szPath, "a");
+	if (!poFile)
+	{
+		return;
+	}
+
+	for (u32Idx = u32From; u32Idx < poNode->u32Count; ++u32Idx)
+	{
+		const oGwSampleTy* poSample = &poNode->paoSamples[u32Idx];
+
+		fprintf(poFile, "%llu,%u,%u,%u,%u,%u,%u,%u,%u\n",
+			(unsigned long long)poSample->u64RxTime, poSample->u32Sequence, poSample->u32Timestamp,
+			poSample->u16RawValue, poSample->u8CurrentValue, poSample->u8MinimumValue,
+			poSample->u8MaximumValue, poSample->u8AverageValue, poSample->u8Flags);
+	}
+
+	fclose(poFile);
+}
+
+static void* GwLoadGenThread(void* pvArg)
+{
+	oGwLoadGenTy*		poGen								= (oGwLoadGenTy*)pvArg;
+	UINT8				aau8Buffers[GW_BATCH][COMMREPORT_SIZE];
+	struct sockaddr_in	oAddr;
+	oCommReportTy		oReport;
+	UINT64				u64Interval							= (UINT64)oGateway.u32LoadIntervalMs * 1000000ULL;
+	UINT64				u64Start							= GwNow();
+	UINT64				u64Now								= 0;
+	UINT32				u32Node								= 0;
+	UINT32				u32Pending							= 0;
+	UINT32				u32Random							= 0x12345678 ^ poGen->u32FirstNode;
+	int					iSocket								= socket(AF_INET, SOCK_DGRAM, 0);
+	bool				bIdle								= TRUE;
+
+	memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sin_family		= AF_INET;
+	oAddr.sin_port			= htons(oGateway.u16Port);
+	oAddr.sin_addr.s_addr	= htonl(INADDR_LOOPBACK);
+	connect(iSocket, (struct sockaddr*)&oAddr, sizeof(oAddr));
+
+	poGen->pu32Sequence	= calloc(poGen->u32NodeCount, sizeof(UINT32));
+	poGen->pu64NextSend	= calloc(poGen->u32NodeCount, sizeof(UINT64));
+	if (!poGen->pu32Sequence || !poGen->pu64NextSend)
+	{
+		return NULL;
+	}
+
+	// Nodes boot at random times within one interval.
+	for (u32Node = 0; u32Node < poGen->u32NodeCount; ++u32Node)
+	{
+		u32Random = u32Random * 1664525 + 1013904223;
+		poGen->pu64NextSend[u32Node] = u64Start + (u64Interval * (u32Random >> 16) >> 16);
+	}
+
+	memset(&oReport, 0, sizeof(oReport));
+	oReport.u8Type = COMMREPORT_TYPE_READING;
+	oReport.u8BootId = 1;
+
+	while (!oGateway.bStopLoad)
+	{
+		u64Now	= GwNow();
+		bIdle	= TRUE;
+
+		for (u32Node = 0; u32Node < poGen->u32NodeCount; ++u32Node)
+		{
+			if (poGen->pu64NextSend[u32Node] > u64Now)
+			{
+				continue;
+			}
+
+			bIdle							= FALSE;
+			poGen->pu64NextSend[u32Node]	+= u64Interval;
+
+			u32Random					= u32Random * 1664525 + 1013904223;
+			oReport.u32NodeId			= 0x00100000 + poGen->u32FirstNode + u32Node;
+			oReport.u32Sequence			= poGen->pu32Sequence[u32Node]++;
+			oReport.u32Timestamp		= (UINT32)((u64Now - u64Start) / 1000000ULL);
+			oReport.u16RawValue			= 350 + ((u32Random >> 8) % 674);
+			oReport.u8CurrentValue		= (UINT8)((u32Random >> 4) % 101);
+			oReport.u8MinimumValue		= oReport.u8CurrentValue;
+			oReport.u8MaximumValue		= oReport.u8CurrentValue;
+			oReport.u8AverageValue		= oReport.u8CurrentValue;
+
+			CommReportEncode(&oReport, aau8Buffers[u32Pending], COMMREPORT_SIZE);
+			++u32Pending;
+
+			// Retransmit: same report again.
+			if (((u32Random >> 24) % 100 < oGateway.u32LoadDupPct) && (u32Pending < GW_BATCH))
+			{
+				memcpy(aau8Buffers[u32Pending], aau8Buffers[u32Pending - 1], COMMREPORT_SIZE);
+				++u32Pending;
+				++poGen->u64Retransmits;
+			}
+
+			if (u32Pending >= GW_BATCH - 1)
+			{
+				GwLoadGenSend(poGen, iSocket, aau8Buffers, u32Pending);
+				u32Pending = 0;
+			}
+		}
+
+		if (bIdle)
+		{
+			usleep(1000);
+		}
+	}
+
+	GwLoadGenSend(poGen, iSocket, aau8Buffers, u32Pending);
+	close(iSocket);
+
+	return NULL;
+}
+
+static void GwLoadGenSend(oGwLoadGenTy* poGen, int iSocket, UINT8 aau8Buffers[][COMMREPORT_SIZE], UINT32 u32Count)
+{
+	struct iovec	aoIov[GW_BATCH];
+	struct mmsghdr	aoMsgs[GW_BATCH];
+	UINT32			u32Idx				= 0;
+	int				iSent				= 0;
+
+	if (u32Count == 0)
+	{
+		return;
+	}
+
+	for (u32Idx = 0; u32Idx < u32Count; ++u32Idx)
+	{
+		aoIov[u32Idx].iov_base				= aau8Buffers[u32Idx];
+		aoIov[u32Idx].iov_len				= COMMREPORT_SIZE;
+		memset(&aoMsgs[u32Idx], 0, sizeof(aoMsgs[u32Idx]));
+		aoMsgs[u32Idx].msg_hdr.msg_iov		= &aoIov[u32Idx];
+		aoMsgs[u32Idx].msg_hdr.msg_iovlen	= 1;
+	}
+
+	iSent = sendmmsg(iSocket, aoMsgs, u32Count, 0);
+	if (iSent > 0)
+	{
+		__atomic_add_fetch(&poGen->u64Sent, iSent, __ATOMIC_RELAXED);
+	}
+}
+
+static void* GwBeaconThread(void* pvArg)
+{
+	UINT8				au8Buffer[COMMREPORT_SIZE];
+	struct sockaddr_in	oAddr;
+	oCommBeaconTy		oBeacon;
+	UINT64				u64Cycle	= (UINT64)oGateway.u32BeaconCycle * 1000000ULL;
+	UINT64				u64Start	= GwNow();
+	UINT64				u64Wait		= 0;
+	UINT32				u32Next		= 0;
+	UINT32				u32Sent		= 0;
+	int					iOne		= 1;
+	int					iSocket		= socket(AF_INET, SOCK_DGRAM, 0);
+
+	(void)pvArg;
+
+	setsockopt(iSocket, SOL_SOCKET, SO_BROADCAST, &iOne, sizeof(iOne));
+
+	memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sin_family		= AF_INET;
+	oAddr.sin_port			= htons(COMM_BEACON_PORT);
+	oAddr.sin_addr.s_addr	= htonl(INADDR_BROADCAST);
+
+	memset(&oBeacon, 0, sizeof(oBeacon));
+	oBeacon.u32Cycle		= oGateway.u32BeaconCycle;
+	oBeacon.u16SlotCount	= oGateway.u16BeaconSlots;
+
+	// The cycle starts when the gateway starts. One synchronization, then a
+	// few assignments, at each cycle start.
+	while (!oGateway.bStopReceive)
+	{
+		u64Wait = u64Cycle - (GwNow() - u64Start) % u64Cycle;
+		if (u64Wait > 100000000ULL)
+		{
+			usleep(100000);
+			continue;
+		}
+		usleep((useconds_t)(u64Wait / 1000));
+
+		for (u32Sent = 0; u32Sent <= GW_BEACON_ASSIGN; ++u32Sent)
+		{
+			if (u32Sent == 0)
+			{
+				oBeacon.u32NodeId	= 0;
+				oBeacon.u16Slot		= 0;
+			}
+			else if (u32Sent <= oGateway.u32AssignCount)
+			{
+				oBeacon.u32NodeId	= oGateway.aoAssign[u32Next].u32NodeId;
+				oBeacon.u16Slot		= oGateway.aoAssign[u32Next].u16Slot;
+				u32Next				= (u32Next + 1) % oGateway.u32AssignCount;
+			}
+			else
+			{
+				break;
+			}
+
+			oBeacon.u32Phase = (UINT32)(((GwNow() - u64Start) % u64Cycle) / 1000000ULL);
+			CommReportEncodeBeacon(&oBeacon, au8Buffer, sizeof(au8Buffer));
+			if (sendto(iSocket, au8Buffer, COMMREPORT_SIZE, 0, (struct sockaddr*)&oAddr, sizeof(oAddr)) == COMMREPORT_SIZE)
+			{
+				__atomic_add_fetch(&oGateway.u64Beacons, 1, __ATOMIC_RELAXED);
+			}
+		}
+
+		// Past the cycle start, whatever the sleep granularity.
+		usleep(1000);
+	}
+
+	close(iSocket);
+
+	return NULL;
+}
+
+static bool GwLoadAssignments(const char* pszFile)
+{
+	FILE*			poFile		= fopen(pszFile, "r");
+	long			lNode		= 0;
+	unsigned int	uiSlot		= 0;
+	char			szLine[128];
+
+	if (!poFile)
+	{
+		perror(pszFile);
+		return FALSE;
+	}
+
+	while (fgets(szLine, sizeof(szLine), poFile) && (oGateway.u32AssignCount < GW_ASSIGN_MAX))
+	{
+		if ((szLine[0] == '#') || (sscanf(szLine, "%li %u", &lNode, &uiSlot) != 2))
+		{
+			continue;
+		}
+
+		oGateway.aoAssign[oGateway.u32AssignCount].u32NodeId	= (UINT32)lNode;
+		oGateway.aoAssign[oGateway.u32AssignCount].u16Slot		= (UINT16)uiSlot;
+		++oGateway.u32AssignCount;
+	}
+
+	fclose(poFile);
+
+	return TRUE;
+}
+
+static void GwPrintStats(UINT64 u64Elapsed, bool bFinal)
+{
+	static UINT64	u64LastAccepted	= 0;
+	static UINT64	u64LastElapsed	= 0;
+	UINT64			u64Sent			= 0;
+	UINT64			u64Retransmits	= 0;
+	UINT64			u64Datagrams	= 0;
+	UINT64			u64Invalid		= 0;
+	UINT64			u64Accepted		= 0;
+	UINT64			u64Duplicates	= 0;
+	UINT64			u64Dropped		= 0;
+	UINT64			u64Nodes		= 0;
+	UINT32			u32Idx			= 0;
+	double			dSeconds		= u64Elapsed / 1e9;
+
+	for (u32Idx = 0; u32Idx < oGateway.u32LoadGenCount; ++u32Idx)
+	{
+		u64Sent			+= __atomic_load_n(&oGateway.aoLoadGens[u32Idx].u64Sent, __ATOMIC_RELAXED);
+		u64Retransmits	+= oGateway.aoLoadGens[u32Idx].u64Retransmits;
+	}
+	for (u32Idx = 0; u32Idx < oGateway.u32ReceiverCount; ++u32Idx)
+	{
+		u64Datagrams	+= __atomic_load_n(&oGateway.aoReceivers[u32Idx].u64Datagrams, __ATOMIC_RELAXED);
+		u64Invalid		+= __atomic_load_n(&oGateway.aoReceivers[u32Idx].u64Invalid, __ATOMIC_RELAXED);
+	}
+	for (u32Idx = 0; u32Idx < oGateway.u32WorkerCount; ++u32Idx)
+	{
+		u64Accepted		+= __atomic_load_n(&oGateway.aoWorkers[u32Idx].u64Accepted, __ATOMIC_RELAXED);
+		u64Duplicates	+= __atomic_load_n(&oGateway.aoWorkers[u32Idx].u64Duplicates, __ATOMIC_RELAXED);
+		u64Dropped		+= __atomic_load_n(&oGateway.aoWorkers[u32Idx].oQueue.u64Dropped, __ATOMIC_RELAXED);
+		if (bFinal)
+		{
+			u64Nodes	+= oGateway.aoWorkers[u32Idx].oShard.u32Count;
+		}
+	}
+
+	if (!bFinal)
+	{
+		printf("[%6.1fs] rx %llu  accepted %llu (%.0f/s)  dup %llu  invalid %llu  queue drops %llu\n",
+			dSeconds, (unsigned long long)u64Datagrams, (unsigned long long)u64Accepted,
+			(u64Accepted - u64LastAccepted) * 1e9 / (u64Elapsed - u64LastElapsed),
+			(unsigned long long)u64Duplicates, (unsigned long long)u64Invalid, (unsigned long long)u64Dropped);
+		u64LastAccepted	= u64Accepted;
+		u64LastElapsed	= u64Elapsed;
+		return;
+	}
+
+	printf("\nSummary after %.1f s\n", dSeconds);
+	if (oGateway.u32LoadGenCount)
+	{
+		printf("  sent               %llu (%llu retransmits)\n", (unsigned long long)u64Sent, (unsigned long long)u64Retransmits);
+		printf("  lost in the kernel %llu (%.2f%%)\n", (unsigned long long)(u64Sent - u64Datagrams),
+			u64Sent ? 100.0 * (u64Sent - u64Datagrams) / u64Sent : 0.0);
+	}
+	printf("  received           %llu (%.0f/s)\n", (unsigned long long)u64Datagrams, u64Datagrams / dSeconds);
+	printf("  accepted           %llu (%.0f/s)\n", (unsigned long long)u64Accepted, u64Accepted / dSeconds);
+	printf("  duplicates         %llu\n", (unsigned long long)u64Duplicates);
+	printf("  invalid            %llu\n", (unsigned long long)u64Invalid);
+	printf("  queue drops        %llu\n", (unsigned long long)u64Dropped);
+	printf("  nodes              %llu\n", (unsigned long long)u64Nodes);
+	if (oGateway.u32BeaconCycle)
+	{
+		printf("  beacons            %llu\n", (unsigned long long)oGateway.u64Beacons);
+	}
+}
+
+static void GwPrintQuery(UINT32 u32Start)
+{
+	oTsqSeriesTy**	ppoSeries	= NULL;
+	oTsqAggTy*		paoOut		= NULL;
+	oTsqStatsTy		oStats		= {0};
+	UINT32			u32Series	= 0;
+	UINT32			u32From		= u32Start - u32Start % 3600;
+	UINT32			u32To		= (UINT32)time(NULL) / 3600 * 3600 + 3600;	// Whole hours: the rollups hold the trimmed points.
+	UINT32			u32Steps	= TsqStepCount(u32From, u32To, 3600);
+	UINT32			u32Idx		= 0;
+	UINT32			u32Step		= 0;
+	UINT64			u64Count	= 0;
+	UINT64			u64Failed	= 0;
+	UINT64			u64Points	= 0;
+	UINT64			u64Trimmed	= 0;
+	UINT64			u64Start	= 0;
+	UINT64			u64Elapsed	= 0;
+
+	// The workers are stopped: the series can be read from any thread.
+	for (u32Idx = 0; u32Idx < oGateway.u32WorkerCount; ++u32Idx)
+	{
+		u32Series	+= oGateway.aoWorkers[u32Idx].oShard.u32Count;
+		u64Failed	+= oGateway.aoWorkers[u32Idx].u64StoreFailed;
+	}
+
+	ppoSeries	= calloc(u32Series ? u32Series : 1, sizeof(oTsqSeriesTy*));
+	paoOut		= calloc((size_t)(u32Series ? u32Series : 1) * u32Steps, sizeof(oTsqAggTy));
+	if (!ppoSeries || !paoOut)
+	{
+		goto END;
+	}
+
+	u32Series = 0;
+	for (u32Idx = 0; u32Idx < oGateway.u32WorkerCount; ++u32Idx)
+	{
+		const oGwShardTy* poShard = &oGateway.aoWorkers[u32Idx].oShard;
+		UINT32 u32Slot;
+
+		for (u32Slot = 0; u32Slot < poShard->u32Capacity; ++u32Slot)
+		{
+			if (poShard->ppoNodes[u32Slot] && poShard->ppoNodes[u32Slot]->poSeries)
+			{
+				ppoSeries[u32Series++] = poShard->ppoNodes[u32Slot]->poSeries;
+				u64Points	+= poShard->ppoNodes[u32Slot]->poSeries->u64Points;
+				u64Trimmed	+= poShard->ppoNodes[u32Slot]->poSeries->u64Trimmed;
+			}
+		}
+	}
+
+	u64Start = GwNow();
+	TsqQueryFleet(ppoSeries, u32Series, u32From, u32To, 3600, FALSE, oGateway.u32WorkerCount, paoOut, &oStats);
+	u64Elapsed = GwNow() - u64Start;
+
+	printf("  query store        %u series, %llu points, %llu trimmed, %llu refused\n", u32Series, (unsigned long long)u64Points,
+		(unsigned long long)u64Trimmed, (unsigned long long)u64Failed);
+	printf("  hourly fleet query %.3f ms (%llu buckets, %llu points read)\n", u64Elapsed / 1e6,
+		(unsigned long long)oStats.u64Buckets, (unsigned long long)oStats.u64Points);
+
+	for (u32Step = 0; u32Step < u32Steps; ++u32Step)
+	{
+		oTsqAggTy oHour = {0};
+
+		oHour.u8Minimum = 0xFF;
+		for (u32Idx = 0; u32Idx < u32Series; ++u32Idx)
+		{
+			const oTsqAggTy* poAgg = &paoOut[(UINT64)u32Idx * u32Steps + u32Step];
+
+			if (!poAgg->u32Count) continue;
+
+			oHour.u32Count		+= poAgg->u32Count;
+			oHour.u64SumAverage	+= poAgg->u64SumAverage;
+			if (poAgg->u8Minimum < oHour.u8Minimum) oHour.u8Minimum = poAgg->u8Minimum;
+			if (poAgg->u8Maximum > oHour.u8Maximum) oHour.u8Maximum = poAgg->u8Maximum;
+		}
+
+		u64Count += oHour.u32Count;
+		if (oHour.u32Count)
+		{
+			printf("    %u: %u readings, min %u%%, max %u%%, avg %.1f%%\n", u32From + u32Step * 3600, oHour.u32Count,
+				oHour.u8Minimum, oHour.u8Maximum, (double)oHour.u64SumAverage / oHour.u32Count);
+		}
+	}
+
+	if (u64Count == 0)
+	{
+		printf("    no readings\n");
+	}
+
+END:
+	free(ppoSeries);
+	free(paoOut);
+}
+
+static void GwUsage(const char* pszName)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -p port      UDP port (default %u)\n"
+		"  -w count     worker threads, one shard each (default: cores)\n"
+		"  -r count     receiver threads (default: cores / 2)\n"
+		"  -o dir       append each node series to dir/<node>.csv\n"
+		"  -m count     keep at most count samples per node in memory (default %u, 0: no limit)\n"
+		"  -q           keep the readings in the query store (raw points limited by -m)\n"
+		"Load generator:\n"
+		"  -n nodes     simulate this many nodes on loopback\n"
+		"  -i ms        report interval of each simulated node (default 15000)\n"
+		"  -d percent   retransmit probability (default 0)\n"
+		"  -t seconds   stop after this time and print a summary\n"
+		"Slotted uplink:\n"
+		"  -b ms        broadcast a beacon at each cycle of this length\n"
+		"  -k count     slots per cycle (default %u)\n"
+		"  -a file      slot assignments, one \"<node ID> <slot>\" per line\n",
+		pszName, GW_DEFAULT_PORT, GW_SERIES_LIMIT, COMMSCHED_SLOTS);
+}
@@ -0,0 +1,77 @@
+///
+/// \file     gateway.h
+/// \brief    Telemetry ingest gateway (Linux) - node state and time series
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+#include "CommReport.h"
+#include "tsquery.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oGwSampleTy
+/// \brief 	One reading of a node time series.
+///
+typedef struct
+{
+	UINT64		u64RxTime;					///< Gateway reception time, in ns (monotonic).
+	UINT32		u32Sequence;				///< Node sequence number.
+	UINT32		u32Timestamp;				///< Node time stamp, in ms.
+	UINT16		u16RawValue;				///< Raw ADC value.
+	UINT8		u8CurrentValue;				///< Current value, in %.
+	UINT8		u8MinimumValue;				///< Minimum value, in %.
+	UINT8		u8MaximumValue;				///< Maximum value, in %.
+	UINT8		u8AverageValue;				///< Average value, in %.
+	UINT8		u8Flags;					///< Report flags.
+} oGwSampleTy;
+
+///
+/// \struct	oGwNodeTy
+/// \brief 	State and time series of one node.
+///
+typedef struct
+{
+	UINT32			u32NodeId;
+	bool			bSeen;					///< At least one report received.
+	UINT32			u32MaxSequence;			///< Highest sequence number received.
+	UINT64			u64SeenMask;			///< Bit n set: u32MaxSequence - n received.
+	UINT32			u32LastTimestamp;		///< Node time stamp of the highest sequence number.
+	UINT8			u8BootId;				///< Boot ID of the last report, 0 if the node sends none.
+	oGwSampleTy*	paoSamples;				///< Time series, in arrival order.
+	UINT32			u32Count;				///< Number of samples.
+	UINT32			u32Capacity;			///< Allocated samples.
+	UINT32			u32Flushed;				///< Samples already written to disk.
+	oTsqSeriesTy*	poSeries;				///< Query store (-q), NULL if disabled.
+} oGwNodeTy;
+
+///
+/// \struct	oGwShardTy
+/// \brief 	Nodes owned by one worker (open addressing hash table).
+///
+typedef struct
+{
+	oGwNodeTy**		ppoNodes;
+	UINT32			u32Capacity;			///< Table size, power of 2.
+	UINT32			u32Count;				///< Number of nodes.
+} oGwShardTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+oGwNodeTy* GwShardFind(oGwShardTy* poShard, UINT32 u32NodeId, bool bCreate);
+bool GwNodeIsDuplicate(oGwNodeTy* poNode, const oCommReportTy* poReport);
+bool GwNodeAppend(oGwNodeTy* poNode, const oCommReportTy* poReport, UINT64 u64RxTime, UINT32 u32Limit);
+
+#endif
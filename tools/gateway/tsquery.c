@@ -0,0 +1,626 @@
+///
+/// \file     tsquery.c
+/// \brief    Time series store and query engine of the gateway (Linux)
+/// \details  See tsquery.h. Built with the gateway and the query benchmark
+///           (tools/querybench), needs -pthread.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#define _GNU_SOURCE
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tsquery.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define TSQ_FLEET_CHUNK         8           ///< Series taken at once by a fleet query thread.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oTsqFleetTy
+/// \brief 	Fleet query shared by its threads.
+///
+typedef struct
+{
+	oTsqSeriesTy* const*	ppoSeries;
+	UINT32					u32Series;
+	UINT32					u32From;
+	UINT32					u32To;
+	UINT32					u32Step;
+	UINT32					u32Steps;
+	bool					bRawOnly;
+	oTsqAggTy*				paoOut;
+	UINT32					u32Next;			///< Next series to take.
+	UINT64					u64Buckets;
+	UINT64					u64Points;
+} oTsqFleetTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static const oTsqPointTy* TsqLastPoint(const oTsqSeriesTy* poSeries);
+static void TsqRollupAppend(oTsqRollupTy* poRollup, const oTsqPointTy* poPoint);
+static void TsqScanRaw(const oTsqSeriesTy* poSeries, UINT32 u32From, UINT32 u32To, UINT32 u32Origin, UINT32 u32Step, oTsqAggTy* paoOut, oTsqStatsTy* poStats);
+static void TsqScanRollup(const oTsqRollupTy* poRollup, UINT32 u32From, UINT32 u32To, UINT32 u32Origin, UINT32 u32Step, oTsqAggTy* paoOut, oTsqStatsTy* poStats);
+static void* TsqFleetThread(void* pvArg);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static const UINT32 au32Widths[TSQ_LEVELS] = TSQ_LEVEL_WIDTHS;
+static const UINT32 au32Retention[TSQ_LEVELS] = TSQ_LEVEL_RETENTION;
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TsqSeriesInit - Initializes an empty series.
+/// \public
+///
+/// \return		TRUE if success.
+////////////////////////////////////////////////////////////////////////////////
+bool TsqSeriesInit(oTsqSeriesTy* poSeries, UINT32 u32NodeId)
+{
+	UINT8 u8Level = 0;
+
+	memset(poSeries, 0, sizeof(oTsqSeriesTy));
+	poSeries->u32NodeId = u32NodeId;
+
+	for (u8Level = 0; u8Level < TSQ_LEVELS; ++u8Level)
+	{
+		poSeries->aoRollups[u8Level].u32Width = au32Widths[u8Level];
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TsqSeriesFree - Frees the points and rollups of a series.
+/// \public
+////////////////////////////////////////////////////////////////////////////////
+void TsqSeriesFree(oTsqSeriesTy* poSeries)
+{
+	UINT32	u32Idx	= 0;
+	UINT8	u8Level	= 0;
+
+	for (u32Idx = 0; u32Idx < poSeries->u32Blocks; ++u32Idx)
+	{
+		free(poSeries->ppaoBlocks[u32Idx]);
+	}
+	free(poSeries->ppaoBlocks);
+	free(poSeries->pu32BlockStart);
+
+	for (u8Level = 0; u8Level < TSQ_LEVELS; ++u8Level)
+	{
+		free(poSeries->aoRollups[u8Level].paoBuckets);
+	}
+
+	TsqSeriesInit(poSeries, poSeries->u32NodeId);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TsqAppend - Appends a point and updates the rollups.
+/// \public
+/// \details	Constant time: the point goes at the end of the last block and
+///				into the last bucket of each rollup (or a new one).
+///
+/// \return		TRUE if success, FALSE if the point is older than the last one
+///				or out of memory.
+////////////////////////////////////////////////////////////////////////////////
+bool TsqAppend(oTsqSeriesTy* poSeries, const oTsqPointTy* poPoint)
+{
+	bool				bRet		= FALSE;
+	const oTsqPointTy*	poLast		= TsqLastPoint(poSeries);
+	UINT32				u32Offset	= (UINT32)(poSeries->u64Points % TSQ_BLOCK_POINTS);
+	UINT32				u32NewCap	= 0;
+	oTsqPointTy**		ppaoNew		= NULL;
+	UINT32*				pu32New		= NULL;
+	oTsqBucketTy*		paoNew		= NULL;
+	UINT8				u8Level		= 0;
+
+	if (poLast && (poPoint->u32Time < poLast->u32Time))
+	{
+		++poSeries->u64Refused;
+		goto END;
+	}
+
+	// Everything is allocated before the point is stored, so a failure leaves
+	// the series as it was (a block allocated for nothing waits for the next
+	// point).
+	if ((UINT64)poSeries->u32Blocks * TSQ_BLOCK_POINTS <= poSeries->u64Points)
+	{
+		if (poSeries->u32Blocks == poSeries->u32BlockCapacity)
+		{
+			u32NewCap	= poSeries->u32BlockCapacity ? poSeries->u32BlockCapacity * 2 : 16;
+			ppaoNew		= realloc(poSeries->ppaoBlocks, u32NewCap * sizeof(oTsqPointTy*));
+			if (!ppaoNew) goto END;
+			poSeries->ppaoBlocks = ppaoNew;
+
+			pu32New		= realloc(poSeries->pu32BlockStart, u32NewCap * sizeof(UINT32));
+			if (!pu32New) goto END;
+			poSeries->pu32BlockStart	= pu32New;
+			poSeries->u32BlockCapacity	= u32NewCap;
+		}
+
+		poSeries->ppaoBlocks[poSeries->u32Blocks] = malloc(TSQ_BLOCK_POINTS * sizeof(oTsqPointTy));
+		if (!poSeries->ppaoBlocks[poSeries->u32Blocks]) goto END;
+
+		++poSeries->u32Blocks;
+	}
+
+	for (u8Level = 0; u8Level < TSQ_LEVELS; ++u8Level)
+	{
+		oTsqRollupTy* poRollup = &poSeries->aoRollups[u8Level];
+
+		if ((poRollup->u32Count == poRollup->u32Capacity)
+			&& (!poRollup->u32Count || (poRollup->paoBuckets[poRollup->u32Count - 1].u32Start != poPoint->u32Time - poPoint->u32Time % poRollup->u32Width)))
+		{
+			u32NewCap	= poRollup->u32Capacity ? poRollup->u32Capacity * 2 : 16;
+			paoNew		= realloc(poRollup->paoBuckets, u32NewCap * sizeof(oTsqBucketTy));
+			if (!paoNew) goto END;
+
+			poRollup->paoBuckets	= paoNew;
+			poRollup->u32Capacity	= u32NewCap;
+		}
+	}
+
+	for (u8Level = 0; u8Level < TSQ_LEVELS; ++u8Level)
+	{
+		TsqRollupAppend(&poSeries->aoRollups[u8Level], poPoint);
+	}
+
+	if (u32Offset == 0)
+	{
+		poSeries->pu32BlockStart[poSeries->u64Points / TSQ_BLOCK_POINTS] = poPoint->u32Time;
+	}
+	poSeries->ppaoBlocks[poSeries->u64Points / TSQ_BLOCK_POINTS][u32Offset] = *poPoint;
+	++poSeries->u64Points;
+
+	bRet = TRUE;
+
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TsqTrim - Bounds the memory of a series.
+/// \public
+/// \details	Frees the oldest raw blocks beyond u64MaxPoints (0: no limit),
+///				whole blocks only, and the rollup buckets older than their
+///				retention at u32Now. The queries of older periods read what
+///				is left, the coarser rollups. Linear in the blocks and
+///				buckets held: call it when a block is full, not at each
+///				point.
+///
+/// \return		Raw points freed.
+////////////////////////////////////////////////////////////////////////////////
+UINT64 TsqTrim(oTsqSeriesTy* poSeries, UINT64 u64MaxPoints, UINT32 u32Now)
+{
+	UINT32	u32Drop		= 0;
+	UINT32	u32Idx		= 0;
+	UINT8	u8Level		= 0;
+
+	// Full blocks only: the one of the last point stays.
+	if (u64MaxPoints && (poSeries->u64Points > u64MaxPoints))
+	{
+		u32Drop = (UINT32)((poSeries->u64Points - u64MaxPoints) / TSQ_BLOCK_POINTS);
+	}
+
+	if (u32Drop)
+	{
+		for (u32Idx = 0; u32Idx < u32Drop; ++u32Idx)
+		{
+			free(poSeries->ppaoBlocks[u32Idx]);
+		}
+		memmove(poSeries->ppaoBlocks, &poSeries->ppaoBlocks[u32Drop], (poSeries->u32Blocks - u32Drop) * sizeof(oTsqPointTy*));
+		memmove(poSeries->pu32BlockStart, &poSeries->pu32BlockStart[u32Drop], (poSeries->u32Blocks - u32Drop) * sizeof(UINT32));
+
+		poSeries->u32Blocks		-= u32Drop;
+		poSeries->u64Points		-= (UINT64)u32Drop * TSQ_BLOCK_POINTS;
+		poSeries->u64Trimmed	+= (UINT64)u32Drop * TSQ_BLOCK_POINTS;
+	}
+
+	for (u8Level = 0; u8Level < TSQ_LEVELS; ++u8Level)
+	{
+		oTsqRollupTy* poRollup = &poSeries->aoRollups[u8Level];
+
+		if (!au32Retention[u8Level] || (u32Now < au32Retention[u8Level]))
+		{
+			continue;
+		}
+
+		for (u32Idx = 0; u32Idx < poRollup->u32Count; ++u32Idx)
+		{
+			if (poRollup->paoBuckets[u32Idx].u32Start + poRollup->u32Width > u32Now - au32Retention[u8Level])
+			{
+				break;
+			}
+		}
+
+		if (u32Idx)
+		{
+			memmove(poRollup->paoBuckets, &poRollup->paoBuckets[u32Idx], (poRollup->u32Count - u32Idx) * sizeof(oTsqBucketTy));
+			poRollup->u32Count -= u32Idx;
+		}
+	}
+
+	return (UINT64)u32Drop * TSQ_BLOCK_POINTS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TsqQuery - Aggregates a series over [u32From, u32To), by
+///				periods of u32Step s.
+/// \public
+/// \details	paoOut receives TsqStepCount() periods, the first one starting
+///				at u32From. Uses the coarsest rollup whose width divides both
+///				u32From and u32Step up to the last of its buckets that ends
+///				before u32To, the finer ones for the rest, and the raw points
+///				when no rollup fits (or bRawOnly). Both give the same result.
+///				poStats (optional) is incremented with the work done.
+///
+/// \return		TRUE if success, FALSE if the range or step is invalid.
+////////////////////////////////////////////////////////////////////////////////
+bool TsqQuery(const oTsqSeriesTy* poSeries, UINT32 u32From, UINT32 u32To, UINT32 u32Step, bool bRawOnly, oTsqAggTy* paoOut, oTsqStatsTy* poStats)
+{
+	bool		bRet		= FALSE;
+	UINT32		u32Steps	= TsqStepCount(u32From, u32To, u32Step);
+	UINT32		u32Idx		= 0;
+	UINT32		u32Cut		= u32From;
+	INT8		i8Level		= TSQ_LEVELS - 1;
+	oTsqStatsTy	oStats		= {0};
+
+	if (u32Steps == 0)
+	{
+		goto END;
+	}
+
+	for (u32Idx = 0; u32Idx < u32Steps; ++u32Idx)
+	{
+		paoOut[u32Idx].u32Start			= u32From + u32Idx * u32Step;
+		paoOut[u32Idx].u32Count			= 0;
+		paoOut[u32Idx].u8Minimum		= 0xFF;
+		paoOut[u32Idx].u8Maximum		= 0;
+		paoOut[u32Idx].u64SumAverage	= 0;
+		paoOut[u32Idx].u64SumCurrent	= 0;
+		paoOut[u32Idx].u64SumRaw		= 0;
+	}
+
+	if (!bRawOnly)
+	{
+		// Coarsest rollup aligned on the periods.
+		while ((i8Level >= 0) && ((u32Step % au32Widths[i8Level]) || (u32From % au32Widths[i8Level])))
+		{
+			--i8Level;
+		}
+
+		// Each level covers the whole buckets it can, the next finer one
+		// takes over from there (the widths divide each other).
+		for (; i8Level >= 0; --i8Level)
+		{
+			UINT32 u32End = u32To - u32To % au32Widths[i8Level];
+
+			if (u32End > u32Cut)
+			{
+				TsqScanRollup(&poSeries->aoRollups[i8Level], u32Cut, u32End, u32From, u32Step, paoOut, &oStats);
+				u32Cut = u32End;
+			}
+		}
+	}
+
+	if (u32Cut < u32To)
+	{
+		TsqScanRaw(poSeries, u32Cut, u32To, u32From, u32Step, paoOut, &oStats);
+	}
+
+	if (poStats)
+	{
+		poStats->u64Buckets	+= oStats.u64Buckets;
+		poStats->u64Points	+= oStats.u64Points;
+	}
+
+	bRet = TRUE;
+
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TsqQueryFleet - TsqQuery() on many series, spread over
+///				threads.
+/// \public
+/// \details	paoOut receives TsqStepCount() periods per series, series after
+///				series. u32Threads 0 uses one thread per core. The threads
+///				take the series by chunks of TSQ_FLEET_CHUNK, so a few long
+///				series do not hold the others back. The series must not be
+///				written during the query.
+///
+/// \return		TRUE if success, FALSE if the range or step is invalid.
+////////////////////////////////////////////////////////////////////////////////
+bool TsqQueryFleet(oTsqSeriesTy* const* ppoSeries, UINT32 u32Series, UINT32 u32From, UINT32 u32To, UINT32 u32Step, bool bRawOnly, UINT32 u32Threads, oTsqAggTy* paoOut, oTsqStatsTy* poStats)
+{
+	bool		bRet		= FALSE;
+	oTsqFleetTy	oFleet;
+	pthread_t	aoThreads[TSQ_THREADS_MAX];
+	UINT32		u32Started	= 0;
+	UINT32		u32Idx		= 0;
+
+	memset(&oFleet, 0, sizeof(oFleet));
+	oFleet.ppoSeries	= ppoSeries;
+	oFleet.u32Series	= u32Series;
+	oFleet.u32From		= u32From;
+	oFleet.u32To		= u32To;
+	oFleet.u32Step		= u32Step;
+	oFleet.u32Steps		= TsqStepCount(u32From, u32To, u32Step);
+	oFleet.bRawOnly		= bRawOnly;
+	oFleet.paoOut		= paoOut;
+
+	if (oFleet.u32Steps == 0)
+	{
+		goto END;
+	}
+
+	if (u32Threads == 0)
+	{
+		u32Threads = (UINT32)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (u32Threads > TSQ_THREADS_MAX)
+	{
+		u32Threads = TSQ_THREADS_MAX;
+	}
+	if (u32Threads > (u32Series + TSQ_FLEET_CHUNK - 1) / TSQ_FLEET_CHUNK)
+	{
+		u32Threads = (u32Series + TSQ_FLEET_CHUNK - 1) / TSQ_FLEET_CHUNK;
+	}
+
+	// The calling thread is one of them.
+	for (u32Idx = 1; u32Idx < u32Threads; ++u32Idx)
+	{
+		if (pthread_create(&aoThreads[u32Started], NULL, TsqFleetThread, &oFleet) == 0)
+		{
+			++u32Started;
+		}
+	}
+
+	TsqFleetThread(&oFleet);
+
+	for (u32Idx = 0; u32Idx < u32Started; ++u32Idx)
+	{
+		pthread_join(aoThreads[u32Idx], NULL);
+	}
+
+	if (poStats)
+	{
+		poStats->u64Buckets	+= oFleet.u64Buckets;
+		poStats->u64Points	+= oFleet.u64Points;
+	}
+
+	bRet = TRUE;
+
+END:
+	return bRet;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TsqStepCount - Periods of u32Step s in [u32From, u32To).
+/// \public
+///
+/// \return		Number of periods, the last one may be partial. 0 if the range
+///				or step is invalid.
+////////////////////////////////////////////////////////////////////////////////
+UINT32 TsqStepCount(UINT32 u32From, UINT32 u32To, UINT32 u32Step)
+{
+	if ((u32Step == 0) || (u32To <= u32From))
+	{
+		return 0;
+	}
+
+	return (UINT32)(((UINT64)u32To - u32From + u32Step - 1) / u32Step);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		TsqFindBlock - Range seek in the time index.
+/// \public
+/// \details	Binary search for the last block starting before u32Time: the
+///				blocks before it only hold older points.
+///
+/// \return		Index of the first block that may hold points at or after
+///				u32Time (0 if the series is empty).
+////////////////////////////////////////////////////////////////////////////////
+UINT32 TsqFindBlock(const oTsqSeriesTy* poSeries, UINT32 u32Time)
+{
+	UINT32 u32Low	= 0;
+	UINT32 u32High	= (UINT32)((poSeries->u64Points + TSQ_BLOCK_POINTS - 1) / TSQ_BLOCK_POINTS);
+
+	// First block starting at or after u32Time.
+	while (u32Low < u32High)
+	{
+		UINT32 u32Mid = u32Low + (u32High - u32Low) / 2;
+
+		if (poSeries->pu32BlockStart[u32Mid] < u32Time)
+		{
+			u32Low = u32Mid + 1;
+		}
+		else
+		{
+			u32High = u32Mid;
+		}
+	}
+
+	return (u32Low > 0) ? u32Low - 1 : u32Low;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static const oTsqPointTy* TsqLastPoint(const oTsqSeriesTy* poSeries)
+{
+	if (poSeries->u64Points == 0)
+	{
+		return NULL;
+	}
+
+	return &poSeries->ppaoBlocks[(poSeries->u64Points - 1) / TSQ_BLOCK_POINTS][(poSeries->u64Points - 1) % TSQ_BLOCK_POINTS];
+}
+
+static void TsqRollupAppend(oTsqRollupTy* poRollup, const oTsqPointTy* poPoint)
+{
+	UINT32			u32Start	= poPoint->u32Time - poPoint->u32Time % poRollup->u32Width;
+	oTsqBucketTy*	poBucket	= poRollup->u32Count ? &poRollup->paoBuckets[poRollup->u32Count - 1] : NULL;
+
+	if (!poBucket || (poBucket->u32Start != u32Start))
+	{
+		// Room made by TsqAppend().
+		poBucket = &poRollup->paoBuckets[poRollup->u32Count++];
+		memset(poBucket, 0, sizeof(oTsqBucketTy));
+		poBucket->u32Start	= u32Start;
+		poBucket->u8Minimum	= 0xFF;
+	}
+
+	++poBucket->u32Count;
+	poBucket->u32SumAverage	+= poPoint->u8AverageValue;
+	poBucket->u32SumCurrent	+= poPoint->u8CurrentValue;
+	poBucket->u32SumRaw		+= poPoint->u16RawValue;
+	if (poPoint->u8MinimumValue < poBucket->u8Minimum)
+	{
+		poBucket->u8Minimum = poPoint->u8MinimumValue;
+	}
+	if (poPoint->u8MaximumValue > poBucket->u8Maximum)
+	{
+		poBucket->u8Maximum = poPoint->u8MaximumValue;
+	}
+}
+
+static void TsqScanRaw(const oTsqSeriesTy* poSeries, UINT32 u32From, UINT32 u32To, UINT32 u32Origin, UINT32 u32Step, oTsqAggTy* paoOut, oTsqStatsTy* poStats)
+{
+	UINT32 u32Block	= TsqFindBlock(poSeries, u32From);
+	UINT64 u64Point	= (UINT64)u32Block * TSQ_BLOCK_POINTS;
+	UINT64 u64High	= u64Point + TSQ_BLOCK_POINTS;
+
+	// First point at or after u32From, within the block.
+	if (u64High > poSeries->u64Points)
+	{
+		u64High = poSeries->u64Points;
+	}
+	while (u64Point < u64High)
+	{
+		UINT64 u64Mid = u64Point + (u64High - u64Point) / 2;
+
+		if (poSeries->ppaoBlocks[u32Block][u64Mid % TSQ_BLOCK_POINTS].u32Time < u32From)
+		{
+			u64Point = u64Mid + 1;
+		}
+		else
+		{
+			u64High = u64Mid;
+		}
+	}
+
+	for (; u64Point < poSeries->u64Points; ++u64Point)
+	{
+		const oTsqPointTy*	poPoint	= &poSeries->ppaoBlocks[u64Point / TSQ_BLOCK_POINTS][u64Point % TSQ_BLOCK_POINTS];
+		oTsqAggTy*			poOut	= NULL;
+
+		if (poPoint->u32Time >= u32To)
+		{
+			break;
+		}
+
+		++poStats->u64Points;
+		poOut = &paoOut[(poPoint->u32Time - u32Origin) / u32Step];
+		++poOut->u32Count;
+		poOut->u64SumAverage	+= poPoint->u8AverageValue;
+		poOut->u64SumCurrent	+= poPoint->u8CurrentValue;
+		poOut->u64SumRaw		+= poPoint->u16RawValue;
+		if (poPoint->u8MinimumValue < poOut->u8Minimum)
+		{
+			poOut->u8Minimum = poPoint->u8MinimumValue;
+		}
+		if (poPoint->u8MaximumValue > poOut->u8Maximum)
+		{
+			poOut->u8Maximum = poPoint->u8MaximumValue;
+		}
+	}
+}
+
+static void TsqScanRollup(const oTsqRollupTy* poRollup, UINT32 u32From, UINT32 u32To, UINT32 u32Origin, UINT32 u32Step, oTsqAggTy* paoOut, oTsqStatsTy* poStats)
+{
+	UINT32 u32Low	= 0;
+	UINT32 u32High	= poRollup->u32Count;
+
+	// First bucket at or after u32From.
+	while (u32Low < u32High)
+	{
+		UINT32 u32Mid = u32Low + (u32High - u32Low) / 2;
+
+		if (poRollup->paoBuckets[u32Mid].u32Start < u32From)
+		{
+			u32Low = u32Mid + 1;
+		}
+		else
+		{
+			u32High = u32Mid;
+		}
+	}
+
+	for (; (u32Low < poRollup->u32Count) && (poRollup->paoBuckets[u32Low].u32Start < u32To); ++u32Low)
+	{
+		const oTsqBucketTy*	poBucket	= &poRollup->paoBuckets[u32Low];
+		oTsqAggTy*			poOut		= &paoOut[(poBucket->u32Start - u32Origin) / u32Step];
+
+		++poStats->u64Buckets;
+		poOut->u32Count			+= poBucket->u32Count;
+		poOut->u64SumAverage	+= poBucket->u32SumAverage;
+		poOut->u64SumCurrent	+= poBucket->u32SumCurrent;
+		poOut->u64SumRaw		+= poBucket->u32SumRaw;
+		if (poBucket->u8Minimum < poOut->u8Minimum)
+		{
+			poOut->u8Minimum = poBucket->u8Minimum;
+		}
+		if (poBucket->u8Maximum > poOut->u8Maximum)
+		{
+			poOut->u8Maximum = poBucket->u8Maximum;
+		}
+	}
+}
+
+static void* TsqFleetThread(void* pvArg)
+{
+	oTsqFleetTy*	poFleet	= (oTsqFleetTy*)pvArg;
+	oTsqStatsTy		oStats	= {0};
+	UINT32			u32Idx	= 0;
+	UINT32			u32End	= 0;
+
+	for (;;)
+	{
+		u32Idx = __atomic_fetch_add(&poFleet->u32Next, TSQ_FLEET_CHUNK, __ATOMIC_RELAXED);
+		if (u32Idx >= poFleet->u32Series)
+		{
+			break;
+		}
+
+		u32End = (u32Idx + TSQ_FLEET_CHUNK < poFleet->u32Series) ? u32Idx + TSQ_FLEET_CHUNK : poFleet->u32Series;
+		for (; u32Idx < u32End; ++u32Idx)
+		{
+			TsqQuery(poFleet->ppoSeries[u32Idx], poFleet->u32From, poFleet->u32To, poFleet->u32Step, poFleet->bRawOnly,
+				&poFleet->paoOut[(UINT64)u32Idx * poFleet->u32Steps], &oStats);
+		}
+	}
+
+	__atomic_add_fetch(&poFleet->u64Buckets, oStats.u64Buckets, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&poFleet->u64Points, oStats.u64Points, __ATOMIC_RELAXED);
+
+	return NULL;
+}
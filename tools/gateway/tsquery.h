@@ -0,0 +1,151 @@
+///
+/// \file     tsquery.h
+/// \brief    Time series store and query engine of the gateway (Linux)
+/// \details  Keeps the readings of each node (the fields of oCommReportTy)
+///           and answers range queries like "daily min/max/avg of every
+///           probe over a season" without going through the raw points:
+///
+///           - Raw points: in fixed size blocks, with a time index (start
+///             time of each block) for the range seeks.
+///           - Rollups: one sparse bucket list per resolution (1 h, 1 day),
+///             updated as the points are appended. A bucket holds the
+///             count, the lowest minimum, the highest maximum and the sums
+///             of the averages, current and raw values. None is finer than
+///             the report period (MOISTURE_HEARTBEAT, 15 min): such a
+///             bucket holds a single point, costs more than the point and
+///             reads no faster.
+///           - Retention: TsqTrim() bounds a series to a number of raw
+///             points and each rollup to TSQ_LEVEL_RETENTION.
+///           - Queries pick the coarsest rollup that fits the requested
+///             resolution and range, and read raw points only for the edges
+///             not aligned on it. TsqQueryFleet() spreads the series over
+///             threads.
+///
+///           Times are in seconds (UTC epoch); buckets are aligned on
+///           multiples of their width, so the days are UTC days. Points are
+///           appended in time order: older ones are refused. A series has
+///           one writer, and is not queried while it is written.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef TSQUERY_H
+#define TSQUERY_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "TypeDefs.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define TSQ_BLOCK_POINTS        1024        ///< Raw points per block.
+#define TSQ_LEVELS              2           ///< Rollup resolutions.
+#define TSQ_LEVEL_WIDTHS        {3600, 86400}     ///< Width of each rollup, in s. Each one divides the next.
+#define TSQ_LEVEL_RETENTION     {92 * 86400UL, 3 * 366 * 86400UL}     ///< Age of the oldest bucket kept by TsqTrim(), in s. 0: no limit.
+#define TSQ_THREADS_MAX         64
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oTsqPointTy
+/// \brief 	One reading.
+///
+typedef struct
+{
+	UINT32		u32Time;				///< Seconds, UTC epoch.
+	UINT16		u16RawValue;
+	UINT8		u8CurrentValue;			///< In %.
+	UINT8		u8MinimumValue;			///< In %.
+	UINT8		u8MaximumValue;			///< In %.
+	UINT8		u8AverageValue;			///< In %.
+} oTsqPointTy;
+
+///
+/// \struct	oTsqBucketTy
+/// \brief 	Rollup of the points of one period.
+///
+typedef struct
+{
+	UINT32		u32Start;				///< Start of the period, in s.
+	UINT32		u32Count;
+	UINT32		u32SumAverage;
+	UINT32		u32SumCurrent;
+	UINT32		u32SumRaw;
+	UINT8		u8Minimum;				///< Lowest u8MinimumValue.
+	UINT8		u8Maximum;				///< Highest u8MaximumValue.
+} oTsqBucketTy;
+
+///
+/// \struct	oTsqRollupTy
+/// \brief 	Buckets of one resolution, non-empty ones only, in time order.
+///
+typedef struct
+{
+	UINT32			u32Width;			///< In s.
+	oTsqBucketTy*	paoBuckets;
+	UINT32			u32Count;
+	UINT32			u32Capacity;
+} oTsqRollupTy;
+
+///
+/// \struct	oTsqSeriesTy
+/// \brief 	Points and rollups of one node.
+///
+typedef struct
+{
+	UINT32			u32NodeId;
+	oTsqPointTy**	ppaoBlocks;						///< Raw points, TSQ_BLOCK_POINTS per block.
+	UINT32*			pu32BlockStart;					///< Time index: time of the first point of each block.
+	UINT32			u32Blocks;
+	UINT32			u32BlockCapacity;
+	UINT64			u64Points;						///< Raw points held.
+	UINT64			u64Refused;						///< Points older than the last one.
+	UINT64			u64Trimmed;						///< Raw points freed by TsqTrim().
+	oTsqRollupTy	aoRollups[TSQ_LEVELS];
+} oTsqSeriesTy;
+
+///
+/// \struct	oTsqAggTy
+/// \brief 	Result of a query, for one period.
+///
+typedef struct
+{
+	UINT32		u32Start;				///< Start of the period, in s.
+	UINT32		u32Count;				///< Points. 0: no data, the other fields are meaningless.
+	UINT8		u8Minimum;
+	UINT8		u8Maximum;
+	UINT64		u64SumAverage;
+	UINT64		u64SumCurrent;
+	UINT64		u64SumRaw;
+} oTsqAggTy;
+
+///
+/// \struct	oTsqStatsTy
+/// \brief 	Work done by a query.
+///
+typedef struct
+{
+	UINT64		u64Buckets;				///< Rollup buckets read.
+	UINT64		u64Points;				///< Raw points read.
+} oTsqStatsTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+bool TsqSeriesInit(oTsqSeriesTy* poSeries, UINT32 u32NodeId);
+void TsqSeriesFree(oTsqSeriesTy* poSeries);
+bool TsqAppend(oTsqSeriesTy* poSeries, const oTsqPointTy* poPoint);
+UINT64 TsqTrim(oTsqSeriesTy* poSeries, UINT64 u64MaxPoints, UINT32 u32Now);
+
+bool TsqQuery(const oTsqSeriesTy* poSeries, UINT32 u32From, UINT32 u32To, UINT32 u32Step, bool bRawOnly, oTsqAggTy* paoOut, oTsqStatsTy* poStats);
+bool TsqQueryFleet(oTsqSeriesTy* const* ppoSeries, UINT32 u32Series, UINT32 u32From, UINT32 u32To, UINT32 u32Step, bool bRawOnly, UINT32 u32Threads, oTsqAggTy* paoOut, oTsqStatsTy* poStats);
+UINT32 TsqStepCount(UINT32 u32From, UINT32 u32To, UINT32 u32Step);
+UINT32 TsqFindBlock(const oTsqSeriesTy* poSeries, UINT32 u32Time);
+
+#endif
@@ -0,0 +1,81 @@
+///
+/// \file     Arduino.h
+/// \brief    Host (Linux) replacement of the Arduino core header
+/// \details  Lets the host tools under tools/ include the firmware headers
+///           and compile the hardware independent modules. Only what the
+///           modules use is declared here.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+// The ESP8266 SDK (c_types.h) provides these through Arduino.h.
+#ifndef TRUE
+#define TRUE    true
+#define FALSE   false
+#endif
+#define BOOL    bool
+
+#define A0      17
+#define D5      14
+#define D8      15
+
+#define INPUT   0x00
+#define OUTPUT  0x01
+
+#define LOW     0x00
+#define HIGH    0x01
+
+// No separate flash address space on the host.
+#define PROGMEM
+#define memcpy_P    memcpy
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef uint16_t (*HostArduinoAnalogReadFuncTy)(uint8_t u8Pin);                    ///< Source of analogRead().
+typedef void (*HostArduinoDigitalWriteFuncTy)(uint8_t u8Pin, uint8_t u8Level);     ///< Sink of digitalWrite().
+typedef bool (*HostArduinoUdpSendFuncTy)(void* pvMsg);                              ///< Network stack of CommMgr (poBufTy).
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Prototypes
+////////////////////////////////////////////////////////////////////////////////
+// Arduino core subset, see HostArduino.c. The clock is virtual: it only
+// moves when the tool sets it (or through delay()).
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ulMs);
+int analogRead(uint8_t u8Pin);
+void digitalWrite(uint8_t u8Pin, uint8_t u8Level);
+int digitalRead(uint8_t u8Pin);
+void pinMode(uint8_t u8Pin, uint8_t u8Mode);
+
+// Host side controls.
+void HostArduinoSetMillis(uint32_t u32Ms);
+void HostArduinoAdvance(uint32_t u32Ms);
+void HostArduinoSetAnalogRead(HostArduinoAnalogReadFuncTy pfRead);
+void HostArduinoSetDigitalWrite(HostArduinoDigitalWriteFuncTy pfWrite);
+
+// Virtual network, for the host paths of WifiMgr and CommMgr.
+void HostArduinoSetLink(bool bUp);
+bool HostArduinoIsLinkUp(void);
+void HostArduinoSetUdpSend(HostArduinoUdpSendFuncTy pfSend);
+bool HostArduinoUdpSend(void* pvMsg);
+
+#endif
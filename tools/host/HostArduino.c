@@ -0,0 +1,172 @@
+///
+/// \file     HostArduino.c
+/// \brief    Host (Linux) replacement of the Arduino core functions
+/// \details  Virtual time and pins for the host tools that run firmware
+///           modules. millis() returns whatever the tool set, so hours of
+///           operation can be simulated in milliseconds. analogRead() and
+///           digitalWrite() are forwarded to callbacks of the tool, and so
+///           are the UDP sends of CommMgr; the WiFi link is up unless the
+///           tool drops it.
+///
+///           Link it with the tool: gcc ... tools/host/HostArduino.c
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "Arduino.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define HOSTARDUINO_PIN_MAX     32          ///< Pins with a remembered level.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oHostArduinoTy
+/// \brief 	Virtual board.
+///
+typedef struct
+{
+	uint32_t						u32Millis;							///< Virtual time, in ms.
+	HostArduinoAnalogReadFuncTy		pfAnalogRead;						///< NULL: analogRead() returns 0.
+	HostArduinoDigitalWriteFuncTy	pfDigitalWrite;						///< NULL: levels are only remembered.
+	uint8_t							au8Level[HOSTARDUINO_PIN_MAX];		///< Last level written to each pin.
+	bool							bLinkDown;							///< WiFi link, up by default.
+	HostArduinoUdpSendFuncTy		pfUdpSend;							///< NULL: every send succeeds.
+} oHostArduinoTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oHostArduinoTy oHostArduino = {0};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Arduino core
+////////////////////////////////////////////////////////////////////////////////
+unsigned long millis(void)
+{
+	return oHostArduino.u32Millis;
+}
+
+unsigned long micros(void)
+{
+	return (unsigned long)(uint32_t)(oHostArduino.u32Millis * 1000UL);
+}
+
+void delay(unsigned long ulMs)
+{
+	oHostArduino.u32Millis += (uint32_t)ulMs;
+}
+
+int analogRead(uint8_t u8Pin)
+{
+	return oHostArduino.pfAnalogRead ? oHostArduino.pfAnalogRead(u8Pin) : 0;
+}
+
+void digitalWrite(uint8_t u8Pin, uint8_t u8Level)
+{
+	if (u8Pin < HOSTARDUINO_PIN_MAX)
+	{
+		oHostArduino.au8Level[u8Pin] = u8Level ? HIGH : LOW;
+	}
+
+	if (oHostArduino.pfDigitalWrite)
+	{
+		oHostArduino.pfDigitalWrite(u8Pin, u8Level ? HIGH : LOW);
+	}
+}
+
+int digitalRead(uint8_t u8Pin)
+{
+	return (u8Pin < HOSTARDUINO_PIN_MAX) ? oHostArduino.au8Level[u8Pin] : LOW;
+}
+
+void pinMode(uint8_t u8Pin, uint8_t u8Mode)
+{
+	(void)u8Pin;
+	(void)u8Mode;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Host side controls
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HostArduinoSetMillis - Sets the virtual time.
+///
+/// \param[in]	u32Ms	New value of millis(). Wraps like the real one.
+////////////////////////////////////////////////////////////////////////////////
+void HostArduinoSetMillis(uint32_t u32Ms)
+{
+	oHostArduino.u32Millis = u32Ms;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HostArduinoAdvance - Moves the virtual time forward.
+///
+/// \param[in]	u32Ms	Milliseconds to add.
+////////////////////////////////////////////////////////////////////////////////
+void HostArduinoAdvance(uint32_t u32Ms)
+{
+	oHostArduino.u32Millis += u32Ms;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HostArduinoSetAnalogRead - Sets the source of analogRead().
+///
+/// \param[in]	pfRead	Callback, NULL for a constant 0.
+////////////////////////////////////////////////////////////////////////////////
+void HostArduinoSetAnalogRead(HostArduinoAnalogReadFuncTy pfRead)
+{
+	oHostArduino.pfAnalogRead = pfRead;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HostArduinoSetDigitalWrite - Sets the sink of digitalWrite().
+///
+/// \param[in]	pfWrite	Callback, NULL to only remember the levels.
+////////////////////////////////////////////////////////////////////////////////
+void HostArduinoSetDigitalWrite(HostArduinoDigitalWriteFuncTy pfWrite)
+{
+	oHostArduino.pfDigitalWrite = pfWrite;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HostArduinoSetLink - Brings the virtual WiFi link up or down.
+///
+/// \param[in]	bUp		TRUE for up (the default).
+////////////////////////////////////////////////////////////////////////////////
+void HostArduinoSetLink(bool bUp)
+{
+	oHostArduino.bLinkDown = !bUp;
+}
+
+bool HostArduinoIsLinkUp(void)
+{
+	return !oHostArduino.bLinkDown;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		HostArduinoSetUdpSend - Sets the network stack of CommMgr.
+/// \details	The callback may keep a reference on the buffer (BufPoolRef()),
+///				as lwIP does with the PBUF_REF of the firmware.
+///
+/// \param[in]	pfSend	Callback, NULL for sends that always succeed.
+////////////////////////////////////////////////////////////////////////////////
+void HostArduinoSetUdpSend(HostArduinoUdpSendFuncTy pfSend)
+{
+	oHostArduino.pfUdpSend = pfSend;
+}
+
+bool HostArduinoUdpSend(void* pvMsg)
+{
+	return oHostArduino.pfUdpSend ? oHostArduino.pfUdpSend(pvMsg) : true;
+}
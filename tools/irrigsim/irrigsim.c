@@ -0,0 +1,468 @@
+///
+/// \file     irrigsim.c
+/// \brief    Closed-loop irrigation simulation (Linux)
+/// \details  Runs the firmware MoistSensorMgr and IrrigationMgr on the
+///           virtual board against a simulated pot: the valve output feeds
+///           a surface water store that infiltrates into the root zone with
+///           a lag, the plant takes water out with a day/night cycle
+///           (slower when the soil is dry), the excess above the field
+///           capacity drains, and the probe reads the root zone with noise.
+///
+///           Checked at every step (exit 1 on any violation):
+///           - no opening longer than the maximum on-time (plus one loop
+///             step) and no two openings closer than the minimum off-time;
+///           - no more water per day than the daily cap;
+///           - no opening on a BAD reading (-f disconnects the probe for two
+///             hours, it then reads "bone dry");
+///           - the valve reacts in the same loop() iteration as the reading
+///             that decided it (reading-to-actuation latency of 0 on the
+///             virtual clock). The wall-clock time of that path is printed.
+///
+///           Build:
+///             gcc -O2 -Itools/host -I. -o irrigsim tools/irrigsim/irrigsim.c
+///                 tools/host/HostArduino.c SystemTime.c MoistSensorMgr.c
+///                 SensorHealth.c CalibMgr.c TraceMgr.c IrrigationMgr.c
+///                 StreamStats.c -lm
+///
+///           Usage: ./irrigsim [-m 1|2] [-d days] [-l loop ms] [-f] [-s seed]
+///             -m 1: hysteresis, -m 2: PI (default).
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MoistSensorMgr.h"
+#include "IrrigationMgr.h"
+#include "CalibMgr.h"
+#include "SensorHealth.h"
+#include "SystemTime.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SIM_DAY                 86400000ULL     ///< One day, in ms.
+#define SIM_HOUR                3600000ULL      ///< One hour, in ms.
+#define SIM_DAYS                14              ///< Default simulated time.
+#define SIM_LOOP_MS             20              ///< Default loop period.
+#define SIM_SENSOR_PIN          D8
+#define SIM_VALVE_PIN           D5
+
+// Pot.
+#define SIM_ROOT_ZONE_ML        100000.0        ///< Water held by the root zone at 100 %.
+#define SIM_INFILTRATION_MS     600000.0        ///< Time constant of the surface store.
+#define SIM_FIELD_CAPACITY      60.0            ///< Moisture above which the pot drains, in %.
+#define SIM_DRAIN_PER_HOUR      0.5             ///< Share of the excess drained per hour.
+#define SIM_ET_PEAK             1.5             ///< Plant uptake at noon in a moist soil, in % per hour.
+#define SIM_ET_NIGHT            0.1             ///< Night uptake, share of the peak.
+#define SIM_ET_DRY              40.0            ///< Moisture below which the uptake slows down, in %.
+#define SIM_WILTING             20.0            ///< Plant stress below, in %.
+#define SIM_NOISE               3               ///< Probe noise, +/- raw counts.
+
+// Fault injection (-f).
+#define SIM_FAULT_START         (2 * SIM_DAY + 13 * SIM_HOUR)
+#define SIM_FAULT_LENGTH        (2 * SIM_HOUR)
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef enum
+{
+	SIM_CHECK_MAX_ON = 0,
+	SIM_CHECK_MIN_OFF,
+	SIM_CHECK_DAILY_CAP,
+	SIM_CHECK_FAULT,
+	SIM_CHECK_LATENCY,
+	SIM_CHECK_MAX
+} SimCheckTy;
+
+///
+/// \struct	oSimDayTy
+/// \brief 	Statistics of one day.
+///
+typedef struct
+{
+	double		dMin;
+	double		dMax;
+	double		dSum;
+	UINT32		u32Samples;
+	double		dWater;					///< mL.
+	UINT32		u32Openings;
+	UINT64		u64Stress;				///< Time below the wilting point, in ms.
+} oSimDayTy;
+
+///
+/// \struct	oSimTy
+/// \brief 	Simulation state.
+///
+typedef struct
+{
+	// Options.
+	UINT8				u8Mode;
+	UINT32				u32Days;
+	UINT32				u32LoopMs;
+	bool				bFault;
+	UINT32				u32Seed;
+
+	// Virtual node.
+	poMoistSensorMgrTy	poSensor;
+	poIrrigationMgrTy	poIrrigation;
+	UINT64				u64Now;					///< Elapsed time, in ms.
+	UINT32				u32Iteration;			///< loop() iteration.
+
+	// Pot.
+	double				dMoisture;				///< Root zone, in %.
+	double				dSurface;				///< Water not infiltrated yet, in mL.
+
+	// Valve, as seen on the pin.
+	bool				bValve;
+	UINT64				u64ValveChange;			///< Time of the last change.
+	bool				bHasClosed;
+	struct timespec		oValveWall;				///< Wall-clock time of the last change.
+
+	// Statistics.
+	oSimDayTy			oDay;
+	double				dWaterTotal;
+	UINT64				u64StressTotal;
+	UINT64				u64LongestOn;
+	UINT64				u64ShortestOff;
+	UINT32				u32Readings;
+	UINT32				u32Actuations;			///< Valve changes decided by a reading.
+	double				dWallMax;				///< Longest reading-to-pin path, in us.
+	double				dWallSum;
+	UINT32				au32Violations[SIM_CHECK_MAX];
+} oSimTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void SimLoop();
+static void SimPot(UINT32 u32Step);
+static void SimEndOfDay(UINT32 u32Day);
+static UINT16 SimAnalogRead(UINT8 u8Pin);
+static void SimDigitalWrite(UINT8 u8Pin, UINT8 u8Level);
+static void SimViolation(SimCheckTy eCheck, const char* pszFormat, double dA, double dB);
+static UINT32 SimRand();
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oSimTy oSim = {0};
+
+static const char* const apszCheck[SIM_CHECK_MAX] = {
+	"maximum on-time", "minimum off-time", "daily cap", "no watering on fault", "same-iteration actuation"
+};
+
+
+int main(int argc, char** argv)
+{
+	oCalibCurveTy	oCurve		= {0};
+	UINT64			u64End		= 0;
+	UINT32			u32Total	= 0;
+	int				iOpt		= 0;
+	int				iCheck		= 0;
+
+	oSim.u8Mode		= IRRIGATIONMGR_MODE_PI;
+	oSim.u32Days	= SIM_DAYS;
+	oSim.u32LoopMs	= SIM_LOOP_MS;
+	oSim.u32Seed	= 1;
+
+	while ((iOpt = getopt(argc, argv, "m:d:l:fs:h")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'm': oSim.u8Mode	= (UINT8)atoi(optarg); break;
+		case 'd': oSim.u32Days	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'l': oSim.u32LoopMs	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'f': oSim.bFault	= TRUE; break;
+		case 's': oSim.u32Seed	= (UINT32)strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "Usage: %s [-m 1 hysteresis|2 PI] [-d days] [-l loop ms] [-f] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (!oSim.u32LoopMs)
+	{
+		oSim.u32LoopMs = 1;
+	}
+
+	// Virtual node, same bring-up as the boot sequence.
+	HostArduinoSetAnalogRead(SimAnalogRead);
+	HostArduinoSetDigitalWrite(SimDigitalWrite);
+	HostArduinoSetMillis(0);
+	SystemTimeInit();
+
+	oSim.poSensor = MoistSensorMgr(SIM_SENSOR_PIN);
+	if (!CalibMgrBuild(0, &oCurve, oSim.poSensor->u16MapMax, oSim.poSensor->u16MapMin)
+		|| !MoistSensorMgrConfigure(oSim.poSensor))
+	{
+		fprintf(stderr, "Sensor configuration failed\n");
+		return 1;
+	}
+
+	// Defaults of the firmware, only the mode changes.
+	oSim.poIrrigation			= IrrigationMgr(SIM_VALVE_PIN);
+	oSim.poIrrigation->u8Mode	= oSim.u8Mode;
+	if (!IrrigationMgrConfigure(oSim.poIrrigation))
+	{
+		fprintf(stderr, "Irrigation configuration failed\n");
+		return 1;
+	}
+
+	oSim.dMoisture		= 35.0;
+	oSim.u64ShortestOff	= (UINT64)-1;
+	oSim.oDay.dMin		= 100.0;
+	u64End				= oSim.u32Days * SIM_DAY;
+
+	printf("%s, %u days, flow %u mL/min, max on %lu s, min off %lu s, cap %lu mL/day%s\n",
+		(oSim.u8Mode == IRRIGATIONMGR_MODE_HYSTERESIS) ? "hysteresis" : "PI", oSim.u32Days,
+		oSim.poIrrigation->u16Flow, (unsigned long)oSim.poIrrigation->u32MaxOn / 1000,
+		(unsigned long)oSim.poIrrigation->u32MinOff / 1000, (unsigned long)oSim.poIrrigation->u32DailyCap,
+		oSim.bFault ? ", probe disconnected on day 3" : "");
+	printf("day   min %%   avg %%   max %%   water mL  openings  stress min\n");
+
+	while (oSim.u64Now < u64End)
+	{
+		SimLoop();
+
+		if ((oSim.u64Now % SIM_DAY) < oSim.u32LoopMs)
+		{
+			SimEndOfDay((UINT32)(oSim.u64Now / SIM_DAY));
+		}
+	}
+
+	printf("water %.0f mL, %u openings, longest %.0f s, shortest off %.0f s, stress %.0f min\n",
+		oSim.dWaterTotal, oSim.poIrrigation->u32Openings, oSim.u64LongestOn / 1000.0,
+		(oSim.u64ShortestOff == (UINT64)-1) ? 0.0 : oSim.u64ShortestOff / 1000.0, oSim.u64StressTotal / 60000.0);
+	printf("refused: min-off %u, cap %u, fault %u; max-on cutoffs %u\n",
+		oSim.poIrrigation->u32BlockedMinOff, oSim.poIrrigation->u32BlockedCap,
+		oSim.poIrrigation->u32BlockedFault, oSim.poIrrigation->u32MaxOnCutoffs);
+	printf("%u readings, %u actuations; reading-to-pin path %.2f us mean, %.2f us max (wall clock)\n",
+		oSim.u32Readings, oSim.u32Actuations, oSim.u32Readings ? oSim.dWallSum / oSim.u32Readings : 0.0, oSim.dWallMax);
+
+	for (iCheck = 0; iCheck < SIM_CHECK_MAX; ++iCheck)
+	{
+		printf("  %-26s %s (%u)\n", apszCheck[iCheck], oSim.au32Violations[iCheck] ? "FAILED" : "ok", oSim.au32Violations[iCheck]);
+		u32Total += oSim.au32Violations[iCheck];
+	}
+
+	return u32Total ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void SimLoop()
+{
+	BOOL			bNewReading	= FALSE;
+	bool			bValve		= FALSE;
+	struct timespec	oStart;
+	double			dWall		= 0;
+
+	// Next loop iteration.
+	HostArduinoAdvance(oSim.u32LoopMs);
+	oSim.u64Now += oSim.u32LoopMs;
+	++oSim.u32Iteration;
+
+	SimPot(oSim.u32LoopMs);
+
+	// Application loop, sensor and irrigation side, in the firmware order.
+	MoistSensorMgrTask();
+
+	if (MoistSensorMgrIsNewReadingAvail(&bNewReading) && bNewReading)
+	{
+		bValve = oSim.bValve;
+		clock_gettime(CLOCK_MONOTONIC, &oStart);
+
+		IrrigationMgrOnReading(oSim.poIrrigation, oSim.poSensor);
+		++oSim.u32Readings;
+
+		if (oSim.bValve != bValve)
+		{
+			++oSim.u32Actuations;
+
+			dWall = (oSim.oValveWall.tv_sec - oStart.tv_sec) * 1e6 + (oSim.oValveWall.tv_nsec - oStart.tv_nsec) / 1e3;
+			oSim.dWallSum += dWall;
+			if (dWall > oSim.dWallMax)
+			{
+				oSim.dWallMax = dWall;
+			}
+		}
+
+		if (oSim.bValve && (oSim.poSensor->u8ReadingQuality == SENSORHEALTH_QUALITY_BAD))
+		{
+			SimViolation(SIM_CHECK_FAULT, "valve open after a BAD reading (%.0f %%, quality %.0f)", oSim.poSensor->u8ReadingValue, oSim.poSensor->u8ReadingQuality);
+		}
+
+		if (oSim.poIrrigation->u32LatencyLast != 0)
+		{
+			SimViolation(SIM_CHECK_LATENCY, "actuation %.0f us after the reading, budget %.0f us", oSim.poIrrigation->u32LatencyLast, IRRIGATIONMGR_LATENCY_BUDGET);
+		}
+	}
+
+	IrrigationMgrTask();
+
+	if (oSim.bValve && (oSim.u64Now - oSim.u64ValveChange > oSim.poIrrigation->u32MaxOn + oSim.u32LoopMs))
+	{
+		SimViolation(SIM_CHECK_MAX_ON, "valve open for %.0f ms, maximum %.0f ms", oSim.u64Now - oSim.u64ValveChange, oSim.poIrrigation->u32MaxOn);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SimPot - Moves the pot forward by one loop step.
+////////////////////////////////////////////////////////////////////////////////
+static void SimPot(UINT32 u32Step)
+{
+	double	dHour		= (double)(oSim.u64Now % SIM_DAY) / SIM_HOUR;
+	double	dSun		= ((dHour > 6.0) && (dHour < 18.0)) ? sin(M_PI * (dHour - 6.0) / 12.0) : 0.0;
+	double	dUptake		= 0;
+	double	dInfiltrate	= 0;
+	double	dWater		= 0;
+
+	// Valve: into the surface store.
+	if (oSim.bValve)
+	{
+		dWater = oSim.poIrrigation->u16Flow * u32Step / 60000.0;
+		oSim.dSurface		+= dWater;
+		oSim.oDay.dWater	+= dWater;
+		oSim.dWaterTotal	+= dWater;
+	}
+
+	// Surface store: into the root zone, with a lag.
+	dInfiltrate = oSim.dSurface * (1.0 - exp(-(double)u32Step / SIM_INFILTRATION_MS));
+	oSim.dSurface	-= dInfiltrate;
+	oSim.dMoisture	+= dInfiltrate * 100.0 / SIM_ROOT_ZONE_ML;
+
+	// Plant: day/night cycle, slower in a dry soil.
+	dUptake = SIM_ET_PEAK * (SIM_ET_NIGHT + (1.0 - SIM_ET_NIGHT) * dSun);
+	if (oSim.dMoisture < SIM_ET_DRY)
+	{
+		dUptake *= oSim.dMoisture / SIM_ET_DRY;
+	}
+	oSim.dMoisture -= dUptake * u32Step / SIM_HOUR;
+
+	// Drainage above the field capacity.
+	if (oSim.dMoisture > SIM_FIELD_CAPACITY)
+	{
+		oSim.dMoisture -= (oSim.dMoisture - SIM_FIELD_CAPACITY) * SIM_DRAIN_PER_HOUR * u32Step / SIM_HOUR;
+	}
+
+	if (oSim.dMoisture < 0.0)	oSim.dMoisture = 0.0;
+	if (oSim.dMoisture > 100.0)	oSim.dMoisture = 100.0;
+
+	if (oSim.dMoisture < oSim.oDay.dMin) oSim.oDay.dMin = oSim.dMoisture;
+	if (oSim.dMoisture > oSim.oDay.dMax) oSim.oDay.dMax = oSim.dMoisture;
+	oSim.oDay.dSum += oSim.dMoisture;
+	++oSim.oDay.u32Samples;
+
+	if (oSim.dMoisture < SIM_WILTING)
+	{
+		oSim.oDay.u64Stress		+= u32Step;
+		oSim.u64StressTotal		+= u32Step;
+	}
+}
+
+static void SimEndOfDay(UINT32 u32Day)
+{
+	// The cap counts what the valve let through, plus one loop step of
+	// rounding at each end of the window.
+	if (oSim.oDay.dWater > oSim.poIrrigation->u32DailyCap + 2.0 * oSim.poIrrigation->u16Flow * oSim.u32LoopMs / 60000.0)
+	{
+		SimViolation(SIM_CHECK_DAILY_CAP, "%.0f mL in a day, cap %.0f mL", oSim.oDay.dWater, oSim.poIrrigation->u32DailyCap);
+	}
+
+	printf("%3u  %6.1f  %6.1f  %6.1f  %9.0f  %8u  %10.0f\n", u32Day, oSim.oDay.dMin,
+		oSim.oDay.u32Samples ? oSim.oDay.dSum / oSim.oDay.u32Samples : 0.0, oSim.oDay.dMax,
+		oSim.oDay.dWater, oSim.oDay.u32Openings, oSim.oDay.u64Stress / 60000.0);
+
+	memset(&oSim.oDay, 0, sizeof(oSim.oDay));
+	oSim.oDay.dMin = 100.0;
+}
+
+static UINT16 SimAnalogRead(UINT8 u8Pin)
+{
+	poMoistSensorMgrTy	poSensor	= oSim.poSensor;
+	double				dRaw		= 0;
+	INT32				i32Raw		= 0;
+
+	(void)u8Pin;
+
+	if (oSim.bFault && (oSim.u64Now >= SIM_FAULT_START) && (oSim.u64Now < SIM_FAULT_START + SIM_FAULT_LENGTH))
+	{
+		// Disconnected probe: full scale, "bone dry".
+		return 1023;
+	}
+
+	dRaw	= poSensor->u16MapMax - oSim.dMoisture / 100.0 * (poSensor->u16MapMax - poSensor->u16MapMin);
+	i32Raw	= (INT32)(dRaw + 0.5) + (INT32)(SimRand() % (2 * SIM_NOISE + 1)) - SIM_NOISE;
+
+	if (i32Raw < 0)		i32Raw = 0;
+	if (i32Raw > 1020)	i32Raw = 1020;
+
+	return (UINT16)i32Raw;
+}
+
+static void SimDigitalWrite(UINT8 u8Pin, UINT8 u8Level)
+{
+	if ((u8Pin != SIM_VALVE_PIN) || ((bool)u8Level == oSim.bValve))
+	{
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &oSim.oValveWall);
+
+	if (u8Level)
+	{
+		if (oSim.bHasClosed)
+		{
+			if (oSim.u64Now - oSim.u64ValveChange < oSim.poIrrigation->u32MinOff)
+			{
+				SimViolation(SIM_CHECK_MIN_OFF, "reopened after %.0f ms, minimum %.0f ms", oSim.u64Now - oSim.u64ValveChange, oSim.poIrrigation->u32MinOff);
+			}
+			if (oSim.u64Now - oSim.u64ValveChange < oSim.u64ShortestOff)
+			{
+				oSim.u64ShortestOff = oSim.u64Now - oSim.u64ValveChange;
+			}
+		}
+		++oSim.oDay.u32Openings;
+	}
+	else
+	{
+		if (oSim.u64Now - oSim.u64ValveChange > oSim.u64LongestOn)
+		{
+			oSim.u64LongestOn = oSim.u64Now - oSim.u64ValveChange;
+		}
+		oSim.bHasClosed = TRUE;
+	}
+
+	oSim.bValve				= u8Level;
+	oSim.u64ValveChange		= oSim.u64Now;
+}
+
+static void SimViolation(SimCheckTy eCheck, const char* pszFormat, double dA, double dB)
+{
+	if (oSim.au32Violations[eCheck]++ < 5)
+	{
+		printf("VIOLATION %.3f h: ", oSim.u64Now / (double)SIM_HOUR);
+		printf(pszFormat, dA, dB);
+		printf("\n");
+	}
+}
+
+static UINT32 SimRand()
+{
+	oSim.u32Seed = oSim.u32Seed * 1103515245 + 12345;
+	return oSim.u32Seed >> 8;
+}
@@ -0,0 +1,436 @@
+///
+/// \file     langpack.c
+/// \brief    Language pack builder (Linux)
+/// \details  Builds the language packs of StringTable from text files, puts
+///           them together in an image of the FLASHMGR_PART_LANG partition,
+///           and checks packs or images with the loader of the firmware.
+///
+///           Source file: one "lang <code>" line, then one "<id> <text>"
+///           line per string, <id> being the StringTableIDTy value. Blank
+///           lines and lines starting with '#' are ignored. Strings left out
+///           are taken from English on the node. -t prints the English
+///           strings in this format, as a starting point.
+///
+///           The strings end up in the JSON of the web dashboard as they
+///           are: quotes, backslashes and control characters are refused.
+///
+///           The image goes to the partition offset printed by the "lang"
+///           console command of the node, e.g.:
+///             esptool.py write_flash 0x<offset> lang.bin
+///
+///           Build:
+///             gcc -O2 -Itools/host -I. -o langpack tools/langpack/langpack.c
+///                 StringTable.c FlashMgr.c Crc.c
+///
+///           Examples:
+///             ./langpack -t > de.txt                  (then translate it)
+///             ./langpack -o de.lpk de.txt
+///             ./langpack -p lang.bin de.lpk es.lpk
+///             ./langpack -c lang.bin                  (lists every string)
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "StringTable.h"
+#include "FlashMgr.h"
+#include "Crc.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define LP_ID_MAX           1024        ///< Highest string ID accepted, plus one.
+#define LP_BLOB_MAX         0xFFFF      ///< Offsets are 16 bits.
+#define LP_LINE_MAX         512
+#define LP_FILE_MAX         (1024UL * 1024UL)
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oLpPackTy
+/// \brief 	Pack being built.
+///
+typedef struct
+{
+	oStringTablePackHdrTy	oHdr;
+	UINT16					au16Index[LP_ID_MAX];
+	char					acBlob[LP_BLOB_MAX];
+	UINT32					u32Blob;				///< Bytes used in acBlob.
+} oLpPackTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static int LpCompile(const char* pszSource, const char* pszOutput);
+static bool LpAddString(oLpPackTy* poPack, UINT32 u32Id, const char* pszText);
+static int LpImage(const char* pszOutput, int iCount, char** ppszPacks);
+static int LpTemplate();
+static int LpCheck(const char* pszFile);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oLpPackTy oPack;
+
+
+int main(int argc, char** argv)
+{
+	const char*	pszOutput	= NULL;
+	const char*	pszImage	= NULL;
+	const char*	pszCheck	= NULL;
+	bool		bTemplate	= FALSE;
+	int			iOpt		= 0;
+
+	while ((iOpt = getopt(argc, argv, "o:p:c:th")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'o': pszOutput	= optarg; break;
+		case 'p': pszImage	= optarg; break;
+		case 'c': pszCheck	= optarg; break;
+		case 't': bTemplate	= TRUE; break;
+		default:
+			fprintf(stderr, "Usage: %s -o pack source.txt\n", argv[0]);
+			fprintf(stderr, "       %s -p image pack...\n", argv[0]);
+			fprintf(stderr, "       %s -c pack_or_image\n", argv[0]);
+			fprintf(stderr, "       %s -t  (English strings, in the source format)\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (bTemplate)
+	{
+		return LpTemplate();
+	}
+	if (pszCheck)
+	{
+		return LpCheck(pszCheck);
+	}
+	if (pszImage && (optind < argc))
+	{
+		return LpImage(pszImage, argc - optind, &argv[optind]);
+	}
+	if (pszOutput && (optind + 1 == argc))
+	{
+		return LpCompile(argv[optind], pszOutput);
+	}
+
+	fprintf(stderr, "Nothing to do, see -h.\n");
+	return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		LpCompile - Builds a pack from a source file.
+///
+/// \return		Exit code.
+////////////////////////////////////////////////////////////////////////////////
+static int LpCompile(const char* pszSource, const char* pszOutput)
+{
+	FILE*	pfIn		= fopen(pszSource, "r");
+	FILE*	pfOut		= NULL;
+	char	szLine[LP_LINE_MAX];
+	char*	pszText		= NULL;
+	UINT32	u32Line		= 0;
+	UINT32	u32Id		= 0;
+	UINT32	u32Index	= 0;
+	UINT32	u32Size		= 0;
+	size_t	uLen		= 0;
+
+	if (!pfIn)
+	{
+		perror(pszSource);
+		return 1;
+	}
+
+	memset(&oPack, 0, sizeof(oPack));
+	memset(oPack.au16Index, 0xFF, sizeof(oPack.au16Index));
+
+	while (fgets(szLine, sizeof(szLine), pfIn))
+	{
+		++u32Line;
+		uLen = strlen(szLine);
+		while (uLen && ((szLine[uLen - 1] == '\n') || (szLine[uLen - 1] == '\r')))
+		{
+			szLine[--uLen] = '\0';
+		}
+
+		if (!uLen || (szLine[0] == '#'))
+		{
+			continue;
+		}
+
+		if (!strncmp(szLine, "lang ", 5))
+		{
+			if (oPack.oHdr.acCode[0] || !szLine[5] || (strlen(&szLine[5]) >= STRINGTABLE_CODE_MAX))
+			{
+				fprintf(stderr, "%s:%u: one language code, up to %u characters\n", pszSource, u32Line, STRINGTABLE_CODE_MAX - 1);
+				fclose(pfIn);
+				return 1;
+			}
+			strcpy(oPack.oHdr.acCode, &szLine[5]);
+			continue;
+		}
+
+		u32Id = (UINT32)strtoul(szLine, &pszText, 10);
+		if ((pszText == szLine) || ((*pszText != ' ') && (*pszText != '\t') && (*pszText != '\0')))
+		{
+			fprintf(stderr, "%s:%u: expected \"<id> <text>\"\n", pszSource, u32Line);
+			fclose(pfIn);
+			return 1;
+		}
+		if (*pszText)
+		{
+			++pszText;
+		}
+
+		if (!LpAddString(&oPack, u32Id, pszText))
+		{
+			fprintf(stderr, "%s:%u: string refused\n", pszSource, u32Line);
+			fclose(pfIn);
+			return 1;
+		}
+	}
+	fclose(pfIn);
+
+	if (!oPack.oHdr.acCode[0] || !oPack.oHdr.u16Count)
+	{
+		fprintf(stderr, "%s: no \"lang\" line or no string\n", pszSource);
+		return 1;
+	}
+
+	// The index is written whole, then the blob right after it.
+	u32Index				= (UINT32)oPack.oHdr.u16Count * sizeof(UINT16);
+	u32Size					= sizeof(oStringTablePackHdrTy) + u32Index + oPack.u32Blob;
+	oPack.oHdr.u32Magic		= STRINGTABLE_PACK_MAGIC;
+	oPack.oHdr.u16Version	= STRINGTABLE_PACK_VERSION;
+	oPack.oHdr.u32Size		= u32Size;
+	oPack.oHdr.u32Crc		= Crc32Final(Crc32Update(Crc32Update(CRC32_INIT, oPack.au16Index, u32Index), oPack.acBlob, oPack.u32Blob));
+
+	pfOut = fopen(pszOutput, "wb");
+	if (!pfOut
+		|| (fwrite(&oPack.oHdr, sizeof(oPack.oHdr), 1, pfOut) != 1)
+		|| (fwrite(oPack.au16Index, u32Index, 1, pfOut) != 1)
+		|| (fwrite(oPack.acBlob, oPack.u32Blob, 1, pfOut) != 1)
+		|| fclose(pfOut))
+	{
+		perror(pszOutput);
+		return 1;
+	}
+
+	printf("%s: \"%s\", %u IDs, %u bytes\n", pszOutput, oPack.oHdr.acCode, oPack.oHdr.u16Count, u32Size);
+	if (u32Size > STRINGTABLE_PACK_MAX)
+	{
+		fprintf(stderr, "warning: larger than STRINGTABLE_PACK_MAX (%u), the node will not load it\n", STRINGTABLE_PACK_MAX);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		LpAddString - Adds a string to the pack. Equal strings are
+///				stored once.
+///
+/// \return		TRUE if success, FALSE if the ID or the text is not valid.
+////////////////////////////////////////////////////////////////////////////////
+static bool LpAddString(oLpPackTy* poPack, UINT32 u32Id, const char* pszText)
+{
+	const char*	pszChar		= NULL;
+	UINT32		u32Offset	= 0;
+	UINT32		u32Len		= (UINT32)strlen(pszText) + 1;
+
+	if ((u32Id >= LP_ID_MAX) || (poPack->au16Index[u32Id] != STRINGTABLE_PACK_NONE))
+	{
+		return FALSE;
+	}
+
+	for (pszChar = pszText; *pszChar; ++pszChar)
+	{
+		if ((*pszChar == '"') || (*pszChar == '\\') || ((UINT8)*pszChar < ' '))
+		{
+			return FALSE;
+		}
+	}
+
+	for (u32Offset = 0; u32Offset < poPack->u32Blob; u32Offset += (UINT32)strlen(&poPack->acBlob[u32Offset]) + 1)
+	{
+		if (!strcmp(&poPack->acBlob[u32Offset], pszText))
+		{
+			break;
+		}
+	}
+
+	if (u32Offset == poPack->u32Blob)
+	{
+		if (poPack->u32Blob + u32Len >= STRINGTABLE_PACK_NONE)
+		{
+			return FALSE;
+		}
+		memcpy(&poPack->acBlob[poPack->u32Blob], pszText, u32Len);
+		poPack->u32Blob += u32Len;
+	}
+
+	poPack->au16Index[u32Id] = (UINT16)u32Offset;
+	if (u32Id >= poPack->oHdr.u16Count)
+	{
+		poPack->oHdr.u16Count = (UINT16)(u32Id + 1);
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		LpImage - Puts packs together in a partition image.
+///
+/// \return		Exit code.
+////////////////////////////////////////////////////////////////////////////////
+static int LpImage(const char* pszOutput, int iCount, char** ppszPacks)
+{
+	static UINT8			au8File[LP_FILE_MAX];
+	const oStringTablePackHdrTy*	poHdr	= (const oStringTablePackHdrTy*)au8File;
+	FILE*					pfIn		= NULL;
+	FILE*					pfOut		= fopen(pszOutput, "wb");
+	UINT32					u32Total	= 0;
+	size_t					uRead		= 0;
+	int						iPack		= 0;
+
+	if (!pfOut)
+	{
+		perror(pszOutput);
+		return 1;
+	}
+
+	if (iCount > STRINGTABLE_PACK_COUNT)
+	{
+		fprintf(stderr, "At most %u packs\n", STRINGTABLE_PACK_COUNT);
+		return 1;
+	}
+
+	for (iPack = 0; iPack < iCount; ++iPack)
+	{
+		pfIn = fopen(ppszPacks[iPack], "rb");
+		if (!pfIn)
+		{
+			perror(ppszPacks[iPack]);
+			return 1;
+		}
+		uRead = fread(au8File, 1, sizeof(au8File), pfIn);
+		fclose(pfIn);
+
+		if ((uRead < sizeof(*poHdr)) || (poHdr->u32Magic != STRINGTABLE_PACK_MAGIC) || (poHdr->u32Size != uRead))
+		{
+			fprintf(stderr, "%s: not a language pack\n", ppszPacks[iPack]);
+			return 1;
+		}
+
+		// The next pack starts 4 bytes aligned, the padding looks erased.
+		while (uRead % 4)
+		{
+			au8File[uRead++] = 0xFF;
+		}
+
+		if (fwrite(au8File, uRead, 1, pfOut) != 1)
+		{
+			perror(pszOutput);
+			return 1;
+		}
+		u32Total += (UINT32)uRead;
+		printf("%s: \"%s\" at offset %u\n", ppszPacks[iPack], poHdr->acCode, u32Total - (UINT32)uRead);
+	}
+
+	if (fclose(pfOut))
+	{
+		perror(pszOutput);
+		return 1;
+	}
+
+	printf("%s: %u bytes\n", pszOutput, u32Total);
+	if (u32Total > FLASHMGR_LANG_SIZE)
+	{
+		fprintf(stderr, "warning: larger than FLASHMGR_LANG_SIZE (%lu)\n", (unsigned long)FLASHMGR_LANG_SIZE);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		LpTemplate - Prints the English strings as a source file.
+///
+/// \return		Exit code.
+////////////////////////////////////////////////////////////////////////////////
+static int LpTemplate()
+{
+	UINT32 u32Id = 0;
+
+	printf("# Translate the texts, keep the IDs. Strings left out stay in English.\n");
+	printf("lang xx\n");
+	for (u32Id = STRINGTABLE_ID_000_EMPTY + 1; u32Id < STRINGTABLE_ID_999_CUSTOM; ++u32Id)
+	{
+		printf("%u %s\n", u32Id, StringTableGetStrInLang(STRINGTABLE_LANG_EN, (StringTableIDTy)u32Id));
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		LpCheck - Loads every pack of a file the way the node does,
+///				and prints its strings.
+///
+/// \return		Exit code: 0 if every pack loads.
+////////////////////////////////////////////////////////////////////////////////
+static int LpCheck(const char* pszFile)
+{
+	const char*	pszCode		= NULL;
+	const char*	pszText		= NULL;
+	UINT32		u32Lang		= 0;
+	UINT32		u32Id		= 0;
+	int			iRet		= 0;
+
+	if (!StringTablePackAttach(pszFile))
+	{
+		fprintf(stderr, "%s: cannot map the file\n", pszFile);
+		return 1;
+	}
+
+	for (u32Lang = STRINGTABLE_LANG_PACK; u32Lang < STRINGTABLE_LANG_MAX; ++u32Lang)
+	{
+		pszCode = StringTableGetLangCode((StringTableLangTy)u32Lang);
+		if (!pszCode)
+		{
+			break;
+		}
+
+		printf("[%s]\n", pszCode);
+		if (!StringTableSetLang((StringTableLangTy)u32Lang))
+		{
+			printf("  damaged, not loaded\n");
+			iRet = 1;
+			continue;
+		}
+
+		for (u32Id = STRINGTABLE_ID_000_EMPTY + 1; u32Id < STRINGTABLE_ID_999_CUSTOM; ++u32Id)
+		{
+			pszText = StringTableGetStr((StringTableIDTy)u32Id);
+			printf("  %3u %s%s\n", u32Id, pszText,
+				(pszText == StringTableGetStrInLang(STRINGTABLE_LANG_EN, (StringTableIDTy)u32Id)) ? "  (English)" : "");
+		}
+	}
+
+	if (u32Lang == STRINGTABLE_LANG_PACK)
+	{
+		fprintf(stderr, "%s: no language pack\n", pszFile);
+		iRet = 1;
+	}
+
+	return iRet;
+}
@@ -0,0 +1,576 @@
+///
+/// \file     otasim.c
+/// \brief    Firmware update server and simulated node (Linux)
+/// \details  Serves a firmware image with the OtaMgr stream protocol and, in
+///           the same process, runs a node that fetches it through the real
+///           OtaMgr and FlashMgr code on a simulated flash. The server can
+///           drop the connection every N bytes and throttle its rate, the
+///           flash can be given the timing of a real chip, and the node can
+///           be stopped after N bytes to emulate a power loss: run the tool
+///           again with the same flash file and it resumes.
+///
+///           Build:
+///             gcc -O2 -pthread -Itools/host -I. -o otasim
+///                 tools/otasim/otasim.c OtaMgr.c FlashMgr.c Sha256.c Crc.c
+///
+///           Examples:
+///             ./otasim -g 600000 -k 100000          drops every 100 kB
+///             ./otasim -g 600000 -s flash.bin -x 250000; ./otasim -g 600000 -s flash.bin
+///             ./otasim -S -f firmware.bin           server only, for a real node
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "OtaMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SIM_SEGMENT_SIZE        1460        ///< Bytes per send / receive, one TCP segment.
+#define SIM_SEED                12345       ///< Seed of the generated image (-g).
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+	// Image.
+	UINT8*		pu8Image;
+	UINT32		u32ImageSize;
+	UINT8		au8Digest[SHA256_DIGEST_SIZE];
+
+	// Server.
+	int			iListenFd;
+	UINT16		u16Port;
+	UINT32		u32DropEvery;		///< Close each connection after this many image bytes (0: never).
+	UINT32		u32RateKBps;		///< Send rate limit, in kB/s (0: none).
+	UINT64		u64ServedBytes;		///< Image bytes sent, all connections.
+	UINT32		u32Connections;
+
+	// Node.
+	UINT32		u32StopAfter;		///< Exit after this many image bytes received (0: never).
+} oSimTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool SimLoadImage(const char* pszPath, UINT32 u32Generate);
+static bool SimListen();
+static void* SimServerThread(void* pvArg);
+static void SimServe(int iFd);
+static int SimNode(const char* pszHost);
+static int SimNodeSession(const char* pszHost, UINT32* pu32Offset, UINT64* pu64Received);
+static bool SimSendAll(int iFd, const void* pvData, UINT32 u32Size);
+static bool SimRecvAll(int iFd, void* pvData, UINT32 u32Size);
+static UINT64 SimNow();
+static void SimUsage(const char* pszName);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oSimTy oSim = {0};
+
+
+int main(int argc, char* argv[])
+{
+	const char*	pszImage		= NULL;
+	const char*	pszFlash		= NULL;
+	const char*	pszHost			= NULL;
+	UINT32		u32Generate		= 0;
+	UINT32		u32EraseUs		= 0;
+	UINT32		u32WriteNs		= 0;
+	bool		bServerOnly		= FALSE;
+	pthread_t	oServer;
+	int			iOpt			= 0;
+
+	oSim.u16Port = OTAMGR_PORT;
+
+	while ((iOpt = getopt(argc, argv, "f:g:p:k:r:s:e:w:x:SC:h")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'f': pszImage			= optarg; break;
+		case 'g': u32Generate		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'p': oSim.u16Port		= (UINT16)atoi(optarg); break;
+		case 'k': oSim.u32DropEvery	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'r': oSim.u32RateKBps	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 's': pszFlash			= optarg; break;
+		case 'e': u32EraseUs		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'w': u32WriteNs		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'x': oSim.u32StopAfter	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'S': bServerOnly		= TRUE; break;
+		case 'C': pszHost			= optarg; break;
+		default:  SimUsage(argv[0]); return 1;
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	// Node only: the image comes from a remote server.
+	if (pszHost)
+	{
+		if (pszFlash && !FlashMgrSimAttach(pszFlash))
+		{
+			fprintf(stderr, "Cannot open the flash file %s\n", pszFlash);
+			return 1;
+		}
+		FlashMgrSimSetTiming(u32EraseUs, u32WriteNs);
+		return SimNode(pszHost);
+	}
+
+	if ((!pszImage == !u32Generate) || !SimLoadImage(pszImage, u32Generate))
+	{
+		SimUsage(argv[0]);
+		return 1;
+	}
+
+	if (!SimListen())
+	{
+		perror("listen");
+		return 1;
+	}
+
+	printf("Serving %u bytes on port %u\n", oSim.u32ImageSize, oSim.u16Port);
+
+	if (bServerOnly)
+	{
+		SimServerThread(NULL);
+		return 0;
+	}
+
+	if (pthread_create(&oServer, NULL, SimServerThread, NULL))
+	{
+		perror("pthread_create");
+		return 1;
+	}
+	pthread_detach(oServer);
+
+	if (pszFlash && !FlashMgrSimAttach(pszFlash))
+	{
+		fprintf(stderr, "Cannot open the flash file %s\n", pszFlash);
+		return 1;
+	}
+	FlashMgrSimSetTiming(u32EraseUs, u32WriteNs);
+
+	return SimNode("127.0.0.1");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SimLoadImage - Reads or generates the image and hashes it.
+////////////////////////////////////////////////////////////////////////////////
+static bool SimLoadImage(const char* pszPath, UINT32 u32Generate)
+{
+	FILE*		poFile	= NULL;
+	long		lSize	= 0;
+	UINT32		u32Idx	= 0;
+	UINT32		u32Rand	= SIM_SEED;
+	oSha256Ty	oSha;
+
+	if (pszPath)
+	{
+		poFile = fopen(pszPath, "rb");
+		if (!poFile || fseek(poFile, 0, SEEK_END) || ((lSize = ftell(poFile)) <= 0) || fseek(poFile, 0, SEEK_SET))
+		{
+			fprintf(stderr, "Cannot read %s\n", pszPath);
+			return FALSE;
+		}
+
+		oSim.u32ImageSize	= (UINT32)lSize;
+		oSim.pu8Image		= malloc(oSim.u32ImageSize);
+		if (!oSim.pu8Image || (fread(oSim.pu8Image, 1, oSim.u32ImageSize, poFile) != oSim.u32ImageSize))
+		{
+			fclose(poFile);
+			return FALSE;
+		}
+		fclose(poFile);
+	}
+	else
+	{
+		oSim.u32ImageSize	= u32Generate;
+		oSim.pu8Image		= malloc(oSim.u32ImageSize);
+		if (!oSim.pu8Image)
+		{
+			return FALSE;
+		}
+
+		for (u32Idx = 0; u32Idx < oSim.u32ImageSize; ++u32Idx)
+		{
+			u32Rand = u32Rand * 1103515245 + 12345;
+			oSim.pu8Image[u32Idx] = (UINT8)(u32Rand >> 16);
+		}
+	}
+
+	Sha256Init(&oSha);
+	Sha256Update(&oSha, oSim.pu8Image, oSim.u32ImageSize);
+	Sha256Final(&oSha, oSim.au8Digest);
+
+	return TRUE;
+}
+
+static bool SimListen()
+{
+	struct sockaddr_in	oAddr;
+	int					iOne	= 1;
+
+	oSim.iListenFd = socket(AF_INET, SOCK_STREAM, 0);
+	if (oSim.iListenFd < 0)
+	{
+		return FALSE;
+	}
+
+	setsockopt(oSim.iListenFd, SOL_SOCKET, SO_REUSEADDR, &iOne, sizeof(iOne));
+
+	memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sin_family		= AF_INET;
+	oAddr.sin_port			= htons(oSim.u16Port);
+	oAddr.sin_addr.s_addr	= htonl(INADDR_ANY);
+
+	return !bind(oSim.iListenFd, (struct sockaddr*)&oAddr, sizeof(oAddr)) && !listen(oSim.iListenFd, 4);
+}
+
+static void* SimServerThread(void* pvArg)
+{
+	int iFd = -1;
+
+	(void)pvArg;
+
+	for (;;)
+	{
+		iFd = accept(oSim.iListenFd, NULL, NULL);
+		if (iFd < 0)
+		{
+			continue;
+		}
+
+		// One node at a time is enough for a test bench.
+		SimServe(iFd);
+		close(iFd);
+	}
+
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SimServe - Serves one request.
+////////////////////////////////////////////////////////////////////////////////
+static void SimServe(int iFd)
+{
+	char	szRequest[OTAMGR_REQUEST_MAX + 1];
+	UINT8	au8Header[OTAMGR_HEADER_SIZE];
+	UINT32	u32Len		= 0;
+	UINT32	u32Offset	= 0;
+	UINT32	u32Sent		= 0;
+	UINT32	u32Chunk	= 0;
+	UINT64	u64Start	= SimNow();
+	UINT64	u64Due		= 0;
+
+	// Request line, one byte at a time: it is tiny.
+	while ((u32Len < OTAMGR_REQUEST_MAX) && (recv(iFd, &szRequest[u32Len], 1, 0) == 1) && (szRequest[u32Len] != '\n'))
+	{
+		++u32Len;
+	}
+	szRequest[u32Len] = '\0';
+
+	if ((sscanf(szRequest, "OTA %u", &u32Offset) != 1) || (u32Offset > oSim.u32ImageSize))
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&oSim.u32Connections, 1, __ATOMIC_RELAXED);
+
+	OtaMgrEncodeHeader(oSim.u32ImageSize, oSim.au8Digest, au8Header);
+	if (!SimSendAll(iFd, au8Header, sizeof(au8Header)))
+	{
+		return;
+	}
+
+	while (u32Offset < oSim.u32ImageSize)
+	{
+		u32Chunk = oSim.u32ImageSize - u32Offset;
+		if (u32Chunk > SIM_SEGMENT_SIZE)
+		{
+			u32Chunk = SIM_SEGMENT_SIZE;
+		}
+
+		if (oSim.u32DropEvery && (u32Sent + u32Chunk > oSim.u32DropEvery))
+		{
+			u32Chunk = oSim.u32DropEvery - u32Sent;
+		}
+
+		if (!SimSendAll(iFd, &oSim.pu8Image[u32Offset], u32Chunk))
+		{
+			return;
+		}
+
+		u32Offset	+= u32Chunk;
+		u32Sent		+= u32Chunk;
+		__atomic_add_fetch(&oSim.u64ServedBytes, u32Chunk, __ATOMIC_RELAXED);
+
+		if (oSim.u32DropEvery && (u32Sent >= oSim.u32DropEvery))
+		{
+			// Abrupt drop, like a lost WiFi link.
+			struct linger oLinger = {1, 0};
+			setsockopt(iFd, SOL_SOCKET, SO_LINGER, &oLinger, sizeof(oLinger));
+			return;
+		}
+
+		if (oSim.u32RateKBps)
+		{
+			u64Due = u64Start + (UINT64)u32Sent * 1000000ULL / oSim.u32RateKBps;
+			while (SimNow() < u64Due)
+			{
+				usleep(200);
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SimNode - Fetches the image until it is verified.
+/// \return		Exit code of the tool.
+////////////////////////////////////////////////////////////////////////////////
+static int SimNode(const char* pszHost)
+{
+	UINT32	u32Offset		= 0;
+	UINT32	u32StartOffset	= 0;
+	UINT64	u64Received		= 0;
+	UINT32	u32Sessions		= 0;
+	UINT64	u64Start		= 0;
+	double	dSeconds		= 0.0;
+	int		iRet			= 0;
+
+	if (!OtaMgr())
+	{
+		fprintf(stderr, "OtaMgr init failed\n");
+		return 1;
+	}
+
+	u32Offset		= OtaMgrGetOffset();
+	u32StartOffset	= u32Offset;
+	if (u32Offset)
+	{
+		printf("Node: progress record found, asking from offset %u\n", u32Offset);
+	}
+
+	u64Start = SimNow();
+
+	do
+	{
+		++u32Sessions;
+		iRet = SimNodeSession(pszHost, &u32Offset, &u64Received);
+
+		if (iRet < 0)
+		{
+			// Emulated power loss.
+			printf("Node: stopped after %llu bytes, committed offset %u\n", (unsigned long long)u64Received, OtaMgrGetOffset());
+			return 2;
+		}
+	} while ((iRet > 0) && (u32Sessions < 10000));
+
+	dSeconds = (SimNow() - u64Start) / 1e6;
+
+	if (iRet != 0)
+	{
+		printf("Node: update FAILED\n");
+		return 1;
+	}
+
+	printf("Node: image verified\n");
+	printf("  image size         %u bytes\n", u32Offset);
+	printf("  resumed from       %u\n", u32StartOffset);
+	printf("  connections        %u\n", u32Sessions);
+	printf("  bytes received     %llu\n", (unsigned long long)u64Received);
+	printf("  time               %.3f s\n", dSeconds);
+	printf("  throughput         %.1f kB/s\n", dSeconds > 0 ? u64Received / 1000.0 / dSeconds : 0.0);
+	if (oSim.u32Connections)
+	{
+		printf("  server sent        %llu bytes in %u connections\n", (unsigned long long)oSim.u64ServedBytes, oSim.u32Connections);
+	}
+
+	OtaMgrApply();
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SimNodeSession - One connection.
+/// \return		0 when verified, 1 to reconnect, -1 when stopped by -x, 2 on a
+///				fatal error.
+////////////////////////////////////////////////////////////////////////////////
+static int SimNodeSession(const char* pszHost, UINT32* pu32Offset, UINT64* pu64Received)
+{
+	struct sockaddr_in	oAddr;
+	char				szRequest[OTAMGR_REQUEST_MAX];
+	UINT8				au8Header[OTAMGR_HEADER_SIZE];
+	UINT8				au8Digest[SHA256_DIGEST_SIZE];
+	UINT8				au8Segment[SIM_SEGMENT_SIZE];
+	UINT32				u32ImageSize	= 0;
+	UINT32				u32Begin		= 0;
+	UINT32				u32Pos			= 0;
+	ssize_t				iLen			= 0;
+	int					iFd				= -1;
+	int					iRet			= 1;
+
+	iFd = socket(AF_INET, SOCK_STREAM, 0);
+	if (iFd < 0) goto END;
+
+	memset(&oAddr, 0, sizeof(oAddr));
+	oAddr.sin_family	= AF_INET;
+	oAddr.sin_port		= htons(oSim.u16Port);
+	if (inet_pton(AF_INET, pszHost, &oAddr.sin_addr) != 1)
+	{
+		iRet = 2;
+		goto END;
+	}
+
+	if (connect(iFd, (struct sockaddr*)&oAddr, sizeof(oAddr)))
+	{
+		usleep(100000);
+		goto END;
+	}
+
+	snprintf(szRequest, sizeof(szRequest), "OTA %u\n", *pu32Offset);
+	if (!SimSendAll(iFd, szRequest, (UINT32)strlen(szRequest))) goto END;
+
+	if (!SimRecvAll(iFd, au8Header, sizeof(au8Header))) goto END;
+
+	if (!OtaMgrDecodeHeader(au8Header, &u32ImageSize, au8Digest) || !OtaMgrBegin(u32ImageSize, au8Digest, &u32Begin))
+	{
+		iRet = 2;
+		goto END;
+	}
+
+	// Not the recorded image, or asked too far: ask again.
+	if (u32Begin != *pu32Offset)
+	{
+		*pu32Offset = u32Begin;
+		goto END;
+	}
+
+	u32Pos = u32Begin;
+	while (u32Pos < u32ImageSize)
+	{
+		iLen = recv(iFd, au8Segment, sizeof(au8Segment), 0);
+		if (iLen <= 0)
+		{
+			// Dropped: resume from the last committed chunk.
+			*pu32Offset = OtaMgrGetOffset();
+			goto END;
+		}
+
+		if (oSim.u32StopAfter && (*pu64Received + iLen >= oSim.u32StopAfter))
+		{
+			iLen = oSim.u32StopAfter - *pu64Received;
+			OtaMgrWrite(au8Segment, (UINT32)iLen);
+			*pu64Received += iLen;
+			iRet = -1;
+			goto END;
+		}
+
+		if (!OtaMgrWrite(au8Segment, (UINT32)iLen))
+		{
+			iRet = 2;
+			goto END;
+		}
+
+		u32Pos			+= (UINT32)iLen;
+		*pu64Received	+= (UINT64)iLen;
+	}
+
+	*pu32Offset = u32ImageSize;
+	iRet = OtaMgrEnd() ? 0 : 2;
+END:
+	if (iFd >= 0)
+	{
+		close(iFd);
+	}
+	return iRet;
+}
+
+static bool SimSendAll(int iFd, const void* pvData, UINT32 u32Size)
+{
+	const UINT8*	pu8Data	= (const UINT8*)pvData;
+	ssize_t			iLen	= 0;
+
+	while (u32Size > 0)
+	{
+		iLen = send(iFd, pu8Data, u32Size, 0);
+		if (iLen <= 0)
+		{
+			return FALSE;
+		}
+		pu8Data	+= iLen;
+		u32Size	-= (UINT32)iLen;
+	}
+
+	return TRUE;
+}
+
+static bool SimRecvAll(int iFd, void* pvData, UINT32 u32Size)
+{
+	UINT8*	pu8Data	= (UINT8*)pvData;
+	ssize_t	iLen	= 0;
+
+	while (u32Size > 0)
+	{
+		iLen = recv(iFd, pu8Data, u32Size, 0);
+		if (iLen <= 0)
+		{
+			return FALSE;
+		}
+		pu8Data	+= iLen;
+		u32Size	-= (UINT32)iLen;
+	}
+
+	return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SimNow - Monotonic time, in us.
+////////////////////////////////////////////////////////////////////////////////
+static UINT64 SimNow()
+{
+	struct timespec oNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &oNow);
+
+	return (UINT64)oNow.tv_sec * 1000000ULL + (UINT64)oNow.tv_nsec / 1000;
+}
+
+static void SimUsage(const char* pszName)
+{
+	fprintf(stderr,
+		"Usage: %s (-f image | -g bytes) [options]\n"
+		"       %s -C host [node options]\n"
+		"Server:\n"
+		"  -f file      image to serve\n"
+		"  -g bytes     serve a generated image of this size\n"
+		"  -p port      TCP port (default %u)\n"
+		"  -k bytes     drop each connection after this many image bytes\n"
+		"  -r kB/s      limit the send rate\n"
+		"  -S           server only, no simulated node\n"
+		"Node:\n"
+		"  -C host      fetch from this server instead of the local one\n"
+		"  -s file      back the simulated flash with this file (resume across runs)\n"
+		"  -e us        sector erase time (ESP8266: about 40000)\n"
+		"  -w ns        programming time per byte (ESP8266: about 500)\n"
+		"  -x bytes     stop after receiving this many bytes (power loss)\n",
+		pszName, pszName, OTAMGR_PORT);
+}
@@ -0,0 +1,196 @@
+///
+/// \file     pipebench.c
+/// \brief    Sensor pipeline benchmark (Linux)
+/// \details  Runs the firmware MoistSensorMgr on the virtual board, one
+///           reading after the other with every reading published, and
+///           prints the CPU time spent in MoistSensorMgrTask() per report:
+///           in total (sampling calls included) and in the call that closes
+///           the reading (filter, health, adaptation, mapping, statistics,
+///           deadband). x86 hosts count TSC cycles, others nanoseconds.
+///
+///           Built once per variant of the pipeline: configured at runtime
+///           (default) or fixed at compile time (MOISTURE_PIPELINE_FIXED and
+///           its MOISTURE_FIXED_* stage switches, see MoistSensorMgr.h). The
+///           runtime variant is set up like the fixed one (same sample
+///           count and interval), so both print the same checksum of the
+///           averages.
+///
+///           Build:
+///             gcc -O2 -Itools/host -I. -o pipebench tools/pipebench/pipebench.c
+///                 tools/host/HostArduino.c SystemTime.c MoistSensorMgr.c
+///                 SensorHealth.c CalibMgr.c TraceMgr.c StreamStats.c
+///             Same with -DMOISTURE_PIPELINE_FIXED -o pipebench_fixed, and
+///             for instance -DMOISTURE_FIXED_STATS=0 -DMOISTURE_FIXED_ADAPT=0
+///             to leave those stages out; -DMOISTURE_FILTER=1 for the
+///             trimmed mean in either variant.
+///
+///           Usage: ./pipebench [-r reports] [-s seed]
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "MoistSensorMgr.h"
+#include "CalibMgr.h"
+#include "SystemTime.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define BENCH_REPORTS           100000
+#define BENCH_PIN               D8
+#define BENCH_READING_MS        1000        ///< Time between two readings.
+#define BENCH_RAW               600         ///< Mean of the probe.
+#define BENCH_NOISE             8           ///< Probe noise, +/- raw counts.
+#define BENCH_SPIKE_PERIOD      37          ///< One sample in this many is a spike.
+
+#ifdef MOISTURE_PIPELINE_FIXED
+#define BENCH_SAMPLES           MOISTURE_FIXED_SAMPLES
+#define BENCH_POLL_MS           MOISTURE_FIXED_POLL_INTERVAL
+#define BENCH_VARIANT           "fixed at compile time"
+#else
+#define BENCH_SAMPLES           ((MOISTURE_FILTER == MOISTURE_FILTER_TRIMMED) ? 10 : 8)
+#define BENCH_POLL_MS           POLL_DELAY
+#define BENCH_VARIANT           "configured at runtime"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_UNIT              "TSC cycles"
+#else
+#define BENCH_UNIT              "ns"
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static UINT16 BenchAnalogRead(UINT8 u8Pin);
+static UINT64 BenchTicks();
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static UINT32 u32Rand		= 1;
+static UINT32 u32Samples	= 0;
+
+
+int main(int argc, char** argv)
+{
+	poMoistSensorMgrTy	poSensor		= NULL;
+	oCalibCurveTy		oCurve			= {0};
+	UINT32				u32Reports		= BENCH_REPORTS;
+	UINT32				u32Done			= 0;
+	UINT32				u32Calls		= 0;
+	UINT64				u64Start		= 0;
+	UINT64				u64Call			= 0;
+	UINT64				u64Total		= 0;
+	UINT64				u64Closing		= 0;
+	UINT64				u64Checksum		= 0;
+	bool				bNewResult		= FALSE;
+	int					iOpt			= 0;
+
+	while ((iOpt = getopt(argc, argv, "r:s:h")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'r': u32Reports	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 's': u32Rand		= (UINT32)strtoul(optarg, NULL, 0) | 1; break;
+		default:
+			fprintf(stderr, "Usage: %s [-r reports] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Virtual node, same bring-up as the boot sequence.
+	HostArduinoSetAnalogRead(BenchAnalogRead);
+	HostArduinoSetMillis(0);
+	SystemTimeInit();
+
+	poSensor = MoistSensorMgr(BENCH_PIN);
+	poSensor->u32ReadingIntervalMin	= BENCH_READING_MS;
+	poSensor->u32ReadingIntervalMax	= BENCH_READING_MS;
+	poSensor->u16PollingInterval	= BENCH_POLL_MS;
+	poSensor->u16PollingDuration	= BENCH_SAMPLES * BENCH_POLL_MS;
+	poSensor->u8DeadbandAbs			= 0;		// Every reading is published.
+	poSensor->u8DeadbandPct			= 0;
+
+	if (!CalibMgrBuild(0, &oCurve, poSensor->u16MapMax, poSensor->u16MapMin)
+		|| !MoistSensorMgrConfigure(poSensor))
+	{
+		fprintf(stderr, "Sensor setup failed\n");
+		return 1;
+	}
+
+	while (u32Done < u32Reports)
+	{
+		HostArduinoAdvance(BENCH_POLL_MS);
+
+		u64Start = BenchTicks();
+		MoistSensorMgrTask();
+		u64Call = BenchTicks() - u64Start;
+
+		u64Total += u64Call;
+		++u32Calls;
+
+		if (MoistSensorMgrIsNewResultAvail(&bNewResult) && bNewResult)
+		{
+			u64Closing	+= u64Call;
+			u64Checksum	+= (UINT64)poSensor->u16AverageValueRaw * (u32Done + 1) + poSensor->u8MedianValue;
+			++u32Done;
+		}
+	}
+
+	printf("pipeline:               %s\n", BENCH_VARIANT);
+	printf("filter:                 %s, %u samples %u ms apart\n",
+		(MOISTURE_FILTER == MOISTURE_FILTER_TRIMMED) ? "trimmed mean" : "mean", BENCH_SAMPLES, BENCH_POLL_MS);
+#ifdef MOISTURE_PIPELINE_FIXED
+	printf("stages:                 adapt %s, stats %s\n", MOISTURE_FIXED_ADAPT ? "on" : "off", MOISTURE_FIXED_STATS ? "on" : "off");
+#endif
+	printf("reports:                %u (%u task calls, %u samples)\n", u32Done, u32Calls, u32Samples);
+	printf("per report (%s): %.1f total, %.1f in the closing call\n", BENCH_UNIT,
+		(double)u64Total / u32Done, (double)u64Closing / u32Done);
+	printf("per sampling call:      %.1f\n", (double)(u64Total - u64Closing) / (u32Calls - u32Done));
+	printf("checksum:               %llu\n", (unsigned long long)u64Checksum);
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BenchAnalogRead - Noisy probe with a spike now and then.
+////////////////////////////////////////////////////////////////////////////////
+static UINT16 BenchAnalogRead(UINT8 u8Pin)
+{
+	(void)u8Pin;
+
+	u32Rand = u32Rand * 1103515245UL + 12345;
+	if ((++u32Samples % BENCH_SPIKE_PERIOD) == 0)
+	{
+		return 1023;
+	}
+
+	return (UINT16)(BENCH_RAW - BENCH_NOISE + (u32Rand >> 16) % (2 * BENCH_NOISE + 1));
+}
+
+static UINT64 BenchTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec oTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &oTs);
+	return (UINT64)oTs.tv_sec * 1000000000ULL + oTs.tv_nsec;
+#endif
+}
@@ -0,0 +1,370 @@
+///
+/// \file     querybench.c
+/// \brief    Gateway query engine benchmark (Linux)
+/// \details  Fills the time series store of the gateway (tsquery) with a
+///           synthetic fleet - N probes, Y years, one report every I
+///           minutes, each probe drying out and being watered on its own
+///           schedule over a seasonal trend - then times the queries the
+///           dashboards make, each one read from the raw points and from
+///           the rollups, on one thread and on all of them:
+///
+///           - season:  daily min/max/avg of every probe over 120 days
+///           - week:    hourly, over 7 days from hh:00 to hh:58 (1 h
+///                      rollup, raw points for the last hour)
+///           - history: 30 day periods over the whole history
+///           - last:    the last hour of every probe, not aligned on any
+///                      rollup (raw points, time index seek)
+///
+///           The raw and rollup results are compared, period by period.
+///
+///           Build:
+///             gcc -O2 -pthread -Itools/host -I. -Itools/gateway -o querybench
+///                 tools/querybench/querybench.c tools/gateway/tsquery.c -lm
+///
+///           Usage: ./querybench [-n probes] [-y years] [-i minutes]
+///                               [-t threads] [-r repeats] [-s seed]
+///           The default fleet (100 probes, 3 years, 15 min) takes about
+///           180 MB.
+/// \author   Infinition - Nicolas Bourré
+///
+
+#define _GNU_SOURCE
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tsquery.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define BENCH_PROBES            100
+#define BENCH_YEARS             3
+#define BENCH_INTERVAL_MIN      15
+#define BENCH_REPEATS           5
+#define BENCH_EPOCH             1672531200UL    ///< 2023-01-01 00:00 UTC.
+#define BENCH_DAY               86400UL
+#define BENCH_SEASON_DAYS       120
+#define BENCH_WEEK_OFFSET       (13 * 3600UL)               ///< Start of the week query in its day.
+#define BENCH_LAST_AGO          (7 * 60 + 13)               ///< End of the last hour query, before the end of the history.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \struct	oBenchFillTy
+/// \brief 	Fill thread, generating a slice of the probes.
+///
+typedef struct
+{
+	pthread_t		oThread;
+	UINT32			u32First;
+	UINT32			u32Count;
+} oBenchFillTy;
+
+///
+/// \struct	oBenchQueryTy
+/// \brief 	One of the timed queries.
+///
+typedef struct
+{
+	const char*		pszName;
+	UINT32			u32From;
+	UINT32			u32To;
+	UINT32			u32Step;
+} oBenchQueryTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void* BenchFillThread(void* pvArg);
+static double BenchRun(const oBenchQueryTy* poQuery, bool bRawOnly, UINT32 u32Threads, oTsqAggTy* paoOut, oTsqStatsTy* poStats);
+static bool BenchSame(const oTsqAggTy* paoA, const oTsqAggTy* paoB, UINT64 u64Count);
+static double BenchNow();
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oTsqSeriesTy*	paoSeries		= NULL;
+static oTsqSeriesTy**	ppoSeries		= NULL;
+static UINT32			u32Probes		= BENCH_PROBES;
+static UINT32			u32Years		= BENCH_YEARS;
+static UINT32			u32Interval		= BENCH_INTERVAL_MIN * 60;
+static UINT32			u32Repeats		= BENCH_REPEATS;
+static UINT32			u32Seed			= 1;
+
+
+int main(int argc, char** argv)
+{
+	oBenchFillTy	aoFill[TSQ_THREADS_MAX];
+	oBenchQueryTy	aoQueries[4];
+	oTsqAggTy*		paoRaw			= NULL;
+	oTsqAggTy*		paoRollup		= NULL;
+	oTsqStatsTy		oRawStats;
+	oTsqStatsTy		oRollupStats;
+	UINT32			u32Threads		= (UINT32)sysconf(_SC_NPROCESSORS_ONLN);
+	UINT32			u32End			= 0;
+	UINT32			u32Idx			= 0;
+	UINT32			u32MaxSteps		= 0;
+	UINT64			u64Points		= 0;
+	UINT64			u64Buckets		= 0;
+	double			dStart			= 0;
+	double			dFill			= 0;
+	double			dRaw1			= 0;
+	double			dRawN			= 0;
+	double			dRollup1		= 0;
+	double			dRollupN		= 0;
+	bool			bSame			= TRUE;
+	int				iOpt			= 0;
+
+	while ((iOpt = getopt(argc, argv, "n:y:i:t:r:s:h")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'n': u32Probes		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'y': u32Years		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'i': u32Interval	= (UINT32)strtoul(optarg, NULL, 0) * 60; break;
+		case 't': u32Threads	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'r': u32Repeats	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 's': u32Seed		= (UINT32)strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "Usage: %s [-n probes] [-y years] [-i minutes] [-t threads] [-r repeats] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (!u32Probes || !u32Years || (u32Years > 50) || !u32Interval || !u32Threads || (u32Threads > TSQ_THREADS_MAX) || !u32Repeats)
+	{
+		fprintf(stderr, "Invalid parameters\n");
+		return 1;
+	}
+
+	paoSeries	= calloc(u32Probes, sizeof(oTsqSeriesTy));
+	ppoSeries	= calloc(u32Probes, sizeof(oTsqSeriesTy*));
+	if (!paoSeries || !ppoSeries)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	// Fill, one slice of the probes per thread (like the gateway workers).
+	dStart = BenchNow();
+	for (u32Idx = 0; u32Idx < u32Threads; ++u32Idx)
+	{
+		aoFill[u32Idx].u32First	= (UINT32)((UINT64)u32Probes * u32Idx / u32Threads);
+		aoFill[u32Idx].u32Count	= (UINT32)((UINT64)u32Probes * (u32Idx + 1) / u32Threads) - aoFill[u32Idx].u32First;
+		pthread_create(&aoFill[u32Idx].oThread, NULL, BenchFillThread, &aoFill[u32Idx]);
+	}
+	for (u32Idx = 0; u32Idx < u32Threads; ++u32Idx)
+	{
+		pthread_join(aoFill[u32Idx].oThread, NULL);
+	}
+	dFill = BenchNow() - dStart;
+
+	for (u32Idx = 0; u32Idx < u32Probes; ++u32Idx)
+	{
+		UINT8 u8Level;
+
+		if (paoSeries[u32Idx].u64Points == 0)
+		{
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+
+		ppoSeries[u32Idx]	= &paoSeries[u32Idx];
+		u64Points			+= paoSeries[u32Idx].u64Points;
+		for (u8Level = 0; u8Level < TSQ_LEVELS; ++u8Level)
+		{
+			u64Buckets += paoSeries[u32Idx].aoRollups[u8Level].u32Count;
+		}
+	}
+
+	printf("fleet:    %u probes, %u years, one report every %u min\n", u32Probes, u32Years, u32Interval / 60);
+	printf("store:    %llu points, %llu rollup buckets, %.0f MB\n", (unsigned long long)u64Points, (unsigned long long)u64Buckets,
+		(u64Points * sizeof(oTsqPointTy) + u64Buckets * sizeof(oTsqBucketTy)) / 1048576.0);
+	printf("fill:     %.2f s on %u threads (%.1f M points/s, rollups included)\n", dFill, u32Threads, u64Points / dFill / 1e6);
+	printf("queries:  best of %u, ms (raw points / rollups)\n", u32Repeats);
+	printf("%-9s %9s %12s %12s %10s %10s %10s %10s  %s\n", "", "periods", "points read", "buckets read",
+		"raw 1T", "raw NT", "rollup 1T", "rollup NT", "result");
+
+	// Queries, anchored on the end of the history.
+	u32End = (UINT32)(BENCH_EPOCH + u32Years * 365UL * BENCH_DAY);
+
+	aoQueries[0].pszName	= "season";
+	aoQueries[0].u32From	= u32End - (BENCH_SEASON_DAYS + 200) * BENCH_DAY;
+	aoQueries[0].u32To		= aoQueries[0].u32From + BENCH_SEASON_DAYS * BENCH_DAY;
+	aoQueries[0].u32Step	= BENCH_DAY;
+
+	aoQueries[1].pszName	= "week";
+	aoQueries[1].u32From	= u32End - 60 * BENCH_DAY + BENCH_WEEK_OFFSET;
+	aoQueries[1].u32To		= aoQueries[1].u32From + 7 * BENCH_DAY - 120;
+	aoQueries[1].u32Step	= 3600;
+
+	aoQueries[2].pszName	= "history";
+	aoQueries[2].u32From	= BENCH_EPOCH;
+	aoQueries[2].u32To		= u32End;
+	aoQueries[2].u32Step	= 30 * BENCH_DAY;
+
+	aoQueries[3].pszName	= "last";
+	aoQueries[3].u32From	= u32End - BENCH_LAST_AGO - 3600;
+	aoQueries[3].u32To		= u32End - BENCH_LAST_AGO;
+	aoQueries[3].u32Step	= 3600;
+
+	for (u32Idx = 0; u32Idx < 4; ++u32Idx)
+	{
+		UINT32 u32Steps = TsqStepCount(aoQueries[u32Idx].u32From, aoQueries[u32Idx].u32To, aoQueries[u32Idx].u32Step);
+
+		if (u32Steps > u32MaxSteps) u32MaxSteps = u32Steps;
+	}
+
+	paoRaw		= malloc((size_t)u32Probes * u32MaxSteps * sizeof(oTsqAggTy));
+	paoRollup	= malloc((size_t)u32Probes * u32MaxSteps * sizeof(oTsqAggTy));
+	if (!paoRaw || !paoRollup)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (u32Idx = 0; u32Idx < 4; ++u32Idx)
+	{
+		const oBenchQueryTy*	poQuery		= &aoQueries[u32Idx];
+		UINT32					u32Steps	= TsqStepCount(poQuery->u32From, poQuery->u32To, poQuery->u32Step);
+		bool					bQuerySame	= FALSE;
+
+		dRaw1		= BenchRun(poQuery, TRUE, 1, paoRaw, &oRawStats);
+		dRawN		= BenchRun(poQuery, TRUE, u32Threads, paoRaw, &oRawStats);
+		dRollup1	= BenchRun(poQuery, FALSE, 1, paoRollup, &oRollupStats);
+		dRollupN	= BenchRun(poQuery, FALSE, u32Threads, paoRollup, &oRollupStats);
+
+		bQuerySame	= BenchSame(paoRaw, paoRollup, (UINT64)u32Probes * u32Steps);
+		bSame		= bSame && bQuerySame;
+
+		printf("%-9s %9u %12llu %12llu %10.3f %10.3f %10.3f %10.3f  %s\n", poQuery->pszName, u32Steps,
+			(unsigned long long)oRollupStats.u64Points, (unsigned long long)oRollupStats.u64Buckets,
+			dRaw1 * 1e3, dRawN * 1e3, dRollup1 * 1e3, dRollupN * 1e3, bQuerySame ? "same" : "DIFFERENT");
+	}
+
+	printf("raw scan: %llu points per query over the whole history\n", (unsigned long long)u64Points);
+
+	return bSame ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		BenchFillThread - Synthetic history of a slice of the probes.
+////////////////////////////////////////////////////////////////////////////////
+static void* BenchFillThread(void* pvArg)
+{
+	oBenchFillTy*	poFill	= (oBenchFillTy*)pvArg;
+	UINT32			u32Idx	= 0;
+
+	for (u32Idx = poFill->u32First; u32Idx < poFill->u32First + poFill->u32Count; ++u32Idx)
+	{
+		oTsqSeriesTy*	poSeries	= &paoSeries[u32Idx];
+		UINT32			u32Rand		= (u32Seed * 2654435761UL) ^ (u32Idx * 40503UL) ^ 0x9E3779B9UL;
+		UINT32			u32Time		= (UINT32)BENCH_EPOCH + u32Idx % u32Interval;
+		UINT32			u32End		= (UINT32)(BENCH_EPOCH + u32Years * 365UL * BENCH_DAY);
+		double			dMoisture	= 70.0;
+		double			dDryRate	= 0.0;
+		oTsqPointTy		oPoint;
+
+		TsqSeriesInit(poSeries, 0x00A00000UL + u32Idx);
+
+		for (; u32Time < u32End; u32Time += u32Interval)
+		{
+			double	dSeason	= sin(2.0 * M_PI * (u32Time - BENCH_EPOCH) / (365.0 * BENCH_DAY));
+			INT32	i32Avg	= 0;
+
+			// Dries faster in summer and in the afternoon, watered below 35 %.
+			dDryRate	= (0.6 + 0.4 * dSeason) * (1.0 + 0.5 * sin(2.0 * M_PI * (u32Time % BENCH_DAY) / BENCH_DAY)) / 3600.0;
+			dMoisture	-= dDryRate * u32Interval * (1.0 + (u32Idx % 7) / 10.0);
+			if (dMoisture < 35.0)
+			{
+				dMoisture = 75.0 + (u32Idx % 5);
+			}
+
+			u32Rand	= u32Rand * 1103515245UL + 12345;
+			i32Avg	= (INT32)(dMoisture + (INT32)((u32Rand >> 16) % 5) - 2);
+			if (i32Avg < 3)		i32Avg = 3;
+			if (i32Avg > 96)	i32Avg = 96;
+
+			oPoint.u32Time			= u32Time;
+			oPoint.u8AverageValue	= (UINT8)i32Avg;
+			oPoint.u8MinimumValue	= (UINT8)(i32Avg - (INT32)((u32Rand >> 20) % 4));
+			oPoint.u8MaximumValue	= (UINT8)(i32Avg + (INT32)((u32Rand >> 24) % 4));
+			oPoint.u8CurrentValue	= (UINT8)(i32Avg + (INT32)((u32Rand >> 28) % 3) - 1);
+			oPoint.u16RawValue		= (UINT16)(1023 - i32Avg * 7);
+
+			if (!TsqAppend(poSeries, &oPoint))
+			{
+				break;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static double BenchRun(const oBenchQueryTy* poQuery, bool bRawOnly, UINT32 u32Threads, oTsqAggTy* paoOut, oTsqStatsTy* poStats)
+{
+	double dBest	= 0;
+	double dStart	= 0;
+	UINT32 u32Run	= 0;
+
+	for (u32Run = 0; u32Run < u32Repeats; ++u32Run)
+	{
+		memset(poStats, 0, sizeof(oTsqStatsTy));
+
+		dStart = BenchNow();
+		TsqQueryFleet(ppoSeries, u32Probes, poQuery->u32From, poQuery->u32To, poQuery->u32Step, bRawOnly, u32Threads, paoOut, poStats);
+		dStart = BenchNow() - dStart;
+
+		if ((u32Run == 0) || (dStart < dBest))
+		{
+			dBest = dStart;
+		}
+	}
+
+	return dBest;
+}
+
+static bool BenchSame(const oTsqAggTy* paoA, const oTsqAggTy* paoB, UINT64 u64Count)
+{
+	UINT64 u64Idx = 0;
+
+	for (u64Idx = 0; u64Idx < u64Count; ++u64Idx)
+	{
+		if ((paoA[u64Idx].u32Start != paoB[u64Idx].u32Start)
+			|| (paoA[u64Idx].u32Count != paoB[u64Idx].u32Count)
+			|| (paoA[u64Idx].u32Count
+				&& ((paoA[u64Idx].u8Minimum != paoB[u64Idx].u8Minimum)
+					|| (paoA[u64Idx].u8Maximum != paoB[u64Idx].u8Maximum)
+					|| (paoA[u64Idx].u64SumAverage != paoB[u64Idx].u64SumAverage)
+					|| (paoA[u64Idx].u64SumCurrent != paoB[u64Idx].u64SumCurrent)
+					|| (paoA[u64Idx].u64SumRaw != paoB[u64Idx].u64SumRaw))))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static double BenchNow()
+{
+	struct timespec oTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &oTs);
+	return oTs.tv_sec + oTs.tv_nsec / 1e9;
+}
@@ -0,0 +1,627 @@
+///
+/// \file     replay.c
+/// \brief    Sensor trace replay (Linux)
+/// \details  Feeds a trace recorded by TraceMgr ("trace on" on the serial
+///           console) back into the real MoistSensorMgr code, on a virtual
+///           clock, and prints the results it publishes. Weeks of field data
+///           replay in seconds, so a filter or scheduling change can be
+///           checked by diffing the output before and after the change.
+///
+///           Two modes:
+///           - exact (default): the sensor task is called at the recorded
+///             times and the ADC returns the recorded samples in order. An
+///             unchanged firmware reproduces the recorded results exactly;
+///             -c checks it. Samples, pin changes or results that move in
+///             time are counted as divergences.
+///           - resampled (-s <ms>): the task is called every <ms> and the ADC
+///             returns the recorded signal at that time (last sample held).
+///             Use it when the change moves the samples in time.
+///
+///           Build:
+///             gcc -O2 -Itools/host -I. -o replay tools/replay/replay.c
+///                 tools/host/HostArduino.c MoistSensorMgr.c SensorHealth.c
+///                 TraceMgr.c SystemTime.c StreamStats.c
+///
+///           Examples:
+///             grep -a '#TRC' node.log > node.trc
+///             ./replay -c node.trc                        firmware vs node
+///             ./replay node.trc > before.txt              (change, rebuild)
+///             ./replay node.trc > after.txt; diff before.txt after.txt
+///             ./replay -s 7 -r resampled.trc node.trc     new trace from a resampled run
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MoistSensorMgr.h"
+#include "CalibMgr.h"
+#include "SystemTime.h"
+#include "TraceMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define REPLAY_LINE_MAX         256         ///< Longest input line.
+#define REPLAY_GAP_STEP         60000       ///< Longest time between two task calls, in ms, as on a running node.
+#define REPLAY_WARN_MAX         10          ///< Divergences printed in full.
+#define REPLAY_PIN              D8          ///< Probe power pin of the node.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef enum
+{
+	REPLAY_EV_SETTING = 0,			///< S
+	REPLAY_EV_TABLE,				///< L
+	REPLAY_EV_INIT,					///< I
+	REPLAY_EV_ADC,					///< A
+	REPLAY_EV_PIN,					///< D
+	REPLAY_EV_RESULT,				///< R
+} ReplayEventTypeTy;
+
+typedef enum
+{
+	REPLAY_KEY_READING_MIN = 0,
+	REPLAY_KEY_READING_MAX,
+	REPLAY_KEY_ADAPT_DELTA,
+	REPLAY_KEY_ADAPT_VAR,
+	REPLAY_KEY_POLLING,
+	REPLAY_KEY_DURATION,
+	REPLAY_KEY_DEADBAND,
+	REPLAY_KEY_DEADBAND_PCT,
+	REPLAY_KEY_HEARTBEAT,
+	REPLAY_KEY_MAX
+} ReplayKeyTy;
+
+///
+/// \struct	oReplayEventTy
+/// \brief 	One trace line.
+///
+typedef struct
+{
+	UINT64		u64Time;				///< Recorded time, unwrapped.
+	UINT8		u8Type;					///< ReplayEventTypeTy.
+	UINT8		u8Key;					///< ReplayKeyTy (S) or pin (A, D).
+	UINT16		u16Arg;					///< Raw (A, L), level (D).
+	UINT32		u32Value;				///< Setting value (S), percent (L).
+	UINT8		au8Result[6];			///< avg, cur, min, max, quality, fault (R).
+} oReplayEventTy;
+
+///
+/// \struct	oReplayTy
+/// \brief 	Replay state.
+///
+typedef struct
+{
+	// Trace.
+	oReplayEventTy*		paoEvent;
+	UINT32				u32Count;
+	UINT32				u32Bad;					///< Lines that could not be parsed.
+
+	// Options.
+	UINT32				u32Step;				///< Resampled mode step, 0 for the exact mode.
+	bool				bCheck;					///< Fail on any divergence.
+	FILE*				pRecord;				///< Re-recorded trace, or NULL.
+
+	// Virtual node.
+	poMoistSensorMgrTy	poSensor;
+	UINT8				au8Table[CALIBMGR_LUT_SIZE];
+	UINT64				u64Now;
+	bool				bConfigured;
+
+	// Cursors in the trace.
+	UINT32				u32NextAdc;
+	UINT32				u32NextPin;
+	UINT32				u32NextResult;
+	UINT16				u16Held;				///< Resampled mode: last sample.
+
+	// Statistics.
+	UINT32				u32Calls;
+	UINT32				u32Results;
+	UINT32				u32AdcDiverged;
+	UINT32				u32PinDiverged;
+	UINT32				u32ResultDiverged;
+	UINT32				u32Warnings;
+} oReplayTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool ReplayLoad(FILE* pFile);
+static void ReplayApply(const oReplayEventTy* poEvent);
+static void ReplayCall(UINT64 u64Time);
+static void ReplayCallTask(UINT64 u64Time);
+static void ReplayRunExact();
+static void ReplayRunResampled();
+static UINT16 ReplayAnalogRead(UINT8 u8Pin);
+static void ReplayDigitalWrite(UINT8 u8Pin, UINT8 u8Level);
+static void ReplayTraceWrite(const char* pszLine);
+static void ReplayWarn(const char* pszWhat, UINT64 u64Expected);
+static UINT32 ReplayFind(UINT32 u32From, ReplayEventTypeTy eType);
+static double ReplayNow();
+static void ReplayUsage(const char* pszName);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oReplayTy oReplay = {0};
+
+static const char* const apszKey[REPLAY_KEY_MAX] = {
+	"reading_min", "reading_max", "adapt_delta", "adapt_var", "polling",
+	"duration", "deadband", "deadband_pct", "heartbeat"
+};
+
+
+int main(int argc, char** argv)
+{
+	FILE*	pFile		= stdin;
+	double	dStart		= 0;
+	double	dElapsed	= 0;
+	double	dSpan		= 0;
+	UINT32	u32Diverged	= 0;
+	int		iOpt		= 0;
+
+	while ((iOpt = getopt(argc, argv, "s:cr:h")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 's': oReplay.u32Step = (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'c': oReplay.bCheck = TRUE; break;
+		case 'r':
+			oReplay.pRecord = fopen(optarg, "w");
+			if (!oReplay.pRecord)
+			{
+				perror(optarg);
+				return 1;
+			}
+			break;
+		default:  ReplayUsage(argv[0]); return 1;
+		}
+	}
+
+	if ((optind < argc) && !(pFile = fopen(argv[optind], "r")))
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (!ReplayLoad(pFile) || !oReplay.u32Count)
+	{
+		fprintf(stderr, "No trace line found\n");
+		return 1;
+	}
+
+	// Virtual node.
+	HostArduinoSetAnalogRead(ReplayAnalogRead);
+	HostArduinoSetDigitalWrite(ReplayDigitalWrite);
+	SystemTimeInit();
+	oReplay.poSensor = MoistSensorMgr(REPLAY_PIN);
+
+	if (oReplay.pRecord)
+	{
+		TraceMgrStart(ReplayTraceWrite);
+	}
+
+	dStart = ReplayNow();
+
+	if (oReplay.u32Step)
+	{
+		ReplayRunResampled();
+	}
+	else
+	{
+		ReplayRunExact();
+	}
+
+	dElapsed	= ReplayNow() - dStart;
+	dSpan		= (oReplay.paoEvent[oReplay.u32Count - 1].u64Time - oReplay.paoEvent[0].u64Time) / 1000.0;
+	u32Diverged	= oReplay.u32AdcDiverged + oReplay.u32PinDiverged + oReplay.u32ResultDiverged;
+
+	fprintf(stderr, "%u events (%u bad lines), %.1f h of trace in %.3f s (%.0fx real time), %u task calls\n",
+		oReplay.u32Count, oReplay.u32Bad, dSpan / 3600.0, dElapsed, (dElapsed > 0) ? dSpan / dElapsed : 0.0, oReplay.u32Calls);
+	fprintf(stderr, "results: %u published, %u suppressed\n", oReplay.poSensor->u32ReportsEmitted, oReplay.poSensor->u32ReportsSuppressed);
+
+	if (!oReplay.u32Step)
+	{
+		fprintf(stderr, "divergences from the trace: %u samples, %u pin changes, %u results\n",
+			oReplay.u32AdcDiverged, oReplay.u32PinDiverged, oReplay.u32ResultDiverged);
+	}
+
+	if (oReplay.pRecord)
+	{
+		fclose(oReplay.pRecord);
+	}
+
+	return (oReplay.bCheck && u32Diverged) ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The calibration table comes from the trace (L lines), not from CalibMgr.
+////////////////////////////////////////////////////////////////////////////////
+const UINT8* CalibMgrGetTable(UINT8 u8Probe)
+{
+	(void)u8Probe;
+	return oReplay.au8Table;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static bool ReplayLoad(FILE* pFile)
+{
+	char			szLine[REPLAY_LINE_MAX];
+	char			szKey[32];
+	char			cType		= 0;
+	const char*		pszStart	= NULL;
+	unsigned long	ulTime		= 0;
+	unsigned		auArg[6];
+	UINT32			u32Alloc	= 0;
+	UINT32			u32Prev		= 0;
+	UINT64			u64Epoch	= 0;
+	int				iPos		= 0;
+	int				iKey		= 0;
+	oReplayEventTy	oEvent;
+
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		// The trace may be mixed with other output on the same serial log.
+		if (!(pszStart = strstr(szLine, TRACEMGR_PREFIX " ")))
+		{
+			continue;
+		}
+
+		memset(&oEvent, 0, sizeof(oEvent));
+
+		if (sscanf(pszStart + sizeof(TRACEMGR_PREFIX), "%lu %c%n", &ulTime, &cType, &iPos) < 2)
+		{
+			++oReplay.u32Bad;
+			continue;
+		}
+
+		pszStart += sizeof(TRACEMGR_PREFIX) + iPos;
+
+		switch (cType)
+		{
+		case 'V':
+			if ((sscanf(pszStart, "%u", &auArg[0]) != 1) || (auArg[0] != TRACEMGR_VERSION))
+			{
+				fprintf(stderr, "Unsupported trace version\n");
+				return FALSE;
+			}
+			continue;
+		case 'S':
+			if (sscanf(pszStart, "%31s %u", szKey, &auArg[0]) != 2) goto BAD;
+			for (iKey = 0; (iKey < REPLAY_KEY_MAX) && strcmp(szKey, apszKey[iKey]); ++iKey);
+			if (iKey == REPLAY_KEY_MAX) goto BAD;
+			oEvent.u8Type	= REPLAY_EV_SETTING;
+			oEvent.u8Key	= (UINT8)iKey;
+			oEvent.u32Value	= auArg[0];
+			break;
+		case 'L':
+			if ((sscanf(pszStart, "%u %u", &auArg[0], &auArg[1]) != 2) || (auArg[0] >= CALIBMGR_LUT_SIZE)) goto BAD;
+			oEvent.u8Type	= REPLAY_EV_TABLE;
+			oEvent.u16Arg	= (UINT16)auArg[0];
+			oEvent.u32Value	= auArg[1];
+			break;
+		case 'I':
+			oEvent.u8Type	= REPLAY_EV_INIT;
+			break;
+		case 'A':
+		case 'D':
+			if (sscanf(pszStart, "%u %u", &auArg[0], &auArg[1]) != 2) goto BAD;
+			oEvent.u8Type	= (cType == 'A') ? REPLAY_EV_ADC : REPLAY_EV_PIN;
+			oEvent.u8Key	= (UINT8)auArg[0];
+			oEvent.u16Arg	= (UINT16)auArg[1];
+			break;
+		case 'R':
+			if (sscanf(pszStart, "%u %u %u %u %u %u", &auArg[0], &auArg[1], &auArg[2], &auArg[3], &auArg[4], &auArg[5]) != 6) goto BAD;
+			oEvent.u8Type	= REPLAY_EV_RESULT;
+			for (iKey = 0; iKey < 6; ++iKey)
+			{
+				oEvent.au8Result[iKey] = (UINT8)auArg[iKey];
+			}
+			break;
+		default:
+			goto BAD;
+		}
+
+		// millis() wraps after 49.7 days.
+		if (oReplay.u32Count && ((UINT32)ulTime < u32Prev) && (u32Prev - (UINT32)ulTime > 0x80000000UL))
+		{
+			u64Epoch += 0x100000000ULL;
+		}
+		u32Prev			= (UINT32)ulTime;
+		oEvent.u64Time	= u64Epoch + (UINT32)ulTime;
+
+		if (oReplay.u32Count == u32Alloc)
+		{
+			u32Alloc			= u32Alloc ? u32Alloc * 2 : 65536;
+			oReplay.paoEvent	= realloc(oReplay.paoEvent, u32Alloc * sizeof(oReplayEventTy));
+			if (!oReplay.paoEvent)
+			{
+				return FALSE;
+			}
+		}
+
+		oReplay.paoEvent[oReplay.u32Count++] = oEvent;
+		continue;
+BAD:
+		++oReplay.u32Bad;
+	}
+
+	return TRUE;
+}
+
+static void ReplayApply(const oReplayEventTy* poEvent)
+{
+	poMoistSensorMgrTy	poSensor	= oReplay.poSensor;
+	UINT16				u16Raw		= 0;
+
+	if (poEvent->u8Type == REPLAY_EV_TABLE)
+	{
+		// Sorted by raw value: each line sets the rest of the table.
+		for (u16Raw = poEvent->u16Arg; u16Raw < CALIBMGR_LUT_SIZE; ++u16Raw)
+		{
+			oReplay.au8Table[u16Raw] = (UINT8)poEvent->u32Value;
+		}
+		return;
+	}
+
+	switch (poEvent->u8Key)
+	{
+	case REPLAY_KEY_READING_MIN:	poSensor->u32ReadingIntervalMin	= poEvent->u32Value; break;
+	case REPLAY_KEY_READING_MAX:	poSensor->u32ReadingIntervalMax	= poEvent->u32Value; break;
+	case REPLAY_KEY_ADAPT_DELTA:	poSensor->u16AdaptDelta			= (UINT16)poEvent->u32Value; break;
+	case REPLAY_KEY_ADAPT_VAR:		poSensor->u16AdaptVariance		= (UINT16)poEvent->u32Value; break;
+	case REPLAY_KEY_POLLING:		poSensor->u16PollingInterval	= (UINT16)poEvent->u32Value; break;
+	case REPLAY_KEY_DURATION:		poSensor->u16PollingDuration	= (UINT16)poEvent->u32Value; break;
+	case REPLAY_KEY_DEADBAND:		poSensor->u8DeadbandAbs			= (UINT8)poEvent->u32Value; break;
+	case REPLAY_KEY_DEADBAND_PCT:	poSensor->u8DeadbandPct			= (UINT8)poEvent->u32Value; break;
+	case REPLAY_KEY_HEARTBEAT:		poSensor->u32Heartbeat			= poEvent->u32Value; break;
+	}
+}
+
+static void ReplayRunExact()
+{
+	const oReplayEventTy*	poEvent		= NULL;
+	UINT32					u32Idx		= 0;
+	bool					bCalled		= FALSE;
+	UINT64					u64LastCall	= 0;
+
+	for (u32Idx = 0; u32Idx < oReplay.u32Count; ++u32Idx)
+	{
+		poEvent = &oReplay.paoEvent[u32Idx];
+
+		switch (poEvent->u8Type)
+		{
+		case REPLAY_EV_SETTING:
+		case REPLAY_EV_TABLE:
+			ReplayApply(poEvent);
+
+			// Re-record the settings once the whole set is applied.
+			if ((u32Idx + 1 == oReplay.u32Count) || (oReplay.paoEvent[u32Idx + 1].u8Type > REPLAY_EV_INIT))
+			{
+				TraceMgrSettings((UINT32)poEvent->u64Time, oReplay.poSensor);
+			}
+			break;
+
+		case REPLAY_EV_INIT:
+			oReplay.u64Now = poEvent->u64Time;
+			HostArduinoSetMillis((UINT32)oReplay.u64Now);
+			oReplay.bConfigured = MoistSensorMgrConfigure(oReplay.poSensor);
+			bCalled = FALSE;
+			break;
+
+		default:
+			// One task call per recorded time stamp with something in it;
+			// the calls in between had no effect on the node.
+			if (oReplay.bConfigured && (!bCalled || (poEvent->u64Time != u64LastCall)))
+			{
+				ReplayCall(poEvent->u64Time);
+				bCalled		= TRUE;
+				u64LastCall	= poEvent->u64Time;
+			}
+			break;
+		}
+	}
+}
+
+static void ReplayRunResampled()
+{
+	const oReplayEventTy*	poEvent		= NULL;
+	UINT32					u32Idx		= 0;
+	UINT64					u64End		= oReplay.paoEvent[oReplay.u32Count - 1].u64Time;
+
+	// Before the first sample, read as the first sample.
+	u32Idx = ReplayFind(0, REPLAY_EV_ADC);
+	oReplay.u16Held = (u32Idx < oReplay.u32Count) ? oReplay.paoEvent[u32Idx].u16Arg : 0;
+
+	// Settings and restarts at their time, the task at every step.
+	for (u32Idx = 0; u32Idx < oReplay.u32Count; ++u32Idx)
+	{
+		poEvent = &oReplay.paoEvent[u32Idx];
+
+		while (oReplay.bConfigured && (oReplay.u64Now + oReplay.u32Step <= poEvent->u64Time))
+		{
+			ReplayCallTask(oReplay.u64Now + oReplay.u32Step);
+		}
+
+		if ((poEvent->u8Type == REPLAY_EV_SETTING) || (poEvent->u8Type == REPLAY_EV_TABLE))
+		{
+			ReplayApply(poEvent);
+
+			if ((u32Idx + 1 == oReplay.u32Count) || (oReplay.paoEvent[u32Idx + 1].u8Type > REPLAY_EV_INIT))
+			{
+				TraceMgrSettings((UINT32)oReplay.u64Now, oReplay.poSensor);
+			}
+		}
+		else if (poEvent->u8Type == REPLAY_EV_INIT)
+		{
+			oReplay.u64Now = poEvent->u64Time;
+			HostArduinoSetMillis((UINT32)oReplay.u64Now);
+			oReplay.bConfigured = MoistSensorMgrConfigure(oReplay.poSensor);
+		}
+		else if (poEvent->u8Type == REPLAY_EV_ADC)
+		{
+			// The calls up to this sample are done: hold it for the next ones.
+			oReplay.u16Held = poEvent->u16Arg;
+		}
+	}
+
+	while (oReplay.bConfigured && (oReplay.u64Now + oReplay.u32Step <= u64End))
+	{
+		ReplayCallTask(oReplay.u64Now + oReplay.u32Step);
+	}
+}
+
+static void ReplayCall(UINT64 u64Time)
+{
+	// Long waits are cut into steps ending at the recorded call, so none
+	// of them reaches a threshold before the node did.
+	while (u64Time - oReplay.u64Now > REPLAY_GAP_STEP)
+	{
+		ReplayCallTask(u64Time - ((u64Time - oReplay.u64Now - 1) / REPLAY_GAP_STEP) * REPLAY_GAP_STEP);
+	}
+
+	ReplayCallTask(u64Time);
+}
+
+static void ReplayCallTask(UINT64 u64Time)
+{
+	const oReplayEventTy*	poRecorded	= NULL;
+	BOOL					bNewResult	= FALSE;
+	poMoistSensorMgrTy		poSensor	= oReplay.poSensor;
+
+	oReplay.u64Now = u64Time;
+	HostArduinoSetMillis((UINT32)u64Time);
+
+	MoistSensorMgrTask();
+	++oReplay.u32Calls;
+
+	if (!MoistSensorMgrIsNewResultAvail(&bNewResult) || !bNewResult)
+	{
+		return;
+	}
+
+	++oReplay.u32Results;
+	printf("%lu R %u %u %u %u %u %u\n", (unsigned long)(UINT32)u64Time, poSensor->u8AverageValue, poSensor->u8CurrentValue,
+		poSensor->u8MinimumValue, poSensor->u8MaximumValue, poSensor->u8Quality, poSensor->u8FaultCode);
+
+	if (oReplay.u32Step)
+	{
+		return;
+	}
+
+	// Compare with the next recorded result.
+	oReplay.u32NextResult	= ReplayFind(oReplay.u32NextResult, REPLAY_EV_RESULT);
+	poRecorded				= (oReplay.u32NextResult < oReplay.u32Count) ? &oReplay.paoEvent[oReplay.u32NextResult++] : NULL;
+
+	if (!poRecorded || (poRecorded->u64Time != u64Time)
+		|| (poRecorded->au8Result[0] != poSensor->u8AverageValue) || (poRecorded->au8Result[1] != poSensor->u8CurrentValue)
+		|| (poRecorded->au8Result[2] != poSensor->u8MinimumValue) || (poRecorded->au8Result[3] != poSensor->u8MaximumValue)
+		|| (poRecorded->au8Result[4] != poSensor->u8Quality) || (poRecorded->au8Result[5] != poSensor->u8FaultCode))
+	{
+		++oReplay.u32ResultDiverged;
+		ReplayWarn("result", poRecorded ? poRecorded->u64Time : 0);
+	}
+}
+
+static UINT16 ReplayAnalogRead(UINT8 u8Pin)
+{
+	const oReplayEventTy* poRecorded = NULL;
+
+	(void)u8Pin;
+
+	if (oReplay.u32Step)
+	{
+		return oReplay.u16Held;
+	}
+
+	oReplay.u32NextAdc = ReplayFind(oReplay.u32NextAdc, REPLAY_EV_ADC);
+	if (oReplay.u32NextAdc >= oReplay.u32Count)
+	{
+		++oReplay.u32AdcDiverged;
+		ReplayWarn("sample (past the end)", 0);
+		return 0;
+	}
+
+	poRecorded = &oReplay.paoEvent[oReplay.u32NextAdc++];
+	if (poRecorded->u64Time != oReplay.u64Now)
+	{
+		++oReplay.u32AdcDiverged;
+		ReplayWarn("sample", poRecorded->u64Time);
+	}
+
+	return poRecorded->u16Arg;
+}
+
+static void ReplayDigitalWrite(UINT8 u8Pin, UINT8 u8Level)
+{
+	const oReplayEventTy* poRecorded = NULL;
+
+	if (oReplay.u32Step)
+	{
+		return;
+	}
+
+	oReplay.u32NextPin	= ReplayFind(oReplay.u32NextPin, REPLAY_EV_PIN);
+	poRecorded			= (oReplay.u32NextPin < oReplay.u32Count) ? &oReplay.paoEvent[oReplay.u32NextPin++] : NULL;
+
+	if (!poRecorded || (poRecorded->u64Time != oReplay.u64Now) || (poRecorded->u8Key != u8Pin) || (poRecorded->u16Arg != u8Level))
+	{
+		++oReplay.u32PinDiverged;
+		ReplayWarn("pin change", poRecorded ? poRecorded->u64Time : 0);
+	}
+}
+
+static void ReplayTraceWrite(const char* pszLine)
+{
+	fputs(pszLine, oReplay.pRecord);
+}
+
+static void ReplayWarn(const char* pszWhat, UINT64 u64Expected)
+{
+	if (++oReplay.u32Warnings <= REPLAY_WARN_MAX)
+	{
+		fprintf(stderr, "diverged: %s at %llu ms, recorded at %llu ms\n", pszWhat,
+			(unsigned long long)oReplay.u64Now, (unsigned long long)u64Expected);
+	}
+}
+
+static UINT32 ReplayFind(UINT32 u32From, ReplayEventTypeTy eType)
+{
+	while ((u32From < oReplay.u32Count) && (oReplay.paoEvent[u32From].u8Type != eType))
+	{
+		++u32From;
+	}
+
+	return u32From;
+}
+
+static double ReplayNow()
+{
+	struct timespec oTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &oTs);
+	return oTs.tv_sec + oTs.tv_nsec / 1e9;
+}
+
+static void ReplayUsage(const char* pszName)
+{
+	fprintf(stderr,
+		"Usage: %s [options] [trace]     (trace on stdin by default)\n"
+		"  -s ms     resampled mode: call the sensor task every ms\n"
+		"  -c        exit with 1 if the replay diverges from the trace\n"
+		"  -r file   record the replayed run as a new trace\n",
+		pszName);
+}
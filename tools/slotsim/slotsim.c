@@ -0,0 +1,498 @@
+///
+/// \file     slotsim.c
+/// \brief    Multi-node uplink simulation over a shared medium (Linux)
+/// \details  Compares, for a growing number of nodes, the free uplink (each
+///           result sent as soon as it is ready) with the slotted one (see
+///           CommSched), before the gateway assigns the slots (the nodes send
+///           as in free mode, the derived slot is not used) and after.
+///
+///           Nodes:
+///           - boot within a short window (default 1 s: power restored to
+///             the whole field), one reading per cycle;
+///           - local clocks drift (default +/- 40 ppm); the slotted nodes
+///             resynchronize on the gateway beacon of each cycle, through
+///             the firmware CommSched code;
+///           - the report is handed to the radio at the next loop()
+///             iteration after the result (free) or the slot opening
+///             (slotted).
+///
+///           Medium: one 802.11 DCF cell, every station hears the others (no
+///           hidden terminal), the beacons are not counted:
+///           - DIFS, then a random backoff of CW slots, frozen while the
+///             medium is busy; the stations whose backoff ends in the same
+///             slot collide;
+///           - unicast (gw_ip set): an ACK, and after a collision CW doubles
+///             and the frame is retried, up to the retry limit;
+///           - broadcast (-B, the default gw_ip): no ACK, a collision loses
+///             the frames.
+///
+///           Slots: -k, else sized to the field like the gateway should be
+///           (at least one per node). Age (result to ACK) includes, when
+///           slotted, the COMMSCHED_READING_MARGIN between the aligned
+///           reading and the slot.
+///
+///           Build:
+///             gcc -O2 -Itools/host -I. -o slotsim tools/slotsim/slotsim.c
+///                 CommSched.c -lm
+///
+///           Usage: ./slotsim [-n 8,16,...] [-c cycles] [-k slots] [-b boot ms]
+///                            [-d drift ppm] [-B] [-s seed]
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CommSched.h"
+#include "MoistSensorMgr.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SIM_NODES               "8,16,32,64,128,256"
+#define SIM_NODES_MAX           4096
+#define SIM_CYCLES              240         ///< One hour of 15 s cycles.
+#define SIM_BOOT_SPREAD         1000        ///< Boot window, in ms.
+#define SIM_DRIFT_PPM           40          ///< Largest clock error of a node.
+#define SIM_LOOP_US             5000        ///< Longest loop() iteration, in us.
+#define SIM_BEACON_LATENCY_US   2000        ///< Longest beacon delivery delay, in us.
+#define SIM_READING_MS          POLLING_TIME    ///< Duration of a reading.
+
+// 802.11b DCF, in us.
+#define SIM_SLOT_US             20
+#define SIM_SIFS_US             10
+#define SIM_DIFS_US             (SIM_SIFS_US + 2 * SIM_SLOT_US)
+#define SIM_CW_MIN              31
+#define SIM_CW_MAX              1023
+#define SIM_RETRY_LIMIT         7
+#define SIM_DATA_US             896         ///< 88 byte frame at 1 Mb/s (weak link), long preamble.
+#define SIM_ACK_US              304
+#define SIM_ACK_TIMEOUT_US      (SIM_SIFS_US + SIM_ACK_US + SIM_SLOT_US)
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef enum
+{
+	SIM_SCHEME_FREE = 0,
+	SIM_SCHEME_DERIVED,
+	SIM_SCHEME_ASSIGNED,
+	SIM_SCHEME_MAX
+} SimSchemeTy;
+
+///
+/// \struct	oSimFrameTy
+/// \brief 	One report and its way through the medium.
+///
+typedef struct
+{
+	UINT64		u64Result;				///< Result published, true time in us.
+	UINT64		u64Ready;				///< Handed to the radio.
+	UINT32		u32Backoff;				///< Remaining backoff slots.
+	UINT32		u32Cw;
+	UINT32		u32Retries;
+} oSimFrameTy;
+
+///
+/// \struct	oSimStatsTy
+/// \brief 	Outcome of one run.
+///
+typedef struct
+{
+	UINT32		u32Frames;
+	UINT32		u32Delivered;
+	UINT32		u32Lost;
+	UINT32		u32Attempts;
+	UINT32		u32Collisions;			///< Collision events.
+	UINT32		u32MaxContenders;		///< Most frames waiting for the medium at once.
+	double*		pdAccess;				///< Ready to delivered, in ms.
+	double*		pdAge;					///< Result to delivered, in ms.
+} oSimStatsTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static UINT32 SimBuildFrames(SimSchemeTy eScheme, UINT32 u32Nodes, oSimFrameTy* paoFrames);
+static void SimMedium(oSimFrameTy* paoFrames, UINT32 u32Count, oSimStatsTy* poStats);
+static void SimPrint(UINT32 u32Nodes, SimSchemeTy eScheme, oSimStatsTy* poStats);
+static UINT32 SimLocal(UINT64 u64True, UINT64 u64Boot, double dRate);
+static UINT64 SimTrue(UINT32 u32Local, UINT64 u64Boot, double dRate);
+static int SimCompareFrames(const void* pvA, const void* pvB);
+static int SimCompareDouble(const void* pvA, const void* pvB);
+static UINT32 SimRand();
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static UINT32	u32Cycles		= SIM_CYCLES;
+static UINT16	u16SlotsSet		= 0;		///< 0: sized to the field.
+static UINT16	u16Slots		= COMMSCHED_SLOTS;
+static UINT32	u32BootSpread	= SIM_BOOT_SPREAD;
+static UINT32	u32DriftPpm		= SIM_DRIFT_PPM;
+static bool		bBroadcast		= FALSE;
+static UINT32	u32Seed			= 1;
+static UINT32	u32Rand			= 1;
+
+static const char* const apszScheme[SIM_SCHEME_MAX] = {"free", "slotted, unassigned", "slotted, assigned"};
+
+
+int main(int argc, char** argv)
+{
+	const char*		pszNodes	= SIM_NODES;
+	char			szList[256];
+	char*			pszToken	= NULL;
+	oSimFrameTy*	paoFrames	= NULL;
+	oSimStatsTy		oStats;
+	UINT32			u32Nodes	= 0;
+	UINT32			u32Count	= 0;
+	int				iOpt		= 0;
+	int				iScheme		= 0;
+
+	while ((iOpt = getopt(argc, argv, "n:c:k:b:d:Bs:h")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'n': pszNodes		= optarg; break;
+		case 'c': u32Cycles		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'k': u16SlotsSet	= (UINT16)strtoul(optarg, NULL, 0); break;
+		case 'b': u32BootSpread	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'd': u32DriftPpm	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'B': bBroadcast	= TRUE; break;
+		case 's': u32Seed		= (UINT32)strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "Usage: %s [-n 8,16,...] [-c cycles] [-k slots] [-b boot ms] [-d drift ppm] [-B] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (!u32Cycles || (u16SlotsSet && (COMMSCHED_CYCLE / u16SlotsSet < COMMSCHED_SLOT_WIDTH_MIN)))
+	{
+		fprintf(stderr, "Invalid cycle count or slot count\n");
+		return 1;
+	}
+
+	paoFrames		= malloc(sizeof(oSimFrameTy) * SIM_NODES_MAX * (u32Cycles + 1));
+	oStats.pdAccess	= malloc(sizeof(double) * SIM_NODES_MAX * (u32Cycles + 1));
+	oStats.pdAge	= malloc(sizeof(double) * SIM_NODES_MAX * (u32Cycles + 1));
+	if (!paoFrames || !oStats.pdAccess || !oStats.pdAge)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	printf("%u cycles of %lu ms, boot within %u ms, drift +/-%u ppm, %s\n",
+		u32Cycles, (unsigned long)COMMSCHED_CYCLE, u32BootSpread, u32DriftPpm,
+		bBroadcast ? "broadcast (no ACK, no retry)" : "unicast");
+	printf("nodes  slots  scheme              delivered  retries/frame  collisions  contenders  access ms mean/p99/max   age ms mean/p99\n");
+
+	snprintf(szList, sizeof(szList), "%s", pszNodes);
+	for (pszToken = strtok(szList, ","); pszToken; pszToken = strtok(NULL, ","))
+	{
+		u32Nodes = (UINT32)strtoul(pszToken, NULL, 0);
+		if (!u32Nodes || (u32Nodes > SIM_NODES_MAX))
+		{
+			fprintf(stderr, "Node count out of range: %s\n", pszToken);
+			return 1;
+		}
+
+		// As the gateway would be set (-k): at least one slot per node.
+		u16Slots = u16SlotsSet;
+		if (!u16Slots)
+		{
+			for (u16Slots = COMMSCHED_SLOTS; (u16Slots < u32Nodes) && (COMMSCHED_CYCLE / (u16Slots * 2) >= COMMSCHED_SLOT_WIDTH_MIN); u16Slots *= 2);
+		}
+
+		for (iScheme = 0; iScheme < SIM_SCHEME_MAX; ++iScheme)
+		{
+			u32Count = SimBuildFrames((SimSchemeTy)iScheme, u32Nodes, paoFrames);
+			SimMedium(paoFrames, u32Count, &oStats);
+			SimPrint(u32Nodes, (SimSchemeTy)iScheme, &oStats);
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SimBuildFrames - Reports of every node, in the order they reach
+///				the radio.
+///
+/// \return		Number of frames.
+////////////////////////////////////////////////////////////////////////////////
+static UINT32 SimBuildFrames(SimSchemeTy eScheme, UINT32 u32Nodes, oSimFrameTy* paoFrames)
+{
+	oCommSchedTy	oSched;
+	UINT64			u64Boot		= 0;
+	UINT64			u64Beacon	= 0;
+	UINT64			u64End		= (UINT64)(u32Cycles + 1) * COMMSCHED_CYCLE * 1000;
+	UINT32			u32Count	= 0;
+	UINT32			u32Node		= 0;
+	UINT32			u32Cycle	= 0;
+	UINT32			u32Local	= 0;
+	UINT32			u32Wait		= 0;
+	double			dRate		= 1.0;
+	oSimFrameTy*	poFrame		= NULL;
+
+	// Same field for every scheme.
+	u32Rand = u32Seed;
+
+	for (u32Node = 0; u32Node < u32Nodes; ++u32Node)
+	{
+		u64Boot	= (UINT64)(SimRand() % (u32BootSpread + 1)) * 1000 + SimRand() % 1000;
+		dRate	= 1.0 + ((double)(SimRand() % (2 * u32DriftPpm + 1)) - u32DriftPpm) * 1e-6;
+
+		CommSchedInit(&oSched, (eScheme == SIM_SCHEME_FREE) ? COMMSCHED_MODE_FREE : COMMSCHED_MODE_SLOTTED,
+			COMMSCHED_CYCLE, u16Slots, COMMSCHED_SLOT_AUTO, 0x00A00000 + SimRand() % 0x100000);
+
+		if (eScheme == SIM_SCHEME_ASSIGNED)
+		{
+			// The gateway spreads the nodes over the slots.
+			CommSchedAssign(&oSched, (UINT16)((UINT64)(u32Node % u16Slots) * u16Slots / ((u32Nodes < u16Slots) ? u32Nodes : u16Slots)));
+		}
+
+		for (u32Cycle = 1; u32Cycle <= u32Cycles; ++u32Cycle)
+		{
+			poFrame = &paoFrames[u32Count];
+
+			if (eScheme != SIM_SCHEME_FREE)
+			{
+				// Beacon at the cycle start, phase 0.
+				u64Beacon = (UINT64)u32Cycle * COMMSCHED_CYCLE * 1000 + SimRand() % SIM_BEACON_LATENCY_US;
+				CommSchedSync(&oSched, SimLocal(u64Beacon, u64Boot, dRate), COMMSCHED_CYCLE, u16Slots, 0);
+			}
+
+			if (!CommSchedHasSlot(&oSched))
+			{
+				// Reading interval, then the reading itself (see waiting_state).
+				poFrame->u64Result	= u64Boot + (UINT64)((u32Cycle - 1) * (MOISTURE_DELAY + SIM_READING_MS) + SIM_READING_MS) * 1000 / dRate;
+				poFrame->u64Ready	= poFrame->u64Result + SimRand() % SIM_LOOP_US;
+			}
+			else
+			{
+				// Reading aligned on the slot (see MoistSensorMgrSetPhase).
+				u32Local			= CommSchedReadingStart(&oSched, SIM_READING_MS) + SIM_READING_MS;
+				poFrame->u64Result	= SimTrue(u32Local, u64Boot, dRate);
+
+				u32Wait				= CommSchedTimeToSlot(&oSched, u32Local);
+				poFrame->u64Ready	= SimTrue(u32Local + u32Wait, u64Boot, dRate) + SimRand() % SIM_LOOP_US;
+			}
+
+			if ((poFrame->u64Result < u64Boot) || (poFrame->u64Ready >= u64End))
+			{
+				continue;
+			}
+
+			poFrame->u32Cw		= SIM_CW_MIN;
+			poFrame->u32Retries	= 0;
+			++u32Count;
+		}
+	}
+
+	qsort(paoFrames, u32Count, sizeof(oSimFrameTy), SimCompareFrames);
+
+	return u32Count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SimMedium - Runs the frames through the DCF.
+/// \details	Event driven: the time jumps from one transmission to the
+///				next. A frame arriving during a countdown joins it at the
+///				current slot.
+////////////////////////////////////////////////////////////////////////////////
+static void SimMedium(oSimFrameTy* paoFrames, UINT32 u32Count, oSimStatsTy* poStats)
+{
+	oSimFrameTy*	apoActive[SIM_NODES_MAX * 2];
+	UINT32			u32Active	= 0;
+	UINT32			u32Next		= 0;
+	UINT32			u32Idx		= 0;
+	UINT32			u32Min		= 0;
+	UINT32			u32Tx		= 0;
+	UINT32			u32Elapsed	= 0;
+	UINT64			u64Now		= 0;
+	UINT64			u64Countdown	= 0;
+	UINT64			u64TxTime	= 0;
+
+	poStats->u32Frames			= u32Count;
+	poStats->u32Delivered		= 0;
+	poStats->u32Lost			= 0;
+	poStats->u32Attempts		= 0;
+	poStats->u32Collisions		= 0;
+	poStats->u32MaxContenders	= 0;
+
+	while ((u32Next < u32Count) || u32Active)
+	{
+		if (!u32Active && (u64Now < paoFrames[u32Next].u64Ready))
+		{
+			u64Now = paoFrames[u32Next].u64Ready;
+		}
+
+		// New contenders.
+		while ((u32Next < u32Count) && (paoFrames[u32Next].u64Ready <= u64Now) && (u32Active < SIM_NODES_MAX * 2))
+		{
+			paoFrames[u32Next].u32Backoff	= SimRand() % (paoFrames[u32Next].u32Cw + 1);
+			apoActive[u32Active++]			= &paoFrames[u32Next++];
+		}
+
+		if (u32Active > poStats->u32MaxContenders)
+		{
+			poStats->u32MaxContenders = u32Active;
+		}
+
+		// Medium idle from u64Now: DIFS, then the shortest backoff.
+		u64Countdown	= u64Now + SIM_DIFS_US;
+		u32Min			= SIM_CW_MAX;
+		for (u32Idx = 0; u32Idx < u32Active; ++u32Idx)
+		{
+			if (apoActive[u32Idx]->u32Backoff < u32Min)
+			{
+				u32Min = apoActive[u32Idx]->u32Backoff;
+			}
+		}
+		u64TxTime = u64Countdown + (UINT64)u32Min * SIM_SLOT_US;
+
+		// Someone else arrives first: count down to there and let it in.
+		if ((u32Next < u32Count) && (paoFrames[u32Next].u64Ready < u64TxTime))
+		{
+			u32Elapsed = (paoFrames[u32Next].u64Ready > u64Countdown) ? (UINT32)((paoFrames[u32Next].u64Ready - u64Countdown) / SIM_SLOT_US) : 0;
+			for (u32Idx = 0; u32Idx < u32Active; ++u32Idx)
+			{
+				apoActive[u32Idx]->u32Backoff -= u32Elapsed;
+			}
+			u64Now = u64Countdown + (UINT64)u32Elapsed * SIM_SLOT_US - SIM_DIFS_US;
+			if (u64Now < paoFrames[u32Next].u64Ready)
+			{
+				u64Now = paoFrames[u32Next].u64Ready;
+			}
+			continue;
+		}
+
+		// Transmission(s) at u64TxTime.
+		u32Tx = 0;
+		for (u32Idx = 0; u32Idx < u32Active; ++u32Idx)
+		{
+			apoActive[u32Idx]->u32Backoff -= u32Min;
+			if (apoActive[u32Idx]->u32Backoff == 0)
+			{
+				++u32Tx;
+			}
+		}
+		poStats->u32Attempts += u32Tx;
+
+		u64Now = u64TxTime + SIM_DATA_US;
+		if (u32Tx == 1)
+		{
+			u64Now += bBroadcast ? 0 : SIM_SIFS_US + SIM_ACK_US;
+		}
+		else
+		{
+			u64Now += bBroadcast ? 0 : SIM_ACK_TIMEOUT_US;
+			++poStats->u32Collisions;
+		}
+
+		for (u32Idx = 0; u32Idx < u32Active; )
+		{
+			oSimFrameTy* poFrame = apoActive[u32Idx];
+
+			if (poFrame->u32Backoff != 0)
+			{
+				++u32Idx;
+				continue;
+			}
+
+			if (u32Tx == 1)
+			{
+				poStats->pdAccess[poStats->u32Delivered]	= (u64Now - poFrame->u64Ready) / 1000.0;
+				poStats->pdAge[poStats->u32Delivered]		= (u64Now - poFrame->u64Result) / 1000.0;
+				++poStats->u32Delivered;
+			}
+			else if (!bBroadcast && (poFrame->u32Retries < SIM_RETRY_LIMIT))
+			{
+				++poFrame->u32Retries;
+				poFrame->u32Cw		= (poFrame->u32Cw * 2 + 1 > SIM_CW_MAX) ? SIM_CW_MAX : poFrame->u32Cw * 2 + 1;
+				poFrame->u32Backoff	= SimRand() % (poFrame->u32Cw + 1);
+				++u32Idx;
+				continue;
+			}
+			else
+			{
+				++poStats->u32Lost;
+			}
+
+			apoActive[u32Idx] = apoActive[--u32Active];
+		}
+	}
+}
+
+static void SimPrint(UINT32 u32Nodes, SimSchemeTy eScheme, oSimStatsTy* poStats)
+{
+	UINT32	u32Idx		= 0;
+	UINT32	u32P99		= 0;
+	double	dAccess		= 0;
+	double	dAge		= 0;
+
+	for (u32Idx = 0; u32Idx < poStats->u32Delivered; ++u32Idx)
+	{
+		dAccess	+= poStats->pdAccess[u32Idx];
+		dAge	+= poStats->pdAge[u32Idx];
+	}
+
+	qsort(poStats->pdAccess, poStats->u32Delivered, sizeof(double), SimCompareDouble);
+	qsort(poStats->pdAge, poStats->u32Delivered, sizeof(double), SimCompareDouble);
+	u32P99 = poStats->u32Delivered ? (UINT32)((poStats->u32Delivered - 1) * 0.99) : 0;
+
+	printf("%5u  %5u  %-18s  %8.2f%%  %13.3f  %10u  %10u  %7.2f /%7.2f /%7.2f  %8.1f /%7.1f\n",
+		u32Nodes, u16Slots, apszScheme[eScheme],
+		poStats->u32Frames ? 100.0 * poStats->u32Delivered / poStats->u32Frames : 0.0,
+		poStats->u32Frames ? (double)(poStats->u32Attempts - poStats->u32Frames) / poStats->u32Frames : 0.0,
+		poStats->u32Collisions, poStats->u32MaxContenders,
+		poStats->u32Delivered ? dAccess / poStats->u32Delivered : 0.0,
+		poStats->u32Delivered ? poStats->pdAccess[u32P99] : 0.0,
+		poStats->u32Delivered ? poStats->pdAccess[poStats->u32Delivered - 1] : 0.0,
+		poStats->u32Delivered ? dAge / poStats->u32Delivered : 0.0,
+		poStats->u32Delivered ? poStats->pdAge[u32P99] : 0.0);
+}
+
+static UINT32 SimLocal(UINT64 u64True, UINT64 u64Boot, double dRate)
+{
+	// millis() of the node: wraps like the firmware one.
+	return (UINT32)(UINT64)((u64True - u64Boot) * dRate / 1000.0);
+}
+
+static UINT64 SimTrue(UINT32 u32Local, UINT64 u64Boot, double dRate)
+{
+	return u64Boot + (UINT64)(u32Local * 1000.0 / dRate);
+}
+
+static int SimCompareFrames(const void* pvA, const void* pvB)
+{
+	const oSimFrameTy* poA = (const oSimFrameTy*)pvA;
+	const oSimFrameTy* poB = (const oSimFrameTy*)pvB;
+
+	return (poA->u64Ready > poB->u64Ready) - (poA->u64Ready < poB->u64Ready);
+}
+
+static int SimCompareDouble(const void* pvA, const void* pvB)
+{
+	double dA = *(const double*)pvA;
+	double dB = *(const double*)pvB;
+
+	return (dA > dB) - (dA < dB);
+}
+
+static UINT32 SimRand()
+{
+	u32Rand = u32Rand * 1103515245 + 12345;
+	return u32Rand >> 8;
+}
@@ -0,0 +1,805 @@
+///
+/// \file     soak.c
+/// \brief    Long uptime soak test of the application loop (Linux)
+/// \details  Runs the application loop (work budget mark, MoistSensorMgr
+///           task, then, as ApplicationTask() does, IrrigationMgr on each
+///           reading, HistoryMgr, WifiMgr, CommMgr and its reading phase,
+///           WebMgr) on the virtual system clock, through months of simulated uptime and as many
+///           wrap-arounds of the 32 bits millisecond counter. The loop period
+///           is random and the loop is stalled from time to time (long WiFi
+///           connection, flash erase...), beyond 65 s by default. The soil
+///           starts dry, so the valve opens, closes and waits for its
+///           minimum off-time across the first wrap-around.
+///
+///           Timing invariants checked at every step:
+///           - the system time difference is the time actually elapsed;
+///           - a reading starts between its interval and its interval plus
+///             the last loop step after the previous one ended (none missed,
+///             none early), and the interval stays within its bounds;
+///           - a reading lasts its duration, plus at most the last loop step,
+///             and takes between 1 and duration / polling samples;
+///           - every reading is either published or suppressed, and a result
+///             is published once the heartbeat expired;
+///           - the reports: each result goes to CommMgr, which queues it
+///             while the WiFi link is down (12 hours every 5 days, so the
+///             queue overflows) and sends it once it is back; every report
+///             is sent, dropped or queued, none while the link is down;
+///           - the message buffers: the virtual network stack holds the
+///             reports (and a chained payload now and then) for a few loops,
+///             as lwIP does. No allocation fails, and every buffer is back
+///             in the pool at the end;
+///           - the valve (hysteresis, the soil wets while it is open): an
+///             opening lasts at most the maximum on-time plus the last loop
+///             step, two openings are at least the minimum off-time apart,
+///             and the water given in a day stays within the cap (plus the
+///             flow of the last loop step);
+///           - the history: every result is stored, and read back in time
+///             order across the wrap-arounds, the last one as appended.
+///
+///           With -c the probe creeps out of the soil instead: the valve
+///           stays off, the soil keeps its moisture and the probe reads
+///           SOAK_CREEP_RAW more, little by little over SOAK_CREEP_LENGTH
+///           from day 2. The drift must not be flagged before the probe
+///           moved by SENSORHEALTH_DRIFT_MAX, and must be flagged before the
+///           end (-d 30). Without -c the soil itself goes from dry to
+///           watered, which the detector cannot tell from a drift: not
+///           checked.
+///
+///           WebMgr has no TCP stack on the host: its task only runs in the
+///           loop, the requests are not simulated.
+///
+///           Build:
+///             gcc -O2 -DSYSTEMTIME_VIRTUAL_CLOCK -Itools/host -I. -o soak
+///                 tools/soak/soak.c tools/host/HostArduino.c SystemTime.c
+///                 MoistSensorMgr.c SensorHealth.c CalibMgr.c TraceMgr.c
+///                 WorkBudget.c StreamStats.c BufPool.c CommReport.c
+///                 CommMgr.c CommSched.c WifiMgr.c ConfigMgr.c FlashMgr.c
+///                 Crc.c IrrigationMgr.c HistoryMgr.c SeriesCodec.c WebMgr.c
+///
+///           Usage: ./soak [-d days] [-t start ms] [-l loop ms] [-j stall ms] [-s seed] [-c]
+/// \author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MoistSensorMgr.h"
+#include "CalibMgr.h"
+#include "SystemTime.h"
+#include "WorkBudget.h"
+#include "BufPool.h"
+#include "CommMgr.h"
+#include "ConfigMgr.h"
+#include "IrrigationMgr.h"
+#include "HistoryMgr.h"
+#include "WebMgr.h"
+#include "SensorHealth.h"
+
+#ifndef SYSTEMTIME_VIRTUAL_CLOCK
+#error "Build with -DSYSTEMTIME_VIRTUAL_CLOCK"
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Definitions
+////////////////////////////////////////////////////////////////////////////////
+#define SOAK_DAY                86400000ULL                 ///< One day, in ms.
+#define SOAK_DAYS               120                         ///< Default simulated uptime.
+#define SOAK_START              (0xFFFFFFFFUL - 600000UL)   ///< Default start: 10 min before the wrap-around.
+#define SOAK_LOOP_MS            10                          ///< Default mean loop period.
+#define SOAK_STALL_MS           120000                      ///< Default longest stall.
+#define SOAK_STALL_EVERY        3600000UL                   ///< Mean time between two stalls.
+#define SOAK_WARN_MAX           10                          ///< Violations printed in full.
+#define SOAK_PIN                D8
+#define SOAK_VALVE_PIN          D5
+#define SOAK_SOIL_DRY           830.0                       ///< Raw value at the start, below the low threshold.
+#define SOAK_SOIL_DRYING        (200.0 / SOAK_DAY)          ///< Raw counts per ms, valve closed.
+#define SOAK_SOIL_WETTING       (60.0 / 60000)              ///< Raw counts per ms, valve open.
+#define SOAK_INFLIGHT_MAX       8                           ///< Buffers held by the network stack.
+#define SOAK_OUTAGE_EVERY       (5 * SOAK_DAY)              ///< Link down for SOAK_OUTAGE_MS at the start of each period.
+#define SOAK_OUTAGE_MS          (12 * 3600000ULL)
+#define SOAK_BLOB_EVERY         16                          ///< One result in this many also sends a chained payload.
+#define SOAK_BLOB_SIZE          700
+#define SOAK_CREEP_START        (2 * SOAK_DAY)              ///< Probe creep (-c): starts once the reference is learnt,
+#define SOAK_CREEP_LENGTH       (21 * SOAK_DAY)             ///< lasts three weeks,
+#define SOAK_CREEP_RAW          200.0                       ///< and moves the probe by this much in the end.
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////////////
+typedef enum
+{
+	SOAK_CHECK_TIMEDIFF = 0,
+	SOAK_CHECK_INTERVAL,
+	SOAK_CHECK_READING_START,
+	SOAK_CHECK_READING_LENGTH,
+	SOAK_CHECK_SAMPLES,
+	SOAK_CHECK_ACCOUNTING,
+	SOAK_CHECK_HEARTBEAT,
+	SOAK_CHECK_REPORTS,
+	SOAK_CHECK_BUFFERS,
+	SOAK_CHECK_VALVE,
+	SOAK_CHECK_HISTORY,
+	SOAK_CHECK_DRIFT,
+	SOAK_CHECK_MAX
+} SoakCheckTy;
+
+///
+/// \struct	oSoakTy
+/// \brief 	Soak state.
+///
+typedef struct
+{
+	// Options.
+	UINT32				u32Days;
+	UINT32				u32Start;
+	UINT32				u32LoopMs;
+	UINT32				u32StallMs;
+	UINT32				u32Seed;
+	bool				bCreep;
+
+	// Virtual node.
+	poMoistSensorMgrTy	poSensor;
+	UINT64				u64Now;					///< Elapsed time, never wraps.
+	UINT32				u32Step;				///< Last loop step.
+	double				dSoil;					///< Raw value of the soil.
+	double				dCreep;					///< Raw offset of the probe (-c).
+	UINT64				u64DriftFlagged;		///< First drift fault, 0 if none.
+
+	// Current reading, from the probe pin and the ADC.
+	bool				bBooted;				///< Boot reading done.
+	bool				bPowered;
+	bool				bReadingEnded;			///< Set by the pin callback, cleared by the loop.
+	UINT64				u64ReadingStart;
+	UINT64				u64ReadingEnd;
+	UINT32				u32Samples;
+	UINT32				u32Interval;			///< Interval chosen at the end of the last reading.
+	bool				bHasReading;			///< A reading ended since the start.
+
+	// Published results.
+	UINT64				u64LastPublished;
+	UINT32				u32Accounted;			///< Published + suppressed at the last reading.
+
+	// Valve.
+	poIrrigationMgrTy	poIrrigation;
+	bool				bValveOpen;
+	bool				bValveClosed;			///< u64ValveClose is valid.
+	UINT64				u64ValveOpen;
+	UINT64				u64ValveClose;
+	UINT32				u32Waterings;
+
+	// History.
+	UINT32				u32HistoryRead;			///< Readings read back at the last check.
+
+	// Network.
+	bool				bLinkUp;
+	poBufTy				apoInFlight[SOAK_INFLIGHT_MAX];		///< Buffers held by the network stack.
+	UINT8				au8InFlightLoops[SOAK_INFLIGHT_MAX];	///< Loops before the stack releases it.
+	UINT32				u32Outages;
+	UINT32				u32Blobs;
+
+	// Statistics.
+	UINT32				u32Loops;
+	UINT32				u32Stalls;
+	UINT32				u32Readings;
+	UINT32				u32Results;
+	UINT32				u32Wraps;
+	UINT32				u32MinInterval;
+	UINT32				u32MaxInterval;
+	UINT32				au32Violations[SOAK_CHECK_MAX];
+	UINT32				u32Warnings;
+} oSoakTy;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void SoakLoop();
+static void SoakCheckReading();
+static void SoakPublish();
+static void SoakHistory();
+static void SoakValveCheck();
+static void SoakDriftCheck();
+static void SoakNetwork(bool bFinal);
+static bool SoakStackTake(poBufTy poBuf);
+static bool SoakUdpSend(void* pvMsg);
+static UINT16 SoakAnalogRead(UINT8 u8Pin);
+static void SoakDigitalWrite(UINT8 u8Pin, UINT8 u8Level);
+static void SoakViolation(SoakCheckTy eCheck, const char* pszFormat, unsigned long long ullA, unsigned long long ullB);
+static UINT32 SoakRand();
+static double SoakNow();
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+static oSoakTy oSoak = {0};
+
+static const char* const apszCheck[SOAK_CHECK_MAX] = {
+	"time difference", "interval bounds", "reading start", "reading length",
+	"samples per reading", "result accounting", "heartbeat", "report accounting", "message buffers",
+	"valve limits", "history", "probe drift"
+};
+
+
+int main(int argc, char** argv)
+{
+	oCalibCurveTy	oCurve		= {0};
+	UINT64			u64End		= 0;
+	UINT32			u32Total	= 0;
+	double			dStart		= 0;
+	double			dElapsed	= 0;
+	int				iOpt		= 0;
+	int				iCheck		= 0;
+	char			szLine[BUFPOOL_LINE_MAX];
+	oCommMgrStatsTy	oComm;
+
+	oSoak.u32Days		= SOAK_DAYS;
+	oSoak.u32Start		= SOAK_START;
+	oSoak.u32LoopMs		= SOAK_LOOP_MS;
+	oSoak.u32StallMs	= SOAK_STALL_MS;
+	oSoak.u32Seed		= 1;
+
+	while ((iOpt = getopt(argc, argv, "d:t:l:j:s:ch")) != -1)
+	{
+		switch (iOpt)
+		{
+		case 'd': oSoak.u32Days		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 't': oSoak.u32Start	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'l': oSoak.u32LoopMs	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'j': oSoak.u32StallMs	= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 's': oSoak.u32Seed		= (UINT32)strtoul(optarg, NULL, 0); break;
+		case 'c': oSoak.bCreep		= TRUE; break;
+		default:
+			fprintf(stderr, "Usage: %s [-d days] [-t start ms] [-l loop ms] [-j stall ms, 0: none] [-s seed] [-c probe creep]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (!oSoak.u32LoopMs)
+	{
+		oSoak.u32LoopMs = 1;
+	}
+
+	// Virtual node, same bring-up as the boot sequence.
+	HostArduinoSetAnalogRead(SoakAnalogRead);
+	HostArduinoSetDigitalWrite(SoakDigitalWrite);
+	HostArduinoSetUdpSend(SoakUdpSend);
+	SystemTimeInit();
+	SystemTimeVirtualSetRate(0);
+	SystemTimeVirtualSet(oSoak.u32Start);
+
+	oSoak.poSensor = MoistSensorMgr(SOAK_PIN);
+	if (!CalibMgrBuild(0, &oCurve, oSoak.poSensor->u16MapMax, oSoak.poSensor->u16MapMin)
+		|| !MoistSensorMgrConfigure(oSoak.poSensor))
+	{
+		fprintf(stderr, "Sensor configuration failed\n");
+		return 1;
+	}
+
+	// The defaults leave the valve off: hysteresis, as set from the console.
+	// Not with a creeping probe: the valve would make up for it.
+	oSoak.poIrrigation = IrrigationMgr(SOAK_VALVE_PIN);
+	if (!oSoak.bCreep)
+	{
+		oSoak.poIrrigation->u8Mode = IRRIGATIONMGR_MODE_HYSTERESIS;
+	}
+	if (!IrrigationMgrConfigure(oSoak.poIrrigation))
+	{
+		fprintf(stderr, "Irrigation configuration failed\n");
+		return 1;
+	}
+
+	if (!ConfigMgrLoad(ConfigMgr()) || !WifiMgr() || !WifiMgrConfigure() || !WifiMgrConnect()
+		|| !CommMgr() || !CommMgrConfigure())
+	{
+		fprintf(stderr, "Network configuration failed\n");
+		return 1;
+	}
+	oSoak.bLinkUp = TRUE;
+
+	// No TCP stack on the host: refused, the task runs anyway.
+	WebMgrStart(WEBMGR_PORT, oSoak.poSensor);
+
+	oSoak.dSoil				= SOAK_SOIL_DRY;
+	oSoak.u32MinInterval	= MAX_VAL_UINT32;
+	u64End					= oSoak.u32Days * SOAK_DAY;
+	dStart					= SoakNow();
+
+	while (oSoak.u64Now < u64End)
+	{
+		SoakLoop();
+	}
+
+	dElapsed = SoakNow() - dStart;
+
+	// Releases the queue, then the stack lets go of everything.
+	CommMgrGetStats(&oComm);
+	CommMgr();
+	SoakNetwork(TRUE);
+
+	if (oSoak.bCreep && !oSoak.u64DriftFlagged)
+	{
+		SoakViolation(SOAK_CHECK_DRIFT, "probe moved by %llu raw, drift not flagged (limit %llu raw)", (UINT64)oSoak.dCreep, SENSORHEALTH_DRIFT_MAX);
+	}
+
+	printf("%u days from %lu ms: %u wrap-arounds, %u loops, %u stalls, %.2f s (%.0fx real time)\n",
+		oSoak.u32Days, (unsigned long)oSoak.u32Start, oSoak.u32Wraps, oSoak.u32Loops, oSoak.u32Stalls,
+		dElapsed, (dElapsed > 0) ? oSoak.u64Now / 1000.0 / dElapsed : 0.0);
+	printf("%u readings (interval %lu .. %lu ms), %u results published, %u suppressed\n",
+		oSoak.u32Readings, (unsigned long)oSoak.u32MinInterval, (unsigned long)oSoak.u32MaxInterval,
+		oSoak.poSensor->u32ReportsEmitted, oSoak.poSensor->u32ReportsSuppressed);
+	printf("longest stretch without yield %lu ms, %lu over %u ms\n",
+		(unsigned long)WorkBudgetGetStats()->u32LongestStretch, (unsigned long)WorkBudgetGetStats()->u32StretchWarnings, WORKBUDGET_STRETCH_WARN);
+	printf("%u link outages: %lu reports sent, %lu dropped from the queue, %u still queued, %lu send errors, %u chained payloads\n",
+		oSoak.u32Outages, (unsigned long)oComm.u32Sent, (unsigned long)oComm.u32Dropped, oComm.u8Queued,
+		(unsigned long)oComm.u32Errors, oSoak.u32Blobs);
+	printf("%u waterings (%lu mL), %lu cut by the maximum on-time, %lu refused by the minimum off-time, %lu by the daily cap; %lu readings in the history\n",
+		oSoak.u32Waterings, (unsigned long)oSoak.poIrrigation->u32VolumeTotal, (unsigned long)oSoak.poIrrigation->u32MaxOnCutoffs,
+		(unsigned long)oSoak.poIrrigation->u32BlockedMinOff, (unsigned long)oSoak.poIrrigation->u32BlockedCap, (unsigned long)oSoak.u32HistoryRead);
+	if (oSoak.bCreep)
+	{
+		printf("probe moved by %.0f raw: drift %s%.1f days into the creep\n", oSoak.dCreep,
+			oSoak.u64DriftFlagged ? "flagged " : "not flagged, ",
+			((oSoak.u64DriftFlagged ? oSoak.u64DriftFlagged : oSoak.u64Now) - SOAK_CREEP_START) / (double)SOAK_DAY);
+	}
+	while (BufPoolFormatLine((UINT8)iCheck++, szLine, sizeof(szLine)))
+	{
+		printf("  %s\n", szLine);
+	}
+
+	for (iCheck = 0; iCheck < SOAK_CHECK_MAX; ++iCheck)
+	{
+		printf("  %-20s %s (%u)\n", apszCheck[iCheck], oSoak.au32Violations[iCheck] ? "FAILED" : "ok", oSoak.au32Violations[iCheck]);
+		u32Total += oSoak.au32Violations[iCheck];
+	}
+
+	return u32Total ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private functions
+////////////////////////////////////////////////////////////////////////////////
+static void SoakLoop()
+{
+	BOOL	bNewResult	= FALSE;
+	BOOL	bNewReading	= FALSE;
+	UINT32	u32Before	= SystemTimeGetTime();
+	UINT32	u32Cycle	= 0;
+	UINT32	u32Start	= 0;
+
+	// Next loop iteration: random period, sometimes a long stall.
+	oSoak.u32Step = 1 + SoakRand() % (2 * oSoak.u32LoopMs - 1);
+	if (oSoak.u32StallMs && (SoakRand() % (SOAK_STALL_EVERY / oSoak.u32LoopMs) == 0))
+	{
+		oSoak.u32Step += SoakRand() % oSoak.u32StallMs;
+		++oSoak.u32Stalls;
+	}
+
+	SystemTimeVirtualAdvance(oSoak.u32Step);
+	oSoak.u64Now += oSoak.u32Step;
+	++oSoak.u32Loops;
+
+	if (SystemTimeGetTime() < u32Before)
+	{
+		++oSoak.u32Wraps;
+	}
+
+	if (SystemTimeGetTimeDiff(u32Before) != oSoak.u32Step)
+	{
+		SoakViolation(SOAK_CHECK_TIMEDIFF, "time difference %llu ms, elapsed %llu ms", SystemTimeGetTimeDiff(u32Before), oSoak.u32Step);
+	}
+
+	// Soil: dries slowly, wets while the valve is open. A creeping probe
+	// reads drier and drier while the soil stays as it is.
+	if (!oSoak.bCreep)
+	{
+		oSoak.dSoil += oSoak.u32Step * (oSoak.bValveOpen ? -SOAK_SOIL_WETTING : SOAK_SOIL_DRYING);
+		if (oSoak.dSoil < MAP_MIN)
+		{
+			oSoak.dSoil = MAP_MIN;
+		}
+	}
+	else if ((oSoak.u64Now > SOAK_CREEP_START) && (oSoak.dCreep < SOAK_CREEP_RAW))
+	{
+		oSoak.dCreep = SOAK_CREEP_RAW * (oSoak.u64Now - SOAK_CREEP_START) / SOAK_CREEP_LENGTH;
+		if (oSoak.dCreep > SOAK_CREEP_RAW)
+		{
+			oSoak.dCreep = SOAK_CREEP_RAW;
+		}
+	}
+
+	// WiFi link: down at the start of each outage period.
+	if (oSoak.bLinkUp != ((oSoak.u64Now % SOAK_OUTAGE_EVERY) >= SOAK_OUTAGE_MS))
+	{
+		oSoak.bLinkUp = !oSoak.bLinkUp;
+		oSoak.u32Outages += oSoak.bLinkUp ? 0 : 1;
+		HostArduinoSetLink(oSoak.bLinkUp);
+	}
+
+	// Application loop, in the order of ApplicationTask().
+	WorkBudgetMark();
+	MoistSensorMgrTask();
+
+	if (MoistSensorMgrIsNewReadingAvail(&bNewReading) && bNewReading)
+	{
+		IrrigationMgrOnReading(oSoak.poIrrigation, oSoak.poSensor);
+	}
+
+	if (MoistSensorMgrIsNewResultAvail(&bNewResult) && bNewResult)
+	{
+		oSoak.u64LastPublished = oSoak.u64Now;
+		++oSoak.u32Results;
+		SoakHistory();
+		SoakPublish();
+		SoakDriftCheck();
+	}
+
+	IrrigationMgrTask();
+	SoakValveCheck();
+
+	WifiMgrTask();
+
+	CommMgrTask();
+	if (!CommMgrGetReadingPhase(oSoak.poSensor->u16PollingDuration, &u32Cycle, &u32Start))
+	{
+		u32Cycle = 0;
+	}
+	MoistSensorMgrSetPhase(oSoak.poSensor, u32Cycle, u32Start);
+
+	SoakNetwork(FALSE);
+	WebMgrTask();
+
+	if (oSoak.bReadingEnded)
+	{
+		oSoak.bReadingEnded = FALSE;
+		SoakCheckReading();
+	}
+}
+
+static void SoakCheckReading()
+{
+	poMoistSensorMgrTy	poSensor	= oSoak.poSensor;
+	UINT64				u64Length	= oSoak.u64ReadingEnd - oSoak.u64ReadingStart;
+	UINT32				u32Accounted = poSensor->u32ReportsEmitted + poSensor->u32ReportsSuppressed;
+
+	++oSoak.u32Readings;
+
+	if ((u64Length < poSensor->u16PollingDuration) || (u64Length >= (UINT64)poSensor->u16PollingDuration + oSoak.u32Step))
+	{
+		SoakViolation(SOAK_CHECK_READING_LENGTH, "reading lasted %llu ms, duration %llu ms", u64Length, poSensor->u16PollingDuration);
+	}
+
+	if ((oSoak.u32Samples < 1) || (oSoak.u32Samples > u64Length / poSensor->u16PollingInterval))
+	{
+		SoakViolation(SOAK_CHECK_SAMPLES, "%llu samples in %llu ms", oSoak.u32Samples, u64Length);
+	}
+
+	if (u32Accounted != oSoak.u32Accounted + 1)
+	{
+		SoakViolation(SOAK_CHECK_ACCOUNTING, "%llu results for %llu reading", u32Accounted - oSoak.u32Accounted, 1);
+	}
+	oSoak.u32Accounted = u32Accounted;
+
+	if (oSoak.u64Now - oSoak.u64LastPublished >= poSensor->u32Heartbeat)
+	{
+		SoakViolation(SOAK_CHECK_HEARTBEAT, "nothing published for %llu ms, heartbeat %llu ms", oSoak.u64Now - oSoak.u64LastPublished, poSensor->u32Heartbeat);
+	}
+
+	// Interval until the next reading, chosen by this one.
+	oSoak.u32Interval = poSensor->u32ReadingInterval;
+	oSoak.bHasReading = TRUE;
+
+	if ((oSoak.u32Interval < poSensor->u32ReadingIntervalMin) || (oSoak.u32Interval > poSensor->u32ReadingIntervalMax))
+	{
+		SoakViolation(SOAK_CHECK_INTERVAL, "interval %llu ms, max %llu ms", oSoak.u32Interval, poSensor->u32ReadingIntervalMax);
+	}
+
+	if (oSoak.u32Interval < oSoak.u32MinInterval) oSoak.u32MinInterval = oSoak.u32Interval;
+	if (oSoak.u32Interval > oSoak.u32MaxInterval) oSoak.u32MaxInterval = oSoak.u32Interval;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SoakPublish - Hands the result to CommMgr, as the application
+///				does, and sends a chained payload now and then.
+////////////////////////////////////////////////////////////////////////////////
+static void SoakPublish()
+{
+	oCommMgrStatsTy	oBefore;
+	oCommMgrStatsTy	oAfter;
+	poBufTy			poChain		= NULL;
+	UINT8			au8Blob[SOAK_BLOB_SIZE];
+	UINT8			au8Check[16];
+	UINT16			u16Idx		= 0;
+
+	CommMgrGetStats(&oBefore);
+
+	if (!CommMgrSendReading(oSoak.poSensor))
+	{
+		SoakViolation(SOAK_CHECK_BUFFERS, "report %llu not queued, %llu buffers in use", oSoak.u32Results, BufPoolInUse());
+	}
+
+	CommMgrGetStats(&oAfter);
+
+	if (oAfter.u32Sent + oAfter.u32Dropped + oAfter.u8Queued != oSoak.u32Results)
+	{
+		SoakViolation(SOAK_CHECK_REPORTS, "%llu reports sent, dropped or queued for %llu results",
+			oAfter.u32Sent + oAfter.u32Dropped + oAfter.u8Queued, oSoak.u32Results);
+	}
+
+	if (!oSoak.bLinkUp && (oAfter.u32Sent != oBefore.u32Sent))
+	{
+		SoakViolation(SOAK_CHECK_REPORTS, "%llu reports sent with the link down, %llu queued", oAfter.u32Sent - oBefore.u32Sent, oAfter.u8Queued);
+	}
+
+	if (oSoak.u32Results % SOAK_BLOB_EVERY)
+	{
+		return;
+	}
+
+	// Built in three parts, so the segments are filled and chained.
+	for (u16Idx = 0; u16Idx < SOAK_BLOB_SIZE; ++u16Idx)
+	{
+		au8Blob[u16Idx] = (UINT8)(u16Idx + oSoak.u32Results);
+	}
+
+	if (!BufPoolAppend(&poChain, au8Blob, 300) || !BufPoolAppend(&poChain, &au8Blob[300], 300)
+		|| !BufPoolAppend(&poChain, &au8Blob[600], SOAK_BLOB_SIZE - 600))
+	{
+		SoakViolation(SOAK_CHECK_BUFFERS, "no buffer for a %llu bytes payload, %llu in use", SOAK_BLOB_SIZE, BufPoolInUse());
+	}
+	else if ((BufPoolChainLen(poChain) != SOAK_BLOB_SIZE)
+		|| (BufPoolCopyOut(poChain, 505, au8Check, sizeof(au8Check)) != sizeof(au8Check))
+		|| memcmp(au8Check, &au8Blob[505], sizeof(au8Check)))
+	{
+		SoakViolation(SOAK_CHECK_BUFFERS, "chained payload of %llu bytes read back wrong (%llu)", SOAK_BLOB_SIZE, BufPoolChainLen(poChain));
+	}
+	else if (SoakStackTake(poChain))
+	{
+		++oSoak.u32Blobs;
+	}
+
+	BufPoolRelease(poChain);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SoakHistory - Stores the result, as the application does, and
+///				reads the whole history back.
+////////////////////////////////////////////////////////////////////////////////
+static void SoakHistory()
+{
+	poMoistSensorMgrTy	poSensor	= oSoak.poSensor;
+	oHistoryReaderTy	oReader;
+	UINT32				u32Time		= SystemTimeGetTime();
+	UINT32				u32Last		= 0;
+	UINT32				u32Stamp	= 0;
+	UINT16				u16Raw		= 0;
+	UINT8				u8Value		= 0;
+	UINT32				u32Count	= 0;
+
+	if (!HistoryMgrAppend(u32Time, poSensor->u16AverageValueRaw, poSensor->u8AverageValue))
+	{
+		SoakViolation(SOAK_CHECK_HISTORY, "result %llu not stored, %llu readings held", oSoak.u32Results, HistoryMgrGetCount());
+		return;
+	}
+
+	HistoryReaderInit(&oReader);
+	while (HistoryReaderNext(&oReader, &u32Stamp, &u16Raw, &u8Value))
+	{
+		// Results are at least one reading apart, the wrap-around included.
+		if (u32Count && ((UINT32)(u32Stamp - u32Last) == 0 || (UINT32)(u32Stamp - u32Last) > MAX_VAL_UINT32 / 2))
+		{
+			SoakViolation(SOAK_CHECK_HISTORY, "history out of order: %llu after %llu", u32Stamp, u32Last);
+			return;
+		}
+		u32Last = u32Stamp;
+		++u32Count;
+	}
+
+	if ((u32Count != HistoryMgrGetCount())
+		|| (u32Stamp != u32Time) || (u16Raw != poSensor->u16AverageValueRaw) || (u8Value != poSensor->u8AverageValue))
+	{
+		SoakViolation(SOAK_CHECK_HISTORY, "%llu readings read back, %llu held, last one differs", u32Count, HistoryMgrGetCount());
+	}
+	oSoak.u32HistoryRead = u32Count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SoakValveCheck - Daily volume, once IrrigationMgrTask() ran.
+////////////////////////////////////////////////////////////////////////////////
+static void SoakValveCheck()
+{
+	poIrrigationMgrTy	poIrrigation	= oSoak.poIrrigation;
+	UINT32				u32Slack		= (UINT32)((UINT64)oSoak.u32Step * poIrrigation->u16Flow / 60000) + 1;
+
+	if (poIrrigation->u32VolumeToday > poIrrigation->u32DailyCap + u32Slack)
+	{
+		SoakViolation(SOAK_CHECK_VALVE, "%llu mL given today, cap %llu mL", poIrrigation->u32VolumeToday, poIrrigation->u32DailyCap);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SoakDriftCheck - Probe drift of the published result.
+////////////////////////////////////////////////////////////////////////////////
+static void SoakDriftCheck()
+{
+	if (!oSoak.bCreep || !(oSoak.poSensor->u8FaultCode & SENSORHEALTH_FAULT_DRIFT))
+	{
+		return;
+	}
+
+	// The baseline lags behind the probe: never flagged before it moved enough.
+	if (oSoak.dCreep < SENSORHEALTH_DRIFT_MAX)
+	{
+		SoakViolation(SOAK_CHECK_DRIFT, "drift flagged, probe moved by %llu raw (limit %llu raw)", (UINT64)oSoak.dCreep, SENSORHEALTH_DRIFT_MAX);
+	}
+
+	if (!oSoak.u64DriftFlagged)
+	{
+		oSoak.u64DriftFlagged = oSoak.u64Now;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief 		SoakNetwork - Network stack releasing its buffers. bFinal
+///				releases everything and checks that the pool is full again.
+////////////////////////////////////////////////////////////////////////////////
+static void SoakNetwork(bool bFinal)
+{
+	oBufPoolStatsTy	oStats;
+	UINT8			u8Idx	= 0;
+
+	for (u8Idx = 0; u8Idx < SOAK_INFLIGHT_MAX; ++u8Idx)
+	{
+		if (oSoak.apoInFlight[u8Idx] && (bFinal || (--oSoak.au8InFlightLoops[u8Idx] == 0)))
+		{
+			BufPoolRelease(oSoak.apoInFlight[u8Idx]);
+			oSoak.apoInFlight[u8Idx] = NULL;
+		}
+	}
+
+	if (!bFinal)
+	{
+		return;
+	}
+
+	BufPoolGetStats(&oStats);
+	if (BufPoolInUse() || oStats.u32Misuses)
+	{
+		SoakViolation(SOAK_CHECK_BUFFERS, "%llu buffers still in use, %llu misuses", BufPoolInUse(), oStats.u32Misuses);
+	}
+}
+
+static bool SoakStackTake(poBufTy poBuf)
+{
+	UINT8 u8Idx = 0;
+
+	for (u8Idx = 0; u8Idx < SOAK_INFLIGHT_MAX; ++u8Idx)
+	{
+		if (!oSoak.apoInFlight[u8Idx])
+		{
+			BufPoolRef(poBuf);
+			oSoak.apoInFlight[u8Idx]		= poBuf;
+			oSoak.au8InFlightLoops[u8Idx]	= (UINT8)(1 + SoakRand() % 3);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static bool SoakUdpSend(void* pvMsg)
+{
+	// Full stack: the send fails and CommMgr keeps the report.
+	return oSoak.bLinkUp && SoakStackTake((poBufTy)pvMsg);
+}
+
+static UINT16 SoakAnalogRead(UINT8 u8Pin)
+{
+	(void)u8Pin;
+
+	if (oSoak.bPowered)
+	{
+		++oSoak.u32Samples;
+	}
+
+	return (UINT16)(oSoak.dSoil + oSoak.dCreep + (INT32)(SoakRand() % 5) - 2);
+}
+
+static void SoakDigitalWrite(UINT8 u8Pin, UINT8 u8Level)
+{
+	UINT64 u64Gap = 0;
+
+	if ((u8Pin == SOAK_VALVE_PIN) && (u8Level != oSoak.bValveOpen))
+	{
+		oSoak.bValveOpen = u8Level;
+
+		if (u8Level)
+		{
+			++oSoak.u32Waterings;
+			oSoak.u64ValveOpen = oSoak.u64Now;
+			if (oSoak.bValveClosed && (oSoak.u64Now - oSoak.u64ValveClose < oSoak.poIrrigation->u32MinOff))
+			{
+				SoakViolation(SOAK_CHECK_VALVE, "valve opened %llu ms after closing, minimum off-time %llu ms",
+					oSoak.u64Now - oSoak.u64ValveClose, oSoak.poIrrigation->u32MinOff);
+			}
+		}
+		else
+		{
+			oSoak.u64ValveClose	= oSoak.u64Now;
+			oSoak.bValveClosed	= TRUE;
+			if (oSoak.u64Now - oSoak.u64ValveOpen >= (UINT64)oSoak.poIrrigation->u32MaxOn + oSoak.u32Step)
+			{
+				SoakViolation(SOAK_CHECK_VALVE, "valve open for %llu ms, maximum on-time %llu ms",
+					oSoak.u64Now - oSoak.u64ValveOpen, oSoak.poIrrigation->u32MaxOn);
+			}
+		}
+		return;
+	}
+
+	if ((u8Pin != SOAK_PIN) || (u8Level == oSoak.bPowered))
+	{
+		return;
+	}
+
+	oSoak.bPowered = u8Level;
+
+	// The boot reading switches the probe on and off within a single call.
+	if (!oSoak.bBooted)
+	{
+		oSoak.bBooted = !u8Level;
+		return;
+	}
+
+	if (u8Level)
+	{
+		oSoak.u64ReadingStart	= oSoak.u64Now;
+		oSoak.u32Samples		= 0;
+
+		if (oSoak.bHasReading)
+		{
+			u64Gap = oSoak.u64Now - oSoak.u64ReadingEnd;
+			if ((u64Gap < oSoak.u32Interval) || (u64Gap >= (UINT64)oSoak.u32Interval + oSoak.u32Step))
+			{
+				SoakViolation(SOAK_CHECK_READING_START, "reading started %llu ms after the previous one, interval %llu ms", u64Gap, oSoak.u32Interval);
+			}
+		}
+	}
+	else
+	{
+		oSoak.u64ReadingEnd	= oSoak.u64Now;
+		oSoak.bReadingEnded	= TRUE;
+	}
+}
+
+static void SoakViolation(SoakCheckTy eCheck, const char* pszFormat, unsigned long long ullA, unsigned long long ullB)
+{
+	++oSoak.au32Violations[eCheck];
+
+	if (++oSoak.u32Warnings <= SOAK_WARN_MAX)
+	{
+		printf("day %.3f (system time %lu): ", oSoak.u64Now / (double)SOAK_DAY, (unsigned long)SystemTimeGetTime());
+		printf(pszFormat, ullA, ullB);
+		printf("\n");
+	}
+}
+
+static UINT32 SoakRand()
+{
+	oSoak.u32Seed = oSoak.u32Seed * 1103515245 + 12345;
+	return oSoak.u32Seed >> 8;
+}
+
+static double SoakNow()
+{
+	struct timespec oTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &oTs);
+	return oTs.tv_sec + oTs.tv_nsec / 1e9;
+}
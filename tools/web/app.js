@@ -0,0 +1,68 @@
+// Dashboard of the node. Labels come from /api/labels (active language).
+var L = {};
+var QUALITY = ['good', 'suspect', 'bad'];
+
+function get(url, cb) {
+  var x = new XMLHttpRequest();
+  x.onload = function () { if (x.status == 200) cb(JSON.parse(x.responseText)); };
+  x.open('GET', url);
+  x.send();
+}
+
+function $(id) { return document.getElementById(id); }
+
+function duration(ms) {
+  var s = Math.floor(ms / 1000), d = Math.floor(s / 86400);
+  var h = Math.floor(s / 3600) % 24, m = Math.floor(s / 60) % 60;
+  return (d ? d + 'd ' : '') + h + 'h ' + m + 'm';
+}
+
+function labels(l) {
+  L = l;
+  document.documentElement.lang = l.lang;
+  document.title = l.title;
+  var e = document.querySelectorAll('[data-label]');
+  for (var i = 0; i < e.length; i++) {
+    var k = e[i].getAttribute('data-label');
+    if (l[k]) e[i].textContent = l[k];
+  }
+}
+
+function status(s) {
+  $('avg').textContent = s.avg;
+  $('min').textContent = s.min + ' %';
+  $('max').textContent = s.max + ' %';
+  $('raw').textContent = s.raw;
+  var q = QUALITY[s.quality] || 'bad';
+  $('quality').textContent = L[q] || q;
+  $('quality').className = q;
+  $('faults').textContent = '0x' + s.faults.toString(16);
+  $('uptime').textContent = duration(s.now);
+}
+
+// Readings are [time_ms, raw, pct], oldest first.
+function chart(h) {
+  var c = $('chart'), g = c.getContext('2d'), r = h.readings;
+  g.clearRect(0, 0, c.width, c.height);
+  if (r.length < 2) return;
+  var t0 = r[0][0], span = Math.max(h.now - t0, 1);
+  g.strokeStyle = '#36c';
+  g.beginPath();
+  for (var i = 0; i < r.length; i++) {
+    var x = (r[i][0] - t0) * c.width / span;
+    var y = c.height - r[i][2] * c.height / 100;
+    i ? g.lineTo(x, y) : g.moveTo(x, y);
+  }
+  g.stroke();
+}
+
+// One request at a time: the node serves few connections.
+function refresh() {
+  get('/api/status', function (s) {
+    status(s);
+    get('/api/history?format=json', chart);
+  });
+}
+
+get('/api/labels', function (l) { labels(l); refresh(); });
+setInterval(refresh, 30000);
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+##
+## \file     gen_assets.py
+## \brief    Generates WebAssets.c from the dashboard sources
+## \details  Compresses each file of tools/web with gzip (level 9, no time
+##           stamp, so the output only changes with the sources) and writes
+##           it as a PROGMEM array, with the lookup table, in WebAssets.c at
+##           the root of the sketch. WebMgr sends the arrays unchanged.
+##
+##           Run it after editing a source:  python3 tools/web/gen_assets.py
+## \author   Infinition - Nicolas Bourré
+##
+
+import gzip
+import os
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+OUTPUT = os.path.join(HERE, '..', '..', 'WebAssets.c')
+
+# Request path, source file, Content-Type.
+ASSETS = [
+    ('/', 'index.html', 'text/html; charset=utf-8'),
+    ('/app.js', 'app.js', 'application/javascript'),
+    ('/style.css', 'style.css', 'text/css'),
+]
+
+HEADER = '''///
+/// \\file     WebAssets.c
+/// \\brief    Static files of the web dashboard
+/// \\details  GENERATED by tools/web/gen_assets.py, do not edit.
+/// \\author   Infinition - Nicolas Bourré
+///
+
+////////////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////////////
+#include "WebAssets.h"
+#include "MemStats.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Local variables
+////////////////////////////////////////////////////////////////////////////////
+'''
+
+FOOTER = '''
+
+////////////////////////////////////////////////////////////////////////////////
+/// \\brief 		WebAssetsFind - Looks up a static file.
+/// \\public
+///
+/// \\param[in]	pszPath		Request path, not necessarily terminated.
+/// \\param[in]	u8PathLen	Length of the path.
+///
+/// \\return		The file, NULL if none.
+////////////////////////////////////////////////////////////////////////////////
+const oWebAssetTy* WebAssetsFind(const char* pszPath, UINT8 u8PathLen)
+{
+	UINT8 u8Asset = 0;
+
+	for (u8Asset = 0; u8Asset < sizeof(aoWebAssets) / sizeof(aoWebAssets[0]); ++u8Asset)
+	{
+		if ((strlen(aoWebAssets[u8Asset].pszPath) == u8PathLen) && !strncmp(aoWebAssets[u8Asset].pszPath, pszPath, u8PathLen))
+		{
+			return &aoWebAssets[u8Asset];
+		}
+	}
+
+	return NULL;
+}
+'''
+
+
+def c_array(name, data):
+    lines = ['static const UINT8 %s[%d] PROGMEM = {' % (name, len(data))]
+    for i in range(0, len(data), 16):
+        lines.append('\t' + ', '.join('0x%02X' % b for b in data[i:i + 16]) + ',')
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def main():
+    arrays = []
+    table = []
+    total = 0
+
+    for path, source, content_type in ASSETS:
+        with open(os.path.join(HERE, source), 'rb') as f:
+            raw = f.read()
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        name = 'au8WebAsset_' + source.replace('.', '_')
+
+        arrays.append('// %s: %d bytes, %d compressed.\n%s' % (source, len(raw), len(data), c_array(name, data)))
+        table.append('\t{"%s", "%s", %s, sizeof(%s)},' % (path, content_type, name, name))
+        total += len(data)
+        print('%-12s %6d -> %6d bytes' % (source, len(raw), len(data)))
+
+    with open(OUTPUT, 'w', newline='\n') as f:
+        f.write(HEADER)
+        f.write('\n\n'.join(arrays))
+        f.write('\n\nstatic const oWebAssetTy aoWebAssets[] = {\n%s\n};\n' % '\n'.join(table))
+        f.write('\n// In flash, only the table is in RAM.\nMEMSTATS_REGISTER(WebAssets, sizeof(aoWebAssets))\n')
+        f.write(FOOTER)
+
+    print('total        %6d bytes in flash' % total)
+
+
+if __name__ == '__main__':
+    main()